@@ -6,6 +6,75 @@ contains(CONFIG, "noupcasename") {
     TARGET = jamulus
 }
 
+# build the synthetic client load generator for server capacity tests instead
+# of the application (qmake "CONFIG+=loadgen")
+contains(CONFIG, "loadgen") {
+    message(Building the synthetic client load generator.)
+    TARGET = jamulus-loadgen
+    CONFIG += headless nosound
+    DEFINES += LOADGEN
+    HEADERS += src/loadgen.h
+    SOURCES += src/loadgen.cpp
+}
+
+# build the microbenchmarks of the hot paths instead of the application
+# (qmake "CONFIG+=bench")
+contains(CONFIG, "bench") {
+    message(Building the microbenchmarks.)
+    TARGET = jamulus-bench
+    CONFIG += headless nosound
+    DEFINES += BENCH
+    HEADERS += src/bench.h
+    SOURCES += src/bench.cpp
+}
+
+# build the offline jitter buffer evaluation instead of the application
+# (qmake "CONFIG+=jbeval")
+contains(CONFIG, "jbeval") {
+    message(Building the offline jitter buffer evaluation.)
+    TARGET = jamulus-jbeval
+    CONFIG += headless nosound
+    DEFINES += JBEVAL
+    HEADERS += src/jbeval.h
+    SOURCES += src/jbeval.cpp
+}
+
+# build the offline decoder of the coded recordings instead of the application
+# (qmake "CONFIG+=recdecode")
+contains(CONFIG, "recdecode") {
+    message(Building the offline decoder of the coded recordings.)
+    TARGET = jamulus-recdecode
+    CONFIG += headless nosound
+    DEFINES += RECDECODE
+    HEADERS += src/recdecode.h
+    SOURCES += src/recdecode.cpp
+}
+
+# build the offline mixdown of recorded sessions instead of the application
+# (qmake "CONFIG+=mixdown")
+contains(CONFIG, "mixdown") {
+    message(Building the offline mixdown of the recorded sessions.)
+    TARGET = jamulus-mixdown
+    CONFIG += headless nosound
+    DEFINES += MIXDOWN
+    HEADERS += src/mixdown.h
+    SOURCES += src/mixdown.cpp
+}
+
+# build the self tests instead of the application (qmake "CONFIG+=selftest")
+contains(CONFIG, "selftest") {
+    message(Building the self tests.)
+    TARGET = jamulus-selftest
+    CONFIG += headless nosound
+    DEFINES += SELFTEST
+    HEADERS += src/selftest.h
+    SOURCES += src/selftest.cpp
+
+    # the decoder of the coded recordings is tested
+    HEADERS += src/recdecode.h
+    SOURCES += src/recdecode.cpp
+}
+
 # allow detailed version info for intermediate builds (#475)
 contains(VERSION, .*dev.*) {
     exists(".git/config"){
@@ -402,8 +471,13 @@ HEADERS += src/buffer.h \
     src/channel.h \
     src/client.h \
     src/global.h \
+    src/packettrace.h \
+    src/netemulator.h \
+    src/metrics.h \
+    src/audioprofiler.h \
     src/protocol.h \
     src/recorder/jamcontroller.h \
+    src/recorder/recorderring.h \
     src/server.h \
     src/serverlist.h \
     src/serverlogging.h \
@@ -415,6 +489,8 @@ HEADERS += src/buffer.h \
     src/recorder/jamrecorder.h \
     src/recorder/creaperproject.h \
     src/recorder/cwavestream.h \
+    src/recorder/cwavewriter.h \
+    src/recorder/cpacketstream.h \
     src/signalhandler.h \
     src/startup.h
 
@@ -505,8 +581,13 @@ SOURCES += src/buffer.cpp \
     src/channel.cpp \
     src/client.cpp \
     src/main.cpp \
+    src/packettrace.cpp \
+    src/netemulator.cpp \
+    src/metrics.cpp \
+    src/audioprofiler.cpp \
     src/protocol.cpp \
     src/recorder/jamcontroller.cpp \
+    src/recorder/recorderring.cpp \
     src/server.cpp \
     src/serverlist.cpp \
     src/serverlogging.cpp \
@@ -517,7 +598,9 @@ SOURCES += src/buffer.cpp \
     src/util.cpp \
     src/recorder/jamrecorder.cpp \
     src/recorder/creaperproject.cpp \
-    src/recorder/cwavestream.cpp
+    src/recorder/cwavestream.cpp \
+    src/recorder/cwavewriter.cpp \
+    src/recorder/cpacketstream.cpp
 
 SOURCES_GUI = src/audiomixerboard.cpp \
     src/chatdlg.cpp \
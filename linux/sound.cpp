@@ -28,6 +28,9 @@
 \******************************************************************************/
 
 #include "sound.h"
+#ifndef WITH_SOUND
+# include <QtEndian>
+#endif
 
 #ifdef WITH_SOUND
 void CSound::OpenJack ( const bool  bNoAutoJackConnect,
@@ -172,7 +175,9 @@ void CSound::OpenJack ( const bool  bNoAutoJackConnect,
 
         // compute latency by using the first input and first output
         // ports and using the most optimistic values
-        fInOutLatencyMs = static_cast<float> ( inLatency + outLatency ) * 1000 / SYSTEM_SAMPLE_RATE_HZ;
+        fInLatencyMs    = static_cast<float> ( inLatency ) * 1000 / SYSTEM_SAMPLE_RATE_HZ;
+        fOutLatencyMs   = static_cast<float> ( outLatency ) * 1000 / SYSTEM_SAMPLE_RATE_HZ;
+        fInOutLatencyMs = fInLatencyMs + fOutLatencyMs;
     }
 }
 
@@ -232,6 +237,7 @@ int CSound::Init ( const int /* iNewPrefMonoBufferSize */ )
 
     // create memory for intermediate audio buffer
     vecsTmpAudioSndCrdStereo.Init ( iJACKBufferSizeStero );
+    vecfTmpAudioSndCrdStereo.Init ( iJACKBufferSizeStero );
 
     return iJACKBufferSizeMono;
 }
@@ -257,19 +263,6 @@ int CSound::process ( jack_nframes_t nframes, void* arg )
             (jack_default_audio_sample_t*) jack_port_get_buffer (
             pSound->input_port_right, nframes );
 
-        // copy input audio data
-        if ( ( in_left != nullptr ) && ( in_right != nullptr ) )
-        {
-            for ( i = 0; i < pSound->iJACKBufferSizeMono; i++ )
-            {
-                pSound->vecsTmpAudioSndCrdStereo[2 * i]     = Float2Short ( in_left[i] * _MAXSHORT );
-                pSound->vecsTmpAudioSndCrdStereo[2 * i + 1] = Float2Short ( in_right[i] * _MAXSHORT );
-            }
-        }
-
-        // call processing callback function
-        pSound->ProcessCallback ( pSound->vecsTmpAudioSndCrdStereo );
-
         // get output data pointer
         jack_default_audio_sample_t* out_left =
             (jack_default_audio_sample_t*) jack_port_get_buffer (
@@ -279,16 +272,56 @@ int CSound::process ( jack_nframes_t nframes, void* arg )
             (jack_default_audio_sample_t*) jack_port_get_buffer (
             pSound->output_port_right, nframes );
 
-        // copy output data
-        if ( ( out_left != nullptr ) && ( out_right != nullptr ) )
+        if ( pSound->HasFloatProcessCallback() )
+        {
+            // float processing: the JACK samples are only interleaved, there
+            // is no conversion to int16 and no clipping
+            if ( ( in_left != nullptr ) && ( in_right != nullptr ) )
+            {
+                for ( i = 0; i < pSound->iJACKBufferSizeMono; i++ )
+                {
+                    pSound->vecfTmpAudioSndCrdStereo[2 * i]     = in_left[i];
+                    pSound->vecfTmpAudioSndCrdStereo[2 * i + 1] = in_right[i];
+                }
+            }
+
+            pSound->ProcessCallbackFloat ( pSound->vecfTmpAudioSndCrdStereo );
+
+            if ( ( out_left != nullptr ) && ( out_right != nullptr ) )
+            {
+                for ( i = 0; i < pSound->iJACKBufferSizeMono; i++ )
+                {
+                    out_left[i]  = pSound->vecfTmpAudioSndCrdStereo[2 * i];
+                    out_right[i] = pSound->vecfTmpAudioSndCrdStereo[2 * i + 1];
+                }
+            }
+        }
+        else
         {
-            for ( i = 0; i < pSound->iJACKBufferSizeMono; i++ )
+            // copy input audio data
+            if ( ( in_left != nullptr ) && ( in_right != nullptr ) )
             {
-                out_left[i] = (jack_default_audio_sample_t)
-                    pSound->vecsTmpAudioSndCrdStereo[2 * i] / _MAXSHORT;
+                for ( i = 0; i < pSound->iJACKBufferSizeMono; i++ )
+                {
+                    pSound->vecsTmpAudioSndCrdStereo[2 * i]     = Float2Short ( in_left[i] * _MAXSHORT );
+                    pSound->vecsTmpAudioSndCrdStereo[2 * i + 1] = Float2Short ( in_right[i] * _MAXSHORT );
+                }
+            }
+
+            // call processing callback function
+            pSound->ProcessCallback ( pSound->vecsTmpAudioSndCrdStereo );
+
+            // copy output data
+            if ( ( out_left != nullptr ) && ( out_right != nullptr ) )
+            {
+                for ( i = 0; i < pSound->iJACKBufferSizeMono; i++ )
+                {
+                    out_left[i] = (jack_default_audio_sample_t)
+                        pSound->vecsTmpAudioSndCrdStereo[2 * i] / _MAXSHORT;
 
-                out_right[i] = (jack_default_audio_sample_t)
-                    pSound->vecsTmpAudioSndCrdStereo[2 * i + 1] / _MAXSHORT;
+                    out_right[i] = (jack_default_audio_sample_t)
+                        pSound->vecsTmpAudioSndCrdStereo[2 * i + 1] / _MAXSHORT;
+                }
             }
         }
     }
@@ -363,4 +396,257 @@ void CSound::shutdownCallback ( void* arg )
     pSound->bJackWasShutDown = true;
     pSound->EmitReinitRequestSignal ( RS_ONLY_RESTART_AND_INIT );
 }
+#else
+void CSound::SetSoundFiles ( const QString& strInFileName,
+                             const QString& strOutFileName,
+                             const bool     bNVirtualClock )
+{
+    CloseFiles();
+
+    bVirtualClock = bNVirtualClock;
+    bEndOfInput   = false;
+    iNumSamples   = 0;
+
+    if ( !strInFileName.isEmpty() )
+    {
+        OpenInputFile ( strInFileName );
+    }
+
+    if ( !strOutFileName.isEmpty() )
+    {
+        FileOut.setFileName ( strOutFileName );
+
+        if ( !FileOut.open ( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        {
+            throw CGenErr ( QString ( "The sound output file %1 cannot be opened." ).arg ( strOutFileName ) );
+        }
+
+        pOutStream = new recorder::CWaveStream ( &FileOut, 2 );
+    }
+}
+
+void CSound::Start()
+{
+    CSoundBase::Start();
+
+    ElapsedTime.start();
+
+    // with the virtual clock the blocks are processed in the sound thread
+    // instead of the timer
+    if ( bVirtualClock )
+    {
+        QThread::start ( QThread::TimeCriticalPriority );
+    }
+}
+
+void CSound::Stop()
+{
+    CSoundBase::Stop();
+
+    if ( bVirtualClock )
+    {
+        wait();
+    }
+
+    // update the header so that the output file is valid even if the
+    // application is not terminated regularly
+    if ( pOutStream != nullptr )
+    {
+        pOutStream->finalise();
+        FileOut.flush();
+    }
+}
+
+void CSound::run()
+{
+    while ( IsRunning() && !bEndOfInput )
+    {
+        if ( !ProcessBlock() )
+        {
+            EndOfInput();
+        }
+    }
+}
+
+bool CSound::ProcessBlock()
+{
+    if ( FileIn.isOpen() )
+    {
+        if ( !ReadInputFile() )
+        {
+            return false;
+        }
+    }
+    else if ( TestSignal.IsEnabled() )
+    {
+        TestSignal.GetInput ( vecsTemp );
+    }
+    else
+    {
+        vecsTemp.Reset ( 0 );
+    }
+
+    ProcessCallback ( vecsTemp );
+
+    if ( TestSignal.IsEnabled() )
+    {
+        TestSignal.AnalyzeOutput ( vecsTemp );
+    }
+
+    if ( pOutStream != nullptr )
+    {
+        WriteOutputFile();
+    }
+
+    iNumSamples += vecsTemp.Size() / 2;
+
+    return true;
+}
+
+void CSound::OpenInputFile ( const QString& strFileName )
+{
+    FileIn.setFileName ( strFileName );
+
+    if ( !FileIn.open ( QIODevice::ReadOnly ) )
+    {
+        throw CGenErr ( QString ( "The sound input file %1 cannot be opened." ).arg ( strFileName ) );
+    }
+
+    QDataStream InStream ( &FileIn );
+    InStream.setByteOrder ( QDataStream::LittleEndian );
+
+    quint32 iChunkId;
+    quint32 iChunkSize;
+    quint32 iFormat;
+
+    InStream >> iChunkId >> iChunkSize >> iFormat;
+
+    if ( ( iChunkId != recorder::HdrRiff::chunkId ) || ( iFormat != recorder::HdrRiff::format ) )
+    {
+        throw CGenErr ( QString ( "The sound input file %1 is not a WAV file." ).arg ( strFileName ) );
+    }
+
+    iInNumChannels = 0;
+
+    // search the format and the data chunk (chunks are padded to even sizes)
+    while ( !InStream.atEnd() )
+    {
+        InStream >> iChunkId >> iChunkSize;
+
+        if ( iChunkId == recorder::FmtSubChunk::chunkId )
+        {
+            quint16 iAudioFormat;
+            quint16 iNumChannels;
+            quint32 iSampleRate;
+            quint32 iByteRate;
+            quint16 iBlockAlign;
+            quint16 iBitsPerSample;
+
+            InStream >> iAudioFormat >> iNumChannels >> iSampleRate >> iByteRate >> iBlockAlign >> iBitsPerSample;
+            InStream.skipRawData ( iChunkSize + ( iChunkSize & 1 ) - recorder::FmtSubChunk::chunkSize );
+
+            if ( ( iAudioFormat != recorder::FmtSubChunk::audioFormat ) ||
+                 ( iSampleRate != SYSTEM_SAMPLE_RATE_HZ ) ||
+                 ( iBitsPerSample != recorder::FmtSubChunk::bitsPerSample ) ||
+                 ( ( iNumChannels != 1 ) && ( iNumChannels != 2 ) ) )
+            {
+                throw CGenErr ( QString ( "The sound input file %1 must be a 16 bit PCM mono or stereo file "
+                                          "with a sample rate of %2 Hz." ).arg ( strFileName ).arg ( SYSTEM_SAMPLE_RATE_HZ ) );
+            }
+
+            iInNumChannels = iNumChannels;
+        }
+        else if ( ( iChunkId == recorder::DataSubChunkHdr::chunkId ) && ( iInNumChannels > 0 ) )
+        {
+            // the data size is not set if the file was not finalised
+            iInNumBytesLeft = std::min ( static_cast<qint64> ( iChunkSize ), FileIn.size() - FileIn.pos() );
+            return;
+        }
+        else
+        {
+            InStream.skipRawData ( iChunkSize + ( iChunkSize & 1 ) );
+        }
+    }
+
+    throw CGenErr ( QString ( "The sound input file %1 has no audio data." ).arg ( strFileName ) );
+}
+
+bool CSound::ReadInputFile()
+{
+    const int    iNumFrames = vecsTemp.Size() / 2;
+    const qint64 iNumBytes  = std::min ( static_cast<qint64> ( iNumFrames * iInNumChannels * 2 ), iInNumBytesLeft );
+
+    if ( iNumBytes <= 0 )
+    {
+        return false;
+    }
+
+    vecbyInBuf       = FileIn.read ( iNumBytes );
+    iInNumBytesLeft -= vecbyInBuf.size();
+
+    const int    iNumFramesRead = vecbyInBuf.size() / ( iInNumChannels * 2 );
+    const uchar* pbyData        = reinterpret_cast<const uchar*> ( vecbyInBuf.constData() );
+
+    // mono files are copied on both channels, the last block is padded with
+    // zeros
+    for ( int i = 0; i < iNumFrames; i++ )
+    {
+        if ( i < iNumFramesRead )
+        {
+            const int iIdx = i * iInNumChannels * 2;
+
+            vecsTemp[2 * i]     = qFromLittleEndian<qint16> ( pbyData + iIdx );
+            vecsTemp[2 * i + 1] = qFromLittleEndian<qint16> ( pbyData + iIdx + 2 * ( iInNumChannels - 1 ) );
+        }
+        else
+        {
+            vecsTemp[2 * i]     = 0;
+            vecsTemp[2 * i + 1] = 0;
+        }
+    }
+
+    return iNumFramesRead > 0;
+}
+
+void CSound::WriteOutputFile()
+{
+    vecbyOutBuf.resize ( vecsTemp.Size() * 2 );
+
+    uchar* pbyData = reinterpret_cast<uchar*> ( vecbyOutBuf.data() );
+
+    for ( int i = 0; i < vecsTemp.Size(); i++ )
+    {
+        qToLittleEndian<qint16> ( vecsTemp[i], pbyData + 2 * i );
+    }
+
+    pOutStream->writeRawData ( vecbyOutBuf.constData(), vecbyOutBuf.size() );
+}
+
+void CSound::EndOfInput()
+{
+    bEndOfInput = true;
+
+    qInfo() << qUtf8Printable ( QString ( "- end of sound input file: %1 s of audio processed in %2 s" )
+        .arg ( static_cast<double> ( iNumSamples ) / SYSTEM_SAMPLE_RATE_HZ, 0, 'f', 2 )
+        .arg ( static_cast<double> ( ElapsedTime.elapsed() ) / 1000, 0, 'f', 2 ) );
+
+    // the application is terminated regularly so that the output file is
+    // finalised (this may be called from the sound thread)
+    QMetaObject::invokeMethod ( QCoreApplication::instance(), "quit", Qt::QueuedConnection );
+}
+
+void CSound::CloseFiles()
+{
+    if ( pOutStream != nullptr )
+    {
+        pOutStream->finalise();
+        delete pOutStream;
+        pOutStream = nullptr;
+    }
+
+    FileOut.close();
+    FileIn.close();
+
+    iInNumBytesLeft = 0;
+}
 #endif // WITH_SOUND
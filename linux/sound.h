@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <QThread>
 #include <string.h>
+#include <atomic>
 #include "util.h"
 #include "soundbase.h"
 #include "global.h"
@@ -68,7 +69,8 @@ public:
              const bool     bNoAutoJackConnect,
              const QString& strJackClientName ) :
         CSoundBase ( "Jack", fpNewProcessCallback, arg, strMIDISetup ),
-        iJACKBufferSizeMono ( 0 ), bJackWasShutDown ( false ), fInOutLatencyMs ( 0.0f )
+        iJACKBufferSizeMono ( 0 ), bJackWasShutDown ( false ),
+        fInOutLatencyMs ( 0.0f ), fInLatencyMs ( 0.0f ), fOutLatencyMs ( 0.0f )
     {
         QString strJackName = QString ( APP_NAME );
 
@@ -87,10 +89,13 @@ public:
     virtual void Stop();
 
     virtual float GetInOutLatencyMs() { return fInOutLatencyMs; }
+    virtual float GetInLatencyMs()    { return fInLatencyMs; }
+    virtual float GetOutLatencyMs()   { return fOutLatencyMs; }
 
     // these variables should be protected but cannot since we want
     // to access them from the callback function
     CVector<short> vecsTmpAudioSndCrdStereo;
+    CVector<float> vecfTmpAudioSndCrdStereo;
     int            iJACKBufferSizeMono;
     int            iJACKBufferSizeStero;
     bool           bJackWasShutDown;
@@ -114,10 +119,18 @@ protected:
     jack_client_t* pJackClient;
 
     float fInOutLatencyMs;
+    float fInLatencyMs;
+    float fOutLatencyMs;
 };
 #else
-// no sound -> dummy class definition
+// no sound -> dummy class definition, the input can be read from a WAV file
+// and the output can be written to a WAV file (48 kHz, 16 bit), with the
+// virtual clock the audio callbacks are not paced by the timer but run as fast
+// as possible in the sound thread
+#include <QFile>
+#include <QElapsedTimer>
 #include "server.h"
+#include "recorder/cwavestream.h"
 class CSound : public CSoundBase
 {
     Q_OBJECT
@@ -129,17 +142,57 @@ public:
              const bool     ,
              const QString& ) :
         CSoundBase ( "nosound", fpNewProcessCallback, pParg, strMIDISetup ),
-        HighPrecisionTimer ( true ) { HighPrecisionTimer.Start();
-                                      QObject::connect ( &HighPrecisionTimer, &CHighPrecisionTimer::timeout,
-                                                         this, &CSound::OnTimer ); }
-    virtual ~CSound() {}
+        HighPrecisionTimer ( true ),
+        bVirtualClock      ( false ),
+        bEndOfInput        ( false ),
+        iInNumChannels     ( 0 ),
+        iInNumBytesLeft    ( 0 ),
+        iNumSamples        ( 0 ),
+        pOutStream         ( nullptr ) { HighPrecisionTimer.Start();
+                                         QObject::connect ( &HighPrecisionTimer, &CHighPrecisionTimer::timeout,
+                                                            this, &CSound::OnTimer ); }
+    virtual ~CSound() { CloseFiles(); }
     virtual int Init ( const int iNewPrefMonoBufferSize ) { CSoundBase::Init ( iNewPrefMonoBufferSize );
                                                             vecsTemp.Init ( 2 * iNewPrefMonoBufferSize );
                                                             return iNewPrefMonoBufferSize; }
-    CHighPrecisionTimer HighPrecisionTimer;
-    CVector<short>      vecsTemp;
+    virtual void Start();
+    virtual void Stop();
+
+    virtual void SetTestSignal ( const int iFreqHz, const QList<int>& veciPeerFreqHz )
+                                                         { TestSignal.Init ( iFreqHz, veciPeerFreqHz ); }
+    virtual QString GetTestSignalReport() { return TestSignal.IsEnabled() ? TestSignal.ToString() : ""; }
+
+    virtual void SetSoundFiles ( const QString& strInFileName,
+                                 const QString& strOutFileName,
+                                 const bool     bNVirtualClock );
+
+protected:
+    virtual void run();
+
+    bool ProcessBlock();
+    void OpenInputFile ( const QString& strFileName );
+    bool ReadInputFile();
+    void WriteOutputFile();
+    void EndOfInput();
+    void CloseFiles();
+
+    CHighPrecisionTimer    HighPrecisionTimer;
+    CVector<short>         vecsTemp;
+    CTestSignal            TestSignal;
+
+    bool                   bVirtualClock;
+    std::atomic<bool>      bEndOfInput; // set in the sound thread with the virtual clock
+    QFile                  FileIn;
+    int                    iInNumChannels;
+    qint64                 iInNumBytesLeft;
+    QByteArray             vecbyInBuf;
+    QFile                  FileOut;
+    recorder::CWaveStream* pOutStream;
+    QByteArray             vecbyOutBuf;
+    qint64                 iNumSamples; // virtual clock in samples
+    QElapsedTimer          ElapsedTime;
 
 public slots:
-    void OnTimer() { vecsTemp.Reset ( 0 ); if ( IsRunning() ) { ProcessCallback ( vecsTemp ); } }
+    void OnTimer() { if ( IsRunning() && !bVirtualClock && !bEndOfInput && !ProcessBlock() ) { EndOfInput(); } }
 };
 #endif // WITH_SOUND
@@ -67,11 +67,30 @@ CAnalyzerConsole::CAnalyzerConsole ( CClient* pNCliP,
     pMainTabWidget->addTab ( pTabWidgetBufErrRate,
                              tr ( "Error Rate of Each Buffer Size" ) );
 
+    // audio callback profile tab
+    pTabWidgetProfile = new QWidget();
+    QVBoxLayout* pTabProfileLayout = new QVBoxLayout ( pTabWidgetProfile );
+
+    pLabelProfile = new QLabel ( this );
+    pLabelProfile->setFont ( QFontDatabase::systemFont ( QFontDatabase::FixedFont ) );
+    pLabelProfile->setAlignment ( Qt::AlignLeft | Qt::AlignTop );
+    pTabProfileLayout->addWidget ( pLabelProfile );
+
+    pButtonResetProfile = new QPushButton ( tr ( "Reset" ), this );
+    pTabProfileLayout->addWidget ( pButtonResetProfile );
+
+    pMainTabWidget->addTab ( pTabWidgetProfile,
+                             tr ( "Audio Callback Profile" ) );
+
 
     // Connections -------------------------------------------------------------
     // timers
     QObject::connect ( &TimerErrRateUpdate, &QTimer::timeout,
         this, &CAnalyzerConsole::OnTimerErrRateUpdate );
+
+    // buttons
+    QObject::connect ( pButtonResetProfile, &QPushButton::clicked,
+        this, &CAnalyzerConsole::OnResetProfileClicked );
 }
 
 void CAnalyzerConsole::showEvent ( QShowEvent* )
@@ -94,6 +113,9 @@ void CAnalyzerConsole::OnTimerErrRateUpdate()
 
     // set new image to the label
     pGraphErrRate->setPixmap ( QPixmap().fromImage ( GraphImage ) );
+
+    // update the audio callback profile
+    pLabelProfile->setText ( pClient->GetAudioProfiler().ToString() );
 }
 
 void CAnalyzerConsole::DrawFrame()
@@ -27,6 +27,8 @@
 #include <QDialog>
 #include <QTabWidget>
 #include <QLabel>
+#include <QPushButton>
+#include <QFontDatabase>
 #include <QVBoxLayout>
 #include <QImage>
 #include <QPainter>
@@ -85,7 +87,12 @@ protected:
 
     QTimer      TimerErrRateUpdate;
 
+    QWidget*     pTabWidgetProfile;
+    QLabel*      pLabelProfile;
+    QPushButton* pButtonResetProfile;
+
 
 public slots:
     void OnTimerErrRateUpdate();
+    void OnResetProfileClicked() { pClient->ResetAudioProfiler(); }
 };
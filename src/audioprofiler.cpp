@@ -0,0 +1,277 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include "audioprofiler.h"
+
+
+/* Implementation *************************************************************/
+// the statistics are only written by the audio thread, therefore a relaxed
+// load and store is sufficient (no read-modify-write on the bus)
+static inline void AddRelaxed ( std::atomic<qint64>& Value, const qint64 iInc )
+{
+    Value.store ( Value.load ( std::memory_order_relaxed ) + iInc, std::memory_order_relaxed );
+}
+
+void CAudioProfiler::CStage::Reset()
+{
+    for ( int i = 0; i < PROFILER_NUM_BUCKETS; i++ )
+    {
+        Buckets[i].store ( 0, std::memory_order_relaxed );
+    }
+
+    iCount.store            ( 0, std::memory_order_relaxed );
+    iSumNs.store            ( 0, std::memory_order_relaxed );
+    iWorstNs.store          ( 0, std::memory_order_relaxed );
+    iNumXrunsDominant.store ( 0, std::memory_order_relaxed );
+    iXrunSumNs.store        ( 0, std::memory_order_relaxed );
+    iNumXruns.store         ( 0, std::memory_order_relaxed );
+}
+
+void CAudioProfiler::CStage::Add ( const qint64 iDurationNs )
+{
+    int iBucket = 0;
+
+    while ( ( iBucket < PROFILER_NUM_BUCKETS - 1 ) &&
+            ( iDurationNs >= ( static_cast<qint64> ( 1 ) << ( PROFILER_FIRST_BUCKET_EXP + iBucket ) ) ) )
+    {
+        iBucket++;
+    }
+
+    AddRelaxed ( Buckets[iBucket], 1 );
+    AddRelaxed ( iCount, 1 );
+    AddRelaxed ( iSumNs, iDurationNs );
+
+    if ( iDurationNs > iWorstNs.load ( std::memory_order_relaxed ) )
+    {
+        iWorstNs.store ( iDurationNs, std::memory_order_relaxed );
+    }
+}
+
+void CAudioProfiler::CStage::AddToTotals ( const qint64 iDurationNs )
+{
+    const qint64 iCurSmoothedNs = iSmoothedNs.load ( std::memory_order_relaxed );
+
+    iSmoothedNs.store ( iCurSmoothedNs + ( iDurationNs - iCurSmoothedNs ) / PROFILER_SMOOTHING_NUM_CALLBACKS,
+                        std::memory_order_relaxed );
+
+    AddRelaxed ( iTotalNs, iDurationNs );
+}
+
+CAudioProfiler::CAudioProfiler() :
+    bResetRequested  ( false ),
+    iNumCurStages    ( 0 ),
+    iNumUsedStages   ( PS_CALLBACK + 1 ),
+    iCallbackStartNs ( 0 ),
+    iLastMarkNs      ( 0 )
+{
+    for ( int i = 0; i < PROFILER_MAX_STAGES_PER_CALLBACK; i++ )
+    {
+        vecCurStageNs[i] = -1;
+    }
+
+#if !defined ( Q_OS_LINUX ) && !defined ( Q_OS_MACX )
+    ElapsedTimer.start();
+#endif
+}
+
+void CAudioProfiler::DoReset()
+{
+    for ( int i = 0; i < PROFILER_MAX_STAGES_PER_CALLBACK; i++ )
+    {
+        vecStages[i].Reset();
+    }
+}
+
+void CAudioProfiler::BeginCallback()
+{
+    if ( bResetRequested.exchange ( false, std::memory_order_relaxed ) )
+    {
+        DoReset();
+    }
+
+    iCallbackStartNs = GetTimeNs();
+    iLastMarkNs      = iCallbackStartNs;
+}
+
+void CAudioProfiler::EndCallback ( const qint64 iDeadlineNs )
+{
+    const qint64 iCallbackNs = GetTimeNs() - iCallbackStartNs;
+    const bool   bIsXrun     = ( iCallbackNs > iDeadlineNs );
+    int          iDominant   = INVALID_INDEX;
+
+    vecStages[PS_CALLBACK].Add ( iCallbackNs );
+    CallbackDurationHist.Add ( iCallbackNs / 1000 );
+
+    for ( int i = 0; i < iNumCurStages; i++ )
+    {
+        const int    iStage   = veciCurStages[i];
+        const qint64 iStageNs = vecCurStageNs[iStage];
+
+        vecStages[iStage].Add ( iStageNs );
+
+        if ( bIsXrun )
+        {
+            AddRelaxed ( vecStages[iStage].iNumXruns, 1 );
+            AddRelaxed ( vecStages[iStage].iXrunSumNs, iStageNs );
+
+            if ( ( iDominant == INVALID_INDEX ) || ( iStageNs > vecCurStageNs[iDominant] ) )
+            {
+                iDominant = iStage;
+            }
+        }
+    }
+
+    if ( bIsXrun )
+    {
+        AddRelaxed ( vecStages[PS_CALLBACK].iNumXruns, 1 );
+        AddRelaxed ( vecStages[PS_CALLBACK].iXrunSumNs, iCallbackNs );
+
+        if ( iDominant != INVALID_INDEX )
+        {
+            AddRelaxed ( vecStages[iDominant].iNumXrunsDominant, 1 );
+        }
+
+        NumXrunsTotal.Add();
+    }
+
+    // the smoothed durations are per callback, i.e. a stage which was not
+    // measured in this callback counts with zero
+    vecStages[PS_CALLBACK].AddToTotals ( iCallbackNs );
+
+    for ( int iStage = PS_CALLBACK + 1; iStage < iNumUsedStages; iStage++ )
+    {
+        vecStages[iStage].AddToTotals ( std::max ( vecCurStageNs[iStage], static_cast<qint64> ( 0 ) ) );
+    }
+
+    // prepare the next callback
+    for ( int i = 0; i < iNumCurStages; i++ )
+    {
+        vecCurStageNs[veciCurStages[i]] = -1;
+    }
+
+    iNumCurStages = 0;
+}
+
+QString CAudioProfiler::GetStageName ( const int iStage )
+{
+    switch ( iStage )
+    {
+    case PS_CALLBACK:      return "callback";
+    case PS_LEVEL_METER:   return "level meter";
+    case PS_REVERB:        return "reverb";
+    case PS_PAN:           return "pan";
+    case PS_ENCODE:        return "encode";
+    case PS_SEND:          return "send";
+    case PS_SERVER_DECODE: return "server decode";
+    case PS_MIX:           return "mix";
+    case PS_RECORDER:      return "recorder";
+    case PS_OTHER:         return "other";
+    default:               return QString ( "p2p decode %1" ).arg ( iStage - PS_P2P_DECODE );
+    }
+}
+
+CVector<CAudioProfilerStageStats> CAudioProfiler::GetStats() const
+{
+    CVector<CAudioProfilerStageStats> vecStats;
+
+    for ( int iStage = 0; iStage < PROFILER_MAX_STAGES_PER_CALLBACK; iStage++ )
+    {
+        const CStage& Stage  = vecStages[iStage];
+        const qint64  iCount = Stage.iCount.load ( std::memory_order_relaxed );
+
+        if ( iCount == 0 )
+        {
+            continue;
+        }
+
+        CAudioProfilerStageStats Stats;
+
+        Stats.strName           = GetStageName ( iStage );
+        Stats.iCount            = iCount;
+        Stats.dMeanUs           = static_cast<double> ( Stage.iSumNs.load ( std::memory_order_relaxed ) ) / iCount / 1000;
+        Stats.dWorstUs          = static_cast<double> ( Stage.iWorstNs.load ( std::memory_order_relaxed ) ) / 1000;
+        Stats.iNumXrunsDominant = Stage.iNumXrunsDominant.load ( std::memory_order_relaxed );
+
+        const qint64 iNumXruns = Stage.iNumXruns.load ( std::memory_order_relaxed );
+
+        if ( iNumXruns > 0 )
+        {
+            Stats.dMeanInXrunUs = static_cast<double> ( Stage.iXrunSumNs.load ( std::memory_order_relaxed ) ) / iNumXruns / 1000;
+        }
+
+        // the 99th percentile is the upper bound of the bucket in which it lies
+        // (the worst case for the last bucket)
+        qint64 iCumCount = 0;
+        int    iBucket   = 0;
+
+        for ( ; iBucket < PROFILER_NUM_BUCKETS - 1; iBucket++ )
+        {
+            iCumCount += Stage.Buckets[iBucket].load ( std::memory_order_relaxed );
+
+            if ( iCumCount * 100 >= iCount * 99 )
+            {
+                break;
+            }
+        }
+
+        Stats.dP99Us = ( iBucket < PROFILER_NUM_BUCKETS - 1 ) ?
+            static_cast<double> ( static_cast<qint64> ( 1 ) << ( PROFILER_FIRST_BUCKET_EXP + iBucket ) ) / 1000 : Stats.dWorstUs;
+
+        vecStats.Add ( Stats );
+    }
+
+    return vecStats;
+}
+
+QString CAudioProfiler::ToString() const
+{
+    const CVector<CAudioProfilerStageStats> vecStats = GetStats();
+
+    QString strResult = QString ( "Audio callback profile: %1 callbacks, %2 xruns\n" )
+        .arg ( GetNumCallbacks() )
+        .arg ( GetNumXruns() );
+
+    // xrun us: mean duration in the callbacks with xrun, xrun dom: number of
+    // xruns in which the stage took the longest
+    strResult += QString ( "%1 %2 %3 %4 %5 %6\n" )
+        .arg ( "stage", -16 )
+        .arg ( "mean us", 9 )
+        .arg ( "p99 us", 9 )
+        .arg ( "worst us", 9 )
+        .arg ( "xrun us", 9 )
+        .arg ( "xrun dom", 9 );
+
+    for ( int i = 0; i < vecStats.Size(); i++ )
+    {
+        strResult += QString ( "%1 %2 %3 %4 %5 %6\n" )
+            .arg ( vecStats[i].strName, -16 )
+            .arg ( vecStats[i].dMeanUs, 9, 'f', 1 )
+            .arg ( vecStats[i].dP99Us, 9, 'f', 1 )
+            .arg ( vecStats[i].dWorstUs, 9, 'f', 1 )
+            .arg ( vecStats[i].dMeanInXrunUs, 9, 'f', 1 )
+            .arg ( vecStats[i].iNumXrunsDominant, 9 );
+    }
+
+    return strResult;
+}
@@ -0,0 +1,192 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Profiler of the stages of the client audio callback. The audio thread
+ * stores the stage durations in lock-free histograms (relaxed atomics), the
+ * GUI and the headless client read them at any time. Callbacks which take
+ * longer than the audio block are counted as xruns and the stage with the
+ * largest share of such a callback is recorded. The profiler is the only timing
+ * of the callback, the metrics and the latency budget of the client are derived
+ * from its smoothed and total stage durations.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+#include <time.h>
+#include "global.h"
+#include "util.h"
+#include "metrics.h"
+
+
+/* Definitions ****************************************************************/
+// the histogram buckets are powers of two of ns: the first bucket holds
+// durations below 2^PROFILER_FIRST_BUCKET_EXP ns (1 us), the last one all
+// durations above 2^(PROFILER_FIRST_BUCKET_EXP + PROFILER_NUM_BUCKETS - 2) ns
+#define PROFILER_NUM_BUCKETS            16
+#define PROFILER_FIRST_BUCKET_EXP       10
+
+// maximum number of stages which can be measured in one callback
+#define PROFILER_MAX_STAGES_PER_CALLBACK ( CAudioProfiler::PS_P2P_DECODE + MAX_NUM_CHANNELS )
+
+// time constant of the smoothed stage durations in callbacks
+#define PROFILER_SMOOTHING_NUM_CALLBACKS 16
+
+
+/* Classes ********************************************************************/
+// statistics of one stage (copied from the atomics)
+class CAudioProfilerStageStats
+{
+public:
+    CAudioProfilerStageStats() : iCount ( 0 ), dMeanUs ( 0 ), dP99Us ( 0 ), dWorstUs ( 0 ),
+        iNumXrunsDominant ( 0 ), dMeanInXrunUs ( 0 ) {}
+
+    QString strName;
+    qint64  iCount;
+    double  dMeanUs;
+    double  dP99Us; // upper bound of the histogram bucket
+    double  dWorstUs;
+    qint64  iNumXrunsDominant; // xruns in which this stage took the longest
+    double  dMeanInXrunUs;     // mean duration in the callbacks with xrun
+};
+
+class CAudioProfiler
+{
+public:
+    // the P2P decode has one stage per P2P channel, starting at PS_P2P_DECODE,
+    // the stages up to PS_SEND are in the order of the callback
+    enum EStage
+    {
+        PS_CALLBACK,
+        PS_LEVEL_METER,
+        PS_REVERB,
+        PS_PAN,
+        PS_ENCODE,
+        PS_SEND,
+        PS_SERVER_DECODE,
+        PS_MIX,
+        PS_RECORDER,
+        PS_OTHER,
+        PS_P2P_DECODE
+    };
+
+    CAudioProfiler();
+
+    // audio thread ------------------------------------------------------------
+    void BeginCallback();
+
+    // adds the time since the last mark (or the callback begin) to the stage
+    void Mark ( const int iStage )
+    {
+        const qint64 iNowNs = GetTimeNs();
+
+        if ( vecCurStageNs[iStage] < 0 )
+        {
+            vecCurStageNs[iStage]          = 0;
+            veciCurStages[iNumCurStages++] = iStage;
+            iNumUsedStages                 = std::max ( iNumUsedStages, iStage + 1 );
+        }
+
+        vecCurStageNs[iStage] += iNowNs - iLastMarkNs;
+        iLastMarkNs            = iNowNs;
+    }
+
+    void EndCallback ( const qint64 iDeadlineNs );
+
+    // any thread --------------------------------------------------------------
+    // the reset is done by the audio thread at the next callback
+    void Reset() { bResetRequested.store ( true, std::memory_order_relaxed ); }
+
+    CVector<CAudioProfilerStageStats> GetStats() const;
+    qint64                            GetNumCallbacks() const { return vecStages[PS_CALLBACK].iCount.load ( std::memory_order_relaxed ); }
+    qint64                            GetNumXruns() const { return vecStages[PS_CALLBACK].iNumXruns.load ( std::memory_order_relaxed ); }
+    QString                           ToString() const;
+
+    static QString GetStageName ( const int iStage );
+
+    // smoothed duration per callback (zero in the callbacks in which the stage
+    // was not measured), total duration and the callback durations and xruns
+    // since the start, these are not affected by Reset()
+    double GetSmoothedUs ( const int iStage ) const { return vecStages[iStage].iSmoothedNs.load ( std::memory_order_relaxed ) / 1000.0; }
+    qint64 GetTotalNs ( const int iStage ) const { return vecStages[iStage].iTotalNs.load ( std::memory_order_relaxed ); }
+    qint64 GetTotalNumXruns() const { return NumXrunsTotal.Get(); }
+
+    const CMetricsDurationHistogram& GetCallbackDurationHist() const { return CallbackDurationHist; }
+
+protected:
+    // per stage statistics, only written by the audio thread
+    class CStage
+    {
+    public:
+        CStage() : iSmoothedNs ( 0 ), iTotalNs ( 0 ) { Reset(); }
+
+        void Reset();
+        void Add ( const qint64 iDurationNs );
+        void AddToTotals ( const qint64 iDurationNs );
+
+        std::atomic<qint64> Buckets[PROFILER_NUM_BUCKETS];
+        std::atomic<qint64> iCount;
+        std::atomic<qint64> iSumNs;
+        std::atomic<qint64> iWorstNs;
+        std::atomic<qint64> iNumXrunsDominant;
+        std::atomic<qint64> iXrunSumNs;
+        std::atomic<qint64> iNumXruns;
+        std::atomic<qint64> iSmoothedNs; // not reset
+        std::atomic<qint64> iTotalNs;    // not reset
+    };
+
+    // monotonic clock in ns (clock_gettime does not enter the kernel on Linux
+    // and macOS, the other platforms use the Qt timer)
+    qint64 GetTimeNs() const
+    {
+#if defined ( Q_OS_LINUX ) || defined ( Q_OS_MACX )
+        timespec Time;
+        clock_gettime ( CLOCK_MONOTONIC, &Time );
+        return static_cast<qint64> ( Time.tv_sec ) * 1000000000 + Time.tv_nsec;
+#else
+        return ElapsedTimer.nsecsElapsed();
+#endif
+    }
+
+    void DoReset();
+
+    CStage              vecStages[PROFILER_MAX_STAGES_PER_CALLBACK];
+    std::atomic<bool>   bResetRequested;
+
+    CMetricsDurationHistogram CallbackDurationHist;
+    CMetricsCounter           NumXrunsTotal;
+
+    // state of the current callback (audio thread only)
+    qint64              vecCurStageNs[PROFILER_MAX_STAGES_PER_CALLBACK]; // -1: not measured
+    int                 veciCurStages[PROFILER_MAX_STAGES_PER_CALLBACK];
+    int                 iNumCurStages;
+    int                 iNumUsedStages; // highest stage ever measured plus one
+    qint64              iCallbackStartNs;
+    qint64              iLastMarkNs;
+
+#if !defined ( Q_OS_LINUX ) && !defined ( Q_OS_MACX )
+    QElapsedTimer       ElapsedTimer;
+#endif
+};
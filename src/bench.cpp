@@ -0,0 +1,754 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QTemporaryDir>
+#include <algorithm>
+#include "buffer.h"
+#include "client.h"
+#include "recorder/cwavewriter.h"
+#include "bench.h"
+
+
+/* Helper functions ***********************************************************/
+// deterministic test signal (tone with noise) so that the runs are repeatable
+static void FillTestSignal ( CVector<int16_t>& vecsAudio, const quint32 iSeed )
+{
+    quint32 iNoiseState = iSeed;
+
+    for ( int i = 0; i < vecsAudio.Size(); i++ )
+    {
+        iNoiseState = iNoiseState * 1664525 + 1013904223; // linear congruential generator
+
+        vecsAudio[i] = static_cast<int16_t> ( 6000 * sin ( 0.03 * i + iSeed ) +
+                                              ( static_cast<int> ( iNoiseState >> 20 ) - 2048 ) );
+    }
+}
+
+// protocol with access to the message frame generation
+class CBenchProtocol : public CProtocol
+{
+public:
+    using CProtocol::GenMessageFrame;
+};
+
+
+/* Implementation *************************************************************/
+QJsonObject CBenchResult::ToJson() const
+{
+    QJsonObject Result;
+
+    Result["name"]             = strName;
+    Result["iterations"]       = iNumIterations;
+    Result["runs"]             = iNumRuns;
+    Result["ns_per_op_min"]    = dNsPerOpMin;
+    Result["ns_per_op_median"] = dNsPerOpMedian;
+    Result["ns_per_op_max"]    = dNsPerOpMax;
+
+    return Result;
+}
+
+void CBenchRunner::Run ( const QString&        strName,
+                         const int             iNumIterations,
+                         std::function<void()> Function )
+{
+    if ( !strFilter.isEmpty() && !strName.contains ( strFilter ) )
+    {
+        return;
+    }
+
+    QElapsedTimer   ElapsedTimer;
+    QList<double>   vecdNsPerOp;
+    CBenchResult    Result;
+    const int       iCurNumIterations = std::max ( 1, static_cast<int> ( iNumIterations * dIterationScale ) );
+
+    // the first run is not measured to warm up the caches
+    for ( int iRun = 0; iRun <= iNumRuns; iRun++ )
+    {
+        ElapsedTimer.start();
+
+        for ( int i = 0; i < iCurNumIterations; i++ )
+        {
+            Function();
+        }
+
+        const qint64 iElapsedNs = ElapsedTimer.nsecsElapsed();
+
+        if ( iRun > 0 )
+        {
+            vecdNsPerOp.append ( static_cast<double> ( iElapsedNs ) / iCurNumIterations );
+        }
+    }
+
+    std::sort ( vecdNsPerOp.begin(), vecdNsPerOp.end() );
+
+    Result.strName        = strName;
+    Result.iNumIterations = iCurNumIterations;
+    Result.iNumRuns       = iNumRuns;
+    Result.dNsPerOpMin    = vecdNsPerOp.first();
+    Result.dNsPerOpMedian = vecdNsPerOp[vecdNsPerOp.size() / 2];
+    Result.dNsPerOpMax    = vecdNsPerOp.last();
+
+    vecResults.append ( Result );
+
+    qInfo() << qUtf8Printable ( QString ( "%1 %2 ns/op (min %3, max %4)" )
+        .arg ( strName, -40 )
+        .arg ( Result.dNsPerOpMedian, 12, 'f', 1 )
+        .arg ( Result.dNsPerOpMin, 0, 'f', 1 )
+        .arg ( Result.dNsPerOpMax, 0, 'f', 1 ) );
+}
+
+QJsonObject CBenchRunner::ToJson() const
+{
+    QJsonObject Bench;
+    QJsonArray  Results;
+
+    for ( int i = 0; i < vecResults.size(); i++ )
+    {
+        Results.append ( vecResults[i].ToJson() );
+    }
+
+    Bench["version"]    = QString ( VERSION );
+    Bench["qt_version"] = QString ( qVersion() );
+    Bench["cpu_cores"]  = QThread::idealThreadCount();
+    Bench["results"]    = Results;
+
+    return Bench;
+}
+
+bool CBenchRunner::CompareWithBaseline ( const QJsonObject& Baseline,
+                                         const double       dThresholdPercent ) const
+{
+    const QJsonArray BaselineResults = Baseline["results"].toArray();
+    bool             bIsOk           = true;
+
+    for ( int i = 0; i < vecResults.size(); i++ )
+    {
+        for ( int j = 0; j < BaselineResults.size(); j++ )
+        {
+            const QJsonObject BaselineResult = BaselineResults[j].toObject();
+
+            if ( BaselineResult["name"].toString() != vecResults[i].strName )
+            {
+                continue;
+            }
+
+            const double dBaselineNs = BaselineResult["ns_per_op_median"].toDouble();
+
+            if ( dBaselineNs <= 0 )
+            {
+                continue;
+            }
+
+            const double dChangePercent = 100 * ( vecResults[i].dNsPerOpMedian / dBaselineNs - 1 );
+            const bool   bIsRegression  = ( dChangePercent > dThresholdPercent );
+
+            qInfo() << qUtf8Printable ( QString ( "%1 %2 % %3" )
+                .arg ( vecResults[i].strName, -40 )
+                .arg ( dChangePercent, 8, 'f', 1 )
+                .arg ( bIsRegression ? "REGRESSION" : "" ) );
+
+            bIsOk = bIsOk && !bIsRegression;
+        }
+    }
+
+    return bIsOk;
+}
+
+CBenchServer::CBenchServer ( const int     iNNumChannels,
+                             const quint16 iPortNumber,
+                             const bool    bNUseDoubleSystemFrameSize ) :
+    CServer ( iNNumChannels,
+              "",    // no logging
+              iPortNumber,
+              "",    // no HTML status file
+              "",    // no central server
+              "",    // no server info
+              "",    // no server list filter
+              "",    // no public IP
+              "",    // no welcome message
+              "",    // no recording
+              false, // no disconnect on quit
+              bNUseDoubleSystemFrameSize,
+              false, // no multithreading
+              true,  // disable recording
+              LT_NO_LICENCE ),
+    iNumClients ( 0 )
+{
+    // the channels have no address, the send is dropped before the system
+    // call so that only the mixing and the encoding are measured
+    Socket.SetOfflineMode ( true );
+}
+
+void CBenchServer::PrepareMix ( const int iNNumClients, const int iNumAudioChannels )
+{
+    // the clients use the codec which matches the server frame size and
+    // normal audio quality
+    const EAudComprType eAudComprType = bUseDoubleSystemFrameSize ? CT_OPUS : CT_OPUS64;
+    int                 iCeltNumCodedBytes;
+
+    if ( bUseDoubleSystemFrameSize )
+    {
+        iCeltNumCodedBytes = ( iNumAudioChannels == 1 ) ? OPUS_NUM_BYTES_MONO_NORMAL_QUALITY_DBLE_FRAMESIZE
+                                                        : OPUS_NUM_BYTES_STEREO_NORMAL_QUALITY_DBLE_FRAMESIZE;
+    }
+    else
+    {
+        iCeltNumCodedBytes = ( iNumAudioChannels == 1 ) ? OPUS_NUM_BYTES_MONO_NORMAL_QUALITY
+                                                        : OPUS_NUM_BYTES_STEREO_NORMAL_QUALITY;
+    }
+
+    iNumClients = iNNumClients;
+
+    for ( int i = 0; i < iNumClients; i++ )
+    {
+        vecChannels[i].SetAudioStreamProperties ( eAudComprType, iCeltNumCodedBytes, 1, iNumAudioChannels );
+
+        vecChanIDsCurConChan[i]          = i;
+        vecNumAudioChannels[i]           = iNumAudioChannels;
+        vecAudioComprType[i]             = eAudComprType;
+        vecUseDoubleSysFraSizeConvBuf[i] = 0;
+        vecNumFrameSizeConvBlocks[i]     = 1;
+
+        FillTestSignal ( vecvecsData[i], i + 1 );
+
+        // default mixer settings of a new channel
+        for ( int j = 0; j < iNumClients; j++ )
+        {
+            vecvecfGains[i][j]    = 1.0f;
+            vecvecfPannings[i][j] = 0.5f;
+        }
+    }
+}
+
+static void BenchNetBuf ( CBenchRunner& Runner )
+{
+    // block sizes of OPUS64 mono normal quality, OPUS64 stereo high quality and
+    // OPUS stereo high quality (the sequence number is appended to each packet)
+    const int veciBlockSizes[] = { OPUS_NUM_BYTES_MONO_NORMAL_QUALITY,
+                                   OPUS_NUM_BYTES_STEREO_HIGH_QUALITY,
+                                   OPUS_NUM_BYTES_STEREO_HIGH_QUALITY_DBLE_FRAMESIZE };
+
+    for ( const int iBlockSize : veciBlockSizes )
+    {
+        CNetBuf          NetBuf;
+        CNetBufWithStats NetBufWithStats;
+        CVector<uint8_t> vecbyPacket ( iBlockSize + 1, 0 );
+        CVector<uint8_t> vecbyBlock  ( iBlockSize, 0 );
+        uint8_t          iSeqNum     = 0;
+
+        NetBuf.Init          ( iBlockSize, 6, true );
+        NetBufWithStats.Init ( iBlockSize, 6, true );
+
+        // one packet is put and one block is taken per iteration like in the
+        // client and the server
+        Runner.Run ( QString ( "netbuf_put_get/%1" ).arg ( iBlockSize ), 200000, [&]()
+        {
+            vecbyPacket[iBlockSize] = iSeqNum++;
+            NetBuf.Put ( vecbyPacket, iBlockSize + 1 );
+            NetBuf.Get ( vecbyBlock, iBlockSize );
+        } );
+
+        Runner.Run ( QString ( "netbuf_with_stats_put_get/%1" ).arg ( iBlockSize ), 50000, [&]()
+        {
+            vecbyPacket[iBlockSize] = iSeqNum++;
+            NetBufWithStats.Put ( vecbyPacket, iBlockSize + 1 );
+            NetBufWithStats.Get ( vecbyBlock, iBlockSize );
+        } );
+    }
+}
+
+static void BenchServerMix ( CBenchRunner& Runner, const int iMaxNumClients )
+{
+    const int veciNumClients[] = { 4, 10, 50, 100 };
+
+    for ( const bool bUseDoubleSystemFrameSize : { false, true } )
+    {
+        // the server object is created for each frame size mode
+        CBenchServer Server ( iMaxNumClients, BENCH_SERVER_PORT_NUMBER, bUseDoubleSystemFrameSize );
+
+        for ( const int iNumAudioChannels : { 1, 2 } )
+        {
+            for ( const int iNumClients : veciNumClients )
+            {
+                if ( iNumClients > iMaxNumClients )
+                {
+                    continue;
+                }
+
+                Server.PrepareMix ( iNumClients, iNumAudioChannels );
+
+                // one iteration mixes and encodes one output channel (the packet is
+                // dropped by the offline socket)
+                int iChanCnt = 0;
+
+                Runner.Run ( QString ( "server_mix_encode/%1/%2/%3" )
+                                 .arg ( bUseDoubleSystemFrameSize ? DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES : SYSTEM_FRAME_SIZE_SAMPLES )
+                                 .arg ( iNumAudioChannels == 1 ? "mono" : "stereo" )
+                                 .arg ( iNumClients ),
+                             2000,
+                             [&]()
+                {
+                    Server.MixEncodeTransmit ( iChanCnt );
+                    iChanCnt = ( iChanCnt + 1 ) % iNumClients;
+                } );
+            }
+        }
+    }
+}
+
+static void BenchP2pMix ( CBenchRunner& Runner )
+{
+    const int veciNumClients[] = { 2, 4, 8 };
+
+    for ( const int iFrameSizeSamples : { SYSTEM_FRAME_SIZE_SAMPLES, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES } )
+    {
+        for ( const EAudChanConf eAudioChannelConf : { CC_MONO, CC_STEREO } )
+        {
+            for ( const int iNumClients : veciNumClients )
+            {
+                CVector<CVector<int16_t> > vecvecsData         ( iNumClients );
+                CVector<double>            vecdGains           ( iNumClients, 1.0 );
+                CVector<int>               vecNumAudioChannels ( iNumClients, eAudioChannelConf == CC_MONO ? 1 : 2 );
+                CVector<double>            vecdIntermProcBuf   ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES );
+                CVector<int16_t>           vecsSendData        ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES );
+
+                for ( int i = 0; i < iNumClients; i++ )
+                {
+                    vecvecsData[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES );
+                    FillTestSignal ( vecvecsData[i], i + 1 );
+                }
+
+                Runner.Run ( QString ( "p2p_mix/%1/%2/%3" )
+                                 .arg ( iFrameSizeSamples )
+                                 .arg ( eAudioChannelConf == CC_MONO ? "mono" : "stereo" )
+                                 .arg ( iNumClients ),
+                             20000,
+                             [&]()
+                {
+                    CClient::MixP2pData ( iNumClients,
+                                          iFrameSizeSamples,
+                                          eAudioChannelConf,
+                                          vecvecsData,
+                                          vecdGains,
+                                          vecNumAudioChannels,
+                                          vecdIntermProcBuf,
+                                          vecsSendData );
+                } );
+            }
+        }
+    }
+}
+
+static void BenchOpus ( CBenchRunner& Runner )
+{
+    const int iNumCodedFrames = 64;
+    int       iOpusError;
+
+    for ( const int iFrameSizeSamples : { SYSTEM_FRAME_SIZE_SAMPLES, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES } )
+    {
+        OpusCustomMode* pOpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ, iFrameSizeSamples, &iOpusError );
+
+        for ( const int iNumAudioChannels : { 1, 2 } )
+        {
+            int iNumCodedBytes;
+
+            if ( iFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES )
+            {
+                iNumCodedBytes = ( iNumAudioChannels == 1 ) ? OPUS_NUM_BYTES_MONO_NORMAL_QUALITY
+                                                            : OPUS_NUM_BYTES_STEREO_NORMAL_QUALITY;
+            }
+            else
+            {
+                iNumCodedBytes = ( iNumAudioChannels == 1 ) ? OPUS_NUM_BYTES_MONO_NORMAL_QUALITY_DBLE_FRAMESIZE
+                                                            : OPUS_NUM_BYTES_STEREO_NORMAL_QUALITY_DBLE_FRAMESIZE;
+            }
+
+            // same encoder settings as in the client and the server
+            OpusCustomEncoder* pOpusEncoder = opus_custom_encoder_create ( pOpusMode, iNumAudioChannels, &iOpusError );
+            OpusCustomDecoder* pOpusDecoder = opus_custom_decoder_create ( pOpusMode, iNumAudioChannels, &iOpusError );
+
+            opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_VBR ( 0 ) );
+            opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+            opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_BITRATE (
+                CalcBitRateBitsPerSecFromCodedBytes ( iNumCodedBytes, iFrameSizeSamples ) ) );
+
+            if ( iFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES )
+            {
+                opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_PACKET_LOSS_PERC ( 35 ) );
+            }
+            else
+            {
+                opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_COMPLEXITY ( 1 ) );
+            }
+
+            CVector<int16_t> vecsAudio  ( iNumCodedFrames * iFrameSizeSamples * iNumAudioChannels );
+            CVector<uint8_t> vecbyCoded ( iNumCodedFrames * iNumCodedBytes );
+            int              iFrame = 0;
+
+            FillTestSignal ( vecsAudio, 1 );
+
+            const QString strSuffix = QString ( "%1/%2" )
+                .arg ( iFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES ? "opus64" : "opus" )
+                .arg ( iNumAudioChannels == 1 ? "mono" : "stereo" );
+
+            // the encoder fills the coded frames which are used by the decoder
+            Runner.Run ( "opus_encode/" + strSuffix, 5000, [&]()
+            {
+                opus_custom_encode ( pOpusEncoder,
+                                     &vecsAudio[iFrame * iFrameSizeSamples * iNumAudioChannels],
+                                     iFrameSizeSamples,
+                                     &vecbyCoded[iFrame * iNumCodedBytes],
+                                     iNumCodedBytes );
+
+                iFrame = ( iFrame + 1 ) % iNumCodedFrames;
+            } );
+
+            Runner.Run ( "opus_decode/" + strSuffix, 5000, [&]()
+            {
+                opus_custom_decode ( pOpusDecoder,
+                                     &vecbyCoded[iFrame * iNumCodedBytes],
+                                     iNumCodedBytes,
+                                     &vecsAudio[iFrame * iFrameSizeSamples * iNumAudioChannels],
+                                     iFrameSizeSamples );
+
+                iFrame = ( iFrame + 1 ) % iNumCodedFrames;
+            } );
+
+            opus_custom_encoder_destroy ( pOpusEncoder );
+            opus_custom_decoder_destroy ( pOpusDecoder );
+        }
+
+        opus_custom_mode_destroy ( pOpusMode );
+    }
+}
+
+static void BenchProtocol ( CBenchRunner& Runner )
+{
+    CBenchProtocol   Protocol;
+    CVector<uint8_t> vecbyData ( 100 );
+    CVector<uint8_t> vecbyFrame;
+    CVector<uint8_t> vecbyMesBodyData;
+    int              iRecCounter;
+    int              iRecID;
+
+    for ( int i = 0; i < vecbyData.Size(); i++ )
+    {
+        vecbyData[i] = static_cast<uint8_t> ( i );
+    }
+
+    // a chat text message with 100 bytes of data
+    Protocol.GenMessageFrame ( vecbyFrame, 0, PROTMESSID_CHAT_TEXT, vecbyData );
+
+    Runner.Run ( "protocol_parse_message_frame/100", 100000, [&]()
+    {
+        CProtocol::ParseMessageFrame ( vecbyFrame,
+                                       vecbyFrame.Size(),
+                                       vecbyMesBodyData,
+                                       iRecCounter,
+                                       iRecID );
+    } );
+
+    Runner.Run ( "crc/100", 100000, [&]()
+    {
+        CCRC CRCObj;
+
+        for ( int i = 0; i < vecbyData.Size(); i++ )
+        {
+            CRCObj.AddByte ( vecbyData[i] );
+        }
+
+        vecbyData[0] = static_cast<uint8_t> ( CRCObj.GetCRC() );
+    } );
+}
+
+static void BenchAudioEffects ( CBenchRunner& Runner )
+{
+    for ( const int iFrameSizeSamples : { SYSTEM_FRAME_SIZE_SAMPLES, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES } )
+    {
+        CAudioReverb            AudioReverb;
+        CClockDriftCompensator  DriftComp;
+        CStereoSignalLevelMeter SignalLevelMeter;
+        CVector<int16_t>        vecsStereo ( 2 /* stereo */ * iFrameSizeSamples );
+        CVector<float>          vecfStereo ( 2 /* stereo */ * iFrameSizeSamples );
+
+        FillTestSignal ( vecsStereo, 1 );
+
+        for ( int i = 0; i < vecsStereo.Size(); i++ )
+        {
+            vecfStereo[i] = static_cast<float> ( vecsStereo[i] ) / _MAXSHORT;
+        }
+
+        AudioReverb.Init ( CC_STEREO, 2 * iFrameSizeSamples, SYSTEM_SAMPLE_RATE_HZ );
+
+        Runner.Run ( QString ( "reverb_process/%1" ).arg ( iFrameSizeSamples ), 20000, [&]()
+        {
+            AudioReverb.Process ( vecsStereo, false, 0.5f );
+        } );
+
+        Runner.Run ( QString ( "reverb_process_float/%1" ).arg ( iFrameSizeSamples ), 20000, [&]()
+        {
+            AudioReverb.Process ( vecfStereo, false, 0.5f );
+        } );
+
+        // one decoded frame in and one resampled frame out (like one P2P peer
+        // in one client callback)
+        DriftComp.Init ( 2, iFrameSizeSamples, SYSTEM_SAMPLE_RATE_HZ );
+
+        Runner.Run ( QString ( "drift_comp_process/%1" ).arg ( iFrameSizeSamples ), 20000, [&]()
+        {
+            while ( DriftComp.NeedsInput() )
+            {
+                DriftComp.Put ( vecsStereo );
+            }
+
+            DriftComp.Get ( vecsStereo );
+        } );
+
+        Runner.Run ( QString ( "level_meter_update/%1" ).arg ( iFrameSizeSamples ), 100000, [&]()
+        {
+            SignalLevelMeter.Update ( vecsStereo, iFrameSizeSamples, true );
+        } );
+    }
+}
+
+static void BenchWaveWriter ( CBenchRunner& Runner )
+{
+    // one operation writes one stereo frame to each of the concurrent tracks
+    // (like the recorder in one server tick)
+    const int        iNumTracks = 50;
+    const int        iNumSamples = 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+    CVector<int16_t> vecsFrame ( iNumSamples );
+    QTemporaryDir    TempDir;
+
+    if ( !TempDir.isValid() )
+    {
+        throw CGenErr ( "the temporary directory for the WAV benchmark cannot be created" );
+    }
+
+    FillTestSignal ( vecsFrame, 1 );
+
+    qInfo() << qUtf8Printable ( QString ( "wav_write: %1 bytes per operation (%2 tracks)" )
+        .arg ( iNumTracks * iNumSamples * static_cast<int> ( sizeof ( int16_t ) ) )
+        .arg ( iNumTracks ) );
+
+    QList<QFile*> vecpFiles;
+
+    for ( int i = 0; i < 2 * iNumTracks; i++ )
+    {
+        vecpFiles.append ( new QFile ( TempDir.filePath ( QString ( "track%1.wav" ).arg ( i ) ) ) );
+    }
+
+    // sample by sample through the data stream (previous recorder)
+    QList<recorder::CWaveStream*> vecpStreams;
+
+    for ( int i = 0; i < iNumTracks; i++ )
+    {
+        vecpFiles[i]->open ( QIODevice::ReadWrite );
+        vecpStreams.append ( new recorder::CWaveStream ( vecpFiles[i], 2 ) );
+    }
+
+    Runner.Run ( QString ( "wav_write_stream/%1" ).arg ( iNumTracks ), 500, [&]()
+    {
+        for ( int iTrack = 0; iTrack < iNumTracks; iTrack++ )
+        {
+            for ( int i = 0; i < iNumSamples; i++ )
+            {
+                *vecpStreams[iTrack] << vecsFrame[i];
+            }
+        }
+    } );
+
+    // whole frames in the bulk writer
+    QList<recorder::CWaveWriter*> vecpWriters;
+
+    for ( int i = 0; i < iNumTracks; i++ )
+    {
+        vecpFiles[iNumTracks + i]->open ( QIODevice::ReadWrite | QIODevice::Unbuffered );
+        vecpWriters.append ( new recorder::CWaveWriter ( vecpFiles[iNumTracks + i], 2 ) );
+    }
+
+    Runner.Run ( QString ( "wav_write_bulk/%1" ).arg ( iNumTracks ), 500, [&]()
+    {
+        for ( int iTrack = 0; iTrack < iNumTracks; iTrack++ )
+        {
+            vecpWriters[iTrack]->AppendFrame ( &vecsFrame[0], iNumSamples );
+        }
+    } );
+
+    for ( int i = 0; i < iNumTracks; i++ )
+    {
+        vecpStreams[i]->finalise();
+        vecpWriters[i]->finalise();
+        delete vecpStreams[i];
+        delete vecpWriters[i];
+    }
+
+    qDeleteAll ( vecpFiles );
+}
+
+int BenchMain ( int argc, char** argv )
+{
+    QString strArgument;
+    double  rDbleArgument;
+    QString strFilter;
+    QString strOutputFileName;
+    QString strBaselineFileName;
+    double  dIterationScale    = 1;
+    int     iNumRuns           = BENCH_DEFAULT_NUM_RUNS;
+    double  dThresholdPercent  = BENCH_DEFAULT_THRESHOLD_PERCENT;
+    int     iMaxNumClients     = 100;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( GetFlagArgument ( argv, i, "-h", "--help" ) )
+        {
+            qInfo() << qUtf8Printable ( QString (
+                "Usage: %1 [option] [optional argument]\n"
+                "\nMicrobenchmarks of the client and server hot paths, the results are\n"
+                "written as JSON to stdout or to the output file.\n"
+                "\nRecognized options:\n"
+                "  -h, --help            display this help text and exit\n"
+                "  -f, --filter          only run benchmarks whose name contains the text\n"
+                "  -o, --output          write the JSON results to the file\n"
+                "  -b, --baseline        compare with the JSON results of a previous build\n"
+                "                        (exit code 1 on a regression)\n"
+                "  -t, --threshold       regression threshold in percent (default %2)\n"
+                "  -r, --runs            number of measured runs (default %3)\n"
+                "  -s, --scale           scale factor for the number of iterations\n"
+                "  -u, --numclients      maximum number of clients of the server mix\n" )
+                .arg ( argv[0] )
+                .arg ( BENCH_DEFAULT_THRESHOLD_PERCENT )
+                .arg ( BENCH_DEFAULT_NUM_RUNS ) );
+            return 0;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-f", "--filter", strArgument ) )
+        {
+            strFilter = strArgument;
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-o", "--output", strArgument ) )
+        {
+            strOutputFileName = strArgument;
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-b", "--baseline", strArgument ) )
+        {
+            strBaselineFileName = strArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "-t", "--threshold", 0, 1000, rDbleArgument ) )
+        {
+            dThresholdPercent = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "-r", "--runs", 1, 1000, rDbleArgument ) )
+        {
+            iNumRuns = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "-s", "--scale", 0.001, 1000, rDbleArgument ) )
+        {
+            dIterationScale = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "-u", "--numclients", 1, MAX_NUM_CHANNELS, rDbleArgument ) )
+        {
+            iMaxNumClients = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        qCritical() << qUtf8Printable ( QString ( "%1: Unknown option '%2' -- use '--help' for help" )
+            .arg ( argv[0] ).arg ( argv[i] ) );
+    }
+
+    QCoreApplication App ( argc, argv );
+    CBenchRunner     Runner ( strFilter, dIterationScale, iNumRuns );
+
+    try
+    {
+        BenchNetBuf       ( Runner );
+        BenchServerMix    ( Runner, iMaxNumClients );
+        BenchP2pMix       ( Runner );
+        BenchOpus         ( Runner );
+        BenchProtocol     ( Runner );
+        BenchAudioEffects ( Runner );
+        BenchWaveWriter   ( Runner );
+    }
+    catch ( const CGenErr& generr )
+    {
+        qCritical() << "CRITICAL Error:" << generr.GetErrorText();
+        return 1;
+    }
+
+    const QByteArray JsonData = QJsonDocument ( Runner.ToJson() ).toJson();
+
+    if ( strOutputFileName.isEmpty() )
+    {
+        QTextStream ( stdout ) << JsonData;
+    }
+    else
+    {
+        QFile OutputFile ( strOutputFileName );
+
+        if ( !OutputFile.open ( QIODevice::WriteOnly ) )
+        {
+            qCritical() << qUtf8Printable ( QString ( "cannot write the results to '%1'" ).arg ( strOutputFileName ) );
+            return 1;
+        }
+
+        OutputFile.write ( JsonData );
+    }
+
+    if ( !strBaselineFileName.isEmpty() )
+    {
+        QFile BaselineFile ( strBaselineFileName );
+
+        if ( !BaselineFile.open ( QIODevice::ReadOnly ) )
+        {
+            qCritical() << qUtf8Printable ( QString ( "cannot read the baseline '%1'" ).arg ( strBaselineFileName ) );
+            return 1;
+        }
+
+        if ( !Runner.CompareWithBaseline ( QJsonDocument::fromJson ( BaselineFile.readAll() ).object(), dThresholdPercent ) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
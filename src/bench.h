@@ -0,0 +1,117 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Microbenchmarks for the hot paths of the client and the server (jitter
+ * buffer, mixing, OPUS coding, protocol parsing and audio effects). The
+ * results are written as JSON so that they can be compared between builds.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QJsonObject>
+#include <functional>
+#include "global.h"
+#include "util.h"
+#include "protocol.h"
+#include "server.h"
+
+
+/* Definitions ****************************************************************/
+// number of measured runs per benchmark (the first, unmeasured run warms up
+// the caches), the median of the runs is used for the comparison
+#define BENCH_DEFAULT_NUM_RUNS          5
+
+// a benchmark is reported as a regression if its median is slower than the
+// baseline by more than this percentage
+#define BENCH_DEFAULT_THRESHOLD_PERCENT 10
+
+// port of the server object used for the mix benchmark (no network traffic
+// is received on this port)
+#define BENCH_SERVER_PORT_NUMBER        ( DEFAULT_PORT_NUMBER + 77 )
+
+
+/* Classes ********************************************************************/
+// result of one benchmark
+class CBenchResult
+{
+public:
+    CBenchResult() : iNumIterations ( 0 ), iNumRuns ( 0 ), dNsPerOpMin ( 0 ),
+        dNsPerOpMedian ( 0 ), dNsPerOpMax ( 0 ) {}
+
+    QJsonObject ToJson() const;
+
+    QString strName;
+    int     iNumIterations; // iterations per run
+    int     iNumRuns;
+    double  dNsPerOpMin;
+    double  dNsPerOpMedian;
+    double  dNsPerOpMax;
+};
+
+// runs the benchmarks and collects the results
+class CBenchRunner
+{
+public:
+    CBenchRunner ( const QString& strNFilter,
+                   const double   dNIterationScale,
+                   const int      iNNumRuns ) :
+        strFilter ( strNFilter ), dIterationScale ( dNIterationScale ), iNumRuns ( iNNumRuns ) {}
+
+    // calls the function iNumIterations times per run (the number of
+    // iterations is scaled with the command line factor)
+    void Run ( const QString& strName, const int iNumIterations, std::function<void()> Function );
+
+    QJsonObject ToJson() const;
+
+    // compares the results with a baseline, returns false on a regression
+    bool CompareWithBaseline ( const QJsonObject& Baseline, const double dThresholdPercent ) const;
+
+protected:
+    QString             strFilter;
+    double              dIterationScale;
+    int                 iNumRuns;
+    QList<CBenchResult> vecResults;
+};
+
+// server which gives access to the mix/encode stage of the timer callback
+class CBenchServer : public CServer
+{
+public:
+    CBenchServer ( const int     iNNumChannels,
+                   const quint16 iPortNumber,
+                   const bool    bNUseDoubleSystemFrameSize );
+
+    // sets up the state of the timer callback as if iNNumClients clients
+    // with the given number of audio channels were connected
+    void PrepareMix ( const int iNNumClients, const int iNumAudioChannels );
+
+    void MixEncodeTransmit ( const int iChanCnt ) { MixEncodeTransmitData ( iChanCnt, iNumClients ); }
+
+protected:
+    int iNumClients;
+};
+
+// entry point of the benchmark build target
+int BenchMain ( int argc, char** argv );
@@ -142,22 +142,27 @@ bool CNetBuf::Put ( const CVector<uint8_t>& vecbyData,
     // the new network packet
     if ( bUseSequenceNumber )
     {
+        // with redundancy each block also carries the coded bytes of the
+        // previous block (after its own coded bytes, before the sequence number)
+        const int iNumBytesBlock = ( bUseRedundancy ? 2 * iBlockSize : iBlockSize ) + iNumBytesSeqNum;
+
         // check that the input size is a multiple of the block size
-        if ( ( iInSize % ( iBlockSize + iNumBytesSeqNum ) ) != 0 )
+        if ( ( iInSize % iNumBytesBlock ) != 0 )
         {
             return false;
         }
 
-        // to get the number of input blocks we assume that the number of bytes for
-        // the sequence number is much smaller than the number of coded audio bytes
-        const int iNumBlocks = /* floor */ ( iInSize / iBlockSize );
+        const int iNumBlocks = iInSize / iNumBytesBlock;
+
+        iLastPutLateNumBlocks      = 0;
+        iLastPutNumRecoveredBlocks = 0;
 
         // copy new data in internal buffer
         for ( int iBlock = 0; iBlock < iNumBlocks; iBlock++ )
         {
             // extract sequence number of current received block (per definition
             // the sequence number is appended after the coded audio data)
-            const int iCurrentSequenceNumber = vecbyData[iBlock * ( iBlockSize + iNumBytesSeqNum ) + iBlockSize];
+            const int iCurrentSequenceNumber = vecbyData[( iBlock + 1 ) * iNumBytesBlock - iNumBytesSeqNum];
 
             // calculate the sequence number difference and take care of wrap
             int iSeqNumDiff = iCurrentSequenceNumber - static_cast<int> ( iSequenceNumberAtGetPos );
@@ -185,6 +190,8 @@ bool CNetBuf::Put ( const CVector<uint8_t>& vecbyData,
             // buffer which did not use any sequence number at all.
             if ( iSeqNumDiff < 0 )
             {
+                iLastPutLateNumBlocks = std::max ( iLastPutLateNumBlocks, -iSeqNumDiff );
+
                 // the received packet comes too late so we shift the "buffer window" to the past
                 // until the received packet is the very first packet in the buffer
                 for ( int i = iSeqNumDiff; i < 0; i++ )
@@ -249,13 +256,33 @@ bool CNetBuf::Put ( const CVector<uint8_t>& vecbyData,
             if ( !bIsSimulation )
             {
                 // copy one block of data in buffer
-                std::copy ( vecbyData.begin() + iBlock * ( iBlockSize + iNumBytesSeqNum ),
-                            vecbyData.begin() + iBlock * ( iBlockSize + iNumBytesSeqNum ) + iBlockSize,
+                std::copy ( vecbyData.begin() + iBlock * iNumBytesBlock,
+                            vecbyData.begin() + iBlock * iNumBytesBlock + iBlockSize,
                             vecvecMemory[iBlockPutPos].begin() );
             }
 
             // valid packet added, set flag
             veciBlockValid[iBlockPutPos] = 1;
+
+            // a missing previous block is restored from the redundant copy if it
+            // is still in the buffer window (i.e., it was not yet played out)
+            if ( bUseRedundancy && ( iBlockPutPos != iBlockGetPos ) )
+            {
+                const int iPrevBlockPos = ( iBlockPutPos == 0 ) ? iNumBlocksMemory - 1 : iBlockPutPos - 1;
+
+                if ( veciBlockValid[iPrevBlockPos] == 0 )
+                {
+                    if ( !bIsSimulation )
+                    {
+                        std::copy ( vecbyData.begin() + iBlock * iNumBytesBlock + iBlockSize,
+                                    vecbyData.begin() + iBlock * iNumBytesBlock + 2 * iBlockSize,
+                                    vecvecMemory[iPrevBlockPos].begin() );
+                    }
+
+                    veciBlockValid[iPrevBlockPos] = 1;
+                    iLastPutNumRecoveredBlocks++;
+                }
+            }
         }
     }
     else
@@ -361,6 +388,33 @@ bool CNetBuf::Get ( CVector<uint8_t>& vecbyData,
     return bReturn;
 }
 
+int CNetBuf::GetNumValidBlocks() const
+{
+    if ( !bIsInitialized || ( iBlockSize == 0 ) )
+    {
+        return 0;
+    }
+
+    // in case of using sequence numbers, the buffer is always "full" per
+    // definition, therefore we have to count the valid blocks
+    if ( bUseSequenceNumber )
+    {
+        int iNumValid = 0;
+
+        for ( int i = 0; i < iNumBlocksMemory; i++ )
+        {
+            if ( veciBlockValid[i] > 0 )
+            {
+                iNumValid++;
+            }
+        }
+
+        return iNumValid;
+    }
+
+    return GetAvailData() / iBlockSize;
+}
+
 int CNetBuf::GetAvailSpace() const
 {
     // calculate available space in buffer
@@ -517,6 +571,16 @@ void CNetBufWithStats::Init ( const int  iNewBlockSize,
     }
 }
 
+void CNetBufWithStats::SetUseRedundancy ( const bool bNUseRedundancy )
+{
+    CNetBuf::SetUseRedundancy ( bNUseRedundancy );
+
+    for ( int i = 0; i < NUM_STAT_SIMULATION_BUFFERS; i++ )
+    {
+        SimulationBuffer[i].SetUseRedundancy ( bNUseRedundancy );
+    }
+}
+
 void CNetBufWithStats::ResetInitCounter()
 {
     // start initialization phase of IIR filtering, use a quarter the size
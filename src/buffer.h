@@ -234,7 +234,8 @@ class CNetBuf
 {
 public:
     CNetBuf ( const bool bNIsSim = false ) :
-        iSequenceNumberAtGetPos ( 0 ), bIsSimulation ( bNIsSim ), bIsInitialized ( false ) {}
+        iSequenceNumberAtGetPos ( 0 ), iLastPutLateNumBlocks ( 0 ), iLastPutNumRecoveredBlocks ( 0 ),
+        bUseRedundancy ( false ), bIsSimulation ( bNIsSim ), bIsInitialized ( false ) {}
 
     void Init ( const int  iNewBlockSize,
                 const int  iNewNumBlocks,
@@ -243,9 +244,25 @@ public:
 
     void SetIsSimulation ( const bool bNIsSim ) { bIsSimulation = bNIsSim; }
 
+    // each block of a packet also carries the coded bytes of the previous
+    // block which are used if the previous block is missing (only together
+    // with the sequence number)
+    void SetUseRedundancy ( const bool bNUseRedundancy ) { bUseRedundancy = bNUseRedundancy; }
+
     virtual bool Put ( const CVector<uint8_t>& vecbyData, int iInSize );
     virtual bool Get ( CVector<uint8_t>& vecbyData, const int iOutSize );
 
+    // number of blocks the last put packet arrived too late (zero if it was
+    // in time, only available if the sequence number is used)
+    int GetLastPutLateNumBlocks() const { return iLastPutLateNumBlocks; }
+
+    // number of missing blocks the last put packet restored from its
+    // redundant copies
+    int GetLastPutNumRecoveredBlocks() const { return iLastPutNumRecoveredBlocks; }
+
+    // number of blocks which are currently waiting in the buffer for playout
+    int GetNumValidBlocks() const;
+
 protected:
     enum EBufState { BS_OK, BS_FULL, BS_EMPTY };
 
@@ -260,8 +277,11 @@ protected:
     int                        iBlockPutPos;
     int                        iBlockSize;
     uint8_t                    iSequenceNumberAtGetPos; // uint8_t so that it wraps automatically
+    int                        iLastPutLateNumBlocks;
+    int                        iLastPutNumRecoveredBlocks;
     EBufState                  eBufState;
     bool                       bUseSequenceNumber;
+    bool                       bUseRedundancy;
     bool                       bIsSimulation;
     bool                       bIsInitialized;
 
@@ -282,6 +302,9 @@ public:
 
     void SetUseDoubleSystemFrameSize ( const bool bNDSFSize ) { bUseDoubleSystemFrameSize = bNDSFSize; }
 
+    // the simulation buffers of the statistics use the redundancy as well
+    void SetUseRedundancy ( const bool bNUseRedundancy );
+
     virtual bool Put ( const CVector<uint8_t>& vecbyData, const int iInSize );
     virtual bool Get ( CVector<uint8_t>& vecbyData, const int iOutSize );
 
@@ -37,6 +37,12 @@ CChannel::CChannel ( const bool bNIsServer , const bool bNP2pType ) :
     bDoAutoSockBufSize     ( true ),
     bUseSequenceNumber     ( false ), // this is important since in the client we reset on Channel.SetEnable ( false )
     iSendSequenceNumber    ( 0 ),
+    bRedundancyEnabled     ( false ),
+    bUseRedundancy         ( false ),
+    bRedundantBlockValid   ( false ),
+    bDtxReceiving          ( false ),
+    iDtxKeepAliveCnt       ( 0 ),
+    vecbyDtxPacket         ( DTX_KEEP_ALIVE_PACKET_SIZE_BYTES, DTX_KEEP_ALIVE_MARKER ),
     iFadeInCnt             ( 0 ),
     iFadeInCntMax          ( FADE_IN_NUM_FRAMES_DBLE_FRAMESIZE ),
     bIsEnabled             ( false ),
@@ -171,7 +177,9 @@ void CChannel::SetEnable ( const bool bNEnStat )
     // function. NOTE that it is important to reset this parameter on SetEnable(false)
     // since the SetEnable(true) is set AFTER the Init() in the client -> we
     // simply set it regardless of the state which does not hurt.
-    bUseSequenceNumber = false;
+    // P2P channels have no version exchange, they use the sequence number
+    // only together with the redundancy which must be enabled on all peers.
+    bUseSequenceNumber = bP2pType && bRedundancyEnabled;
 
     // if channel is not enabled, reset time out count and protocol
     if ( !bNEnStat )
@@ -220,6 +228,15 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
         iCeltNumCodedBytes    = iNewCeltNumCodedBytes;
         iNetwFrameSizeFact    = iNewNetwFrameSizeFact;
 
+        // P2P channels (see SetEnable()), the redundancy needs the sequence
+        // number to find the missing blocks
+        if ( bP2pType )
+        {
+            bUseSequenceNumber = bRedundancyEnabled;
+        }
+
+        bUseRedundancy = bRedundancyEnabled && bUseSequenceNumber;
+
         // add the size of the optional packet counter
         if ( bUseSequenceNumber )
         {
@@ -230,6 +247,12 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
             iNetwFrameSize = iCeltNumCodedBytes;
         }
 
+        // add the size of the optional redundant copy of the previous block
+        if ( bUseRedundancy )
+        {
+            iNetwFrameSize += iCeltNumCodedBytes;
+        }
+
         // update audio frame size
         if ( eAudioCompressionType == CT_OPUS )
         {
@@ -244,6 +267,7 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
         {
             // init socket buffer
             SockBuf.SetUseDoubleSystemFrameSize ( eAudioCompressionType == CT_OPUS ); // NOTE must be set BEFORE the init()
+            SockBuf.SetUseRedundancy ( bUseRedundancy );
             SockBuf.Init ( iCeltNumCodedBytes, iCurSockBufNumFrames, bUseSequenceNumber );
         }
         MutexSocketBuf.unlock();
@@ -252,6 +276,8 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
         {
             // init conversion buffer
             ConvBuf.Init ( iNetwFrameSize * iNetwFrameSizeFact, bUseSequenceNumber );
+            vecbyRedundantBlock.Init ( 2 * iCeltNumCodedBytes );
+            bRedundantBlockValid = false;
         }
         MutexConvBuf.unlock();
 
@@ -482,7 +508,47 @@ int  CChannel::MatchesAddresses ( const CHostAddress& LookupAddr ) {
 //     qDebug() << "DEBUG LookupAddr " << LookupAddr.toString();
 //     qDebug() << "DEBUG LInetAddr " << LInetAddr.toString();
 //     qDebug() << "DEBUG PInetAddr " << PInetAddr.toString();
-    return ((LookupAddr == LInetAddr) || (LookupAddr == PInetAddr));
+    // the address selected by the connectivity check may differ from both
+    // (e.g. a guessed port of a NAT which allocates the ports sequentially)
+    return ((LookupAddr == LInetAddr) || (LookupAddr == PInetAddr) || (LookupAddr == InetAddr));
+}
+
+void CChannel::EnableLinkTelemetry()
+{
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    LinkTelemetry.Init();
+}
+
+void CChannel::ResetLinkTelemetry()
+{
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    LinkTelemetry.Reset();
+}
+
+void CChannel::AddLinkPing ( const uint32_t iTransmitUs,
+                             const uint32_t iPeerUs,
+                             const uint32_t iReceiveUs )
+{
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    LinkTelemetry.AddPing ( iTransmitUs, iPeerUs, iReceiveUs );
+}
+
+CLinkTelemetrySummary CChannel::GetLinkTelemetrySummary()
+{
+    // the telemetry is updated in the socket and in the audio thread
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    return LinkTelemetry.GetSummary();
+}
+
+CLinkTelemetry CChannel::GetLinkTelemetry()
+{
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    return LinkTelemetry;
 }
 
 void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTransportProps )
@@ -505,7 +571,9 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
             iNumAudioChannels     = static_cast<int> ( NetworkTransportProps.iNumAudioChannels );
             iNetwFrameSizeFact    = NetworkTransportProps.iBlockSizeFact;
             iNetwFrameSize        = static_cast<int> ( NetworkTransportProps.iBaseNetworkPacketSize );
-            bUseSequenceNumber    = ( NetworkTransportProps.eFlags == NF_WITH_COUNTER );
+            bUseSequenceNumber    = ( NetworkTransportProps.eFlags == NF_WITH_COUNTER ) ||
+                                    ( NetworkTransportProps.eFlags == NF_WITH_COUNTER_REDUNDANCY );
+            bUseRedundancy        = ( NetworkTransportProps.eFlags == NF_WITH_COUNTER_REDUNDANCY );
 
             if ( bUseSequenceNumber )
             {
@@ -516,6 +584,12 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
                 iCeltNumCodedBytes = iNetwFrameSize;
             }
 
+            // the redundant copy of the previous block has the same size
+            if ( bUseRedundancy )
+            {
+                iCeltNumCodedBytes /= 2;
+            }
+
             // update maximum number of frames for fade in counter (only needed for server)
             // and audio frame size
             if ( eAudioCompressionType == CT_OPUS )
@@ -538,6 +612,7 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
                 // update socket buffer (the network block size is a multiple of the
                 // minimum network frame size)
                 SockBuf.SetUseDoubleSystemFrameSize ( eAudioCompressionType == CT_OPUS ); // NOTE must be set BEFORE the init()
+                SockBuf.SetUseRedundancy ( bUseRedundancy );
                 SockBuf.Init ( iCeltNumCodedBytes, iCurSockBufNumFrames, bUseSequenceNumber );
             }
             MutexSocketBuf.unlock();
@@ -546,6 +621,8 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
             {
                 // init conversion buffer
                 ConvBuf.Init ( iNetwFrameSize * iNetwFrameSizeFact, bUseSequenceNumber );
+                vecbyRedundantBlock.Init ( 2 * iCeltNumCodedBytes );
+                bRedundantBlockValid = false;
             }
             MutexConvBuf.unlock();
         }
@@ -571,7 +648,11 @@ CNetworkTransportProps CChannel::GetNetworkTransportPropsFromCurrentSettings()
     // set network flags
     ENetwFlags eFlags = NF_NONE;
 
-    if ( bUseSequenceNumber )
+    if ( bUseRedundancy )
+    {
+        eFlags = NF_WITH_COUNTER_REDUNDANCY;
+    }
+    else if ( bUseSequenceNumber )
     {
         eFlags = NF_WITH_COUNTER;
     }
@@ -635,6 +716,12 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
             // only process audio if packet has correct size
             if ( iNumBytes == ( iNetwFrameSize * iNetwFrameSizeFact ) )
             {
+                Metrics.RxPackets.Add();
+                Metrics.RxBytes.Add ( iNumBytes );
+
+                // a regular audio packet ends the discontinuous transmission
+                bDtxReceiving = false;
+
                 // store new packet in jitter buffer
                 if ( SockBuf.Put ( vecbyData, iNumBytes ) )
                 {
@@ -643,14 +730,44 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
                 else
                 {
                     eRet = PS_AUDIO_ERR;
+                    Metrics.JitterBufPutErrors.Add();
+                }
+
+                if ( SockBuf.GetLastPutNumRecoveredBlocks() > 0 )
+                {
+                    Metrics.JitterBufRecovered.Add ( SockBuf.GetLastPutNumRecoveredBlocks() );
                 }
 
+                // update link statistics (per definition the sequence number
+                // is the last byte of the first block)
+                LinkTelemetry.AddPacket ( bUseSequenceNumber ? vecbyData[iNetwFrameSize - 1] : INVALID_INDEX,
+                                          iNetwFrameSizeFact,
+                                          iAudioFrameSizeSamples * 1000000 / SYSTEM_SAMPLE_RATE_HZ,
+                                          SockBuf.GetLastPutLateNumBlocks() );
+
                 // manage audio fade-in counter
                 if ( iFadeInCnt < iFadeInCntMax )
                 {
                     iFadeInCnt++;
                 }
             }
+            else if ( ( iNumBytes == DTX_KEEP_ALIVE_PACKET_SIZE_BYTES ) &&
+                      ( vecbyData[0] == DTX_KEEP_ALIVE_MARKER ) &&
+                      ( vecbyData[1] == DTX_KEEP_ALIVE_MARKER ) )
+            {
+                Metrics.RxPackets.Add();
+                Metrics.RxBytes.Add ( iNumBytes );
+
+                // the sender suppresses its silent input, the missing packets
+                // are no loss
+                if ( !bDtxReceiving )
+                {
+                    LinkTelemetry.SetDiscontinuity();
+                    bDtxReceiving = true;
+                }
+
+                eRet = PS_AUDIO_OK;
+            }
             else
             {
                 // the protocol parsing failed and this was no audio block,
@@ -699,8 +816,21 @@ EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
 
     MutexSocketBuf.lock();
     {
-        // the socket access must be inside a mutex
-        const bool bSockBufState = SockBuf.Get ( vecbyData, iNumBytes );
+        // the socket access must be inside a mutex, the occupancy scans the
+        // jitter buffer and is therefore only evaluated if the telemetry of
+        // this channel is enabled (not on the server channels)
+        if ( LinkTelemetry.IsInitialized() && !bDtxReceiving )
+        {
+            LinkTelemetry.AddOccupancy ( SockBuf.GetNumValidBlocks() );
+        }
+
+        // during discontinuous transmission the buffered frames before the
+        // silence are still played out and the buffer window keeps moving with
+        // the sequence numbers of the sender, but the statistics of the auto
+        // jitter buffer size are not updated since the missing packets are no
+        // network errors
+        const bool bSockBufState = bDtxReceiving ? SockBuf.CNetBuf::Get ( vecbyData, iNumBytes ) :
+                                                   SockBuf.Get ( vecbyData, iNumBytes );
 
         // decrease time-out counter
         if ( iConTimeOut > 0 )
@@ -732,11 +862,19 @@ EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
                     // everything is ok
                     eGetStatus = GS_BUFFER_OK;
                 }
+                else if ( bDtxReceiving )
+                {
+                    // the sender suppresses its silent input
+                    eGetStatus = GS_DTX_SILENCE;
+                }
                 else
                 {
                     // channel is not yet disconnected but no data in buffer
                     eGetStatus = GS_BUFFER_UNDERRUN;
+                    Metrics.JitterBufUnderruns.Add();
                 }
+
+                Metrics.JitterBufGets.Add();
             }
         }
         else
@@ -766,12 +904,119 @@ void CChannel::PrepAndSendPacket ( CHighPrioSocket*        pSocket,
 {
     QMutexLocker locker ( &MutexConvBuf );
 
+    // the next suppressed frame starts a new discontinuous transmission
+    iDtxKeepAliveCnt = 0;
+
     // use conversion buffer to convert sound card block size in network
     // block size and take care of optional sequence number (note that
     // the sequence number wraps automatically)
-    if ( ConvBuf.Put ( vecbyNPacket, iNPacketLen, iSendSequenceNumber++ ) )
+    if ( PutInConvBuf ( vecbyNPacket, iNPacketLen ) )
+    {
+        const CVector<uint8_t>& vecbyPacket = ConvBuf.GetAll();
+
+        pSocket->SendPacket ( vecbyPacket, GetAddress() );
+
+        Metrics.TxPackets.Add();
+        Metrics.TxBytes.Add ( vecbyPacket.Size() );
+    }
+}
+
+bool CChannel::PrepPacket ( const CVector<uint8_t>& vecbyNPacket,
+                            const int               iNPacketLen,
+                            CVector<uint8_t>&       vecbyOutPacket )
+{
+    QMutexLocker locker ( &MutexConvBuf );
+
+    iDtxKeepAliveCnt = 0;
+
+    if ( PutInConvBuf ( vecbyNPacket, iNPacketLen ) )
+    {
+        vecbyOutPacket = ConvBuf.GetAll();
+
+        Metrics.TxPackets.Add();
+        Metrics.TxBytes.Add ( vecbyOutPacket.Size() );
+        return true;
+    }
+
+    return false;
+}
+
+bool CChannel::PutInConvBuf ( const CVector<uint8_t>& vecbyNPacket,
+                              const int               iNPacketLen )
+{
+    if ( !bUseRedundancy )
     {
-        pSocket->SendPacket ( ConvBuf.GetAll(), GetAddress() );
+        return ConvBuf.Put ( vecbyNPacket, iNPacketLen, iSendSequenceNumber++ );
+    }
+
+    // the conversion buffer is sized for the redundant packets, a block with
+    // a different size would result in malformed packets and is dropped (the
+    // receiver sees a lost frame)
+    Q_ASSERT ( 2 * iNPacketLen == vecbyRedundantBlock.Size() );
+
+    if ( 2 * iNPacketLen != vecbyRedundantBlock.Size() )
+    {
+        iSendSequenceNumber++;
+        ConvBuf.Reset();
+        bRedundantBlockValid = false;
+        return false;
+    }
+
+    // the block is followed by the previous block (the first block after the
+    // initialization is repeated instead)
+    if ( !bRedundantBlockValid )
+    {
+        std::copy ( vecbyNPacket.begin(),
+                    vecbyNPacket.begin() + iNPacketLen,
+                    vecbyRedundantBlock.begin() + iNPacketLen );
+
+        bRedundantBlockValid = true;
+    }
+
+    std::copy ( vecbyNPacket.begin(),
+                vecbyNPacket.begin() + iNPacketLen,
+                vecbyRedundantBlock.begin() );
+
+    const bool bPacketReady = ConvBuf.Put ( vecbyRedundantBlock, 2 * iNPacketLen, iSendSequenceNumber++ );
+
+    // the current block is the redundant copy of the next one
+    std::copy ( vecbyRedundantBlock.begin(),
+                vecbyRedundantBlock.begin() + iNPacketLen,
+                vecbyRedundantBlock.begin() + iNPacketLen );
+
+    return bPacketReady;
+}
+
+void CChannel::PrepAndSendDtxPacket ( CHighPrioSocket* pSocket )
+{
+    QMutexLocker locker ( &MutexConvBuf );
+
+    // the suppressed frame uses up its sequence number so that the buffer
+    // window of the receiver stays aligned to the sender, a partially filled
+    // packet is dropped (it only contains the silent hangover of the sender)
+    iSendSequenceNumber++;
+    ConvBuf.Reset();
+
+    // the block before the pause must not be sent as the redundant copy with
+    // the first packet after the pause
+    bRedundantBlockValid = false;
+
+    // the first keep-alive packet is sent immediately so that the receiver
+    // does not count the missing packets as underruns
+    if ( iDtxKeepAliveCnt == 0 )
+    {
+        pSocket->SendPacket ( vecbyDtxPacket, GetAddress() );
+
+        Metrics.TxPackets.Add();
+        Metrics.TxBytes.Add ( vecbyDtxPacket.Size() );
+    }
+
+    // the counter is based on samples like the time-out counter
+    iDtxKeepAliveCnt += iAudioFrameSizeSamples;
+
+    if ( iDtxKeepAliveCnt >= DTX_KEEP_ALIVE_INTERVAL_MS * SYSTEM_SAMPLE_RATE_HZ / 1000 )
+    {
+        iDtxKeepAliveCnt = 0;
     }
 }
 
@@ -814,6 +1059,13 @@ void CChannel::UpdateSocketBufferSize()
     }
 }
 
+int CChannel::GetSockBufOccupancy()
+{
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    return bDtxReceiving ? INVALID_INDEX : SockBuf.GetNumValidBlocks();
+}
+
 void CChannel::OnClientIpsRec ( CHostAddress LocalAddr,
                                 CHostAddress PublicAddr )
 {
@@ -826,3 +1078,344 @@ void CChannel::OnClientIpsRec ( CHostAddress LocalAddr,
 
     emit NewClientsListToAll();
 }
+
+
+// CLinkTelemetry implementation ***********************************************
+void CLinkTelemetry::Init()
+{
+    JitterHist.Init    ( 64,  0.25, LINK_TELEMETRY_PACKET_WINDOW );
+    LossBurstHist.Init ( 16,  1,    LINK_TELEMETRY_EVENT_WINDOW );
+    ReorderHist.Init   ( 16,  1,    LINK_TELEMETRY_EVENT_WINDOW );
+    LateHist.Init      ( 16,  1,    LINK_TELEMETRY_EVENT_WINDOW );
+    RttHist.Init       ( 100, 2,    LINK_TELEMETRY_PING_WINDOW );
+    OccupancyHist.Init ( 32,  1,    LINK_TELEMETRY_PACKET_WINDOW );
+
+    ArrivalTime.start();
+    bIsInitialized = true;
+
+    Reset();
+}
+
+void CLinkTelemetry::Reset()
+{
+    iNumPackets        = 0;
+    iNumLostFrames     = 0;
+    iNumReordered      = 0;
+    iNumDuplicates     = 0;
+    iNumLate           = 0;
+    dJitterMs          = 0;
+    dRttMs             = 0;
+    dClockOffsetMs     = 0;
+    dOneWayDelayUpMs   = 0;
+    dOneWayDelayDownMs = 0;
+    dOccupancyBlocks   = 0;
+    iLastArrivalUs     = INVALID_INDEX;
+    iHighestSeqNum     = 0;
+    bSeqNumValid       = false;
+    iBestRttUs         = INVALID_INDEX;
+    iBestClockOffsetUs = 0;
+
+    JitterHist.Reset();
+    LossBurstHist.Reset();
+    ReorderHist.Reset();
+    LateHist.Reset();
+    RttHist.Reset();
+    OccupancyHist.Reset();
+}
+
+void CLinkTelemetry::UpdateJitter ( const qint64 iDeviationUs )
+{
+    const double dDeviationMs = std::abs ( iDeviationUs ) / 1000.0;
+
+    // interarrival jitter estimate as defined in RFC 3550
+    dJitterMs += ( dDeviationMs - dJitterMs ) / 16;
+
+    JitterHist.Add ( dDeviationMs );
+}
+
+void CLinkTelemetry::AddPacket ( const int iSeqNum,
+                                 const int iNumFrames,
+                                 const int iFrameDurationUs,
+                                 const int iLateNumBlocks )
+{
+    if ( !bIsInitialized || ( iNumFrames <= 0 ) )
+    {
+        return;
+    }
+
+    const qint64 iArrivalUs = ArrivalTime.nsecsElapsed() / 1000;
+
+    iNumPackets++;
+
+    if ( iLateNumBlocks > 0 )
+    {
+        iNumLate++;
+        LateHist.Add ( iLateNumBlocks );
+    }
+
+    // without sequence number we can only evaluate the interarrival jitter
+    // based on the nominal packet duration
+    if ( iSeqNum == INVALID_INDEX )
+    {
+        if ( iLastArrivalUs != INVALID_INDEX )
+        {
+            UpdateJitter ( iArrivalUs - iLastArrivalUs - static_cast<qint64> ( iNumFrames ) * iFrameDurationUs );
+        }
+
+        iLastArrivalUs = iArrivalUs;
+        return;
+    }
+
+    if ( !bSeqNumValid )
+    {
+        iHighestSeqNum = iSeqNum;
+        iLastArrivalUs = iArrivalUs;
+        bSeqNumValid   = true;
+        return;
+    }
+
+    // calculate the sequence number difference to the highest received
+    // sequence number and take care of wrap (1 byte sequence number)
+    int iSeqNumDiff = iSeqNum - iHighestSeqNum;
+
+    if ( iSeqNumDiff < -128 )
+    {
+        iSeqNumDiff += 256;
+    }
+    else if ( iSeqNumDiff >= 128 )
+    {
+        iSeqNumDiff -= 256;
+    }
+
+    if ( iSeqNumDiff >= iNumFrames )
+    {
+        // in order packet, all frames in between are lost (at least until
+        // they arrive reordered)
+        const int iNumMissingFrames = iSeqNumDiff - iNumFrames;
+
+        if ( iNumMissingFrames > 0 )
+        {
+            iNumLostFrames += iNumMissingFrames;
+            LossBurstHist.Add ( iNumMissingFrames / iNumFrames );
+        }
+
+        // transit time difference to the previous in order packet
+        UpdateJitter ( iArrivalUs - iLastArrivalUs - static_cast<qint64> ( iSeqNumDiff ) * iFrameDurationUs );
+
+        iHighestSeqNum = ( iHighestSeqNum + iSeqNumDiff ) & 0xFF;
+        iLastArrivalUs = iArrivalUs;
+    }
+    else if ( iSeqNumDiff >= 0 )
+    {
+        iNumDuplicates++;
+    }
+    else
+    {
+        // the packet was counted as lost when the later packet arrived
+        iNumReordered++;
+        iNumLostFrames = std::max ( iNumLostFrames - iNumFrames, static_cast<qint64> ( 0 ) );
+        ReorderHist.Add ( -iSeqNumDiff / iNumFrames );
+    }
+}
+
+void CLinkTelemetry::AddPing ( const uint32_t iTransmitUs,
+                               const uint32_t iPeerUs,
+                               const uint32_t iReceiveUs )
+{
+    // the time stamps wrap, therefore all calculations are done with unsigned
+    // integers and only the differences are interpreted as signed values
+    const int iRttUs = static_cast<int32_t> ( iReceiveUs - iTransmitUs );
+
+    if ( !bIsInitialized || ( iRttUs < 0 ) )
+    {
+        return;
+    }
+
+    // clock offset of the peer assuming a symmetric path, the measurement with
+    // the lowest round trip time gives the most accurate estimate (the best
+    // round trip time is slowly aged so that we follow a drift of the clocks)
+    const uint32_t iClockOffsetUs = iPeerUs - iTransmitUs - static_cast<uint32_t> ( iRttUs / 2 );
+
+    if ( ( iBestRttUs == INVALID_INDEX ) || ( iRttUs <= iBestRttUs ) )
+    {
+        iBestRttUs         = iRttUs;
+        iBestClockOffsetUs = iClockOffsetUs;
+    }
+    else
+    {
+        iBestRttUs += iBestRttUs / 64 + 1;
+    }
+
+    dRttMs             = iRttUs / 1000.0;
+    dClockOffsetMs     = static_cast<int32_t> ( iBestClockOffsetUs ) / 1000.0;
+    dOneWayDelayUpMs   = static_cast<int32_t> ( iPeerUs - iTransmitUs - iBestClockOffsetUs ) / 1000.0;
+    dOneWayDelayDownMs = static_cast<int32_t> ( iReceiveUs - iPeerUs + iBestClockOffsetUs ) / 1000.0;
+
+    RttHist.Add ( dRttMs );
+}
+
+void CLinkTelemetry::AddOccupancy ( const int iNumBlocks )
+{
+    if ( !bIsInitialized )
+    {
+        return;
+    }
+
+    // smoothed with the same time constant as the interarrival jitter
+    dOccupancyBlocks += ( iNumBlocks - dOccupancyBlocks ) / 16;
+
+    OccupancyHist.Add ( iNumBlocks );
+}
+
+CLinkTelemetrySummary CLinkTelemetry::GetSummary() const
+{
+    CLinkTelemetrySummary Summary;
+
+    Summary.bIsInitialized     = bIsInitialized;
+    Summary.iNumPackets        = iNumPackets;
+    Summary.iNumLostFrames     = iNumLostFrames;
+    Summary.iNumReordered      = iNumReordered;
+    Summary.iNumDuplicates     = iNumDuplicates;
+    Summary.iNumLate           = iNumLate;
+    Summary.dJitterMs          = dJitterMs;
+    Summary.dJitterP99Ms       = JitterHist.GetPercentile ( 0.99 );
+    Summary.dRttMs             = dRttMs;
+    Summary.dOneWayDelayUpMs   = dOneWayDelayUpMs;
+    Summary.dOneWayDelayDownMs = dOneWayDelayDownMs;
+    Summary.dOccupancyBlocks   = dOccupancyBlocks;
+
+    return Summary;
+}
+
+QString CLinkTelemetry::ToString() const
+{
+    return QString ( "packets %1, lost frames %2, reordered %3, duplicates %4, late %5\n"
+                     "  jitter %6 ms (p99 %7 ms), RTT %8 ms (p99 %9 ms), one-way delay up %10 ms down %11 ms, clock offset %12 ms\n"
+                     "  jitter hist [ms:n] %13\n"
+                     "  loss burst hist [packets:n] %14\n"
+                     "  reorder hist [packets:n] %15\n"
+                     "  late hist [blocks:n] %16\n"
+                     "  RTT hist [ms:n] %17\n"
+                     "  jitter buffer occupancy %18 blocks, hist [blocks:n] %19" )
+        .arg ( iNumPackets )
+        .arg ( iNumLostFrames )
+        .arg ( iNumReordered )
+        .arg ( iNumDuplicates )
+        .arg ( iNumLate )
+        .arg ( dJitterMs, 0, 'f', 2 )
+        .arg ( JitterHist.GetPercentile ( 0.99 ), 0, 'f', 2 )
+        .arg ( dRttMs, 0, 'f', 1 )
+        .arg ( RttHist.GetPercentile ( 0.99 ), 0, 'f', 1 )
+        .arg ( dOneWayDelayUpMs, 0, 'f', 1 )
+        .arg ( dOneWayDelayDownMs, 0, 'f', 1 )
+        .arg ( dClockOffsetMs, 0, 'f', 1 )
+        .arg ( JitterHist.ToString() )
+        .arg ( LossBurstHist.ToString() )
+        .arg ( ReorderHist.ToString() )
+        .arg ( LateHist.ToString() )
+        .arg ( RttHist.ToString() )
+        .arg ( dOccupancyBlocks, 0, 'f', 1 )
+        .arg ( OccupancyHist.ToString() );
+}
+
+void CChannel::WriteMetrics ( CMetricsWriter&         Writer,
+                              const QString&          strPrefix,
+                              const QList<CChannel*>& vecpChannels,
+                              const QStringList&      vecstrLabels )
+{
+    // the telemetry is copied once since it is protected by a mutex
+    QList<CLinkTelemetrySummary> vecTelemetry;
+
+    for ( int i = 0; i < vecpChannels.size(); i++ )
+    {
+        vecTelemetry.append ( vecpChannels[i]->GetLinkTelemetrySummary() );
+    }
+
+    // each family is written with the samples of all channels
+    auto WriteFamily = [&] ( const QString& strName,
+                             const QString& strType,
+                             const QString& strHelp,
+                             std::function<double ( int )> GetValue )
+    {
+        Writer.AddFamily ( strPrefix + strName, strType, strHelp );
+
+        for ( int i = 0; i < vecpChannels.size(); i++ )
+        {
+            Writer.Add ( strPrefix + strName, vecstrLabels[i], GetValue ( i ) );
+        }
+    };
+
+    WriteFamily ( "_link_up", "gauge", "Whether the channel is connected.",
+        [&] ( int i ) { return vecpChannels[i]->IsConnected() ? 1 : 0; } );
+
+    WriteFamily ( "_rx_packets_total", "counter", "Received audio packets.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().RxPackets.Get(); } );
+
+    WriteFamily ( "_rx_bytes_total", "counter", "Received audio bytes.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().RxBytes.Get(); } );
+
+    WriteFamily ( "_tx_packets_total", "counter", "Sent audio packets.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().TxPackets.Get(); } );
+
+    WriteFamily ( "_tx_bytes_total", "counter", "Sent audio bytes.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().TxBytes.Get(); } );
+
+    WriteFamily ( "_jitter_buffer_blocks", "gauge", "Current jitter buffer size in blocks.",
+        [&] ( int i ) { return vecpChannels[i]->GetSockBufNumFrames(); } );
+
+    WriteFamily ( "_jitter_buffer_gets_total", "counter", "Blocks requested from the jitter buffer.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().JitterBufGets.Get(); } );
+
+    WriteFamily ( "_jitter_buffer_underruns_total", "counter", "Jitter buffer gets without an audio block.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().JitterBufUnderruns.Get(); } );
+
+    WriteFamily ( "_jitter_buffer_put_errors_total", "counter", "Audio packets which did not fit in the jitter buffer.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().JitterBufPutErrors.Get(); } );
+
+    WriteFamily ( "_jitter_buffer_recovered_total", "counter", "Missing blocks restored from the redundant copy in the following packet.",
+        [&] ( int i ) { return vecpChannels[i]->GetMetrics().JitterBufRecovered.Get(); } );
+
+    WriteFamily ( "_protocol_retransmissions_total", "counter", "Retransmitted protocol messages.",
+        [&] ( int i ) { return vecpChannels[i]->GetNumProtocolRetransmissions(); } );
+
+    // link telemetry
+    QList<int> vecTelemetryIndices;
+
+    for ( int i = 0; i < vecpChannels.size(); i++ )
+    {
+        if ( vecTelemetry[i].bIsInitialized )
+        {
+            vecTelemetryIndices.append ( i );
+        }
+    }
+
+    if ( vecTelemetryIndices.isEmpty() )
+    {
+        return;
+    }
+
+    auto WriteTelemetryFamily = [&] ( const QString& strName,
+                                      const QString& strType,
+                                      const QString& strHelp,
+                                      std::function<double ( const CLinkTelemetrySummary& )> GetValue )
+    {
+        Writer.AddFamily ( strPrefix + strName, strType, strHelp );
+
+        for ( int i : vecTelemetryIndices )
+        {
+            Writer.Add ( strPrefix + strName, vecstrLabels[i], GetValue ( vecTelemetry[i] ) );
+        }
+    };
+
+    WriteTelemetryFamily ( "_link_jitter_milliseconds", "gauge", "Interarrival jitter (RFC 3550).",
+        [] ( const CLinkTelemetrySummary& T ) { return T.dJitterMs; } );
+
+    WriteTelemetryFamily ( "_link_rtt_milliseconds", "gauge", "Round trip time.",
+        [] ( const CLinkTelemetrySummary& T ) { return T.dRttMs; } );
+
+    WriteTelemetryFamily ( "_link_lost_frames", "gauge", "Lost frames since the last telemetry reset.",
+        [] ( const CLinkTelemetrySummary& T ) { return T.iNumLostFrames; } );
+
+    WriteTelemetryFamily ( "_link_late_packets", "gauge", "Packets which missed the jitter buffer since the last telemetry reset.",
+        [] ( const CLinkTelemetrySummary& T ) { return T.iNumLate; } );
+}
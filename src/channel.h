@@ -50,6 +50,20 @@
 #define FADE_IN_NUM_FRAMES                   2250
 #define FADE_IN_NUM_FRAMES_DBLE_FRAMESIZE    1125
 
+// window sizes of the link telemetry histograms (number of packets: approx.
+// 11 s at 2.67 ms per packet, number of events and number of pings)
+#define LINK_TELEMETRY_PACKET_WINDOW         4096
+#define LINK_TELEMETRY_EVENT_WINDOW          256
+#define LINK_TELEMETRY_PING_WINDOW           64
+
+// discontinuous transmission (DTX): while the input of the sender is silent,
+// only a keep-alive packet is sent in this interval instead of the audio
+// packets, it is shorter than any coded audio packet and no valid protocol
+// message (all bytes are set to the marker value)
+#define DTX_KEEP_ALIVE_INTERVAL_MS           100
+#define DTX_KEEP_ALIVE_PACKET_SIZE_BYTES     2
+#define DTX_KEEP_ALIVE_MARKER                0xD7
+
 
 enum EPutDataStat
 {
@@ -65,6 +79,114 @@ enum EPutDataStat
 
 
 /* Classes ********************************************************************/
+// Current estimates and totals of a link telemetry without the histograms, it
+// is small enough to be copied under the socket buffer mutex which is also
+// taken by the audio thread
+class CLinkTelemetrySummary
+{
+public:
+    CLinkTelemetrySummary() :
+        bIsInitialized     ( false ),
+        iNumPackets        ( 0 ),
+        iNumLostFrames     ( 0 ),
+        iNumReordered      ( 0 ),
+        iNumDuplicates     ( 0 ),
+        iNumLate           ( 0 ),
+        dJitterMs          ( 0 ),
+        dJitterP99Ms       ( 0 ),
+        dRttMs             ( 0 ),
+        dOneWayDelayUpMs   ( 0 ),
+        dOneWayDelayDownMs ( 0 ),
+        dOccupancyBlocks   ( 0 ) {}
+
+    bool   bIsInitialized;
+    qint64 iNumPackets;
+    qint64 iNumLostFrames;
+    qint64 iNumReordered;
+    qint64 iNumDuplicates;
+    qint64 iNumLate;
+    double dJitterMs;
+    double dJitterP99Ms;
+    double dRttMs;
+    double dOneWayDelayUpMs;
+    double dOneWayDelayDownMs;
+    double dOccupancyBlocks;
+};
+
+// Statistics of a network link: interarrival jitter, loss, reordering and late
+// packets of the received audio packets and round trip time, clock offset and
+// one-way delays of the ping measurements and the jitter buffer occupancy at
+// the playout. All memory is allocated in Init()
+// so that AddPacket() can be called in the socket thread.
+class CLinkTelemetry
+{
+public:
+    CLinkTelemetry() : bIsInitialized ( false ) { Reset(); }
+
+    void Init();
+    void Reset();
+
+    bool IsInitialized() const { return bIsInitialized; }
+
+    void AddPacket ( const int iSeqNum,
+                     const int iNumFrames,
+                     const int iFrameDurationUs,
+                     const int iLateNumBlocks );
+
+    // ping with transmit time, time of the peer and receive time (all in us)
+    void AddPing ( const uint32_t iTransmitUs,
+                   const uint32_t iPeerUs,
+                   const uint32_t iReceiveUs );
+
+    // number of blocks waiting in the jitter buffer when a block is played out
+    void AddOccupancy ( const int iNumBlocks );
+
+    // the sender has suppressed packets (DTX), the following sequence number
+    // gap is no loss
+    void SetDiscontinuity()
+    {
+        bSeqNumValid   = false;
+        iLastArrivalUs = INVALID_INDEX;
+    }
+
+    CLinkTelemetrySummary GetSummary() const;
+    QString               ToString() const;
+
+    // totals since the last reset
+    qint64            iNumPackets;
+    qint64            iNumLostFrames;
+    qint64            iNumReordered;
+    qint64            iNumDuplicates;
+    qint64            iNumLate;
+
+    // current estimates
+    double            dJitterMs; // interarrival jitter as defined in RFC 3550
+    double            dRttMs;
+    double            dClockOffsetMs;
+    double            dOneWayDelayUpMs;
+    double            dOneWayDelayDownMs;
+    double            dOccupancyBlocks;
+
+    // rolling histograms
+    CRollingHistogram JitterHist;    // interarrival deviation in ms
+    CRollingHistogram LossBurstHist; // number of consecutive lost packets
+    CRollingHistogram ReorderHist;   // reorder depth in packets
+    CRollingHistogram LateHist;      // number of blocks a packet missed the jitter buffer
+    CRollingHistogram RttHist;       // round trip time in ms
+    CRollingHistogram OccupancyHist; // jitter buffer occupancy in blocks
+
+protected:
+    void UpdateJitter ( const qint64 iDeviationUs );
+
+    bool              bIsInitialized;
+    QElapsedTimer     ArrivalTime;
+    qint64            iLastArrivalUs;
+    int               iHighestSeqNum;
+    bool              bSeqNumValid;
+    int               iBestRttUs;
+    uint32_t          iBestClockOffsetUs;
+};
+
 class CChannel : public QObject
 {
     Q_OBJECT
@@ -90,6 +212,21 @@ public:
                              const CVector<uint8_t>& vecbyNPacket,
                              const int               iNPacketLen );
 
+    // same as PrepAndSendPacket() but the packet is returned instead of being
+    // sent (returns true if a complete packet is ready)
+    bool PrepPacket ( const CVector<uint8_t>& vecbyNPacket,
+                      const int               iNPacketLen,
+                      CVector<uint8_t>&       vecbyOutPacket );
+
+    // called instead of PrepAndSendPacket() for a suppressed silent frame
+    // (DTX), sends a keep-alive packet from time to time
+    void PrepAndSendDtxPacket ( CHighPrioSocket* pSocket );
+
+    // client only: each block also carries the coded bytes of the previous
+    // block if the sequence number is used (applied with the next audio
+    // stream properties)
+    void SetRedundancyEnabled ( const bool bEnable ) { bRedundancyEnabled = bEnable; }
+
     void ResetTimeOutCounter( const bool isP2P )
     {
         if ( isP2P )
@@ -144,6 +281,10 @@ public:
 
     void UpdateSocketBufferSize();
 
+    // number of blocks waiting in the jitter buffer (INVALID_INDEX during
+    // discontinuous transmission where the level has no meaning)
+    int GetSockBufOccupancy();
+
     int GetUploadRateKbps();
 
     // set/get network out buffer size and size factor
@@ -206,6 +347,29 @@ void CreateReqChannelLevelListMes() { Protocol.CreateReqChannelLevelListMes(); }
 
     void SetP2pEnabled ( const bool p2pEnabled ) { bP2pEnabled = p2pEnabled; }
 
+    // link telemetry (only collected if enabled)
+    void EnableLinkTelemetry();
+    void ResetLinkTelemetry();
+    void AddLinkPing ( const uint32_t iTransmitUs,
+                       const uint32_t iPeerUs,
+                       const uint32_t iReceiveUs );
+    CLinkTelemetrySummary GetLinkTelemetrySummary();
+
+    // copies the histograms under the socket buffer mutex, only use it for
+    // dumps on request and not periodically
+    CLinkTelemetry GetLinkTelemetry();
+
+    // metrics of the packets and the jitter buffer (always collected)
+    const CChannelMetrics& GetMetrics() const { return Metrics; }
+    int64_t GetNumProtocolRetransmissions() const { return Protocol.GetNumRetransmissions(); }
+
+    // writes the per channel metric families, one sample per channel with the
+    // given labels (the link telemetry is only written if it is enabled)
+    static void WriteMetrics ( CMetricsWriter&         Writer,
+                               const QString&          strPrefix,
+                               const QList<CChannel*>& vecpChannels,
+                               const QStringList&      vecstrLabels );
+
     int GetChannelID () { return iThisChanID; }
     void SetChannelID ( int iChanID ) { iThisChanID = iChanID; }
 
@@ -218,6 +382,12 @@ void CreateReqChannelLevelListMes() { Protocol.CreateReqChannelLevelListMes(); }
 protected:
     bool ProtocolIsEnabled();
 
+    // puts the coded block (with the optional redundant copy of the previous
+    // block) in the conversion buffer (must be called in the conversion buffer
+    // mutex), returns true if a complete packet is ready
+    bool PutInConvBuf ( const CVector<uint8_t>& vecbyNPacket,
+                        const int               iNPacketLen );
+
     void ResetNetworkTransportProperties()
     {
         // set it to a state were no decoding is ever possible (since we want
@@ -229,6 +399,7 @@ protected:
         iCeltNumCodedBytes    = CELT_MINIMUM_NUM_BYTES;
         iNumAudioChannels     = 1; // mono
         bUseSequenceNumber    = false;
+        bUseRedundancy        = false;
     }
 
     // connection parameters
@@ -248,6 +419,23 @@ protected:
     bool                    bUseSequenceNumber;
     uint8_t                 iSendSequenceNumber;
 
+    // redundant copy of the previous block: the current block followed by
+    // the previous one (secured by the conversion buffer mutex)
+    bool                    bRedundancyEnabled;
+    bool                    bUseRedundancy;
+    bool                    bRedundantBlockValid;
+    CVector<uint8_t>        vecbyRedundantBlock;
+
+    // discontinuous transmission: the receiver state is secured by the socket
+    // buffer mutex, the sender state by the conversion buffer mutex
+    bool                    bDtxReceiving;
+    int                     iDtxKeepAliveCnt;
+    CVector<uint8_t>        vecbyDtxPacket;
+
+    // statistics of the received packets (secured by the socket buffer mutex)
+    CLinkTelemetry          LinkTelemetry;
+    CChannelMetrics         Metrics;
+
     // network output conversion buffer
     CConvBuf<uint8_t>       ConvBuf;
 
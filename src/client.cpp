@@ -25,6 +25,9 @@
  *
 \******************************************************************************/
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <random>
 #include "client.h"
 
 
@@ -52,6 +55,9 @@ CClient::CClient ( const quint16  iPortNumber,
     bIsInitializationPhase           ( true ),
     bMuteOutStream                   ( false ),
     fMuteOutStreamGain               ( 1.0f ),
+    bDtxEnabled                      ( false ),
+    iDtxNumSilentFrames              ( 0 ),
+    bOfflineLoopback                 ( false ),
     Socket                           ( this , &Channel, iPortNumber ),
     Sound                            ( AudioCallback, this, strMIDISetup, bNoAutoJackConnect, strNClientName ),
     iAudioInFader                    ( AUD_FADER_IN_MIDDLE ),
@@ -69,6 +75,8 @@ CClient::CClient ( const quint16  iPortNumber,
     bJitterBufferOK                  ( true ),
     bNuteMeInPersonalMix             ( bNMuteMeInPersonalMix ),
     iServerSockBufNumFrames          ( DEF_NET_BUF_SIZE_NUM_BL ),
+    iServerPingTimeMs                ( 0 ),
+    iOpusLookaheadSam                ( 0 ),
     pSignalHandler                   ( CSignalHandler::getSingletonP() ),
     strStartupAddress                ( strConnOnStartupAddress ),
     strCentralServerAddressClient    ( strCentralServer ),
@@ -76,11 +84,15 @@ CClient::CClient ( const quint16  iPortNumber,
     iMaxNumChannels                  ( iNewMaxNumChan ),
     bLocalServer                     ( localServer ),
     iPort                            ( iPortNumber ),
-    serverNameChanged                ( false )
+    serverNameChanged                ( false ),
+    iSessionReqIntervalMs            ( SESSION_SUBSCR_RETRY_INIT_MS )
 {
     int iOpusError;
     int i;
 
+    // the float sound interfaces (JACK) process the audio without conversions
+    // to int16
+    Sound.SetFloatProcessCallback ( AudioCallbackFloat );
 
     // P2P: enable all channels (all channel must be enabled the
     // entire life time of the software)
@@ -89,8 +101,16 @@ CClient::CClient ( const quint16  iPortNumber,
     {
         p2pChannels[i].SetIsServer( false );
         p2pChannels[i].SetP2pType( true );
+        p2pChannels[i].EnableLinkTelemetry();
     }
 
+    for ( i = 0; i < MAX_NUM_CHANNELS; i++ )
+    {
+        p2pPeerHasP2pPing[i] = false;
+    }
+
+    Channel.EnableLinkTelemetry();
+
     OpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
                                          DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES,
                                          &iOpusError );
@@ -238,6 +258,9 @@ CClient::CClient ( const quint16  iPortNumber,
     QObject::connect ( &ConnLessProtocol, &CProtocol::CLPublicIpRec,
         this, &CClient::OnCLPublicIpRec );
 
+    QObject::connect ( &ConnLessProtocol, &CProtocol::CLSessionAddressReceived,
+        this, &CClient::OnCLSessionAddressReceived );
+
     QObject::connect ( &ConnLessProtocol, &CProtocol::CLConnClientsListMesReceived,
         this, &CClient::CLConnClientsListMesReceived );
 
@@ -256,6 +279,18 @@ CClient::CClient ( const quint16  iPortNumber,
     QObject::connect ( &ConnLessProtocol, &CProtocol::CLChannelLevelListReceived,
         this, &CClient::CLChannelLevelListReceived );
 
+    QObject::connect ( &ConnLessProtocol, &CProtocol::CLP2pConnCheckReceived,
+        this, &CClient::OnCLP2pConnCheckReceived );
+
+    QObject::connect ( &ConnLessProtocol, &CProtocol::CLP2pConnCheckRespReceived,
+        this, &CClient::OnCLP2pConnCheckRespReceived );
+
+    QObject::connect ( &ConnLessProtocol, &CProtocol::CLP2pPingReceived,
+        this, &CClient::OnCLP2pPingReceived );
+
+    QObject::connect ( &ConnLessProtocol, &CProtocol::CLP2pPingRespReceived,
+        this, &CClient::OnCLP2pPingRespReceived );
+
     // other
     QObject::connect ( &Sound, &CSound::ReinitRequest,
         this, &CClient::OnSndCrdReinitRequest );
@@ -281,13 +316,21 @@ CClient::CClient ( const quint16  iPortNumber,
     // start timer so that elapsed time works
     PreciseTime.start();
 
-    // timer
+    // timer (the session request is re-armed with an exponential backoff)
+    TimerClientReReqServList.setSingleShot ( true );
+
     QObject::connect ( &TimerClientReReqServList, &QTimer::timeout,
         this, &CClient::OnTimerClientReReqServList );
 
     QObject::connect ( &TimerPingP2pClients, &QTimer::timeout,
         this, &CClient::OnTimerPingP2pClients );
 
+    QObject::connect ( &TimerP2pConnCheck, &QTimer::timeout,
+        this, &CClient::OnTimerP2pConnCheck );
+
+    QObject::connect ( &TimerLatencyBudget, &QTimer::timeout,
+        this, &CClient::OnTimerLatencyBudget );
+
     QObject::connect ( this, &CClient::Stopped,
         &JamController, &recorder::CJamController::Stopped );
 
@@ -306,10 +349,6 @@ CClient::CClient ( const quint16  iPortNumber,
     // QObject::connect ( &JamController, &recorder::CJamController::EndRecorderThread,
     //     this, &CServer::EndRecorderThread );
 
-    qRegisterMetaType<CVector<int16_t>> ( "CVector<int16_t>" );
-    QObject::connect ( this, &CClient::AudioFrame,
-        &JamController, &recorder::CJamController::AudioFrame );
-
     bRecorderEnabled = false;
     bStopRecorder = false;
 
@@ -331,9 +370,8 @@ CClient::CClient ( const quint16  iPortNumber,
             }
             else
             {
-                // Start waiting for server list from central server
-                waitingForIp = true;
-                TimerClientReReqServList.start( 1000 ); //ms
+                // Start waiting for the session address from central server
+                StartSessionAddressRequest();
             }
         }
     }
@@ -341,6 +379,11 @@ CClient::CClient ( const quint16  iPortNumber,
 
 CClient::~CClient()
 {
+    // the emulator thread must not deliver packets to the socket which is
+    // destroyed before the emulator (the socket thread which is still running
+    // then handles its packets directly)
+    NetworkEmulator.Stop();
+
     // if we were running, stop sound device
     if ( Sound.IsRunning() )
     {
@@ -474,11 +517,96 @@ void CClient::OnCLPingReceived ( CHostAddress InetAddr,
         const int iCurDiff = EvaluatePingMessage ( iMs );
         if ( iCurDiff >= 0 )
         {
+            iServerPingTimeMs = iCurDiff;
+
             emit PingTimeReceived ( iCurDiff );
         }
     }
 }
 
+void CClient::CreateCLPingMesP2p()
+{
+    // the P2P ping carries a us time stamp so that the peer can add its own
+    // time stamp for the link telemetry, peers with an older version do not
+    // know this message and get the legacy ping (which keeps the NAT binding
+    // open) until they have answered a P2P ping
+    for ( int i = 0; i < p2pNumClientIps; i++ )
+    {
+        if ( !p2pPeerHasP2pPing[i] )
+        {
+            ConnLessProtocol.CreateCLPingMes ( p2pChannels[i].GetAddress(), PreparePingMessage() );
+        }
+
+        ConnLessProtocol.CreateCLP2pPingMes ( p2pChannels[i].GetAddress(), GetPreciseTimeUs() );
+    }
+}
+
+void CClient::OnCLP2pPingReceived ( CHostAddress InetAddr,
+                                    uint32_t     iTransmitUs )
+{
+    // answer with our own time stamp so that the peer can estimate the
+    // clock offset and the one-way delays, only peers of the current session
+    // are answered so that the client cannot be used as a reflector
+    if ( p2pEnabled )
+    {
+        const int iCurChanID = FindP2PChannel ( InetAddr );
+
+        if ( ( iCurChanID != INVALID_CHANNEL_ID ) && p2pChannels[iCurChanID].IsEnabled() )
+        {
+            ConnLessProtocol.CreateCLP2pPingRespMes ( InetAddr, iTransmitUs, GetPreciseTimeUs() );
+        }
+    }
+}
+
+void CClient::OnCLP2pPingRespReceived ( CHostAddress InetAddr,
+                                        uint32_t     iTransmitUs,
+                                        uint32_t     iPeerUs )
+{
+    const int iCurChanID = FindP2PChannel ( InetAddr );
+
+    if ( iCurChanID != INVALID_CHANNEL_ID )
+    {
+        p2pPeerHasP2pPing[iCurChanID] = true;
+
+        p2pChannels[iCurChanID].AddLinkPing ( iTransmitUs, iPeerUs, GetPreciseTimeUs() );
+    }
+}
+
+bool CClient::GetP2pLinkTelemetry ( const int iChanID, CLinkTelemetrySummary& LinkTelemetry )
+{
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( p2pChannels[i].IsEnabled() && ( p2pChannels[i].GetChannelID() == iChanID ) )
+        {
+            LinkTelemetry = p2pChannels[i].GetLinkTelemetrySummary();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QString CClient::DumpLinkTelemetry()
+{
+    QString strDump = QString ( "server %1: %2\n" )
+        .arg ( Channel.GetAddress().toString() )
+        .arg ( Channel.GetLinkTelemetry().ToString() );
+
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( p2pChannels[i].IsEnabled() )
+        {
+            strDump += QString ( "P2P channel %1 (%2): %3, clock drift %4 ppm\n" )
+                .arg ( p2pChannels[i].GetChannelID() )
+                .arg ( p2pChannels[i].GetAddress().toString() )
+                .arg ( p2pChannels[i].GetLinkTelemetry().ToString() )
+                .arg ( p2pDriftComp[i].GetDriftPpm(), 0, 'f', 1 );
+        }
+    }
+
+    return strDump;
+}
+
 void CClient::OnCLPingWithNumClientsReceived ( CHostAddress InetAddr,
                                                int          iMs,
                                                int          iNumClients )
@@ -514,6 +642,17 @@ void CClient::SetDoAutoSockBufSize ( const bool bValue )
     CreateServerJitterBufferMessage();
 }
 
+void CClient::SetRedundancyEnabled ( const bool bEnable )
+{
+    // the channels apply it with the audio stream properties in Init()
+    Channel.SetRedundancyEnabled ( bEnable );
+
+    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    {
+        p2pChannels[i].SetRedundancyEnabled ( bEnable );
+    }
+}
+
 void CClient::SetRemoteChanGain ( const int   iId,
                                   const float fGain,
                                   const bool  bIsMyOwnFader,
@@ -878,6 +1017,18 @@ void CClient::OnHandledSignal ( int sigNum )
         QCoreApplication::instance()->exit();
         break;
 
+    case SIGUSR1:
+        // dump the link telemetry and the latency budgets on the console
+        qInfo() << qUtf8Printable ( DumpLinkTelemetry() );
+        qInfo() << qUtf8Printable ( DumpLatencyBudgets() );
+        qInfo() << qUtf8Printable ( AudioProfiler.ToString() );
+
+        if ( !Sound.GetTestSignalReport().isEmpty() )
+        {
+            qInfo() << qUtf8Printable ( Sound.GetTestSignalReport() );
+        }
+        break;
+
     default:
         break;
     }
@@ -956,14 +1107,15 @@ void CClient::OnCLServerIpReceived ( CHostAddress,
     int vecSize = vecServerInfo.Size();
     if ( waitingForIp && (vecSize > 1) )
     {
-        //get Ip from server list
-        waitingForIp = false;
+        //get Ip from server list (keep waiting if the session is not yet in the list)
         for ( int i = 0; i<vecSize ; i++){
             // qInfo() << "DEBUG Hostaddr: " << i << " " << vecServerInfo[i].HostAddr.toString();
             // qInfo() << "DEBUG name: " << i << " " << vecServerInfo[i].strName;
             if ( vecServerInfo[i].HostAddr.toString() != "0.0.0.0:0" )
             {
                 // qInfo() << "DEBUG connection! ";
+                waitingForIp = false;
+                TimerClientReReqServList.stop();
                 emit ServerConnection( vecServerInfo[i].HostAddr.toString(), vecServerInfo[i].strName );
                 break;
             }
@@ -973,6 +1125,20 @@ void CClient::OnCLServerIpReceived ( CHostAddress,
     }
 }
 
+void CClient::OnCLSessionAddressReceived ( CHostAddress,
+                                           CHostAddress SessionInetAddr,
+                                           QString      strSessionName )
+{
+    // the central server pushed the address of our session
+    if ( waitingForIp && ( strSessionName == strStartupAddress ) )
+    {
+        waitingForIp = false;
+        TimerClientReReqServList.stop();
+
+        emit ServerConnection ( SessionInetAddr.toString(), strSessionName );
+    }
+}
+
 void CClient::Start()
 {
     if ( serverNameChanged )
@@ -988,10 +1154,14 @@ void CClient::Start()
 
     // start audio interface
     Sound.Start();
+
+    TimerLatencyBudget.start ( LATENCY_BUDGET_UPDATE_INTERVAL_MS );
 }
 
 void CClient::Stop()
 {
+    TimerLatencyBudget.stop();
+
     // stop audio interface
     Sound.Stop();
 
@@ -1162,12 +1332,13 @@ void CClient::Init()
         }
     }
 
+    // the algorithmic delay of the codec is needed for the latency budget
+    opus_custom_decoder_ctl ( CurOpusDecoder, OPUS_GET_LOOKAHEAD ( &iOpusLookaheadSam ) );
+
     // calculate stereo (two channels) buffer size
     iStereoBlockSizeSam = 2 * iMonoBlockSizeSam;
 
     vecCeltData.Init ( iCeltNumCodedBytes );
-    vecZeros.Init ( iStereoBlockSizeSam, 0 );
-    vecsStereoSndCrdMuteStream.Init ( iStereoBlockSizeSam );
 
     fMuteOutStreamGain = 1.0f;
 
@@ -1179,6 +1350,9 @@ void CClient::Init()
     // inits for network and channel
     vecbyNetwData.Init ( iCeltNumCodedBytes );
 
+    vecbyOfflineLoopback.Init ( iSndCrdFrameSizeFactor * iCeltNumCodedBytes );
+    veciOfflineLoopbackNumBytes.Init ( iSndCrdFrameSizeFactor, 0 );
+
     // set the channel network properties
     Channel.SetAudioStreamProperties ( eAudioCompressionType,
                                        iCeltNumCodedBytes,
@@ -1200,23 +1374,12 @@ void CClient::Init()
                        iStereoBlockSizeSam,
                        SYSTEM_SAMPLE_RATE_HZ );
 
-    // init the sound card conversion buffers
-    if ( bSndCrdConversionBufferRequired )
-    {
-        // inits for conversion buffer (the size of the conversion buffer must
-        // be the sum of input/output sizes which is the worst case fill level)
-        const int iSndCardStereoBlockSizeSamConvBuff = 2 * iSndCardMonoBlockSizeSamConvBuff;
-        const int iConBufSize                        = iStereoBlockSizeSam + iSndCardStereoBlockSizeSamConvBuff;
-
-        SndCrdConversionBufferIn.Init  ( iConBufSize );
-        SndCrdConversionBufferOut.Init ( iConBufSize );
-        vecDataConvBuf.Init            ( iStereoBlockSizeSam );
+    // init the buffers of the audio processing (including the sound card
+    // conversion buffers) for both sample types
+    const int iSndCardStereoBlockSizeSamConvBuff = bSndCrdConversionBufferRequired ? 2 * iSndCardMonoBlockSizeSamConvBuff : 0;
 
-        // the output conversion buffer must be filled with the inner
-        // block size for initialization (this is the latency which is
-        // introduced by the conversion buffer) to avoid buffer underruns
-        SndCrdConversionBufferOut.Put ( vecZeros, iStereoBlockSizeSam );
-    }
+    AudioBuffers.Init      ( iStereoBlockSizeSam, iSndCardStereoBlockSizeSamConvBuff, iMaxNumChannels );
+    AudioBuffersFloat.Init ( iStereoBlockSizeSam, iSndCardStereoBlockSizeSamConvBuff, iMaxNumChannels );
 
     // reset initialization phase flag and mute flag
     bIsInitializationPhase = true;
@@ -1228,9 +1391,7 @@ void CClient::Init()
     vecUseDoubleSysFraSizeConvBuf.Init ( iMaxNumChannels );
     vecNumFrameSizeConvBlocks.Init     ( iMaxNumChannels );
     vecvecbyCodedData.Init             ( iMaxNumChannels );
-    p2pvecvecsData.Init                ( iMaxNumChannels );
     p2pvecGains.Init                   ( iMaxNumChannels );
-    vecLoopAudio.Init                  ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES );
 }
 
 void CClient::AudioCallback ( CVector<int16_t>& psData, void* arg )
@@ -1239,7 +1400,7 @@ void CClient::AudioCallback ( CVector<int16_t>& psData, void* arg )
     CClient* pMyClientObj = static_cast<CClient*> ( arg );
 
     // process audio data
-    pMyClientObj->ProcessSndCrdAudioData ( psData );
+    pMyClientObj->ProcessSndCrdAudioData ( psData, pMyClientObj->AudioBuffers );
 
 /*
 // TEST do a soundcard jitter measurement
@@ -1248,57 +1409,137 @@ JitterMeas.Measure();
 */
 }
 
-void CClient::ProcessSndCrdAudioData ( CVector<int16_t>& vecsStereoSndCrd )
+void CClient::AudioCallbackFloat ( CVector<float>& vecfData, void* arg )
+{
+    // get the pointer to the object
+    CClient* pMyClientObj = static_cast<CClient*> ( arg );
+
+    // process audio data
+    pMyClientObj->ProcessSndCrdAudioData ( vecfData, pMyClientObj->AudioBuffersFloat );
+}
+
+// OPUS coding of the sample types of the audio processing
+static inline int OpusCustomEncode ( OpusCustomEncoder* pEncoder,
+                                     const int16_t*     psPcm,
+                                     const int          iFrameSize,
+                                     unsigned char*     pCompressed,
+                                     const int          iMaxNumBytes )
+{
+    return opus_custom_encode ( pEncoder, psPcm, iFrameSize, pCompressed, iMaxNumBytes );
+}
+
+static inline int OpusCustomEncode ( OpusCustomEncoder* pEncoder,
+                                     const float*       pfPcm,
+                                     const int          iFrameSize,
+                                     unsigned char*     pCompressed,
+                                     const int          iMaxNumBytes )
+{
+    return opus_custom_encode_float ( pEncoder, pfPcm, iFrameSize, pCompressed, iMaxNumBytes );
+}
+
+static inline int OpusCustomDecode ( OpusCustomDecoder*   pDecoder,
+                                     const unsigned char* pData,
+                                     const int            iNumBytes,
+                                     int16_t*             psPcm,
+                                     const int            iFrameSize )
+{
+    return opus_custom_decode ( pDecoder, pData, iNumBytes, psPcm, iFrameSize );
+}
+
+static inline int OpusCustomDecode ( OpusCustomDecoder*   pDecoder,
+                                     const unsigned char* pData,
+                                     const int            iNumBytes,
+                                     float*               pfPcm,
+                                     const int            iFrameSize )
+{
+    return opus_custom_decode_float ( pDecoder, pData, iNumBytes, pfPcm, iFrameSize );
+}
+
+// a frame is silent for the discontinuous transmission if no sample exceeds
+// the silence level
+template<typename TSample>
+static inline bool IsSilentFrame ( const TSample* pData,
+                                   const int      iNumSamples )
+{
+    const float fThreshold = CLIENT_DTX_SILENCE_LEVEL * SampleFullScale<TSample>();
+
+    for ( int i = 0; i < iNumSamples; i++ )
+    {
+        if ( std::abs ( static_cast<float> ( pData[i] ) ) > fThreshold )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename TSample>
+void CClient::ProcessSndCrdAudioData ( CVector<TSample>&             vecStereoSndCrd,
+                                       CClientAudioBuffers<TSample>& Buffers )
 {
     // check if a conversion buffer is required or not
     if ( bSndCrdConversionBufferRequired )
     {
         // add new sound card block in conversion buffer
-        SndCrdConversionBufferIn.Put ( vecsStereoSndCrd, vecsStereoSndCrd.Size() );
+        Buffers.SndCrdConversionBufferIn.Put ( vecStereoSndCrd, vecStereoSndCrd.Size() );
 
         // process all available blocks of data
-        while ( SndCrdConversionBufferIn.GetAvailData() >= iStereoBlockSizeSam )
+        while ( Buffers.SndCrdConversionBufferIn.GetAvailData() >= iStereoBlockSizeSam )
         {
             // get one block of data for processing
-            SndCrdConversionBufferIn.Get ( vecDataConvBuf, iStereoBlockSizeSam );
+            Buffers.SndCrdConversionBufferIn.Get ( Buffers.vecDataConvBuf, iStereoBlockSizeSam );
 
             // process audio data
-            ProcessAudioDataIntern ( vecDataConvBuf );
+            ProcessAudioDataIntern ( Buffers.vecDataConvBuf, Buffers );
 
-            SndCrdConversionBufferOut.Put ( vecDataConvBuf, iStereoBlockSizeSam );
+            Buffers.SndCrdConversionBufferOut.Put ( Buffers.vecDataConvBuf, iStereoBlockSizeSam );
         }
 
         // get processed sound card block out of the conversion buffer
-        SndCrdConversionBufferOut.Get ( vecsStereoSndCrd, vecsStereoSndCrd.Size() );
+        Buffers.SndCrdConversionBufferOut.Get ( vecStereoSndCrd, vecStereoSndCrd.Size() );
     }
     else
     {
         // regular case: no conversion buffer required
         // process audio data
-        ProcessAudioDataIntern ( vecsStereoSndCrd );
+        ProcessAudioDataIntern ( vecStereoSndCrd, Buffers );
     }
 }
 
-void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
+template<typename TSample>
+void CClient::ProcessAudioDataIntern ( CVector<TSample>&             vecStereoSndCrd,
+                                       CClientAudioBuffers<TSample>& Buffers )
 {
     int            i, j, iUnused;
     unsigned char* pCurCodedData;
 
+    // the processing times for the metrics and the latency budget are measured
+    // by the profiler
+    AudioProfiler.BeginCallback();
+
+    // the recorder state is only evaluated once per callback so that all tracks
+    // of a tick are recorded
+    const bool bRecordInCallback = bRecorderEnabled && !bStopRecorder;
 
     // Transmit signal ---------------------------------------------------------
     // update stereo signal level meter (not needed in headless mode)
 #ifndef HEADLESS
-    SignalLevelMeter.Update ( vecsStereoSndCrd,
+    SignalLevelMeter.Update ( vecStereoSndCrd,
                               iMonoBlockSizeSam,
                               true );
+
+    AudioProfiler.Mark ( CAudioProfiler::PS_LEVEL_METER );
 #endif
 
     // add reverberation effect if activated
     if ( iReverbLevel != 0 )
     {
-        AudioReverb.Process ( vecsStereoSndCrd,
+        AudioReverb.Process ( vecStereoSndCrd,
                               bReverbOnLeftChan,
                               static_cast<float> ( iReverbLevel ) / AUD_REVERB_MAX / 4 );
+
+        AudioProfiler.Mark ( CAudioProfiler::PS_REVERB );
     }
 
     // apply pan (audio fader) and mix mono signals
@@ -1317,8 +1558,8 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
             {
                 // note that the gain is always <= 1, therefore a simple cast is
                 // ok since we never can get an overload
-                vecsStereoSndCrd[j + 1] = static_cast<int16_t> ( fGainR * vecsStereoSndCrd[j + 1] );
-                vecsStereoSndCrd[j]     = static_cast<int16_t> ( fGainL * vecsStereoSndCrd[j] );
+                vecStereoSndCrd[j + 1] = static_cast<TSample> ( fGainR * vecStereoSndCrd[j + 1] );
+                vecStereoSndCrd[j]     = static_cast<TSample> ( fGainL * vecStereoSndCrd[j] );
             }
         }
         else
@@ -1330,9 +1571,9 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
 
             for ( i = 0, j = 0; i < iMonoBlockSizeSam; i++, j += 2 )
             {
-                // note that we need the Float2Short for stereo pan mode
-                vecsStereoSndCrd[i] = Float2Short (
-                    fGainL * vecsStereoSndCrd[j] + fGainR * vecsStereoSndCrd[j + 1] );
+                // note that we need the clipping of int16 samples for stereo pan mode
+                vecStereoSndCrd[i] = Float2Sample<TSample> (
+                    fGainL * vecStereoSndCrd[j] + fGainR * vecStereoSndCrd[j + 1] );
             }
         }
     }
@@ -1348,33 +1589,102 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         // overwrite input values)
         for ( i = iMonoBlockSizeSam - 1, j = iStereoBlockSizeSam - 2; i >= 0; i--, j -= 2 )
         {
-            vecsStereoSndCrd[j] = vecsStereoSndCrd[j + 1] = vecsStereoSndCrd[i];
+            vecStereoSndCrd[j] = vecStereoSndCrd[j + 1] = vecStereoSndCrd[i];
         }
     }
 
+    AudioProfiler.Mark ( CAudioProfiler::PS_PAN );
+
+    // export the local input for recording purpose (also if the stream is muted)
+    if ( bRecordInCallback )
+    {
+        static const QString      strLocalName = "local";
+        static const CHostAddress LocalAddress;
+
+        JamController.PutFrame ( CLIENT_REC_CH_LOCAL,
+                                 strLocalName,
+                                 LocalAddress,
+                                 iNumAudioChannels,
+                                 vecStereoSndCrd );
+    }
+
     for ( i = 0; i < iSndCrdFrameSizeFactor; i++ )
     {
+        // discontinuous transmission: after the hangover the silent (or muted)
+        // frames are neither encoded nor sent, only keep-alive packets are sent
+        // so that the receivers do not time out
+        if ( bDtxEnabled )
+        {
+            if ( bMuteOutStream ||
+                 IsSilentFrame ( &vecStereoSndCrd[i * iNumAudioChannels * iOPUSFrameSizeSamples],
+                                 iNumAudioChannels * iOPUSFrameSizeSamples ) )
+            {
+                if ( iDtxNumSilentFrames < CLIENT_DTX_HANGOVER_MS * SYSTEM_SAMPLE_RATE_HZ / 1000 / iOPUSFrameSizeSamples )
+                {
+                    iDtxNumSilentFrames++;
+                }
+                else
+                {
+                    if ( p2pEnabled )
+                    {
+                        for ( int i = 0; i < p2pNumClientIps; i++ )
+                        {
+                            if ( p2pChannels[i].IsEnabled() )
+                            {
+                                p2pChannels[i].PrepAndSendDtxPacket ( &Socket );
+                            }
+                        }
+                    }
+
+                    Channel.PrepAndSendDtxPacket ( &Socket );
+
+                    if ( bOfflineLoopback )
+                    {
+                        veciOfflineLoopbackNumBytes[i] = 0;
+                    }
+
+                    AudioProfiler.Mark ( CAudioProfiler::PS_SEND );
+                    continue;
+                }
+            }
+            else
+            {
+                iDtxNumSilentFrames = 0;
+            }
+        }
+
         // OPUS encoding
         if ( CurOpusEncoder != nullptr )
         {
             if ( bMuteOutStream )
             {
-                iUnused = opus_custom_encode ( CurOpusEncoder,
-                                               &vecZeros[i * iNumAudioChannels * iOPUSFrameSizeSamples],
-                                               iOPUSFrameSizeSamples,
-                                               &vecCeltData[0],
-                                               iCeltNumCodedBytes );
+                iUnused = OpusCustomEncode ( CurOpusEncoder,
+                                             &Buffers.vecZeros[i * iNumAudioChannels * iOPUSFrameSizeSamples],
+                                             iOPUSFrameSizeSamples,
+                                             &vecCeltData[0],
+                                             iCeltNumCodedBytes );
             }
             else
             {
-                iUnused = opus_custom_encode ( CurOpusEncoder,
-                                                &vecsStereoSndCrd[i * iNumAudioChannels * iOPUSFrameSizeSamples],
-                                                iOPUSFrameSizeSamples,
-                                                &vecCeltData[0],
-                                                   iCeltNumCodedBytes );
+                iUnused = OpusCustomEncode ( CurOpusEncoder,
+                                             &vecStereoSndCrd[i * iNumAudioChannels * iOPUSFrameSizeSamples],
+                                             iOPUSFrameSizeSamples,
+                                             &vecCeltData[0],
+                                             iCeltNumCodedBytes );
             }
         }
 
+        AudioProfiler.Mark ( CAudioProfiler::PS_ENCODE );
+
+        if ( bOfflineLoopback )
+        {
+            std::copy ( vecCeltData.begin(),
+                        vecCeltData.begin() + iCeltNumCodedBytes,
+                        vecbyOfflineLoopback.begin() + i * iCeltNumCodedBytes );
+
+            veciOfflineLoopbackNumBytes[i] = iCeltNumCodedBytes;
+        }
+
         if ( p2pEnabled )
         {
             // send coded audio to all other clients
@@ -1393,6 +1703,8 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         Channel.PrepAndSendPacket ( &Socket,
                                     vecCeltData,
                                     iCeltNumCodedBytes );
+
+        AudioProfiler.Mark ( CAudioProfiler::PS_SEND );
     }
 
 
@@ -1400,43 +1712,62 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
     // in case of mute stream, store local data
     if ( bMuteOutStream || p2pEnabled )
     {
-        vecsStereoSndCrdMuteStream = vecsStereoSndCrd;
+        Buffers.vecStereoSndCrdMuteStream = vecStereoSndCrd;
     }
 
     for ( i = 0; i < iSndCrdFrameSizeFactor; i++ )
     {
-        // receive a new block
-        const bool bReceiveDataOk =
-            ( Channel.GetData ( vecbyNetwData, iCeltNumCodedBytes ) == GS_BUFFER_OK );
-
-        // get pointer to coded data and manage the flags
-        if ( bReceiveDataOk )
+        if ( bOfflineLoopback )
         {
-            pCurCodedData = &vecbyNetwData[0];
+            // offline there is no server mix, our own coded frame is decoded
+            // instead (a frame suppressed by DTX is silence)
+            if ( veciOfflineLoopbackNumBytes[i] == 0 )
+            {
+                std::fill ( vecStereoSndCrd.begin() + i * iNumAudioChannels * iOPUSFrameSizeSamples,
+                            vecStereoSndCrd.begin() + ( i + 1 ) * iNumAudioChannels * iOPUSFrameSizeSamples,
+                            static_cast<TSample> ( 0 ) );
+                continue;
+            }
 
-            // on any valid received packet, we clear the initialization phase flag
-            bIsInitializationPhase = false;
+            pCurCodedData = &vecbyOfflineLoopback[i * iCeltNumCodedBytes];
         }
         else
         {
-            // for lost packets use null pointer as coded input data
-            pCurCodedData = nullptr;
+            // receive a new block
+            const bool bReceiveDataOk =
+                ( Channel.GetData ( vecbyNetwData, iCeltNumCodedBytes ) == GS_BUFFER_OK );
+
+            // get pointer to coded data and manage the flags
+            if ( bReceiveDataOk )
+            {
+                pCurCodedData = &vecbyNetwData[0];
+
+                // on any valid received packet, we clear the initialization phase flag
+                bIsInitializationPhase = false;
+            }
+            else
+            {
+                // for lost packets use null pointer as coded input data
+                pCurCodedData = nullptr;
 
-            // invalidate the buffer OK status flag
-            bJitterBufferOK = false;
+                // invalidate the buffer OK status flag
+                bJitterBufferOK = false;
+            }
         }
 
         // OPUS decoding
         if ( CurOpusDecoder != nullptr )
         {
-            iUnused = opus_custom_decode ( CurOpusDecoder,
-                                           pCurCodedData,
-                                           iCeltNumCodedBytes,
-                                           &vecsStereoSndCrd[i * iNumAudioChannels * iOPUSFrameSizeSamples],
-                                           iOPUSFrameSizeSamples );
+            iUnused = OpusCustomDecode ( CurOpusDecoder,
+                                         pCurCodedData,
+                                         iCeltNumCodedBytes,
+                                         &vecStereoSndCrd[i * iNumAudioChannels * iOPUSFrameSizeSamples],
+                                         iOPUSFrameSizeSamples );
         }
     }
 
+    AudioProfiler.Mark ( CAudioProfiler::PS_SERVER_DECODE );
+
     // Receive signal from CLIENTS (p2p) ---------------------------------------------------------- ----------------------------------------------------------
     int  iNumClients               = 0; // init connected client counter
 
@@ -1451,7 +1782,15 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
             vecChanIDsCurConChan[iNumClients] = i;
             iNumClients++;
         }
+        else
+        {
+            // a new connection starts with a new drift estimation
+            p2pDriftComp[i].Reset();
+        }
     }
+
+    AudioProfiler.Mark ( CAudioProfiler::PS_OTHER );
+
     // process connected channels
     for ( int i = 0; i < iNumClients; i++ )
     {
@@ -1466,7 +1805,7 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         vecvecbyCodedData[i].Init ( MAX_SIZE_BYTES_NETW_BUF );
 
          // we always use stereo audio buffers (which is the worst case)
-        p2pvecvecsData[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        Buffers.p2pvecvecData[i].Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
 
         // get and store number of audio channels and compression type
         vecNumAudioChannels[i] = p2pChannels[iCurChanID].GetNumAudioChannels();             // from NetTranspPropsReceived
@@ -1488,7 +1827,7 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         // update conversion buffer size (nothing will happen if the size stays the same)
         // if ( vecUseDoubleSysFraSizeConvBuf[i] )
         // {
-        //     DoubleFrameSizeConvBufIn[iCurChanID].SetBufferSize  ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
+        //     Buffers.DoubleFrameSizeConvBufIn[iCurChanID].SetBufferSize  ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
         //     DoubleFrameSizeConvBufOut[iCurChanID].SetBufferSize ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES  * vecNumAudioChannels[i] );
         // }
 
@@ -1520,69 +1859,115 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
             p2pCurOpusDecoder = nullptr;
         }
 
-        // If the server frame size is smaller than the received OPUS frame size, we need a conversion
-        // buffer which stores the large buffer.
-        // Note that we have a shortcut here. If the conversion buffer is not needed, the boolean flag
-        // is false and the Get() function is not called at all. Therefore if the buffer is not needed
-        // we do not spend any time in the function but go directly inside the if condition.
-        if ( ( vecUseDoubleSysFraSizeConvBuf[i] == 0 ) ||
-                !DoubleFrameSizeConvBufIn[iCurChanID].Get ( p2pvecvecsData[i], SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] ) )
-        {
-            // get current number of OPUS coded bytes
-            const int iCeltNumCodedBytes = p2pChannels[iCurChanID].GetCeltNumCodedBytes();
+        // the clock drift compensation decides if a frame is decoded: usually
+        // once per callback, sometimes none or two if the peer clock is slower
+        // or faster than the local sound card clock
+        CClockDriftCompensator& DriftComp = p2pDriftComp[iCurChanID];
+
+        DriftComp.Init ( vecNumAudioChannels[i], iOPUSFrameSizeSamples, SYSTEM_SAMPLE_RATE_HZ );
 
-            for ( int iB = 0; iB < vecNumFrameSizeConvBlocks[i]; iB++ )
+        while ( DriftComp.NeedsInput() )
+        {
+            // If the server frame size is smaller than the received OPUS frame size, we need a conversion
+            // buffer which stores the large buffer.
+            // Note that we have a shortcut here. If the conversion buffer is not needed, the boolean flag
+            // is false and the Get() function is not called at all. Therefore if the buffer is not needed
+            // we do not spend any time in the function but go directly inside the if condition.
+            if ( ( vecUseDoubleSysFraSizeConvBuf[i] == 0 ) ||
+                    !Buffers.DoubleFrameSizeConvBufIn[iCurChanID].Get ( Buffers.p2pvecvecData[i], SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] ) )
             {
-                // get data
-                const EGetDataStat eGetStat = p2pChannels[iCurChanID].GetData ( vecvecbyCodedData[i], iCeltNumCodedBytes );
+                // get current number of OPUS coded bytes
+                const int iCeltNumCodedBytes = p2pChannels[iCurChanID].GetCeltNumCodedBytes();
 
-                // if channel was just disconnected, set flag that connected
-                // client list is sent to all other clients
-                // and emit the client disconnected signal
-                if ( eGetStat == GS_CHAN_NOW_DISCONNECTED )
+                for ( int iB = 0; iB < vecNumFrameSizeConvBlocks[i]; iB++ )
                 {
-                    // if ( JamController.GetRecordingEnabled() )
-                    // {
-                    //     emit ClientDisconnected ( iCurChanID ); // TODO do this outside the mutex lock?
-                    // }
-                    qDebug() << "Timeout on p2pChannels[iCurChanID].GetChannelID()" << iCurChanID << p2pChannels[iCurChanID].GetChannelID();
-                    emit P2PChStateChange( p2pChannels[iCurChanID].GetChannelID(), false );
-
-                    //bChannelIsNowDisconnected = true; --> NOT DEFINED YET
-                }
+                    // get data
+                    const EGetDataStat eGetStat = p2pChannels[iCurChanID].GetData ( vecvecbyCodedData[i], iCeltNumCodedBytes );
 
-                // get pointer to coded data
-                if ( eGetStat == GS_BUFFER_OK )
-                {
-                    pCurCodedData = &vecvecbyCodedData[i][0];
-                }
-                else
-                {
-                    // for lost packets use null pointer as coded input data
-                    pCurCodedData = nullptr;
+                    // if channel was just disconnected, set flag that connected
+                    // client list is sent to all other clients
+                    // and emit the client disconnected signal
+                    if ( eGetStat == GS_CHAN_NOW_DISCONNECTED )
+                    {
+                        if ( bRecordInCallback )
+                        {
+                            emit JamController.ClientDisconnected ( CLIENT_REC_CH_FIRST_P2P + iCurChanID );
+                        }
+                        qDebug() << "Timeout on p2pChannels[iCurChanID].GetChannelID()" << iCurChanID << p2pChannels[iCurChanID].GetChannelID();
+                        emit P2PChStateChange( p2pChannels[iCurChanID].GetChannelID(), false );
+
+                        //bChannelIsNowDisconnected = true; --> NOT DEFINED YET
+                    }
+
+                    // get pointer to coded data
+                    if ( eGetStat == GS_BUFFER_OK )
+                    {
+                        pCurCodedData = &vecvecbyCodedData[i][0];
+                    }
+                    else
+                    {
+                        // for lost packets use null pointer as coded input data
+                        pCurCodedData = nullptr;
+                    }
+
+                    // OPUS decode received data stream (the peer suppresses its
+                    // silent input in DTX mode, no decoding needed)
+                    if ( eGetStat == GS_DTX_SILENCE )
+                    {
+                        std::fill ( Buffers.p2pvecvecData[i].begin() + iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i],
+                                    Buffers.p2pvecvecData[i].begin() + ( iB * SYSTEM_FRAME_SIZE_SAMPLES + iOPUSFrameSizeSamples ) * vecNumAudioChannels[i],
+                                    static_cast<TSample> ( 0 ) );
+                    }
+                    else if ( p2pCurOpusDecoder != nullptr )
+                    {
+                        iUnused = OpusCustomDecode ( p2pCurOpusDecoder,
+                                                     pCurCodedData,
+                                                     iCeltNumCodedBytes,
+                                                     &Buffers.p2pvecvecData[i][iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i]],
+                                                     iOPUSFrameSizeSamples );
+                    }
                 }
 
-                // OPUS decode received data stream
-                if ( p2pCurOpusDecoder != nullptr )
+                //this is NOT executed with my standard settings
+                // a new large frame is ready, if the conversion buffer is required, put it in the buffer
+                // and read out the small frame size immediately for further processing
+                if ( vecUseDoubleSysFraSizeConvBuf[i] != 0 )
                 {
-                    iUnused = opus_custom_decode ( p2pCurOpusDecoder,
-                                                    pCurCodedData,
-                                                    iCeltNumCodedBytes,
-                                                    &p2pvecvecsData[i][iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i]],
-                                                    iOPUSFrameSizeSamples );
+                    Buffers.DoubleFrameSizeConvBufIn[i].Init  ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ ); //-> new
+                    Buffers.DoubleFrameSizeConvBufIn[iCurChanID].PutAll ( Buffers.p2pvecvecData[i] );
+                    Buffers.DoubleFrameSizeConvBufIn[iCurChanID].Get ( Buffers.p2pvecvecData[i], SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] );
                 }
             }
 
-            //this is NOT executed with my standard settings
-            // a new large frame is ready, if the conversion buffer is required, put it in the buffer
-            // and read out the small frame size immediately for further processing
-            if ( vecUseDoubleSysFraSizeConvBuf[i] != 0 )
-            {
-                DoubleFrameSizeConvBufIn[i].Init  ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ ); //-> new
-                DoubleFrameSizeConvBufIn[iCurChanID].PutAll ( p2pvecvecsData[i] );
-                DoubleFrameSizeConvBufIn[iCurChanID].Get ( p2pvecvecsData[i], SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[i] );
-            }
+            DriftComp.Put ( Buffers.p2pvecvecData[i] );
+        }
+
+        DriftComp.Get ( Buffers.p2pvecvecData[i] );
+
+        // the fill level includes the decoded samples which wait in the
+        // compensator, the target is the middle of the jitter buffer (measured
+        // after the blocks of this callback were taken out)
+        const int iSockBufOccupancy = p2pChannels[iCurChanID].GetSockBufOccupancy();
+
+        if ( iSockBufOccupancy != INVALID_INDEX )
+        {
+            DriftComp.Update ( iSockBufOccupancy + DriftComp.GetNumBufferedSamples() * vecNumFrameSizeConvBlocks[i] / iOPUSFrameSizeSamples,
+                               ( p2pChannels[iCurChanID].GetSockBufNumFrames() - 1 ) / 2.0 );
+        }
+
+        // export the decoded P2P stream for recording purpose (copied into the
+        // preallocated slot of the recorder ring, the buffer is reused for the
+        // mix below)
+        if ( bRecordInCallback )
+        {
+            JamController.PutFrame ( CLIENT_REC_CH_FIRST_P2P + iCurChanID,
+                                     p2pChannels[iCurChanID].GetName(),
+                                     p2pChannels[iCurChanID].GetAddress(),
+                                     vecNumAudioChannels[i],
+                                     Buffers.p2pvecvecData[i] );
         }
+
+        AudioProfiler.Mark ( CAudioProfiler::PS_P2P_DECODE + iCurChanID );
     }
     //---------------------------------------------------------- (p2p) END
 
@@ -1592,79 +1977,225 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
     {
         for ( i = 0; i < iStereoBlockSizeSam; i++ )
         {
-            vecsStereoSndCrd[i] = Float2Short (
-                vecsStereoSndCrd[i] + vecsStereoSndCrdMuteStream[i] * fMuteOutStreamGain );
+            vecStereoSndCrd[i] = Float2Sample<TSample> (
+                vecStereoSndCrd[i] + Buffers.vecStereoSndCrdMuteStream[i] * fMuteOutStreamGain );
         }
     }
 
      //----------------------------------------------- (p2p)
     // mix audio from server & p2p Clients
-    CVector<double>  vecdIntermProcBuf; // use reference for faster access
-    vecdIntermProcBuf.Init    (  2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
-
-    CVector<int16_t> vecsSendData; // use reference for faster access
-    vecsSendData.Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */  );
+    MixP2pChannels ( iNumClients, Buffers );
 
-    int k;
+    // add p2p sound (vecP2pMix) to server audio (vecStereoSndCrd)
+    for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
+    {
+        vecStereoSndCrd[i] += Buffers.vecP2pMix[i];
+    }
 
-    // init intermediate processing vector with zeros since we mix all channels on that vector
-    vecdIntermProcBuf.Reset ( 0 );
+    for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
+    {
+        Buffers.vecLoopAudio[i] = Buffers.vecP2pMix[i];
+    }
 
+    AudioProfiler.Mark ( CAudioProfiler::PS_MIX );
+    //----------------------------------------------- (p2p) END
 
-    if ( eAudioChannelConf == CC_MONO )
+    // check if channel is connected and if we do not have the initialization phase
+    if ( Channel.IsConnected() && ( !bIsInitializationPhase ) )
     {
-        // Mono target channel -------------------------------------------------
-        for ( j = 0; j < iNumClients; j++ )
+        if ( eAudioChannelConf == CC_MONO )
         {
-            // this client runs mono
-            const CVector<int16_t>& vecsData = p2pvecvecsData[j];
-            const double            dGain    = p2pvecGains[j];
-
-            if ( dGain == static_cast<double> ( 1.0 ) )
-            {
-                if ( vecNumAudioChannels[j] == 1 )
-                {
-                    // mono
-                    for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
-                    {
-                        vecdIntermProcBuf[i] += vecsData[i];
-                    }
-                }
-                else
-                {
-                    // stereo: apply stereo-to-mono attenuation
-                    for ( i = 0, k = 0; i < iOPUSFrameSizeSamples; i++, k += 2 )
-                    {
-                        vecdIntermProcBuf[i] +=
-                            ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2;
-                    }
-                }
-            }
-            else
+            // copy mono data in stereo sound card buffer (note that since the input
+            // and output is the same buffer, we have to start from the end not to
+            // overwrite input values)
+            for ( i = iMonoBlockSizeSam - 1, j = iStereoBlockSizeSam - 2; i >= 0; i--, j -= 2 )
             {
-                if ( vecNumAudioChannels[j] == 1 )
-                {
-                    // mono
-                    for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
-                    {
-                        vecdIntermProcBuf[i] += vecsData[i] * dGain;
-                    }
-                }
-                else
-                {
-                    // stereo: apply stereo-to-mono attenuation
-                    for ( i = 0, k = 0; i < iOPUSFrameSizeSamples; i++, k += 2 )
-                    {
-                        vecdIntermProcBuf[i] +=  dGain *
-                            ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2;
-                    }
-                }
+                vecStereoSndCrd[j] = vecStereoSndCrd[j + 1] = vecStereoSndCrd[i];
             }
         }
-        // convert from double to short with clipping
-        for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
-        {
-            vecsSendData[i] = Float2Short ( vecdIntermProcBuf[i] );
+    }
+    else
+    {
+        // if not connected, clear data
+        vecStereoSndCrd.Reset ( 0 );
+    }
+
+    // update socket buffer size
+    Channel.UpdateSocketBufferSize();
+
+    for ( int i = 0; i < p2pNumClientIps; i++ )
+    {
+        // update socket buffer size
+        p2pChannels[i].UpdateSocketBufferSize();
+    }
+
+    AudioProfiler.Mark ( CAudioProfiler::PS_OTHER );
+
+    // export the audio data for recording purpose
+    if ( bRecordInCallback )
+    {
+        // the name and address are constant (no allocation per frame)
+        static const QString      strRecordingName = "recording";
+        static const CHostAddress RecordingAddress;
+
+        JamController.PutFrame ( CLIENT_REC_CH_MIX,
+                                 strRecordingName,
+                                 RecordingAddress,
+                                 2,
+                                 vecStereoSndCrd );
+        JamController.EndTick();
+    }
+    else if ( bStopRecorder )
+    {
+        JamController.SetEnableRecording ( false, true );
+        bStopRecorder = false;
+    }
+
+    AudioProfiler.Mark ( CAudioProfiler::PS_RECORDER );
+
+    // the callback must be processed within the duration of one block
+    AudioProfiler.EndCallback ( static_cast<qint64> ( iMonoBlockSizeSam ) * 1000000000 / SYSTEM_SAMPLE_RATE_HZ );
+
+    Q_UNUSED ( iUnused )
+}
+
+void CClient::WriteMetrics ( CMetricsWriter& Writer )
+{
+    // the server channel and the enabled P2P channels
+    QList<CChannel*> vecpChannels;
+    QStringList      vecstrLabels;
+
+    vecpChannels.append ( &Channel );
+    vecstrLabels.append ( CMetricsWriter::Label ( "peer", "server" ) + "," +
+                          CMetricsWriter::Label ( "address", Channel.GetAddress().toString() ) );
+
+    for ( int i = 0; i < p2pNumClientIps; i++ )
+    {
+        vecpChannels.append ( &p2pChannels[i] );
+        vecstrLabels.append ( CMetricsWriter::Label ( "peer", QString::number ( i ) ) + "," +
+                              CMetricsWriter::Label ( "address", p2pChannels[i].GetAddress().toString() ) );
+    }
+
+    CChannel::WriteMetrics ( Writer, "jamulus_client_channel", vecpChannels, vecstrLabels );
+
+    Writer.AddFamily ( "jamulus_client_callback_duration_seconds", "histogram", "Processing time of an audio callback." );
+    Writer.AddHistogram ( "jamulus_client_callback_duration_seconds", "", AudioProfiler.GetCallbackDurationHist() );
+
+    Writer.AddFamily ( "jamulus_client_deadline_misses_total", "counter", "Audio callbacks which took longer than a block." );
+    Writer.Add ( "jamulus_client_deadline_misses_total", "", AudioProfiler.GetTotalNumXruns() );
+
+    // worst case and xrun correlation of the callback stages
+    const CVector<CAudioProfilerStageStats> vecStageStats = AudioProfiler.GetStats();
+
+    Writer.AddFamily ( "jamulus_client_stage_worst_seconds", "gauge", "Worst processing time of a stage of the audio callback." );
+
+    for ( int i = 0; i < vecStageStats.Size(); i++ )
+    {
+        Writer.Add ( "jamulus_client_stage_worst_seconds", CMetricsWriter::Label ( "stage", vecStageStats[i].strName ),
+                     vecStageStats[i].dWorstUs / 1000000 );
+    }
+
+    Writer.AddFamily ( "jamulus_client_stage_xrun_dominant_total", "counter", "Xruns in which the stage took the longest." );
+
+    for ( int i = 0; i < vecStageStats.Size(); i++ )
+    {
+        Writer.Add ( "jamulus_client_stage_xrun_dominant_total", CMetricsWriter::Label ( "stage", vecStageStats[i].strName ),
+                     vecStageStats[i].iNumXrunsDominant );
+    }
+
+    // the transmit path are the stages until the packet is sent to the server
+    qint64 iTransmitNs = 0;
+    qint64 iDecodeNs   = AudioProfiler.GetTotalNs ( CAudioProfiler::PS_SERVER_DECODE );
+
+    for ( int iStage = CAudioProfiler::PS_LEVEL_METER; iStage <= CAudioProfiler::PS_SEND; iStage++ )
+    {
+        iTransmitNs += AudioProfiler.GetTotalNs ( iStage );
+    }
+
+    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    {
+        iDecodeNs += AudioProfiler.GetTotalNs ( CAudioProfiler::PS_P2P_DECODE + i );
+    }
+
+    Writer.AddFamily ( "jamulus_client_transmit_seconds_total", "counter", "CPU time of the OPUS encoder and the send path." );
+    Writer.Add ( "jamulus_client_transmit_seconds_total", "", static_cast<double> ( iTransmitNs ) / 1e9 );
+
+    Writer.AddFamily ( "jamulus_client_decode_seconds_total", "counter", "CPU time of the OPUS decoders." );
+    Writer.Add ( "jamulus_client_decode_seconds_total", "", static_cast<double> ( iDecodeNs ) / 1e9 );
+
+    Writer.AddFamily ( "jamulus_client_recorder_overflows_total", "counter", "Frames dropped because the recorder ring was full." );
+    Writer.Add ( "jamulus_client_recorder_overflows_total", "", JamController.GetNumRecorderOverflows() );
+}
+
+void CClient::MixP2pData ( const int                         iNumClients,
+                           const int                         iFrameSizeSamples,
+                           const EAudChanConf                eAudioChannelConf,
+                           const CVector<CVector<int16_t> >& vecvecsData,
+                           const CVector<double>&            vecdGains,
+                           const CVector<int>&               vecNumAudioChannels,
+                           CVector<double>&                  vecdIntermProcBuf,
+                           CVector<int16_t>&                 vecsSendData )
+{
+    int i, j, k;
+
+    // init intermediate processing vector with zeros since we mix all channels on that vector
+    vecdIntermProcBuf.Reset ( 0 );
+
+
+    if ( eAudioChannelConf == CC_MONO )
+    {
+        // Mono target channel -------------------------------------------------
+        for ( j = 0; j < iNumClients; j++ )
+        {
+            // this client runs mono
+            const CVector<int16_t>& vecsData = vecvecsData[j];
+            const double            dGain    = vecdGains[j];
+
+            if ( dGain == static_cast<double> ( 1.0 ) )
+            {
+                if ( vecNumAudioChannels[j] == 1 )
+                {
+                    // mono
+                    for ( i = 0; i < iFrameSizeSamples; i++ )
+                    {
+                        vecdIntermProcBuf[i] += vecsData[i];
+                    }
+                }
+                else
+                {
+                    // stereo: apply stereo-to-mono attenuation
+                    for ( i = 0, k = 0; i < iFrameSizeSamples; i++, k += 2 )
+                    {
+                        vecdIntermProcBuf[i] +=
+                            ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2;
+                    }
+                }
+            }
+            else
+            {
+                if ( vecNumAudioChannels[j] == 1 )
+                {
+                    // mono
+                    for ( i = 0; i < iFrameSizeSamples; i++ )
+                    {
+                        vecdIntermProcBuf[i] += vecsData[i] * dGain;
+                    }
+                }
+                else
+                {
+                    // stereo: apply stereo-to-mono attenuation
+                    for ( i = 0, k = 0; i < iFrameSizeSamples; i++, k += 2 )
+                    {
+                        vecdIntermProcBuf[i] +=  dGain *
+                            ( static_cast<double> ( vecsData[k] ) + vecsData[k + 1] ) / 2;
+                    }
+                }
+            }
+        }
+        // convert from double to short with clipping
+        for ( i = 0; i < iFrameSizeSamples; i++ )
+        {
+            vecsSendData[i] = Float2Short ( vecdIntermProcBuf[i] );
         }
     }
     else
@@ -1673,15 +2204,15 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         for ( j = 0; j < iNumClients; j++ )
         {
             // get a reference to the audio data and gain/pan of the current client
-            const CVector<int16_t>& vecsData = p2pvecvecsData[j];
-            const double            dGain    = p2pvecGains[j];
+            const CVector<int16_t>& vecsData = vecvecsData[j];
+            const double            dGain    = vecdGains[j];
 
             if ( dGain == static_cast<double> ( 1.0 ) )
             {
                 if ( vecNumAudioChannels[j] == 1 )
                 {
                     // mono: copy same mono data in both out stereo audio channels
-                    for ( i = 0, k = 0; i < iOPUSFrameSizeSamples; i++, k += 2 )
+                    for ( i = 0, k = 0; i < iFrameSizeSamples; i++, k += 2 )
                     {
                         // left/right channel
                         vecdIntermProcBuf[k]     += vecsData[i];
@@ -1691,7 +2222,7 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
                 else
                 {
                     // stereo
-                    for ( i = 0; i < ( 2 * iOPUSFrameSizeSamples ); i++ )
+                    for ( i = 0; i < ( 2 * iFrameSizeSamples ); i++ )
                     {
                         vecdIntermProcBuf[i] += vecsData[i];
                     }
@@ -1702,7 +2233,7 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
                 if ( vecNumAudioChannels[j] == 1 )
                 {
                     // mono: copy same mono data in both out stereo audio channels
-                    for ( i = 0, k = 0; i < iOPUSFrameSizeSamples; i++, k += 2 )
+                    for ( i = 0, k = 0; i < iFrameSizeSamples; i++, k += 2 )
                     {
                         // left/right channel
                         vecdIntermProcBuf[k]     += vecsData[i] * dGain;
@@ -1712,7 +2243,7 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
                 else
                 {
                     // stereo
-                    for ( i = 0; i < ( 2 * iOPUSFrameSizeSamples ); i++ )
+                    for ( i = 0; i < ( 2 * iFrameSizeSamples ); i++ )
                     {
                         // left/right channel
                         vecdIntermProcBuf[i]     += vecsData[i] *     dGain;
@@ -1723,69 +2254,94 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
 
         }
         // convert from double to short with clipping
-        for ( i = 0; i < ( 2 * iOPUSFrameSizeSamples ); i++ )
+        for ( i = 0; i < ( 2 * iFrameSizeSamples ); i++ )
         {
             vecsSendData[i] = Float2Short ( vecdIntermProcBuf[i] );
         }
     }
+}
 
-    // add p2p sound (vecsSendData) to server audio (vecsSendData)
-    for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
-    {
-        vecsStereoSndCrd[i] += vecsSendData[i];
-    }
+void CClient::MixP2pData ( const int                       iNumClients,
+                           const int                       iFrameSizeSamples,
+                           const EAudChanConf              eAudioChannelConf,
+                           const CVector<CVector<float> >& vecvecfData,
+                           const CVector<double>&          vecdGains,
+                           const CVector<int>&             vecNumAudioChannels,
+                           CVector<float>&                 vecfSendData )
+{
+    int i, j, k;
 
-    for ( i = 0; i < iOPUSFrameSizeSamples; i++ )
-    {
-        vecLoopAudio[i] = vecsSendData[i];
-    }
-    //----------------------------------------------- (p2p) END
+    // the float samples are mixed directly in the output vector
+    vecfSendData.Reset ( 0 );
 
-    // check if channel is connected and if we do not have the initialization phase
-    if ( Channel.IsConnected() && ( !bIsInitializationPhase ) )
+    for ( j = 0; j < iNumClients; j++ )
     {
+        const CVector<float>& vecfData = vecvecfData[j];
+        const float           fGain    = static_cast<float> ( vecdGains[j] );
+
         if ( eAudioChannelConf == CC_MONO )
         {
-            // copy mono data in stereo sound card buffer (note that since the input
-            // and output is the same buffer, we have to start from the end not to
-            // overwrite input values)
-            for ( i = iMonoBlockSizeSam - 1, j = iStereoBlockSizeSam - 2; i >= 0; i--, j -= 2 )
+            if ( vecNumAudioChannels[j] == 1 )
+            {
+                // mono
+                for ( i = 0; i < iFrameSizeSamples; i++ )
+                {
+                    vecfSendData[i] += vecfData[i] * fGain;
+                }
+            }
+            else
             {
-                vecsStereoSndCrd[j] = vecsStereoSndCrd[j + 1] = vecsStereoSndCrd[i];
+                // stereo: apply stereo-to-mono attenuation
+                for ( i = 0, k = 0; i < iFrameSizeSamples; i++, k += 2 )
+                {
+                    vecfSendData[i] += ( vecfData[k] + vecfData[k + 1] ) * ( fGain / 2 );
+                }
+            }
+        }
+        else
+        {
+            if ( vecNumAudioChannels[j] == 1 )
+            {
+                // mono: copy same mono data in both out stereo audio channels
+                for ( i = 0, k = 0; i < iFrameSizeSamples; i++, k += 2 )
+                {
+                    vecfSendData[k]     += vecfData[i] * fGain;
+                    vecfSendData[k + 1] += vecfData[i] * fGain;
+                }
+            }
+            else
+            {
+                // stereo
+                for ( i = 0; i < ( 2 * iFrameSizeSamples ); i++ )
+                {
+                    vecfSendData[i] += vecfData[i] * fGain;
+                }
             }
         }
     }
-    else
-    {
-        // if not connected, clear data
-        vecsStereoSndCrd.Reset ( 0 );
-    }
-
-    // update socket buffer size
-    Channel.UpdateSocketBufferSize();
-
-    for ( int i = 0; i < p2pNumClientIps; i++ )
-    {
-        // update socket buffer size
-        p2pChannels[i].UpdateSocketBufferSize();
-    }
+}
 
-    // export the audio data for recording purpose
-    if ( bRecorderEnabled && !bStopRecorder)
-    {
-        emit AudioFrame ( 0,
-                          "recording",
-                          CHostAddress(),
-                          2,
-                          vecsStereoSndCrd );
-    }
-    else if ( bStopRecorder )
-    {
-        JamController.SetEnableRecording ( false, true );
-        bStopRecorder = false;
-    }
+void CClient::MixP2pChannels ( const int iNumClients, CClientAudioBuffers<int16_t>& Buffers )
+{
+    MixP2pData ( iNumClients,
+                 iOPUSFrameSizeSamples,
+                 eAudioChannelConf,
+                 Buffers.p2pvecvecData,
+                 p2pvecGains,
+                 vecNumAudioChannels,
+                 Buffers.vecdIntermProcBuf,
+                 Buffers.vecP2pMix );
+}
 
-    Q_UNUSED ( iUnused )
+void CClient::MixP2pChannels ( const int iNumClients, CClientAudioBuffers<float>& Buffers )
+{
+    MixP2pData ( iNumClients,
+                 iOPUSFrameSizeSamples,
+                 eAudioChannelConf,
+                 Buffers.p2pvecvecData,
+                 p2pvecGains,
+                 vecNumAudioChannels,
+                 Buffers.vecP2pMix );
 }
 
 int CClient::EstimatedOverallDelay ( const int iPingTimeMs )
@@ -1845,25 +2401,174 @@ int CClient::EstimatedOverallDelay ( const int iPingTimeMs )
     return MathUtils::round ( fTotalBufferDelayMs + iPingTimeMs );
 }
 
-void CClient::OnTimerClientReReqServList()
+double CClient::GetBlockDurationMs ( const EAudComprType eAudComprType ) const
 {
-    // if the server list is not yet received, retransmit the request
-    if ( waitingForIp )
+    // one block of the jitter buffer contains one OPUS frame
+    if ( eAudComprType == CT_OPUS64 )
+    {
+        return static_cast<double> ( SYSTEM_FRAME_SIZE_SAMPLES ) * 1000 / SYSTEM_SAMPLE_RATE_HZ;
+    }
+
+    return static_cast<double> ( DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES ) * 1000 / SYSTEM_SAMPLE_RATE_HZ;
+}
+
+void CClient::UpdateLatencyBudgets()
+{
+    const double dBlockDurationMs = GetBlockDurationMs ( eAudioCompressionType );
+    const double dMixMs           = AudioProfiler.GetSmoothedUs ( CAudioProfiler::PS_MIX ) / 1000;
+
+    // the send side and the sound card are the same for all paths
+    CLatencyBudget Common;
+
+    // if the audio interface does not report separate input/output latencies,
+    // we assume two periods for the input and one period for the output (same
+    // assumption as in EstimatedOverallDelay())
+    const double dInOutLatencyMs = Sound.GetInOutLatencyMs();
+
+    if ( ( Sound.GetInLatencyMs() > 0.0f ) || ( Sound.GetOutLatencyMs() > 0.0f ) )
+    {
+        Common.dCaptureMs  = Sound.GetInLatencyMs();
+        Common.dPlaybackMs = Sound.GetOutLatencyMs();
+    }
+    else if ( dInOutLatencyMs > 0 )
+    {
+        Common.dCaptureMs  = dInOutLatencyMs * 2 / 3;
+        Common.dPlaybackMs = dInOutLatencyMs / 3;
+    }
+    else
+    {
+        const double dSndCrdBlockMs = GetSndCrdActualMonoBlSize() * 1000.0 / SYSTEM_SAMPLE_RATE_HZ;
+
+        Common.dCaptureMs  = 2 * dSndCrdBlockMs;
+        Common.dPlaybackMs = dSndCrdBlockMs;
+    }
+
+    Common.dConvBufMs        = GetSndCrdConvBufAdditionalDelayMonoBlSize() * 1000.0 / SYSTEM_SAMPLE_RATE_HZ;
+    Common.dCodecFrameMs     = GetSystemMonoBlSize() * 1000.0 / SYSTEM_SAMPLE_RATE_HZ;
+    Common.dCodecLookaheadMs = iOpusLookaheadSam * 1000.0 / SYSTEM_SAMPLE_RATE_HZ;
+    Common.dSendQueueMs      = 0;
+
+    // the processing until the packet is sent to the server
+    for ( int iStage = CAudioProfiler::PS_LEVEL_METER; iStage <= CAudioProfiler::PS_SEND; iStage++ )
     {
-        // convert central server address string to chostaddress
-        CHostAddress HostAddressCent;
-        if( NetworkUtil().ParseNetworkAddress ( strCentralServerAddressClient, HostAddressCent ))
+        Common.dSendQueueMs += AudioProfiler.GetSmoothedUs ( iStage ) / 1000;
+    }
+
+    vecLatencyBudgets.Init ( 0 );
+
+    // server path: our own signal goes to the server and back, the jitter
+    // buffer of the server cannot be measured, therefore we use its size with
+    // the server does not report its jitter buffer occupancy, therefore the
+    // server part is only estimated from the configured buffer size with the
+    // same compensation factor as in EstimatedOverallDelay() plus one block
+    // for the mixing
+    CLatencyBudget ServerBudget = Common;
+
+    ServerBudget.PeerAddr         = Channel.GetAddress();
+    ServerBudget.bServerEstimated = true;
+    ServerBudget.dNetworkMs       = iServerPingTimeMs;
+    ServerBudget.dServerMs        = ( GetServerSockBufNumFrames() * 0.7 + 1 ) * dBlockDurationMs;
+    ServerBudget.dJitBufMs        = Channel.GetLinkTelemetrySummary().dOccupancyBlocks * dBlockDurationMs;
+    ServerBudget.dDecodeMixMs     = AudioProfiler.GetSmoothedUs ( CAudioProfiler::PS_SERVER_DECODE ) / 1000 + dMixMs;
+
+    vecLatencyBudgets.Add ( ServerBudget );
+
+    // P2P paths: the signal of the peer comes directly to us
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( p2pChannels[i].IsEnabled() )
+        {
+            const CLinkTelemetrySummary LinkTelemetry = p2pChannels[i].GetLinkTelemetrySummary();
+            CLatencyBudget              P2pBudget     = Common;
+
+            P2pBudget.iChanID      = p2pChannels[i].GetChannelID();
+            P2pBudget.PeerAddr     = p2pChannels[i].GetAddress();
+            P2pBudget.bIsP2p       = true;
+            P2pBudget.dNetworkMs   = std::max ( LinkTelemetry.dOneWayDelayDownMs, 0.0 );
+            P2pBudget.dJitBufMs    = LinkTelemetry.dOccupancyBlocks *
+                GetBlockDurationMs ( p2pChannels[i].GetAudioCompressionType() );
+            P2pBudget.dDecodeMixMs = AudioProfiler.GetSmoothedUs ( CAudioProfiler::PS_P2P_DECODE + i ) / 1000 + dMixMs;
+
+            vecLatencyBudgets.Add ( P2pBudget );
+        }
+    }
+
+    emit LatencyBudgetsUpdated ( vecLatencyBudgets );
+}
+
+QString CClient::DumpLatencyBudgets() const
+{
+    QString    strDump;
+    QJsonArray JsonBudgets;
+
+    for ( int i = 0; i < vecLatencyBudgets.Size(); i++ )
+    {
+        const CLatencyBudget& Budget = vecLatencyBudgets[i];
+
+        if ( Budget.bIsP2p )
+        {
+            strDump += QString ( "latency P2P channel %1 (%2): %3\n" )
+                .arg ( Budget.iChanID )
+                .arg ( Budget.PeerAddr.toString() )
+                .arg ( Budget.ToString() );
+        }
+        else
+        {
+            strDump += QString ( "latency server %1: %2\n" )
+                .arg ( Budget.PeerAddr.toString() )
+                .arg ( Budget.ToString() );
+        }
+
+        JsonBudgets.append ( Budget.ToJson() );
+    }
+
+    return strDump + QJsonDocument ( JsonBudgets ).toJson ( QJsonDocument::Compact );
+}
+
+void CClient::StartSessionAddressRequest()
+{
+    // the first subscription is sent immediately, the central server pushes
+    // the session address as soon as the session is registered
+    waitingForIp          = true;
+    iSessionReqIntervalMs = SESSION_SUBSCR_RETRY_INIT_MS;
+
+    SendSessionAddressRequest ( false );
+}
+
+void CClient::SendSessionAddressRequest ( const bool bIsRetry )
+{
+    // convert central server address string to chostaddress
+    CHostAddress HostAddressCent;
+
+    if ( NetworkUtil().ParseNetworkAddress ( strCentralServerAddressClient, HostAddressCent ) )
+    {
+        ConnLessProtocol.CreateCLSubscribeSessionMes ( HostAddressCent, strStartupAddress );
+
+        // central servers which do not support the subscription ignore the
+        // message, for them we fall back to requesting the server list
+        if ( bIsRetry )
         {
-            // request list from server
             CreateCLReqServerListMes ( HostAddressCent, strStartupAddress );
-            return;
         }
-        qInfo() << "central server address not possible to parse";
-        return;
     }
     else
     {
-        TimerClientReReqServList.stop();
+        qInfo() << "central server address not possible to parse";
+    }
+
+    // the subscription is connection less, retransmit it in case it got lost
+    TimerClientReReqServList.start ( iSessionReqIntervalMs );
+}
+
+void CClient::OnTimerClientReReqServList()
+{
+    // if the session address is not yet received, retransmit the request
+    // with an exponential backoff
+    if ( waitingForIp )
+    {
+        iSessionReqIntervalMs = std::min ( 2 * iSessionReqIntervalMs, SESSION_SUBSCR_RETRY_MAX_MS );
+
+        SendSessionAddressRequest ( true );
     }
 }
 
@@ -1884,7 +2589,8 @@ void CClient::OnConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo )
 
     p2pNumClientIps = vecChanInfo.Size();
 
-    int p2pChannelIndex = 0;
+    int  p2pChannelIndex   = 0;
+    bool bConnCheckStarted = false;
 
     for ( int i = 0; ( i < MAX_NUM_CHANNELS ) && ( i < vecChanInfo.Size() )  ; i++ )
     {
@@ -1924,12 +2630,27 @@ void CClient::OnConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo )
 
         }
 
-        // save ipv4 chostaddr to channel
-        p2pChannels[p2pChannelIndex].SetAddress(HostAddr_temp);
-
         // save local and global address as key to lookup id
         CHostAddress LocalIpAddress = CHostAddress(vecChanInfo[i].LIpAddr, vecChanInfo[i].LiPort);
         CHostAddress PublicIpAddress = CHostAddress(vecChanInfo[i].PIpAddr, vecChanInfo[i].PiPort);
+
+        // for a new peer, use the preferred address until the connectivity
+        // check has selected the best candidate (for a known peer the address
+        // selected by the previous check is kept)
+        if ( !p2pConnChecks[p2pChannelIndex].IsSamePeer ( vecChanInfo[i].iChanID, LocalIpAddress, PublicIpAddress ) )
+        {
+            // save ipv4 chostaddr to channel
+            p2pChannels[p2pChannelIndex].SetAddress(HostAddr_temp);
+
+            p2pConnChecks[p2pChannelIndex].Start ( vecChanInfo[i].iChanID, LocalIpAddress, PublicIpAddress );
+            bConnCheckStarted = true;
+
+            // the version of the new peer is not known yet
+            p2pPeerHasP2pPing[p2pChannelIndex] = false;
+
+            p2pChannels[p2pChannelIndex].ResetLinkTelemetry();
+        }
+
         p2pChannels[p2pChannelIndex].SetKey ( LocalIpAddress,  PublicIpAddress );
 
         // set channel id of channel
@@ -1945,11 +2666,122 @@ void CClient::OnConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo )
     {
         // disable all other channels
         p2pChannels[p2pChannelIndex].SetEnable ( false );
+        p2pConnChecks[p2pChannelIndex].Reset();
+    }
+
+    // send the first checks right away, the timer retransmits them for the
+    // candidates which have not yet answered
+    if ( bConnCheckStarted )
+    {
+        OnTimerP2pConnCheck();
+        TimerP2pConnCheck.start ( P2P_CONN_CHECK_INTERVAL_MS );
     }
 
     TimerPingP2pClients.start( 1000 );
 }
 
+void CClient::OnTimerP2pConnCheck()
+{
+    bool bAnyCheckRunning = false;
+
+    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    {
+        if ( !p2pConnChecks[i].IsRunning() )
+        {
+            continue;
+        }
+
+        if ( p2pConnChecks[i].IsTimedOut() )
+        {
+            p2pConnChecks[i].Stop();
+
+            if ( !p2pConnChecks[i].HasSelectedCandidate() )
+            {
+                qInfo() << qUtf8Printable ( QString ( "P2P connectivity check for channel %1 failed, using %2" )
+                    .arg ( p2pChannels[i].GetChannelID() )
+                    .arg ( p2pChannels[i].GetAddress().toString() ) );
+            }
+            continue;
+        }
+
+        bAnyCheckRunning = true;
+
+        // all candidates are checked in parallel, the transmit time is used
+        // to measure the round trip time of each candidate
+        const int iMs = PreparePingMessage();
+
+        for ( int j = 0; j < p2pConnChecks[i].GetNumCandidates(); j++ )
+        {
+            if ( !p2pConnChecks[i].HasResponded ( j ) )
+            {
+                ConnLessProtocol.CreateCLP2pConnCheckMes ( p2pConnChecks[i].GetCandidate ( j ),
+                                                           iMs,
+                                                           p2pChannels[i].GetChannelID(),
+                                                           j,
+                                                           p2pConnChecks[i].GetTransactionID() );
+            }
+        }
+    }
+
+    if ( !bAnyCheckRunning )
+    {
+        TimerP2pConnCheck.stop();
+    }
+}
+
+void CClient::OnCLP2pConnCheckReceived ( CHostAddress InetAddr,
+                                         int          iMs,
+                                         int          iChanID,
+                                         int          iCandidateIdx,
+                                         uint32_t     iTransactionID )
+{
+    // only answer checks which are addressed to this client (the response
+    // also opens our NAT for the address of the peer)
+    if ( p2pEnabled && ( iChanID == Channel.GetChannelID() ) )
+    {
+        ConnLessProtocol.CreateCLP2pConnCheckRespMes ( InetAddr, iMs, iChanID, iCandidateIdx, iTransactionID );
+    }
+}
+
+void CClient::OnCLP2pConnCheckRespReceived ( CHostAddress InetAddr,
+                                             int          iMs,
+                                             int          iChanID,
+                                             int          iCandidateIdx,
+                                             uint32_t     iTransactionID )
+{
+    // take care of wrap arounds (if wrapping, do not use result)
+    const int iRttMs = EvaluatePingMessage ( iMs );
+
+    if ( iRttMs < 0 )
+    {
+        return;
+    }
+
+    for ( int i = 0; i < MAX_NUM_CHANNELS; i++ )
+    {
+        if ( p2pConnChecks[i].IsRunning() && ( p2pChannels[i].GetChannelID() == iChanID ) )
+        {
+            // use the candidate with the lowest round trip time
+            if ( p2pConnChecks[i].CandidateResponded ( iCandidateIdx, iTransactionID, InetAddr, iRttMs ) )
+            {
+                p2pChannels[i].SetAddress ( p2pConnChecks[i].GetSelectedAddress() );
+
+                qInfo() << qUtf8Printable ( QString ( "P2P channel %1 uses %2 (RTT %3 ms, setup time %4 ms)" )
+                    .arg ( iChanID )
+                    .arg ( p2pConnChecks[i].GetSelectedAddress().toString() )
+                    .arg ( p2pConnChecks[i].GetSelectedRttMs() )
+                    .arg ( p2pConnChecks[i].GetSetupTimeMs() ) );
+            }
+
+            if ( p2pConnChecks[i].AllCandidatesResponded() )
+            {
+                p2pConnChecks[i].Stop();
+            }
+            break;
+        }
+    }
+}
+
 bool CClient::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
                              const int               iNumBytesRead,
                              const CHostAddress&     HostAdr,
@@ -2136,7 +2968,196 @@ void CClient::OnServerRegisteredSuccessfully( QString serverName )
         serverNameChanged = true;
     }
 
-    // Start waiting for server list from central server
-    waitingForIp = true;
-    TimerClientReReqServList.start( 1000 ); //ms
+    // Start waiting for the session address from central server
+    StartSessionAddressRequest();
+}
+
+
+/******************************************************************************\
+* P2P Connectivity Check                                                       *
+\******************************************************************************/
+void CP2pConnCheck::Reset()
+{
+    iChanID        = INVALID_INDEX;
+    LocalAddr      = CHostAddress();
+    PublicAddr     = CHostAddress();
+    iTransactionID = 0;
+    iNumCandidates = 0;
+    iSelCandidate  = INVALID_INDEX;
+    iSetupTimeMs   = INVALID_INDEX;
+    bIsRunning     = false;
+}
+
+void CP2pConnCheck::Start ( const int           iNChanID,
+                            const CHostAddress& NLocalAddr,
+                            const CHostAddress& NPublicAddr )
+{
+    Reset();
+
+    // the transaction ID must not be predictable so that a third party cannot
+    // fake the responses of a candidate
+    static std::random_device RandomDevice;
+
+    iChanID        = iNChanID;
+    LocalAddr      = NLocalAddr;
+    PublicAddr     = NPublicAddr;
+    iTransactionID = static_cast<uint32_t> ( RandomDevice() );
+
+    // the order of the candidates defines the preference if the round trip
+    // times are equal
+    AddCandidate ( LocalAddr );
+    AddCandidate ( PublicAddr );
+
+    // server-reflexive port guesses for NATs which allocate the ports sequentially
+    for ( int i = 1; i <= P2P_NUM_PORT_GUESSES; i++ )
+    {
+        if ( PublicAddr.iPort + i <= 65535 )
+        {
+            AddCandidate ( CHostAddress ( PublicAddr.InetAddr, static_cast<quint16> ( PublicAddr.iPort + i ) ) );
+        }
+    }
+
+    StartTime.start();
+    bIsRunning = true;
+}
+
+void CP2pConnCheck::AddCandidate ( const CHostAddress& Candidate )
+{
+    // ignore invalid addresses
+    if ( ( Candidate.InetAddr.toIPv4Address() == 0 ) || ( Candidate.iPort == 0 ) )
+    {
+        return;
+    }
+
+    // ignore duplicates (e.g. if the peer is not behind a NAT)
+    for ( int i = 0; i < iNumCandidates; i++ )
+    {
+        if ( vecCandidates[i] == Candidate )
+        {
+            return;
+        }
+    }
+
+    if ( iNumCandidates < P2P_MAX_NUM_CANDIDATES )
+    {
+        vecCandidates[iNumCandidates] = Candidate;
+        veciRttMs[iNumCandidates]     = INVALID_INDEX;
+        iNumCandidates++;
+    }
+}
+
+bool CP2pConnCheck::CandidateResponded ( const int           iCandidateIdx,
+                                         const uint32_t      iRespTransactionID,
+                                         const CHostAddress& RespAddr,
+                                         const int           iRttMs )
+{
+    if ( ( iCandidateIdx < 0 ) || ( iCandidateIdx >= iNumCandidates ) )
+    {
+        return false;
+    }
+
+    // only accept the answer to our own request from the checked candidate,
+    // otherwise anybody who knows the channel ID could redirect the P2P audio
+    if ( ( iRespTransactionID != iTransactionID ) || !( vecCandidates[iCandidateIdx] == RespAddr ) )
+    {
+        return false;
+    }
+
+    // the first answer of any candidate defines the setup time
+    if ( iSetupTimeMs == INVALID_INDEX )
+    {
+        iSetupTimeMs = static_cast<int> ( StartTime.elapsed() );
+    }
+
+    if ( ( veciRttMs[iCandidateIdx] < 0 ) || ( iRttMs < veciRttMs[iCandidateIdx] ) )
+    {
+        veciRttMs[iCandidateIdx] = iRttMs;
+    }
+
+    // select the candidate with the lowest round trip time
+    int iBestCandidate = INVALID_INDEX;
+
+    for ( int i = 0; i < iNumCandidates; i++ )
+    {
+        if ( ( veciRttMs[i] >= 0 ) &&
+             ( ( iBestCandidate == INVALID_INDEX ) || ( veciRttMs[i] < veciRttMs[iBestCandidate] ) ) )
+        {
+            iBestCandidate = i;
+        }
+    }
+
+    const bool bSelectionChanged = ( iBestCandidate != iSelCandidate );
+
+    iSelCandidate = iBestCandidate;
+
+    return bSelectionChanged;
+}
+
+bool CP2pConnCheck::AllCandidatesResponded() const
+{
+    for ( int i = 0; i < iNumCandidates; i++ )
+    {
+        if ( veciRttMs[i] < 0 )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/******************************************************************************\
+* Latency Budget                                                               *
+\******************************************************************************/
+double CLatencyBudget::GetTotalMs() const
+{
+    return dCaptureMs + dConvBufMs + dCodecFrameMs + dCodecLookaheadMs + dSendQueueMs +
+        dNetworkMs + dServerMs + dJitBufMs + dDecodeMixMs + dPlaybackMs;
+}
+
+QString CLatencyBudget::ToString() const
+{
+    return QString ( "total %1 ms = capture %2 + conversion buffer %3 + codec frame %4 + "
+                     "codec lookahead %5 + send %6 + network %7 + server%12 %8 + "
+                     "jitter buffer %9 + decode/mix %10 + playback %11" )
+        .arg ( GetTotalMs(), 0, 'f', 1 )
+        .arg ( dCaptureMs, 0, 'f', 2 )
+        .arg ( dConvBufMs, 0, 'f', 2 )
+        .arg ( dCodecFrameMs, 0, 'f', 2 )
+        .arg ( dCodecLookaheadMs, 0, 'f', 2 )
+        .arg ( dSendQueueMs, 0, 'f', 2 )
+        .arg ( dNetworkMs, 0, 'f', 2 )
+        .arg ( dServerMs, 0, 'f', 2 )
+        .arg ( dJitBufMs, 0, 'f', 2 )
+        .arg ( dDecodeMixMs, 0, 'f', 2 )
+        .arg ( dPlaybackMs, 0, 'f', 2 )
+        .arg ( bServerEstimated ? " (est.)" : "" );
+}
+
+QJsonObject CLatencyBudget::ToJson() const
+{
+    QJsonObject Json;
+
+    Json["path"]             = QString ( bIsP2p ? "p2p" : "server" );
+    Json["peer"]             = PeerAddr.toString();
+    Json["total"]            = GetTotalMs();
+    Json["capture"]          = dCaptureMs;
+    Json["conv_buf"]         = dConvBufMs;
+    Json["codec_frame"]      = dCodecFrameMs;
+    Json["codec_lookahead"]  = dCodecLookaheadMs;
+    Json["send_queue"]       = dSendQueueMs;
+    Json["network"]          = dNetworkMs;
+    Json["server"]           = dServerMs;
+    Json["server_estimated"] = bServerEstimated;
+    Json["jitter_buffer"]    = dJitBufMs;
+    Json["decode_mix"]       = dDecodeMixMs;
+    Json["playback"]         = dPlaybackMs;
+
+    if ( bIsP2p )
+    {
+        Json["chan_id"] = iChanID;
+    }
+
+    return Json;
 }
@@ -33,6 +33,7 @@
 #include <QDateTime>
 #include <QMutex>
 #include <QTimer>
+#include <QJsonObject>
 #ifdef USE_OPUS_SHARED_LIB
 # include "opus/opus_custom.h"
 #else
@@ -40,6 +41,10 @@
 #endif
 #include "global.h"
 #include "socket.h"
+#include "packettrace.h"
+#include "netemulator.h"
+#include "metrics.h"
+#include "audioprofiler.h"
 #include "channel.h"
 #include "util.h"
 #include "buffer.h"
@@ -109,8 +114,177 @@
 // no valid channel number
 #define INVALID_CHANNEL_ID                  ( MAX_NUM_CHANNELS + 1 )
 
+// update interval of the latency budgets
+#define LATENCY_BUDGET_UPDATE_INTERVAL_MS   1000
+
+// channels of the recorder ring of the client: the received mix, the local
+// input and one track per P2P client (channel ID of the P2P client added)
+#define CLIENT_REC_CH_MIX                   0
+#define CLIENT_REC_CH_LOCAL                 1
+#define CLIENT_REC_CH_FIRST_P2P             2
+
+// discontinuous transmission (DTX): the input is silent below this level
+// (relative to full scale, about -72 dB), the packets are suppressed after the
+// hangover time
+#define CLIENT_DTX_SILENCE_LEVEL            ( 1.0f / 4096 )
+#define CLIENT_DTX_HANGOVER_MS              200
+
 
 /* Classes ********************************************************************/
+// ICE-lite like connectivity check of the candidate addresses of a P2P peer
+class CP2pConnCheck
+{
+public:
+    CP2pConnCheck() { Reset(); }
+
+    void Reset();
+    void Start ( const int           iNChanID,
+                 const CHostAddress& NLocalAddr,
+                 const CHostAddress& NPublicAddr );
+    void Stop() { bIsRunning = false; }
+
+    bool IsSamePeer ( const int           iNChanID,
+                      const CHostAddress& NLocalAddr,
+                      const CHostAddress& NPublicAddr ) const
+        { return ( iChanID == iNChanID ) && ( LocalAddr == NLocalAddr ) && ( PublicAddr == NPublicAddr ); }
+
+    // returns true if the selected candidate has changed, responses with
+    // another transaction ID or from another address than the checked
+    // candidate are ignored
+    bool CandidateResponded ( const int           iCandidateIdx,
+                              const uint32_t      iRespTransactionID,
+                              const CHostAddress& RespAddr,
+                              const int           iRttMs );
+
+    bool IsRunning() const { return bIsRunning; }
+    bool IsTimedOut() const { return StartTime.elapsed() > P2P_CONN_CHECK_TIME_OUT_MS; }
+    bool AllCandidatesResponded() const;
+
+    uint32_t     GetTransactionID() const { return iTransactionID; }
+    int          GetNumCandidates() const { return iNumCandidates; }
+    CHostAddress GetCandidate ( const int iIdx ) const { return vecCandidates[iIdx]; }
+    bool         HasResponded ( const int iIdx ) const { return veciRttMs[iIdx] >= 0; }
+
+    bool         HasSelectedCandidate() const { return iSelCandidate != INVALID_INDEX; }
+    CHostAddress GetSelectedAddress() const { return vecCandidates[iSelCandidate]; }
+    int          GetSelectedRttMs() const { return veciRttMs[iSelCandidate]; }
+
+    // time from the start of the check until the first candidate answered
+    int          GetSetupTimeMs() const { return iSetupTimeMs; }
+
+protected:
+    void AddCandidate ( const CHostAddress& Candidate );
+
+    int           iChanID;
+    CHostAddress  LocalAddr;
+    CHostAddress  PublicAddr;
+    uint32_t      iTransactionID;
+
+    CHostAddress  vecCandidates[P2P_MAX_NUM_CANDIDATES];
+    int           veciRttMs[P2P_MAX_NUM_CANDIDATES];
+    int           iNumCandidates;
+    int           iSelCandidate;
+
+    int           iSetupTimeMs;
+    bool          bIsRunning;
+    QElapsedTimer StartTime;
+};
+
+// Breakdown of the end-to-end (mouth to ear) latency of one audio path, all
+// values in ms. The server path is our own signal which goes to the server and
+// back. For a P2P path the send side of the peer cannot be measured locally,
+// therefore it is assumed to be equal to our own send side.
+class CLatencyBudget
+{
+public:
+    CLatencyBudget() :
+        iChanID           ( INVALID_CHANNEL_ID ),
+        bIsP2p            ( false ),
+        bServerEstimated  ( false ),
+        dCaptureMs        ( 0 ),
+        dConvBufMs        ( 0 ),
+        dCodecFrameMs     ( 0 ),
+        dCodecLookaheadMs ( 0 ),
+        dSendQueueMs      ( 0 ),
+        dNetworkMs        ( 0 ),
+        dServerMs         ( 0 ),
+        dJitBufMs         ( 0 ),
+        dDecodeMixMs      ( 0 ),
+        dPlaybackMs       ( 0 ) {}
+
+    double      GetTotalMs() const;
+    QString     ToString() const;
+    QJsonObject ToJson() const;
+
+    int          iChanID; // channel ID at the server (P2P path only)
+    CHostAddress PeerAddr;
+    bool         bIsP2p;
+    bool         bServerEstimated;  // dServerMs is not measured but estimated
+
+    double       dCaptureMs;        // sound card capture latency
+    double       dConvBufMs;        // sound card conversion buffer
+    double       dCodecFrameMs;     // filling the network packets
+    double       dCodecLookaheadMs; // OPUS algorithmic delay
+    double       dSendQueueMs;      // audio callback start until the packets are sent
+    double       dNetworkMs;        // measured network delay (round trip for the server path)
+    double       dServerMs;         // server jitter buffer and mixing (server path only)
+    double       dJitBufMs;         // measured jitter buffer occupancy
+    double       dDecodeMixMs;      // measured decoding and mixing time
+    double       dPlaybackMs;       // sound card playback latency
+};
+
+// buffers of the audio processing which depend on the sample type: int16 for
+// the sound interfaces with int16 samples, float (range -1 to 1) for the float
+// sound interfaces (JACK) which are processed without conversions to int16
+template<typename TSample>
+class CClientAudioBuffers
+{
+public:
+    // the conversion buffers are only allocated if the stereo sound card block
+    // size is not zero
+    void Init ( const int iStereoBlockSizeSam,
+                const int iSndCardStereoBlockSizeSamConvBuff,
+                const int iMaxNumChannels )
+    {
+        vecZeros.Init                  ( iStereoBlockSizeSam, 0 );
+        vecStereoSndCrdMuteStream.Init ( iStereoBlockSizeSam );
+
+        if ( iSndCardStereoBlockSizeSamConvBuff > 0 )
+        {
+            // the size of the conversion buffer must be the sum of input/output
+            // sizes which is the worst case fill level
+            const int iConBufSize = iStereoBlockSizeSam + iSndCardStereoBlockSizeSamConvBuff;
+
+            SndCrdConversionBufferIn.Init  ( iConBufSize );
+            SndCrdConversionBufferOut.Init ( iConBufSize );
+            vecDataConvBuf.Init            ( iStereoBlockSizeSam );
+
+            // the output conversion buffer must be filled with the inner
+            // block size for initialization (this is the latency which is
+            // introduced by the conversion buffer) to avoid buffer underruns
+            SndCrdConversionBufferOut.Put ( vecZeros, iStereoBlockSizeSam );
+        }
+
+        p2pvecvecData.Init     ( iMaxNumChannels );
+        vecdIntermProcBuf.Init ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        vecP2pMix.Init         ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES /* worst case buffer size */ );
+        vecLoopAudio.Init      ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES );
+    }
+
+    CBuffer<TSample>           SndCrdConversionBufferIn;
+    CBuffer<TSample>           SndCrdConversionBufferOut;
+    CVector<TSample>           vecDataConvBuf;
+    CVector<TSample>           vecStereoSndCrdMuteStream;
+    CVector<TSample>           vecZeros;
+
+    // P2P decoding and mixing
+    CConvBuf<TSample>          DoubleFrameSizeConvBufIn[MAX_NUM_CHANNELS];
+    CVector<CVector<TSample> > p2pvecvecData;
+    CVector<double>            vecdIntermProcBuf; // only used for int16
+    CVector<TSample>           vecP2pMix;
+    CVector<TSample>           vecLoopAudio;
+};
+
 class CClient : public QObject
 {
     Q_OBJECT
@@ -249,6 +423,12 @@ public:
 
     void SetMuteOutStream ( const bool bDoMute ) { bMuteOutStream = bDoMute; }
 
+    void SetDtxEnabled ( const bool bEnable ) { bDtxEnabled = bEnable; }
+
+    // redundant copy of the previous block in each packet to the server and
+    // the P2P clients (applied on the next start)
+    void SetRedundancyEnabled ( const bool bEnable );
+
     void SetRemoteChanGain ( const int iId, const float fGain, const bool bIsMyOwnFader, const bool bDoServerUpdate, const bool bDoClientUpdate );
 
     void SetRemoteChanPan ( const int iId, const float fPan )
@@ -262,16 +442,24 @@ public:
     void CreateCLPingMes()
         { ConnLessProtocol.CreateCLPingMes ( Channel.GetAddress(), PreparePingMessage() ); }
 
-    void CreateCLPingMesP2p()
-        {
-            for ( int i = 0; i < p2pNumClientIps; i++ )
-            {
-                ConnLessProtocol.CreateCLPingMes ( p2pChannels[i].GetAddress(), PreparePingMessage() );
-            }
-        }
+    void CreateCLPingMesP2p();
 
     void OnTimerPingP2pClients() { CreateCLPingMesP2p(); }
 
+    const CP2pConnCheck& GetP2pConnCheck ( const int iIdx ) const { return p2pConnChecks[iIdx]; }
+
+    // link telemetry of the P2P channel with the given (server) channel ID,
+    // returns false if there is no such P2P channel
+    bool GetP2pLinkTelemetry ( const int iChanID, CLinkTelemetrySummary& LinkTelemetry );
+
+    // textual dump of the link telemetry of the server and all P2P channels
+    QString DumpLinkTelemetry();
+
+    // latency budgets of the server path (first element) and all P2P paths,
+    // updated continuously while the client is running
+    CVector<CLatencyBudget> GetLatencyBudgets() const { return vecLatencyBudgets; }
+    QString DumpLatencyBudgets() const;
+
     void CreateCLServerListPingMes ( const CHostAddress& InetAddr )
     {
         ConnLessProtocol.CreateCLPingWithNumClientsMes ( InetAddr,
@@ -316,6 +504,47 @@ public:
                 .arg( enabled ) );
     }
 
+    // capture of the received packets and replay of a captured trace
+    void StartPacketTrace ( const QString& strFileName, const bool bHashOnly )
+        { PacketTrace.Open ( strFileName, bHashOnly ); Socket.SetPacketTrace ( &PacketTrace ); }
+
+    // the replay is offline only (see CPacketTraceReplay), the application
+    // quits when the whole trace was replayed
+    void StartPacketTraceReplay ( const QString& strFileName, const double dSpeed )
+    {
+        QObject::connect ( &PacketTraceReplay, &CPacketTraceReplay::Finished,
+                           QCoreApplication::instance(), &QCoreApplication::quit, Qt::QueuedConnection );
+
+        PacketTraceReplay.Start ( &Socket, strFileName, dSpeed );
+    }
+
+    // network impairment emulation of the sent and received packets
+    void StartNetworkEmulator ( const QStringList& slRules, const QString& strConfigFileName, const int iSeed )
+        { NetworkEmulator.Init ( slRules, strConfigFileName, iSeed ); Socket.SetNetworkEmulator ( &NetworkEmulator ); }
+
+    // metrics (the callback timing is always measured for the latency budget)
+    void EnableMetrics() {}
+
+    // profile of the stages of the audio callback (always measured)
+    const CAudioProfiler& GetAudioProfiler() const { return AudioProfiler; }
+    void                  ResetAudioProfiler() { AudioProfiler.Reset(); }
+    void WriteMetrics ( CMetricsWriter& Writer );
+
+    // test signal instead of the sound card input (headless client without
+    // sound card, used for the loopback mesh tests)
+    void SetTestSignal ( const int iFreqHz, const QList<int>& veciPeerFreqHz )
+        { Sound.SetTestSignal ( iFreqHz, veciPeerFreqHz ); }
+
+    // WAV files instead of the sound card (headless client without sound
+    // card, used for deterministic tests of the audio path)
+    // with the virtual clock the client runs offline (the socket neither sends
+    // nor receives) since the network is not virtualised, instead of the
+    // server mix our own coded signal is decoded (offline loopback)
+    void SetSoundFiles ( const QString& strInFileName, const QString& strOutFileName, const bool bVirtualClock )
+        { Sound.SetSoundFiles ( strInFileName, strOutFileName, bVirtualClock );
+          Socket.SetOfflineMode ( bVirtualClock );
+          bOfflineLoopback = bVirtualClock; }
+
     void SetRecorderState ( const bool enabled,
                             const QString newRecordingDir )
     {
@@ -351,23 +580,58 @@ public:
     QString GetRecordingDir() { return JamController.GetRecordingDir(); }
 
     void SetRecordingDir( QString newRecordingDir )
-        { JamController.SetRecordingDir ( newRecordingDir, iOPUSFrameSizeSamples, false ); }
+        { JamController.SetRecordingDir ( newRecordingDir, iOPUSFrameSizeSamples, false, CLIENT_REC_CH_FIRST_P2P + iMaxNumChannels ); }
+
+    // mixes the decoded audio of the P2P clients (public for the benchmarks)
+    static void MixP2pData ( const int                         iNumClients,
+                             const int                         iFrameSizeSamples,
+                             const EAudChanConf                eAudioChannelConf,
+                             const CVector<CVector<int16_t> >& vecvecsData,
+                             const CVector<double>&            vecdGains,
+                             const CVector<int>&               vecNumAudioChannels,
+                             CVector<double>&                  vecdIntermProcBuf,
+                             CVector<int16_t>&                 vecsSendData );
+
+    // float samples are mixed without intermediate buffer and without clipping
+    static void MixP2pData ( const int                       iNumClients,
+                             const int                       iFrameSizeSamples,
+                             const EAudChanConf              eAudioChannelConf,
+                             const CVector<CVector<float> >& vecvecfData,
+                             const CVector<double>&          vecdGains,
+                             const CVector<int>&             vecNumAudioChannels,
+                             CVector<float>&                 vecfSendData );
 
 protected:
     // callback function must be static, otherwise it does not work
     static void AudioCallback ( CVector<short>& psData, void* arg );
+    static void AudioCallbackFloat ( CVector<float>& vecfData, void* arg );
 
     void        Init();
-    void        ProcessSndCrdAudioData ( CVector<short>& vecsStereoSndCrd );
-    void        ProcessAudioDataIntern ( CVector<short>& vecsStereoSndCrd );
+
+    template<typename TSample>
+    void        ProcessSndCrdAudioData ( CVector<TSample>&             vecStereoSndCrd,
+                                         CClientAudioBuffers<TSample>& Buffers );
+
+    template<typename TSample>
+    void        ProcessAudioDataIntern ( CVector<TSample>&             vecStereoSndCrd,
+                                         CClientAudioBuffers<TSample>& Buffers );
+
+    void        MixP2pChannels ( const int iNumClients, CClientAudioBuffers<int16_t>& Buffers );
+    void        MixP2pChannels ( const int iNumClients, CClientAudioBuffers<float>& Buffers );
 
     int         PreparePingMessage();
+    uint32_t    GetPreciseTimeUs() { return static_cast<uint32_t> ( PreciseTime.nsecsElapsed() / 1000 ); }
     int         EvaluatePingMessage ( const int iMs );
     void        CreateServerJitterBufferMessage();
 
+    double      GetBlockDurationMs ( const EAudComprType eAudComprType ) const;
+    void        UpdateLatencyBudgets();
+
     // only one channel is needed for client application
     CChannel                Channel;
     CChannel                p2pChannels[MAX_NUM_CHANNELS];
+    CP2pConnCheck           p2pConnChecks[MAX_NUM_CHANNELS];
+    bool                    p2pPeerHasP2pPing[MAX_NUM_CHANNELS]; // peer answered a P2P ping
     CProtocol               ConnLessProtocol;
 
     // audio encoder/decoder
@@ -392,8 +656,16 @@ protected:
     bool                    bIsInitializationPhase;
     bool                    bMuteOutStream;
     float                   fMuteOutStreamGain;
+    bool                    bDtxEnabled;
+    int                     iDtxNumSilentFrames;
     CVector<unsigned char>  vecCeltData;
 
+    // offline loopback: the coded frames of the current callback, frames
+    // suppressed by DTX have zero bytes
+    bool                    bOfflineLoopback;
+    CVector<uint8_t>        vecbyOfflineLoopback;
+    CVector<int>            veciOfflineLoopbackNumBytes;
+
     //p2p audio encoder/decoder
     OpusCustomMode*            p2pOpus64Mode[MAX_NUM_CHANNELS];
     OpusCustomEncoder*         p2pOpus64EncoderMono[MAX_NUM_CHANNELS];
@@ -413,13 +685,18 @@ protected:
     CVector<int>               vecNumFrameSizeConvBlocks;
     CVector<int>               vecUseDoubleSysFraSizeConvBuf;
     CVector<CVector<uint8_t> > vecvecbyCodedData;
-    CConvBuf<int16_t>          DoubleFrameSizeConvBufIn[MAX_NUM_CHANNELS];
     CVector<double>            p2pvecGains;
-    CVector<int16_t>           vecLoopAudio;
 
-    CVector<CVector<int16_t> > p2pvecvecsData;
+    // resampling of the decoded P2P audio to the local sound card clock
+    CClockDriftCompensator     p2pDriftComp[MAX_NUM_CHANNELS];
 
+    // the packet trace and the network emulator must outlive the socket which
+    // uses them, the socket must outlive the trace replay, the emulator thread
+    // which sends through the socket is stopped in the destructor
+    CPacketTrace            PacketTrace;
+    CNetworkEmulator        NetworkEmulator;
     CHighPrioSocket         Socket;
+    CPacketTraceReplay      PacketTraceReplay;
     CSound                  Sound;
     CStereoSignalLevelMeter SignalLevelMeter;
 
@@ -435,11 +712,9 @@ protected:
 
     bool                    bSndCrdConversionBufferRequired;
     int                     iSndCardMonoBlockSizeSamConvBuff;
-    CBuffer<int16_t>        SndCrdConversionBufferIn;
-    CBuffer<int16_t>        SndCrdConversionBufferOut;
-    CVector<int16_t>        vecDataConvBuf;
-    CVector<int16_t>        vecsStereoSndCrdMuteStream;
-    CVector<int16_t>        vecZeros;
+
+    CClientAudioBuffers<int16_t> AudioBuffers;
+    CClientAudioBuffers<float>   AudioBuffersFloat;
 
     bool                    bFraSiFactPrefSupported;
     bool                    bFraSiFactDefSupported;
@@ -460,6 +735,16 @@ protected:
 
     // for ping measurement
     QElapsedTimer           PreciseTime;
+    int                     iServerPingTimeMs;
+
+    // latency budget: processing times of the audio callback (taken from the
+    // profiler) and OPUS algorithmic delay
+    QTimer                  TimerLatencyBudget;
+    CVector<CLatencyBudget> vecLatencyBudgets;
+    int                     iOpusLookaheadSam;
+
+    // stage durations of the audio callback (also used for the metrics)
+    CAudioProfiler          AudioProfiler;
 
     CSignalHandler*         pSignalHandler;
 
@@ -478,10 +763,17 @@ protected:
 
     bool                    bLocalServer;
     QTimer                  TimerPingP2pClients;
+    QTimer                  TimerP2pConnCheck;
     quint16                 iPort;
 
     bool                    serverNameChanged;
 
+    // interval of the session subscription retransmission (exponential backoff)
+    int                     iSessionReqIntervalMs;
+
+    void StartSessionAddressRequest();
+    void SendSessionAddressRequest ( const bool bIsRetry );
+
     //helper function for putaudiodata
     int                     FindChannel ( const CHostAddress& CheckAddr );
     int                     FindP2PChannel ( const CHostAddress& CheckAddr );
@@ -533,9 +825,34 @@ protected slots:
     void OnCLServerIpReceived ( CHostAddress,
                                 CVector<CServerInfo> vecServerInfo );
 
+    void OnCLSessionAddressReceived ( CHostAddress,
+                                      CHostAddress SessionInetAddr,
+                                      QString      strSessionName );
+
     //sczr
     void OnTimerClientReReqServList();
     void OnConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo );
+    void OnTimerP2pConnCheck();
+    void OnTimerLatencyBudget() { UpdateLatencyBudgets(); }
+
+    void OnCLP2pConnCheckReceived ( CHostAddress InetAddr,
+                                    int          iMs,
+                                    int          iChanID,
+                                    int          iCandidateIdx,
+                                    uint32_t     iTransactionID );
+
+    void OnCLP2pConnCheckRespReceived ( CHostAddress InetAddr,
+                                        int          iMs,
+                                        int          iChanID,
+                                        int          iCandidateIdx,
+                                        uint32_t     iTransactionID );
+
+    void OnCLP2pPingReceived ( CHostAddress InetAddr,
+                               uint32_t     iTransmitUs );
+
+    void OnCLP2pPingRespReceived ( CHostAddress InetAddr,
+                                   uint32_t     iTransmitUs,
+                                   uint32_t     iPeerUs );
 
     //received own public ip & port
     void OnCLPublicIpRec            ( CHostAddress          PInetAddr );
@@ -553,6 +870,7 @@ signals:
     void LicenceRequired ( ELicenceType eLicenceType );
     void VersionAndOSReceived ( COSUtil::EOpSystemType eOSType, QString strVersion );
     void PingTimeReceived ( int iPingTime );
+    void LatencyBudgetsUpdated ( CVector<CLatencyBudget> vecLatencyBudgets );
     void RecorderStateReceived ( ERecorderState eRecorderState );
 
     void CLServerListReceived ( CHostAddress         InetAddr,
@@ -589,12 +907,5 @@ signals:
 
     void Stopped();
 
-    // recorder
-    void AudioFrame ( const int              iChID,
-                      const QString          stChName,
-                      const CHostAddress     RecHostAddr,
-                      const int              iNumAudChan,
-                      const CVector<int16_t> vecsData );
-
     void SessionNameChanged ( const QString newServerName );
 };
@@ -194,6 +194,11 @@ LED bar:      lbr
 // change this parameter, you most probably have to adjust MAX_SIZE_BYTES_NETW_BUF.
 #define MAX_NUM_SERVERS_IN_SERVER_LIST   150 // reduced to 150 because we now have genre-based server lists
 
+// Maximum number of sessions registered at the central server. Since a session
+// request is only answered with the matching session, this number is not
+// limited by MAX_SIZE_BYTES_NETW_BUF.
+#define MAX_NUM_SESSIONS_IN_DIRECTORY    10000
+
 // defines the time interval at which the ping time is updated in the GUI
 #define PING_UPDATE_TIME_MS              500 // ms
 
@@ -227,6 +232,27 @@ LED bar:      lbr
 // to SERVLIST_REGIST_INTERV_MINUTES)
 #define REGISTER_SERVER_RETRY_LIMIT      5 // count
 
+// session subscription: the client retransmits the subscription with an
+// exponential backoff starting at the initial interval up to the maximum
+// interval, the central server drops pending subscriptions which were not
+// renewed within the time-out
+#define SESSION_SUBSCR_RETRY_INIT_MS     250   // ms
+#define SESSION_SUBSCR_RETRY_MAX_MS      4000  // ms
+#define SESSION_SUBSCR_TIME_OUT_MS       30000 // ms
+
+// maximum number of pending session subscriptions of one client IP address and
+// in total, further subscriptions are rejected until older ones time out
+#define MAX_NUM_SESSION_SUBSCR_PER_ADDR  8
+#define MAX_NUM_SESSION_SUBSCR           10000
+
+// P2P connectivity checks: all candidate addresses of a peer (local, public and
+// guessed public ports for NATs which allocate the ports sequentially) are
+// checked in parallel until all have answered or the time-out is reached
+#define P2P_NUM_PORT_GUESSES             2
+#define P2P_MAX_NUM_CANDIDATES           ( 2 + P2P_NUM_PORT_GUESSES )
+#define P2P_CONN_CHECK_INTERVAL_MS       100  // ms
+#define P2P_CONN_CHECK_TIME_OUT_MS       5000 // ms
+
 
 // Maximum length of fader tag and text message strings (Since for chat messages
 // some HTML code is added, we also have to define a second length which includes
@@ -0,0 +1,702 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QFile>
+#include <QTextStream>
+#include <QMap>
+#include <QRegExp>
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <random>
+#include <algorithm>
+#include "protocol.h"
+#include "packettrace.h"
+#include "jbeval.h"
+
+
+/* Implementation *************************************************************/
+void CSynthNetworkModel::Generate ( const double                 dDurationS,
+                                    const double                 dBlockDurationUs,
+                                    std::vector<CPacketArrival>& vecArrivals ) const
+{
+    std::mt19937                           RandGen ( iSeed );
+    std::normal_distribution<double>       JitterDist ( 0, dJitterMs * 1000 );
+    std::uniform_real_distribution<double> UniformDist ( 0, 1 );
+
+    // Gilbert-Elliott model: the mean burst length defines the probability to
+    // leave the loss state, the probability to enter it follows from the
+    // mean loss rate p_enter / ( p_enter + p_leave )
+    const double dLossRate  = std::min ( dLossPercent / 100, 0.99 );
+    const double dProbLeave = 1 / std::max ( dMeanBurstLength, 1.0 );
+    const double dProbEnter = dLossRate * dProbLeave / ( 1 - dLossRate );
+    const double dProbSpike = dSpikesPerMinute * dBlockDurationUs / 60e6;
+
+    // a positive drift means that the sender clock is faster than ours
+    const double dSendIntervalUs = dBlockDurationUs / ( 1 + dDriftPpm * 1e-6 );
+    const double dBaseDelayUs    = 4 * dJitterMs * 1000;
+    const qint64 iNumPackets     = static_cast<qint64> ( dDurationS * 1e6 / dSendIntervalUs );
+
+    bool   bInLossState = false;
+    double dSpikeUs     = 0;
+
+    vecArrivals.clear();
+    vecArrivals.reserve ( iNumPackets );
+
+    for ( qint64 i = 0; i < iNumPackets; i++ )
+    {
+        // the spike delay decays with the packet rate (the queued packets are
+        // sent out back to back when the spike is over)
+        dSpikeUs = std::max ( dSpikeUs - dSendIntervalUs, 0.0 );
+
+        if ( UniformDist ( RandGen ) < dProbSpike )
+        {
+            dSpikeUs = dSpikeMs * 1000;
+        }
+
+        bInLossState = bInLossState ? ( UniformDist ( RandGen ) >= dProbLeave ) :
+                                      ( UniformDist ( RandGen ) < dProbEnter );
+
+        const double dDelayUs = std::max ( dBaseDelayUs + JitterDist ( RandGen ), 0.0 ) + dSpikeUs;
+
+        if ( !bInLossState )
+        {
+            vecArrivals.push_back ( CPacketArrival ( static_cast<qint64> ( i * dSendIntervalUs + dDelayUs ),
+                                                     static_cast<uint8_t> ( i & 0xFF ) ) );
+        }
+    }
+
+    std::stable_sort ( vecArrivals.begin(), vecArrivals.end() );
+}
+
+bool CJitterBufParams::Parse ( const QString& strParams )
+{
+    // start with the parameters of the current implementation
+    dErrorRateBound   = ERROR_RATE_BOUND_DOUBLE_FRAME_SIZE;
+    dUpMaxErrorBound  = UP_MAX_ERROR_BOUND_DOUBLE_FRAME_SIZE;
+    dWeightUpNormal   = IIR_WEIGTH_UP_NORMAL_DOUBLE_FRAME_SIZE;
+    dWeightDownNormal = IIR_WEIGTH_DOWN_NORMAL_DOUBLE_FRAME_SIZE;
+    dWeightUpFast     = IIR_WEIGTH_UP_FAST_DOUBLE_FRAME_SIZE;
+    dWeightDownFast   = IIR_WEIGTH_DOWN_FAST_DOUBLE_FRAME_SIZE;
+
+    const int iColonPos = strParams.indexOf ( ':' );
+
+    if ( iColonPos <= 0 )
+    {
+        return false;
+    }
+
+    strName = strParams.left ( iColonPos );
+
+    const QStringList slParams = strParams.mid ( iColonPos + 1 ).split ( ",", QString::SkipEmptyParts );
+
+    for ( int i = 0; i < slParams.size(); i++ )
+    {
+        const QStringList slKeyValue = slParams[i].split ( "=" );
+        bool              bOk        = false;
+
+        if ( slKeyValue.size() != 2 )
+        {
+            return false;
+        }
+
+        const double dValue = slKeyValue[1].toDouble ( &bOk );
+
+        if ( !bOk )
+        {
+            return false;
+        }
+
+        if ( slKeyValue[0] == "errbound" )        { dErrorRateBound   = dValue; }
+        else if ( slKeyValue[0] == "upmaxbound" ) { dUpMaxErrorBound  = dValue; }
+        else if ( slKeyValue[0] == "upnormal" )   { dWeightUpNormal   = dValue; }
+        else if ( slKeyValue[0] == "downnormal" ) { dWeightDownNormal = dValue; }
+        else if ( slKeyValue[0] == "upfast" )     { dWeightUpFast     = dValue; }
+        else if ( slKeyValue[0] == "downfast" )   { dWeightDownFast   = dValue; }
+        else
+        {
+            return false;
+        }
+    }
+
+    bValid = true;
+
+    return true;
+}
+
+void CAutoJitterBufPolicy::CEvalNetBufWithStats::SetParams ( const CJitterBufParams& NParams )
+{
+    dErrorRateBound           = NParams.dErrorRateBound;
+    dUpMaxErrorBound          = NParams.dUpMaxErrorBound;
+    dAutoFilt_WightUpNormal   = NParams.dWeightUpNormal;
+    dAutoFilt_WightDownNormal = NParams.dWeightDownNormal;
+    dAutoFilt_WightUpFast     = NParams.dWeightUpFast;
+    dAutoFilt_WightDownFast   = NParams.dWeightDownFast;
+}
+
+void CAutoJitterBufPolicy::Init ( const bool bNUseSequenceNumber,
+                                  const bool bUseDoubleSystemFrameSize,
+                                  const bool bUseRedundancy )
+{
+    bUseSequenceNumber = bNUseSequenceNumber;
+    iNumBlocks         = DEF_NET_BUF_SIZE_NUM_BL;
+
+    NetBuf.SetUseDoubleSystemFrameSize ( bUseDoubleSystemFrameSize );
+    NetBuf.SetUseRedundancy ( bUseRedundancy );
+    NetBuf.Init ( JBEVAL_BLOCK_SIZE_BYTES, iNumBlocks, bUseSequenceNumber );
+
+    // the candidate parameters replace the ones set in the initialization
+    if ( Params.bValid )
+    {
+        NetBuf.SetParams ( Params );
+    }
+}
+
+bool CAutoJitterBufPolicy::Get ( CVector<uint8_t>& vecbyData )
+{
+    const bool bGetOK = NetBuf.Get ( vecbyData, JBEVAL_BLOCK_SIZE_BYTES );
+
+    // apply the auto setting like CChannel::UpdateSocketBufferSize (preserve
+    // the buffer content)
+    const int iNewNumBlocks = NetBuf.GetAutoSetting();
+
+    if ( ( iNewNumBlocks != iNumBlocks ) &&
+         ( iNewNumBlocks >= MIN_NET_BUF_SIZE_NUM_BL ) &&
+         ( iNewNumBlocks <= MAX_NET_BUF_SIZE_NUM_BL ) )
+    {
+        iNumBlocks = iNewNumBlocks;
+        NetBuf.Init ( JBEVAL_BLOCK_SIZE_BYTES, iNumBlocks, bUseSequenceNumber, true );
+    }
+
+    return bGetOK;
+}
+
+QString CJitterBufEvalResult::GetCsvHeader()
+{
+    return "policy,mean_latency_ms,p50_latency_ms,p95_latency_ms,p99_latency_ms,"
+           "dropout_rate,overrun_rate,size_changes,gets,dropouts,puts,overruns";
+}
+
+QString CJitterBufEvalResult::ToCsv() const
+{
+    return QString ( "%1,%2,%3,%4,%5,%6,%7,%8,%9,%10,%11,%12" )
+        .arg ( strName )
+        .arg ( dMeanLatencyMs, 0, 'f', 3 )
+        .arg ( dP50LatencyMs, 0, 'f', 3 )
+        .arg ( dP95LatencyMs, 0, 'f', 3 )
+        .arg ( dP99LatencyMs, 0, 'f', 3 )
+        .arg ( iNumGets > 0 ? static_cast<double> ( iNumDropouts ) / iNumGets : 0, 0, 'e', 4 )
+        .arg ( iNumPuts > 0 ? static_cast<double> ( iNumOverruns ) / iNumPuts : 0, 0, 'e', 4 )
+        .arg ( iNumSizeChanges )
+        .arg ( iNumGets )
+        .arg ( iNumDropouts )
+        .arg ( iNumPuts )
+        .arg ( iNumOverruns );
+}
+
+CJitterBufEvalResult CJitterBufEvaluator::Run ( CJitterBufPolicy&                  Policy,
+                                                const std::vector<CPacketArrival>& vecArrivals ) const
+{
+    CJitterBufEvalResult Result;
+    Result.strName = Policy.GetName();
+
+    Policy.Init ( bUseSequenceNumber, bUseDoubleSystemFrameSize, bUseRedundancy );
+
+    if ( vecArrivals.empty() )
+    {
+        return Result;
+    }
+
+    const int        iPacketSize = ( bUseRedundancy ? 2 : 1 ) * JBEVAL_BLOCK_SIZE_BYTES + ( bUseSequenceNumber ? 1 : 0 );
+    const double     dBlockUs    = GetBlockDurationUs();
+    const qint64     iStartUs    = vecArrivals.front().iTimeUs;
+    const qint64     iEndUs      = vecArrivals.back().iTimeUs;
+    CVector<uint8_t> vecbyPacket ( iPacketSize, 0 );
+    CVector<uint8_t> vecbyBlock ( JBEVAL_BLOCK_SIZE_BYTES, 0 );
+    CVector<qint64>  veciSizeHist ( MAX_NET_BUF_SIZE_NUM_BL + 1, 0 );
+    size_t           iArrival       = 0;
+    int              iLastNumBlocks = Policy.GetNumBlocks();
+
+    // the playout clock starts with the first packet (like the audio callback
+    // of a client which starts on connection)
+    for ( qint64 iGet = 1; iStartUs + iGet * dBlockUs <= iEndUs; iGet++ )
+    {
+        const double dGetTimeUs = iStartUs + iGet * dBlockUs;
+
+        // put all packets which arrived before this block is played
+        while ( ( iArrival < vecArrivals.size() ) && ( vecArrivals[iArrival].iTimeUs <= dGetTimeUs ) )
+        {
+            if ( bUseSequenceNumber )
+            {
+                vecbyPacket[iPacketSize - 1] = vecArrivals[iArrival].iSeqNum;
+            }
+
+            Result.iNumPuts++;
+
+            if ( !Policy.Put ( vecbyPacket, iPacketSize ) )
+            {
+                Result.iNumOverruns++;
+            }
+
+            iArrival++;
+        }
+
+        Result.iNumGets++;
+
+        if ( !Policy.Get ( vecbyBlock ) )
+        {
+            Result.iNumDropouts++;
+        }
+
+        const int iNumBlocks = Policy.GetNumBlocks();
+
+        if ( iNumBlocks != iLastNumBlocks )
+        {
+            Result.iNumSizeChanges++;
+            iLastNumBlocks = iNumBlocks;
+        }
+
+        veciSizeHist[std::min ( std::max ( iNumBlocks, 0 ), MAX_NET_BUF_SIZE_NUM_BL )]++;
+    }
+
+    // the latency of the jitter buffer is its size times the block duration
+    const double dBlockMs = dBlockUs / 1000;
+    double       dSum     = 0;
+    qint64       iCount   = 0;
+
+    for ( int i = 0; i < veciSizeHist.Size(); i++ )
+    {
+        dSum += static_cast<double> ( i ) * veciSizeHist[i];
+    }
+
+    Result.dMeanLatencyMs = Result.iNumGets > 0 ? dSum / Result.iNumGets * dBlockMs : 0;
+
+    for ( int i = 0; i < veciSizeHist.Size(); i++ )
+    {
+        const qint64 iPrevCount = iCount;
+        iCount                 += veciSizeHist[i];
+
+        if ( ( iPrevCount < 0.50 * Result.iNumGets ) && ( iCount >= 0.50 * Result.iNumGets ) ) { Result.dP50LatencyMs = i * dBlockMs; }
+        if ( ( iPrevCount < 0.95 * Result.iNumGets ) && ( iCount >= 0.95 * Result.iNumGets ) ) { Result.dP95LatencyMs = i * dBlockMs; }
+        if ( ( iPrevCount < 0.99 * Result.iNumGets ) && ( iCount >= 0.99 * Result.iNumGets ) ) { Result.dP99LatencyMs = i * dBlockMs; }
+    }
+
+    return Result;
+}
+
+bool CJitterBufEvaluator::ReadPacketTrace ( const QString&               strFileName,
+                                            const QString&               strSourceAddr,
+                                            const bool                   bUseSequenceNumber,
+                                            std::vector<CPacketArrival>& vecArrivals )
+{
+    QFile File ( strFileName );
+
+    if ( !File.open ( QIODevice::ReadOnly ) )
+    {
+        return false;
+    }
+
+    const QByteArray vecbyData = File.readAll();
+    const uchar*     pbyData   = reinterpret_cast<const uchar*> ( vecbyData.constData() );
+
+    if ( ( vecbyData.size() < PACKET_TRACE_HEADER_SIZE ) ||
+         ( qFromLittleEndian<quint32> ( pbyData ) != PACKET_TRACE_MAGIC ) ||
+         ( qFromLittleEndian<quint16> ( pbyData + 6 ) & PACKET_TRACE_FLAG_HASH_ONLY ) )
+    {
+        return false;
+    }
+
+    // first pass: collect the audio packets of all sources
+    QMap<QString, std::vector<CPacketArrival> > mapArrivals;
+    CVector<uint8_t>                            vecbyPacket ( MAX_SIZE_BYTES_NETW_BUF );
+    CVector<uint8_t>                            vecbyMesBodyData;
+    int                                         iRecCounter;
+    int                                         iRecID;
+    qint64                                      iTimeUs = 0;
+    int                                         iPos    = PACKET_TRACE_HEADER_SIZE;
+
+    while ( iPos + PACKET_TRACE_RECORD_HDR_SIZE <= vecbyData.size() )
+    {
+        const uchar* pbyRecord = pbyData + iPos;
+        const int    iNumBytes = qFromLittleEndian<quint16> ( pbyRecord + 10 );
+
+        if ( ( iPos + PACKET_TRACE_RECORD_HDR_SIZE + iNumBytes > vecbyData.size() ) ||
+             ( iNumBytes > MAX_SIZE_BYTES_NETW_BUF ) || ( iNumBytes == 0 ) )
+        {
+            break;
+        }
+
+        iTimeUs += qFromLittleEndian<quint32> ( pbyRecord );
+
+        std::copy ( pbyRecord + PACKET_TRACE_RECORD_HDR_SIZE,
+                    pbyRecord + PACKET_TRACE_RECORD_HDR_SIZE + iNumBytes,
+                    vecbyPacket.begin() );
+
+        // protocol messages are not put in the jitter buffer
+        if ( CProtocol::ParseMessageFrame ( vecbyPacket, iNumBytes, vecbyMesBodyData, iRecCounter, iRecID ) )
+        {
+            const CHostAddress Source ( qFromLittleEndian<quint32> ( pbyRecord + 4 ),
+                                        qFromLittleEndian<quint16> ( pbyRecord + 8 ) );
+
+            // the sequence number is appended after the coded audio data
+            mapArrivals[Source.toString()].push_back (
+                CPacketArrival ( iTimeUs, bUseSequenceNumber ? vecbyPacket[iNumBytes - 1] : 0 ) );
+        }
+
+        iPos += PACKET_TRACE_RECORD_HDR_SIZE + iNumBytes;
+    }
+
+    // use the given source or the one with the most packets
+    QString strSource = strSourceAddr;
+
+    if ( strSource.isEmpty() )
+    {
+        size_t iMaxNumPackets = 0;
+
+        for ( auto it = mapArrivals.constBegin(); it != mapArrivals.constEnd(); ++it )
+        {
+            if ( it.value().size() > iMaxNumPackets )
+            {
+                iMaxNumPackets = it.value().size();
+                strSource      = it.key();
+            }
+        }
+    }
+
+    if ( !mapArrivals.contains ( strSource ) )
+    {
+        return false;
+    }
+
+    vecArrivals = mapArrivals[strSource];
+
+    // without sequence numbers the packets are numbered in arrival order
+    if ( !bUseSequenceNumber )
+    {
+        for ( size_t i = 0; i < vecArrivals.size(); i++ )
+        {
+            vecArrivals[i].iSeqNum = static_cast<uint8_t> ( i & 0xFF );
+        }
+    }
+
+    qInfo() << qUtf8Printable ( QString ( "- packet trace: %1 audio packets of %2" )
+        .arg ( vecArrivals.size() ).arg ( strSource ) );
+
+    return true;
+}
+
+bool CJitterBufEvaluator::ReadTextTrace ( const QString&               strFileName,
+                                          std::vector<CPacketArrival>& vecArrivals )
+{
+    QFile File ( strFileName );
+
+    if ( !File.open ( QIODevice::ReadOnly | QIODevice::Text ) )
+    {
+        return false;
+    }
+
+    QTextStream InStream ( &File );
+
+    vecArrivals.clear();
+
+    while ( !InStream.atEnd() )
+    {
+        const QString strLine = InStream.readLine().trimmed();
+
+        if ( strLine.isEmpty() || strLine.startsWith ( "#" ) )
+        {
+            continue;
+        }
+
+        const QStringList slValues = strLine.split ( QRegExp ( "[\\s,;]+" ), QString::SkipEmptyParts );
+        bool              bTimeOk  = false;
+        bool              bSeqOk   = false;
+
+        const qint64 iTimeUs = slValues.value ( 0 ).toLongLong ( &bTimeOk );
+        const int    iSeqNum = slValues.value ( 1 ).toInt ( &bSeqOk );
+
+        if ( !bTimeOk || !bSeqOk )
+        {
+            return false;
+        }
+
+        vecArrivals.push_back ( CPacketArrival ( iTimeUs, static_cast<uint8_t> ( iSeqNum & 0xFF ) ) );
+    }
+
+    std::stable_sort ( vecArrivals.begin(), vecArrivals.end() );
+
+    return true;
+}
+
+int JitterBufEvalMain ( int argc, char** argv )
+{
+    QString                 strArgument;
+    double                  rDbleArgument;
+    QString                 strPacketTraceFileName;
+    QString                 strTextTraceFileName;
+    QString                 strSourceAddr;
+    QString                 strOutFileName;
+    double                  dDurationS         = JBEVAL_DEFAULT_DURATION_S;
+    bool                    bUseSequenceNumber = true;
+    bool                    bUseDoubleFrame    = true;
+    bool                    bUseRedundancy     = false;
+    CSynthNetworkModel      NetworkModel;
+    QList<CJitterBufParams> vecCandidates;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( GetFlagArgument ( argv, i, "-h", "--help" ) )
+        {
+            qInfo() << qUtf8Printable ( QString (
+                "Usage: %1 [option] [optional argument]\n"
+                "\nOffline jitter buffer evaluation: runs fixed buffer sizes, the current\n"
+                "auto setting and candidate parameter sets on a packet arrival trace and\n"
+                "writes the latency and dropout rates as CSV.\n"
+                "\nArrival trace (default: synthetic network):\n"
+                "      --trace           packet trace file (see --tracefile of Jamulus)\n"
+                "      --source          source address in the packet trace (default:\n"
+                "                        source with the most audio packets)\n"
+                "      --arrivals        text file with [time in us] [sequence number]\n"
+                "                        per line\n"
+                "\nSynthetic network:\n"
+                "      --duration        duration in s (default %2)\n"
+                "      --jitter          standard deviation of the delay in ms\n"
+                "      --loss            packet loss in percent\n"
+                "      --burst           mean loss burst length in packets\n"
+                "      --spikes          delay spikes per minute\n"
+                "      --spikems         delay of a spike in ms\n"
+                "      --drift           sender clock drift in ppm\n"
+                "      --seed            random seed\n"
+                "\nEvaluation:\n"
+                "  -c, --candidate       candidate parameters of the auto setting (can be\n"
+                "                        given multiple times) in the format:\n"
+                "                        [name]:[key]=[value],... with the keys errbound,\n"
+                "                        upmaxbound, upnormal, downnormal, upfast, downfast\n"
+                "                        (unset keys use the 128 samples frame defaults)\n"
+                "      --noseqnum        jitter buffer without sequence numbers\n"
+                "      --redundancy      each packet also carries the previous block\n"
+                "                        (restores single losses, twice the bandwidth)\n"
+                "  -F, --fastupdate      use 64 samples frame size mode\n"
+                "  -o, --output          CSV output file (default: console)\n"
+                "  -h, --help            display this help text and exit\n" )
+                .arg ( argv[0] )
+                .arg ( JBEVAL_DEFAULT_DURATION_S ) );
+            return 0;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "--trace", "--trace", strArgument ) )
+        {
+            strPacketTraceFileName = strArgument;
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "--source", "--source", strArgument ) )
+        {
+            strSourceAddr = strArgument;
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "--arrivals", "--arrivals", strArgument ) )
+        {
+            strTextTraceFileName = strArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--duration", "--duration", 1, 86400, rDbleArgument ) )
+        {
+            dDurationS = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--jitter", "--jitter", 0, 1000, rDbleArgument ) )
+        {
+            NetworkModel.dJitterMs = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--loss", "--loss", 0, 99, rDbleArgument ) )
+        {
+            NetworkModel.dLossPercent = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--burst", "--burst", 1, 1000, rDbleArgument ) )
+        {
+            NetworkModel.dMeanBurstLength = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--spikes", "--spikes", 0, 6000, rDbleArgument ) )
+        {
+            NetworkModel.dSpikesPerMinute = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--spikems", "--spikems", 0, 10000, rDbleArgument ) )
+        {
+            NetworkModel.dSpikeMs = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--drift", "--drift", -10000, 10000, rDbleArgument ) )
+        {
+            NetworkModel.dDriftPpm = rDbleArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--seed", "--seed", 0, 2147483647, rDbleArgument ) )
+        {
+            NetworkModel.iSeed = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-c", "--candidate", strArgument ) )
+        {
+            CJitterBufParams Params;
+
+            if ( !Params.Parse ( strArgument ) )
+            {
+                qCritical() << qUtf8Printable ( QString ( "%1: invalid candidate '%2'" )
+                    .arg ( argv[0] ).arg ( strArgument ) );
+                return 1;
+            }
+
+            vecCandidates.append ( Params );
+            continue;
+        }
+
+        if ( GetFlagArgument ( argv, i, "--noseqnum", "--noseqnum" ) )
+        {
+            bUseSequenceNumber = false;
+            continue;
+        }
+
+        if ( GetFlagArgument ( argv, i, "--redundancy", "--redundancy" ) )
+        {
+            bUseRedundancy = true;
+            continue;
+        }
+
+        if ( GetFlagArgument ( argv, i, "-F", "--fastupdate" ) )
+        {
+            bUseDoubleFrame = false;
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-o", "--output", strArgument ) )
+        {
+            strOutFileName = strArgument;
+            continue;
+        }
+
+        qCritical() << qUtf8Printable ( QString ( "%1: Unknown option '%2' -- use '--help' for help" )
+            .arg ( argv[0] ).arg ( argv[i] ) );
+    }
+
+    if ( bUseRedundancy && !bUseSequenceNumber )
+    {
+        qCritical() << qUtf8Printable ( QString ( "%1: the redundancy needs the sequence numbers" ).arg ( argv[0] ) );
+        return 1;
+    }
+
+    CJitterBufEvaluator         Evaluator ( bUseSequenceNumber, bUseDoubleFrame, bUseRedundancy );
+    std::vector<CPacketArrival> vecArrivals;
+
+    if ( !strPacketTraceFileName.isEmpty() )
+    {
+        if ( !CJitterBufEvaluator::ReadPacketTrace ( strPacketTraceFileName, strSourceAddr, bUseSequenceNumber, vecArrivals ) )
+        {
+            qCritical() << qUtf8Printable ( QString ( "%1: cannot read the audio packets from '%2'" )
+                .arg ( argv[0] ).arg ( strPacketTraceFileName ) );
+            return 1;
+        }
+    }
+    else if ( !strTextTraceFileName.isEmpty() )
+    {
+        if ( !CJitterBufEvaluator::ReadTextTrace ( strTextTraceFileName, vecArrivals ) )
+        {
+            qCritical() << qUtf8Printable ( QString ( "%1: cannot read the arrivals from '%2'" )
+                .arg ( argv[0] ).arg ( strTextTraceFileName ) );
+            return 1;
+        }
+    }
+    else
+    {
+        NetworkModel.Generate ( dDurationS, Evaluator.GetBlockDurationUs(), vecArrivals );
+    }
+
+    // the policies: all fixed sizes (reference curve), the current auto
+    // setting and the candidates
+    QList<CJitterBufPolicy*> vecpPolicies;
+
+    for ( int i = MIN_NET_BUF_SIZE_NUM_BL; i <= MAX_NET_BUF_SIZE_NUM_BL; i++ )
+    {
+        vecpPolicies.append ( new CFixedJitterBufPolicy ( i ) );
+    }
+
+    vecpPolicies.append ( new CAutoJitterBufPolicy() );
+
+    for ( int i = 0; i < vecCandidates.size(); i++ )
+    {
+        vecpPolicies.append ( new CAutoJitterBufPolicy ( vecCandidates[i] ) );
+    }
+
+    QFile OutFile;
+
+    if ( strOutFileName.isEmpty() )
+    {
+        OutFile.open ( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    }
+    else if ( !OutFile.open ( strOutFileName, QIODevice::WriteOnly | QIODevice::Text ) )
+    {
+        qCritical() << qUtf8Printable ( QString ( "%1: cannot write '%2'" ).arg ( argv[0] ).arg ( strOutFileName ) );
+        qDeleteAll ( vecpPolicies );
+        return 1;
+    }
+
+    QTextStream   OutStream ( &OutFile );
+    QElapsedTimer ElapsedTime;
+
+    OutStream << CJitterBufEvalResult::GetCsvHeader() << "\n";
+
+    ElapsedTime.start();
+
+    for ( int i = 0; i < vecpPolicies.size(); i++ )
+    {
+        OutStream << Evaluator.Run ( *vecpPolicies[i], vecArrivals ).ToCsv() << "\n";
+    }
+
+    OutStream.flush();
+
+    const double dTraceS = vecArrivals.empty() ? 0 : ( vecArrivals.back().iTimeUs - vecArrivals.front().iTimeUs ) / 1e6;
+
+    qInfo() << qUtf8Printable ( QString ( "- %1 packets (%2 s) evaluated with %3 policies in %4 s" )
+        .arg ( vecArrivals.size() )
+        .arg ( dTraceS, 0, 'f', 1 )
+        .arg ( vecpPolicies.size() )
+        .arg ( static_cast<double> ( ElapsedTime.elapsed() ) / 1000, 0, 'f', 2 ) );
+
+    qDeleteAll ( vecpPolicies );
+
+    return 0;
+}
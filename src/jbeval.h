@@ -0,0 +1,220 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Offline evaluation of the jitter buffer sizing: packet arrival traces
+ * (recorded packet traces, text files or a synthetic network model) are fed
+ * into the jitter buffer much faster than real time with different sizing
+ * policies (fixed sizes, the current auto setting and candidate parameter
+ * sets) and the resulting latency and dropout rates are reported as CSV.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <vector>
+#include "global.h"
+#include "util.h"
+#include "buffer.h"
+
+
+/* Definitions ****************************************************************/
+// size of the simulated coded audio blocks (the content is not evaluated)
+#define JBEVAL_BLOCK_SIZE_BYTES         32
+
+#define JBEVAL_DEFAULT_DURATION_S       300
+
+
+/* Classes ********************************************************************/
+// arrival of one audio packet at the receiver
+class CPacketArrival
+{
+public:
+    CPacketArrival ( const qint64 iNTimeUs = 0, const uint8_t iNSeqNum = 0 ) :
+        iTimeUs ( iNTimeUs ), iSeqNum ( iNSeqNum ) {}
+
+    bool operator< ( const CPacketArrival& Other ) const { return iTimeUs < Other.iTimeUs; }
+
+    qint64  iTimeUs;
+    uint8_t iSeqNum;
+};
+
+// synthetic network: constant base delay plus Gaussian jitter, delay spikes,
+// Gilbert-Elliott burst losses and a sender clock drift
+class CSynthNetworkModel
+{
+public:
+    CSynthNetworkModel() : dJitterMs ( 1 ), dLossPercent ( 0 ), dMeanBurstLength ( 1 ),
+        dSpikesPerMinute ( 0 ), dSpikeMs ( 20 ), dDriftPpm ( 0 ), iSeed ( 1 ) {}
+
+    void Generate ( const double                 dDurationS,
+                    const double                 dBlockDurationUs,
+                    std::vector<CPacketArrival>& vecArrivals ) const;
+
+    double dJitterMs;        // standard deviation of the delay
+    double dLossPercent;
+    double dMeanBurstLength; // mean number of consecutive lost packets
+    double dSpikesPerMinute;
+    double dSpikeMs;         // additional delay of a spike (decays linearly)
+    double dDriftPpm;        // sender clock relative to the receiver clock
+    int    iSeed;
+};
+
+// parameters of the auto setting of CNetBufWithStats (the defaults are the
+// values of the current implementation)
+class CJitterBufParams
+{
+public:
+    CJitterBufParams() : bValid ( false ), dErrorRateBound ( 0 ), dUpMaxErrorBound ( 0 ),
+        dWeightUpNormal ( 0 ), dWeightDownNormal ( 0 ), dWeightUpFast ( 0 ), dWeightDownFast ( 0 ) {}
+
+    // format: [name]:[key]=[value],[key]=[value],... with the keys errbound,
+    // upmaxbound, upnormal, downnormal, upfast and downfast
+    bool Parse ( const QString& strParams );
+
+    QString strName;
+    bool    bValid;
+    double  dErrorRateBound;
+    double  dUpMaxErrorBound;
+    double  dWeightUpNormal;
+    double  dWeightDownNormal;
+    double  dWeightUpFast;
+    double  dWeightDownFast;
+};
+
+// jitter buffer sizing policy under evaluation, new sizing algorithms are
+// evaluated by deriving from this class
+class CJitterBufPolicy
+{
+public:
+    virtual ~CJitterBufPolicy() {}
+
+    virtual QString GetName() const = 0;
+    virtual void    Init ( const bool bUseSequenceNumber, const bool bUseDoubleSystemFrameSize, const bool bUseRedundancy ) = 0;
+    virtual bool    Put ( const CVector<uint8_t>& vecbyData, const int iInSize ) = 0;
+    virtual bool    Get ( CVector<uint8_t>& vecbyData ) = 0;
+    virtual int     GetNumBlocks() const = 0; // current buffer size setting
+};
+
+// fixed buffer size (gives the reference latency/dropout curve)
+class CFixedJitterBufPolicy : public CJitterBufPolicy
+{
+public:
+    CFixedJitterBufPolicy ( const int iNNumBlocks ) : iNumBlocks ( iNNumBlocks ) {}
+
+    virtual QString GetName() const { return QString ( "fixed%1" ).arg ( iNumBlocks ); }
+    virtual void    Init ( const bool bUseSequenceNumber, const bool, const bool bUseRedundancy )
+                        { NetBuf.SetUseRedundancy ( bUseRedundancy );
+                          NetBuf.Init ( JBEVAL_BLOCK_SIZE_BYTES, iNumBlocks, bUseSequenceNumber ); }
+    virtual bool    Put ( const CVector<uint8_t>& vecbyData, const int iInSize ) { return NetBuf.Put ( vecbyData, iInSize ); }
+    virtual bool    Get ( CVector<uint8_t>& vecbyData ) { return NetBuf.Get ( vecbyData, JBEVAL_BLOCK_SIZE_BYTES ); }
+    virtual int     GetNumBlocks() const { return iNumBlocks; }
+
+protected:
+    int     iNumBlocks;
+    CNetBuf NetBuf;
+};
+
+// auto setting of CNetBufWithStats, applied like in CChannel
+class CAutoJitterBufPolicy : public CJitterBufPolicy
+{
+public:
+    CAutoJitterBufPolicy ( const CJitterBufParams& NParams = CJitterBufParams() ) :
+        Params ( NParams ), iNumBlocks ( 0 ), bUseSequenceNumber ( false ) {}
+
+    virtual QString GetName() const { return Params.bValid ? Params.strName : "auto"; }
+    virtual void    Init ( const bool bNUseSequenceNumber, const bool bUseDoubleSystemFrameSize, const bool bUseRedundancy );
+    virtual bool    Put ( const CVector<uint8_t>& vecbyData, const int iInSize ) { return NetBuf.Put ( vecbyData, iInSize ); }
+    virtual bool    Get ( CVector<uint8_t>& vecbyData );
+    virtual int     GetNumBlocks() const { return iNumBlocks; }
+
+protected:
+    // gives access to the protected parameters of the auto setting
+    class CEvalNetBufWithStats : public CNetBufWithStats
+    {
+    public:
+        void SetParams ( const CJitterBufParams& NParams );
+    };
+
+    CJitterBufParams     Params;
+    CEvalNetBufWithStats NetBuf;
+    int                  iNumBlocks;
+    bool                 bUseSequenceNumber;
+};
+
+// result of one policy on one arrival trace
+class CJitterBufEvalResult
+{
+public:
+    CJitterBufEvalResult() : iNumGets ( 0 ), iNumDropouts ( 0 ), iNumPuts ( 0 ), iNumOverruns ( 0 ),
+        iNumSizeChanges ( 0 ), dMeanLatencyMs ( 0 ), dP50LatencyMs ( 0 ), dP95LatencyMs ( 0 ), dP99LatencyMs ( 0 ) {}
+
+    static QString GetCsvHeader();
+    QString        ToCsv() const;
+
+    QString strName;
+    qint64  iNumGets;
+    qint64  iNumDropouts;   // gets without valid block (concealment)
+    qint64  iNumPuts;
+    qint64  iNumOverruns;   // puts which did not fit in the buffer
+    qint64  iNumSizeChanges;
+    double  dMeanLatencyMs; // buffer size times block duration
+    double  dP50LatencyMs;
+    double  dP95LatencyMs;
+    double  dP99LatencyMs;
+};
+
+// runs the policies on an arrival trace in simulated time
+class CJitterBufEvaluator
+{
+public:
+    CJitterBufEvaluator ( const bool bNUseSequenceNumber,
+                          const bool bNUseDoubleSystemFrameSize,
+                          const bool bNUseRedundancy = false ) :
+        bUseSequenceNumber ( bNUseSequenceNumber ), bUseDoubleSystemFrameSize ( bNUseDoubleSystemFrameSize ),
+        bUseRedundancy ( bNUseRedundancy ) {}
+
+    double GetBlockDurationUs() const
+        { return 1e6 * ( bUseDoubleSystemFrameSize ? DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES : SYSTEM_FRAME_SIZE_SAMPLES ) / SYSTEM_SAMPLE_RATE_HZ; }
+
+    CJitterBufEvalResult Run ( CJitterBufPolicy& Policy, const std::vector<CPacketArrival>& vecArrivals ) const;
+
+    // the arrivals of the audio packets of one source from a packet trace file
+    // (if the source address is empty the most frequent source is used)
+    static bool ReadPacketTrace ( const QString&               strFileName,
+                                  const QString&               strSourceAddr,
+                                  const bool                   bUseSequenceNumber,
+                                  std::vector<CPacketArrival>& vecArrivals );
+
+    // text file with one "[time in us] [sequence number]" line per packet
+    static bool ReadTextTrace ( const QString&               strFileName,
+                                std::vector<CPacketArrival>& vecArrivals );
+
+protected:
+    bool bUseSequenceNumber;
+    bool bUseDoubleSystemFrameSize;
+    bool bUseRedundancy; // each packet also carries the previous block
+};
+
+// entry point of the jitter buffer evaluation build target
+int JitterBufEvalMain ( int argc, char** argv );
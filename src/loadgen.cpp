@@ -0,0 +1,686 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QCoreApplication>
+#include <cmath>
+#include <algorithm>
+#include "client.h"
+#include "signalhandler.h"
+#include "loadgen.h"
+
+
+/* Implementation *************************************************************/
+CSynthClient::CSynthClient ( const int           iNClientIdx,
+                             const int           iNNumClients,
+                             const CHostAddress& NServerAddr,
+                             OpusCustomMode*     pOpusMode,
+                             const bool          bNUseOpus64 ) :
+    iClientIdx          ( iNClientIdx ),
+    iNumClients         ( iNNumClients ),
+    ServerAddr          ( NServerAddr ),
+    bUseOpus64          ( bNUseOpus64 ),
+    bIsStarted          ( false ),
+    Channel             ( false ), /* we need a client channel -> "false" */
+    ChannelInfo         ( QString ( "loadgen %1" ).arg ( iNClientIdx ) ),
+    iStartUs            ( 0 ),
+    iNumFramesProcessed ( 0 )
+{
+    int iOpusError;
+
+    // mono client with normal audio quality
+    if ( bUseOpus64 )
+    {
+        iFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+        iNumCodedBytes    = OPUS_NUM_BYTES_MONO_NORMAL_QUALITY;
+    }
+    else
+    {
+        iFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+        iNumCodedBytes    = OPUS_NUM_BYTES_MONO_NORMAL_QUALITY_DBLE_FRAMESIZE;
+    }
+
+    // use the same encoder settings as the client
+    OpusEncoder = opus_custom_encoder_create ( pOpusMode, 1, &iOpusError );
+    OpusDecoder = opus_custom_decoder_create ( pOpusMode, 1, &iOpusError );
+
+    opus_custom_encoder_ctl ( OpusEncoder, OPUS_SET_VBR ( 0 ) );
+    opus_custom_encoder_ctl ( OpusEncoder, OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+    opus_custom_encoder_ctl ( OpusEncoder, OPUS_SET_BITRATE (
+        CalcBitRateBitsPerSecFromCodedBytes ( iNumCodedBytes, iFrameSizeSamples ) ) );
+
+    if ( bUseOpus64 )
+    {
+        opus_custom_encoder_ctl ( OpusEncoder, OPUS_SET_PACKET_LOSS_PERC ( 35 ) );
+    }
+
+    // the sum of the test tones of all clients must not clip in the server mix,
+    // the mix must contain our own tone and the tone of the previous client
+    // (which was started before us and is therefore settled, too)
+    QList<int> veciPeerFreqHz;
+
+    if ( iClientIdx > 0 )
+    {
+        veciPeerFreqHz.append ( GetFreqHz ( iClientIdx - 1 ) );
+    }
+
+    TestSignal.Init ( GetFreqHz ( iClientIdx ), veciPeerFreqHz, 0.5 / std::max ( iNumClients, 1 ) );
+
+    vecsAudio.Init     ( iFrameSizeSamples );
+    vecbyCoded.Init    ( iNumCodedBytes );
+    vecbyNetwData.Init ( iNumCodedBytes );
+    vecbyRecBuf.Init   ( MAX_SIZE_BYTES_NETW_BUF );
+
+    Stats.iClientIdx = iClientIdx;
+
+    Channel.SetAddress ( ServerAddr );
+    Channel.SetAudioStreamProperties ( bUseOpus64 ? CT_OPUS64 : CT_OPUS,
+                                       iNumCodedBytes,
+                                       1,
+                                       1 );
+    Channel.EnableLinkTelemetry();
+
+    // Connections -------------------------------------------------------------
+    QObject::connect ( &Channel, &CChannel::MessReadyForSending,
+        this, &CSynthClient::OnSendProtMessage );
+
+    QObject::connect ( &Channel, &CChannel::ReqJittBufSize,
+        this, &CSynthClient::OnReqJittBufSize );
+
+    QObject::connect ( &Channel, &CChannel::ReqChanInfo,
+        this, &CSynthClient::OnReqChanInfo );
+
+    QObject::connect ( &Socket, &QUdpSocket::readyRead,
+        this, &CSynthClient::OnReadyRead );
+}
+
+CSynthClient::~CSynthClient()
+{
+    opus_custom_encoder_destroy ( OpusEncoder );
+    opus_custom_decoder_destroy ( OpusDecoder );
+}
+
+void CSynthClient::Start ( const qint64 iNStartUs )
+{
+    // each client uses its own port so that the server creates a channel for it
+    if ( !Socket.bind ( QHostAddress ( QHostAddress::AnyIPv4 ), 0 ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "loadgen client %1: cannot bind the socket" )
+            .arg ( iClientIdx ) );
+        return;
+    }
+
+    Channel.SetEnable ( true );
+
+    iStartUs         = iNStartUs;
+    bIsStarted       = true;
+    Stats.bIsStarted = true;
+}
+
+void CSynthClient::Process ( const qint64 iElapsedUs )
+{
+    if ( !bIsStarted )
+    {
+        return;
+    }
+
+    const qint64 iNumFramesDue = ( iElapsedUs - iStartUs ) * SYSTEM_SAMPLE_RATE_HZ / 1000000 / iFrameSizeSamples;
+    qint64       iNumFrames    = iNumFramesDue - iNumFramesProcessed;
+
+    // if the thread was stalled, we do not send a burst of packets but skip
+    // the frames (the server sees them as lost)
+    if ( iNumFrames > LOADGEN_MAX_FRAMES_PER_TIMER )
+    {
+        Stats.iNumSkipped   += iNumFrames - LOADGEN_MAX_FRAMES_PER_TIMER;
+        iNumFramesProcessed  = iNumFramesDue - LOADGEN_MAX_FRAMES_PER_TIMER;
+        iNumFrames           = LOADGEN_MAX_FRAMES_PER_TIMER;
+    }
+
+    for ( ; iNumFrames > 0; iNumFrames-- )
+    {
+        ProcessFrame();
+        iNumFramesProcessed++;
+    }
+}
+
+void CSynthClient::ProcessFrame()
+{
+    // Transmit test tone ------------------------------------------------------
+    TestSignal.GetInput ( vecsAudio, 1 );
+
+    opus_custom_encode ( OpusEncoder,
+                         &vecsAudio[0],
+                         iFrameSizeSamples,
+                         &vecbyCoded[0],
+                         iNumCodedBytes );
+
+    if ( Channel.PrepPacket ( vecbyCoded, iNumCodedBytes, vecbyPacket ) )
+    {
+        Socket.writeDatagram ( reinterpret_cast<const char*> ( &vecbyPacket[0] ),
+                               vecbyPacket.Size(),
+                               ServerAddr.InetAddr,
+                               ServerAddr.iPort );
+    }
+
+    Stats.iNumFramesSent++;
+
+
+    // Receive mix -------------------------------------------------------------
+    if ( !Channel.IsConnected() )
+    {
+        return;
+    }
+
+    unsigned char* pCurCodedData = nullptr;
+
+    if ( Channel.GetData ( vecbyNetwData, iNumCodedBytes ) == GS_BUFFER_OK )
+    {
+        pCurCodedData = &vecbyNetwData[0];
+    }
+    else
+    {
+        Stats.iNumUnderruns++;
+    }
+
+    // for lost packets the null pointer activates the packet loss concealment
+    opus_custom_decode ( OpusDecoder,
+                         pCurCodedData,
+                         iNumCodedBytes,
+                         &vecsAudio[0],
+                         iFrameSizeSamples );
+
+    if ( TestSignal.AnalyzeOutput ( vecsAudio, 1 ) )
+    {
+        VerifyMix();
+    }
+
+    // the auto jitter buffer is updated like in the client
+    Channel.UpdateSocketBufferSize();
+}
+
+void CSynthClient::VerifyMix()
+{
+    // wait until the fade in of the server is done
+    if ( iNumFramesProcessed * iFrameSizeSamples < static_cast<qint64> ( LOADGEN_SETTLE_TIME_MS ) * SYSTEM_SAMPLE_RATE_HZ / 1000 )
+    {
+        return;
+    }
+
+    const bool bMixOk = TestSignal.IsOwnToneDetected() && TestSignal.ArePeerTonesDetected();
+
+    if ( bMixOk )
+    {
+        Stats.iNumVerifyOk++;
+    }
+    else
+    {
+        Stats.iNumVerifyFail++;
+    }
+}
+
+CSynthClientStats CSynthClient::GetStats()
+{
+    Stats.iChanID       = Channel.GetChannelID();
+    Stats.bIsConnected  = Channel.IsConnected();
+    Stats.LinkTelemetry = Channel.GetLinkTelemetrySummary();
+
+    return Stats;
+}
+
+void CSynthClient::OnReadyRead()
+{
+    int              iRecCounter;
+    int              iRecID;
+    CVector<uint8_t> vecbyMesBodyData;
+    QHostAddress     SenderAddress;
+    quint16          iSenderPort;
+
+    while ( Socket.hasPendingDatagrams() )
+    {
+        const qint64 iNumBytesRead = Socket.readDatagram ( reinterpret_cast<char*> ( &vecbyRecBuf[0] ),
+                                                           MAX_SIZE_BYTES_NETW_BUF,
+                                                           &SenderAddress,
+                                                           &iSenderPort );
+
+        const CHostAddress RecHostAddr ( SenderAddress, iSenderPort );
+
+        if ( ( iNumBytesRead <= 0 ) || !( RecHostAddr == ServerAddr ) )
+        {
+            continue;
+        }
+
+        if ( !CProtocol::ParseMessageFrame ( vecbyRecBuf,
+                                             static_cast<int> ( iNumBytesRead ),
+                                             vecbyMesBodyData,
+                                             iRecCounter,
+                                             iRecID ) )
+        {
+            // connection less messages are not needed by the synthetic client
+            if ( !CProtocol::IsConnectionLessMessageID ( iRecID ) )
+            {
+                Channel.PutProtcolData ( iRecCounter, iRecID, vecbyMesBodyData, RecHostAddr );
+            }
+        }
+        else
+        {
+            if ( Channel.PutAudioData ( vecbyRecBuf, static_cast<int> ( iNumBytesRead ), RecHostAddr ) == PS_NEW_CONNECTION )
+            {
+                // send our channel info like the client does on a new connection
+                Channel.SetRemoteInfo ( ChannelInfo );
+            }
+        }
+    }
+}
+
+void CSynthClient::OnSendProtMessage ( CVector<uint8_t> vecMessage )
+{
+    Socket.writeDatagram ( reinterpret_cast<const char*> ( &vecMessage[0] ),
+                           vecMessage.Size(),
+                           ServerAddr.InetAddr,
+                           ServerAddr.iPort );
+}
+
+
+/******************************************************************************\
+* Load Generator Threads                                                       *
+\******************************************************************************/
+void CLoadGenThread::run()
+{
+    // the worker (and with it all clients and their sockets) is created in
+    // this thread so that its events are processed here
+    CLoadGenWorker Worker ( this );
+
+    exec();
+
+    // final statistics
+    Worker.PublishStats();
+}
+
+CVector<CSynthClientStats> CLoadGenThread::GetStats()
+{
+    QMutexLocker locker ( &Mutex );
+
+    return vecStats;
+}
+
+void CLoadGenThread::PublishStats ( const QList<CSynthClient*>& vecpClients )
+{
+    CVector<CSynthClientStats> vecNewStats ( vecpClients.size() );
+
+    for ( int i = 0; i < vecpClients.size(); i++ )
+    {
+        vecNewStats[i] = vecpClients[i]->GetStats();
+    }
+
+    QMutexLocker locker ( &Mutex );
+
+    vecStats = vecNewStats;
+}
+
+CLoadGenWorker::CLoadGenWorker ( CLoadGenThread* pNThread ) :
+    pThread        ( pNThread ),
+    iLastPublishUs ( 0 )
+{
+    int iOpusError;
+
+    OpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                         pThread->bUseOpus64 ? SYSTEM_FRAME_SIZE_SAMPLES : DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES,
+                                         &iOpusError );
+
+    for ( int i = 0; i < pThread->vecClientIdx.size(); i++ )
+    {
+        vecpClients.append ( new CSynthClient ( pThread->vecClientIdx[i],
+                                                pThread->iNumClients,
+                                                pThread->ServerAddr,
+                                                OpusMode,
+                                                pThread->bUseOpus64 ) );
+    }
+
+    QObject::connect ( &Timer, &QTimer::timeout,
+        this, &CLoadGenWorker::OnTimer );
+
+    ElapsedTime.start();
+
+    Timer.setTimerType ( Qt::PreciseTimer );
+    Timer.start ( LOADGEN_TIMER_INTERVAL_MS );
+}
+
+CLoadGenWorker::~CLoadGenWorker()
+{
+    qDeleteAll ( vecpClients );
+
+    opus_custom_mode_destroy ( OpusMode );
+}
+
+void CLoadGenWorker::OnTimer()
+{
+    const qint64 iElapsedUs = ElapsedTime.nsecsElapsed() / 1000;
+
+    for ( int i = 0; i < vecpClients.size(); i++ )
+    {
+        CSynthClient* pClient = vecpClients[i];
+
+        // the clients are started one after the other with the ramp interval
+        if ( !pClient->IsStarted() &&
+             ( iElapsedUs >= static_cast<qint64> ( pThread->vecClientIdx[i] ) * pThread->iRampIntervalMs * 1000 ) )
+        {
+            pClient->Start ( iElapsedUs );
+        }
+
+        pClient->Process ( iElapsedUs );
+    }
+
+    if ( iElapsedUs - iLastPublishUs >= 1000000 )
+    {
+        PublishStats();
+        iLastPublishUs = iElapsedUs;
+    }
+}
+
+
+/******************************************************************************\
+* Load Generator                                                               *
+\******************************************************************************/
+CLoadGenerator::CLoadGenerator ( const CHostAddress& NServerAddr,
+                                 const int           iNNumClients,
+                                 const int           iNNumThreads,
+                                 const int           iNRampIntervalMs,
+                                 const int           iNDurationS,
+                                 const bool          bNUseOpus64 ) :
+    iNumClients ( iNNumClients )
+{
+    // distribute the clients round robin on the threads
+    QList<QList<int> > vecvecClientIdx;
+
+    for ( int i = 0; i < iNNumThreads; i++ )
+    {
+        vecvecClientIdx.append ( QList<int>() );
+    }
+
+    for ( int i = 0; i < iNumClients; i++ )
+    {
+        vecvecClientIdx[i % iNNumThreads].append ( i );
+    }
+
+    for ( int i = 0; i < iNNumThreads; i++ )
+    {
+        vecpThreads.append ( new CLoadGenThread ( NServerAddr,
+                                                  vecvecClientIdx[i],
+                                                  iNumClients,
+                                                  iNRampIntervalMs,
+                                                  bNUseOpus64 ) );
+
+        vecpThreads.last()->start ( QThread::TimeCriticalPriority );
+    }
+
+    qInfo() << qUtf8Printable ( QString ( "- load generator: %1 clients on %2 threads, server %3, %4 samples frame size, ramp interval %5 ms" )
+        .arg ( iNumClients )
+        .arg ( iNNumThreads )
+        .arg ( NServerAddr.toString() )
+        .arg ( bNUseOpus64 ? SYSTEM_FRAME_SIZE_SAMPLES : DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES )
+        .arg ( iNRampIntervalMs ) );
+
+    QObject::connect ( &TimerReport, &QTimer::timeout,
+        this, &CLoadGenerator::OnTimerReport );
+
+    QObject::connect ( &TimerDuration, &QTimer::timeout,
+        this, &CLoadGenerator::OnTimerDuration );
+
+    QObject::connect ( CSignalHandler::getSingletonP(), &CSignalHandler::HandledSignal,
+        this, &CLoadGenerator::OnTimerDuration );
+
+    ElapsedTime.start();
+    TimerReport.start ( LOADGEN_REPORT_INTERVAL_MS );
+
+    if ( iNDurationS > 0 )
+    {
+        TimerDuration.setSingleShot ( true );
+        TimerDuration.start ( iNDurationS * 1000 );
+    }
+}
+
+CLoadGenerator::~CLoadGenerator()
+{
+    for ( int i = 0; i < vecpThreads.size(); i++ )
+    {
+        vecpThreads[i]->quit();
+        vecpThreads[i]->wait();
+    }
+
+    qDeleteAll ( vecpThreads );
+}
+
+CVector<CSynthClientStats> CLoadGenerator::GetStats()
+{
+    CVector<CSynthClientStats> vecStats;
+
+    for ( int i = 0; i < vecpThreads.size(); i++ )
+    {
+        const CVector<CSynthClientStats> vecThreadStats = vecpThreads[i]->GetStats();
+
+        const int iOldSize = vecStats.Size();
+
+        vecStats.Enlarge ( vecThreadStats.Size() );
+
+        for ( int j = 0; j < vecThreadStats.Size(); j++ )
+        {
+            vecStats[iOldSize + j] = vecThreadStats[j];
+        }
+    }
+
+    return vecStats;
+}
+
+void CLoadGenerator::Report ( const bool bIsFinal )
+{
+    const CVector<CSynthClientStats> vecStats = GetStats();
+
+    int    iNumStarted    = 0;
+    int    iNumConnected  = 0;
+    qint64 iNumPackets    = 0;
+    qint64 iNumLostFrames = 0;
+    qint64 iNumLate       = 0;
+    qint64 iNumUnderruns  = 0;
+    qint64 iNumVerifyOk   = 0;
+    qint64 iNumVerifyFail = 0;
+    double dJitterSumMs   = 0;
+    double dJitterMaxMs   = 0;
+
+    for ( int i = 0; i < vecStats.Size(); i++ )
+    {
+        const CSynthClientStats& Stats = vecStats[i];
+
+        if ( Stats.bIsStarted )
+        {
+            iNumStarted++;
+        }
+
+        if ( Stats.bIsConnected )
+        {
+            iNumConnected++;
+        }
+
+        iNumPackets    += Stats.LinkTelemetry.iNumPackets;
+        iNumLostFrames += Stats.LinkTelemetry.iNumLostFrames;
+        iNumLate       += Stats.LinkTelemetry.iNumLate;
+        iNumUnderruns  += Stats.iNumUnderruns;
+        iNumVerifyOk   += Stats.iNumVerifyOk;
+        iNumVerifyFail += Stats.iNumVerifyFail;
+        dJitterSumMs   += Stats.LinkTelemetry.dJitterMs;
+        dJitterMaxMs    = std::max ( dJitterMaxMs, Stats.LinkTelemetry.dJitterMs );
+    }
+
+    const double dLossPercent = ( iNumPackets + iNumLostFrames > 0 ) ?
+        100.0 * iNumLostFrames / ( iNumPackets + iNumLostFrames ) : 0;
+
+    qInfo() << qUtf8Printable ( QString ( "%1 s: %2 of %3 clients started, %4 connected, received packets %5, "
+                                          "lost %6 (%7 %), late %8, underruns %9, jitter avg %10 ms max %11 ms, "
+                                          "mix verified %12 ok %13 failed" )
+        .arg ( ElapsedTime.elapsed() / 1000 )
+        .arg ( iNumStarted )
+        .arg ( iNumClients )
+        .arg ( iNumConnected )
+        .arg ( iNumPackets )
+        .arg ( iNumLostFrames )
+        .arg ( dLossPercent, 0, 'f', 3 )
+        .arg ( iNumLate )
+        .arg ( iNumUnderruns )
+        .arg ( vecStats.Size() > 0 ? dJitterSumMs / vecStats.Size() : 0, 0, 'f', 2 )
+        .arg ( dJitterMaxMs, 0, 'f', 2 )
+        .arg ( iNumVerifyOk )
+        .arg ( iNumVerifyFail ) );
+
+    if ( bIsFinal )
+    {
+        for ( int i = 0; i < vecStats.Size(); i++ )
+        {
+            const CSynthClientStats& Stats = vecStats[i];
+
+            qInfo() << qUtf8Printable ( QString ( "client %1 (channel %2): sent %3, skipped %4, received %5, lost %6, "
+                                                  "reordered %7, late %8, underruns %9, jitter %10 ms (p99 %11 ms), "
+                                                  "mix verified %12 ok %13 failed" )
+                .arg ( Stats.iClientIdx )
+                .arg ( Stats.iChanID )
+                .arg ( Stats.iNumFramesSent )
+                .arg ( Stats.iNumSkipped )
+                .arg ( Stats.LinkTelemetry.iNumPackets )
+                .arg ( Stats.LinkTelemetry.iNumLostFrames )
+                .arg ( Stats.LinkTelemetry.iNumReordered )
+                .arg ( Stats.LinkTelemetry.iNumLate )
+                .arg ( Stats.iNumUnderruns )
+                .arg ( Stats.LinkTelemetry.dJitterMs, 0, 'f', 2 )
+                .arg ( Stats.LinkTelemetry.dJitterP99Ms, 0, 'f', 2 )
+                .arg ( Stats.iNumVerifyOk )
+                .arg ( Stats.iNumVerifyFail ) );
+        }
+    }
+}
+
+void CLoadGenerator::OnTimerDuration()
+{
+    TimerReport.stop();
+
+    // stop all threads, they publish their final statistics on exit
+    for ( int i = 0; i < vecpThreads.size(); i++ )
+    {
+        vecpThreads[i]->quit();
+        vecpThreads[i]->wait();
+    }
+
+    Report ( true );
+
+    QCoreApplication::instance()->exit();
+}
+
+int LoadGenMain ( int argc, char** argv )
+{
+    QString strArgument;
+    double  rDbleArgument;
+    QString strServerAddr   = QString ( "127.0.0.1:%1" ).arg ( DEFAULT_PORT_NUMBER );
+    int     iNumClients     = 10;
+    int     iNumThreads     = 1;
+    int     iRampIntervalMs = 0;
+    int     iDurationS      = 0;
+    bool    bUseOpus64      = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( GetFlagArgument ( argv, i, "-h", "--help" ) )
+        {
+            qInfo() << qUtf8Printable ( QString (
+                "Usage: %1 [option] [optional argument]\n"
+                "\nSynthetic client load generator for server capacity tests, start the\n"
+                "server with a sufficient number of channels (-u) on the same host.\n"
+                "\nRecognized options:\n"
+                "  -h, --help            display this help text and exit\n"
+                "  -c, --connect         server address (default 127.0.0.1:%2)\n"
+                "  -u, --numclients      number of synthetic clients\n"
+                "  -T, --threads         number of load generator threads\n"
+                "      --ramp            interval in ms between two client starts\n"
+                "      --duration        test duration in s (0: until interrupted)\n"
+                "  -F, --fastupdate      use 64 samples frame size mode\n" )
+                .arg ( argv[0] )
+                .arg ( DEFAULT_PORT_NUMBER ) );
+            return 0;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-c", "--connect", strArgument ) )
+        {
+            strServerAddr = strArgument;
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "-u", "--numclients", 1, MAX_NUM_CHANNELS, rDbleArgument ) )
+        {
+            iNumClients = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "-T", "--threads", 1, 64, rDbleArgument ) )
+        {
+            iNumThreads = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--ramp", "--ramp", 0, 60000, rDbleArgument ) )
+        {
+            iRampIntervalMs = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        if ( GetNumericArgument ( argc, argv, i, "--duration", "--duration", 0, 86400, rDbleArgument ) )
+        {
+            iDurationS = static_cast<int> ( rDbleArgument );
+            continue;
+        }
+
+        if ( GetFlagArgument ( argv, i, "-F", "--fastupdate" ) )
+        {
+            bUseOpus64 = true;
+            continue;
+        }
+
+        qCritical() << qUtf8Printable ( QString ( "%1: Unknown option '%2' -- use '--help' for help" )
+            .arg ( argv[0] ).arg ( argv[i] ) );
+    }
+
+    CHostAddress ServerAddr;
+
+    if ( !NetworkUtil::ParseNetworkAddress ( strServerAddr, ServerAddr ) )
+    {
+        qCritical() << qUtf8Printable ( QString ( "%1: invalid server address '%2'" )
+            .arg ( argv[0] ).arg ( strServerAddr ) );
+        return 1;
+    }
+
+    QCoreApplication App ( argc, argv );
+
+    CLoadGenerator LoadGenerator ( ServerAddr,
+                                   iNumClients,
+                                   std::min ( iNumThreads, iNumClients ),
+                                   iRampIntervalMs,
+                                   iDurationS,
+                                   bUseOpus64 );
+
+    return App.exec();
+}
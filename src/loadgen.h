@@ -0,0 +1,251 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Synthetic client load generator for capacity tests of the server: a number
+ * of simulated clients run in one process, each negotiates the network
+ * transport properties with the server like a real client, streams an OPUS
+ * coded test tone with the correct packet cadence and decodes and verifies
+ * the mix it receives.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QUdpSocket>
+#include <QElapsedTimer>
+#ifdef USE_OPUS_SHARED_LIB
+# include "opus/opus_custom.h"
+#else
+# include "opus_custom.h"
+#endif
+#include "global.h"
+#include "util.h"
+#include "protocol.h"
+#include "channel.h"
+
+
+/* Definitions ****************************************************************/
+// heartbeat of the load generator threads, all frames which are due are
+// processed on each timer event
+#define LOADGEN_TIMER_INTERVAL_MS       1
+
+// maximum number of frames one client processes per timer event (if the
+// thread was stalled for a longer time the frames are skipped)
+#define LOADGEN_MAX_FRAMES_PER_TIMER    16
+
+#define LOADGEN_REPORT_INTERVAL_MS      5000
+
+// each client sends a sine with its own frequency, the mix is verified with
+// the test signal detector (multiples of 10 Hz)
+#define LOADGEN_BASE_FREQ_HZ            200
+#define LOADGEN_FREQ_STEP_HZ            20
+#define LOADGEN_NUM_FREQS               200
+
+// the server fades in new clients within 3 s, the verification starts after
+// this settle time
+#define LOADGEN_SETTLE_TIME_MS          4000
+
+
+/* Classes ********************************************************************/
+// statistics of one synthetic client
+class CSynthClientStats
+{
+public:
+    CSynthClientStats() :
+        iClientIdx     ( INVALID_INDEX ),
+        iChanID        ( INVALID_INDEX ),
+        bIsStarted     ( false ),
+        bIsConnected   ( false ),
+        iNumFramesSent ( 0 ),
+        iNumUnderruns  ( 0 ),
+        iNumSkipped    ( 0 ),
+        iNumVerifyOk   ( 0 ),
+        iNumVerifyFail ( 0 ) {}
+
+    int                   iClientIdx;
+    int                   iChanID;
+    bool                  bIsStarted;
+    bool                  bIsConnected;
+    qint64                iNumFramesSent;
+    qint64                iNumUnderruns;  // frames which were not available in the jitter buffer
+    qint64                iNumSkipped;    // frames skipped because the thread was stalled
+    qint64                iNumVerifyOk;   // verification windows with the expected tones
+    qint64                iNumVerifyFail;
+    CLinkTelemetrySummary LinkTelemetry;
+};
+
+// one simulated client (lives in the thread of its load generator worker)
+class CSynthClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    CSynthClient ( const int           iNClientIdx,
+                   const int           iNNumClients,
+                   const CHostAddress& NServerAddr,
+                   OpusCustomMode*     pOpusMode,
+                   const bool          bNUseOpus64 );
+
+    virtual ~CSynthClient();
+
+    void Start ( const qint64 iNStartUs );
+    bool IsStarted() const { return bIsStarted; }
+
+    // send and receive all frames which are due at the given time
+    void Process ( const qint64 iElapsedUs );
+
+    CSynthClientStats GetStats();
+
+protected:
+    void   ProcessFrame();
+    void   VerifyMix();
+    int    GetFreqHz ( const int iIdx ) const { return LOADGEN_BASE_FREQ_HZ + LOADGEN_FREQ_STEP_HZ * ( iIdx % LOADGEN_NUM_FREQS ); }
+
+    int                iClientIdx;
+    int                iNumClients;
+    CHostAddress       ServerAddr;
+    bool               bUseOpus64;
+    bool               bIsStarted;
+
+    QUdpSocket         Socket;
+    CChannel           Channel;
+    CChannelCoreInfo   ChannelInfo;
+
+    OpusCustomEncoder* OpusEncoder;
+    OpusCustomDecoder* OpusDecoder;
+    int                iFrameSizeSamples;
+    int                iNumCodedBytes;
+
+    qint64             iStartUs;
+    qint64             iNumFramesProcessed;
+    CTestSignal        TestSignal;
+
+    CVector<int16_t>   vecsAudio;
+    CVector<uint8_t>   vecbyCoded;
+    CVector<uint8_t>   vecbyPacket;
+    CVector<uint8_t>   vecbyNetwData;
+    CVector<uint8_t>   vecbyRecBuf;
+
+    CSynthClientStats  Stats;
+
+public slots:
+    void OnReadyRead();
+    void OnSendProtMessage ( CVector<uint8_t> vecMessage );
+    void OnReqJittBufSize() { Channel.CreateJitBufMes ( AUTO_NET_BUF_SIZE_FOR_PROTOCOL ); }
+    void OnReqChanInfo() { Channel.SetRemoteInfo ( ChannelInfo ); }
+};
+
+// thread which runs a subset of the synthetic clients
+class CLoadGenThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    CLoadGenThread ( const CHostAddress& NServerAddr,
+                     const QList<int>&   NvecClientIdx,
+                     const int           iNNumClients,
+                     const int           iNRampIntervalMs,
+                     const bool          bNUseOpus64 ) :
+        ServerAddr       ( NServerAddr ),
+        vecClientIdx     ( NvecClientIdx ),
+        iNumClients      ( iNNumClients ),
+        iRampIntervalMs  ( iNRampIntervalMs ),
+        bUseOpus64       ( bNUseOpus64 ) { setObjectName ( "CLoadGenThread" ); }
+
+    CVector<CSynthClientStats> GetStats();
+
+protected:
+    virtual void run();
+
+    void PublishStats ( const QList<CSynthClient*>& vecpClients );
+
+    CHostAddress               ServerAddr;
+    QList<int>                 vecClientIdx;
+    int                        iNumClients;
+    int                        iRampIntervalMs;
+    bool                       bUseOpus64;
+
+    QMutex                     Mutex;
+    CVector<CSynthClientStats> vecStats;
+
+    friend class CLoadGenWorker;
+};
+
+// timer driven processing of the clients of one load generator thread
+class CLoadGenWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    CLoadGenWorker ( CLoadGenThread* pNThread );
+    virtual ~CLoadGenWorker();
+
+    void PublishStats() { pThread->PublishStats ( vecpClients ); }
+
+protected:
+    CLoadGenThread*      pThread;
+    OpusCustomMode*      OpusMode;
+    QList<CSynthClient*> vecpClients;
+    QTimer               Timer;
+    QElapsedTimer        ElapsedTime;
+    qint64               iLastPublishUs;
+
+public slots:
+    void OnTimer();
+};
+
+// controls the load generator threads and reports the statistics
+class CLoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    CLoadGenerator ( const CHostAddress& NServerAddr,
+                     const int           iNNumClients,
+                     const int           iNNumThreads,
+                     const int           iNRampIntervalMs,
+                     const int           iNDurationS,
+                     const bool          bNUseOpus64 );
+
+    virtual ~CLoadGenerator();
+
+protected:
+    CVector<CSynthClientStats> GetStats();
+    void Report ( const bool bIsFinal );
+
+    QList<CLoadGenThread*> vecpThreads;
+    QTimer                 TimerReport;
+    QTimer                 TimerDuration;
+    QElapsedTimer          ElapsedTime;
+    int                    iNumClients;
+
+public slots:
+    void OnTimerReport() { Report ( false ); }
+    void OnTimerDuration();
+};
+
+// entry point of the load generator build target
+int LoadGenMain ( int argc, char** argv );
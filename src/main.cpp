@@ -39,6 +39,24 @@
 #include "settings.h"
 #include "testbench.h"
 #include "util.h"
+#ifdef LOADGEN
+# include "loadgen.h"
+#endif
+#ifdef BENCH
+# include "bench.h"
+#endif
+#ifdef JBEVAL
+# include "jbeval.h"
+#endif
+#ifdef RECDECODE
+# include "recdecode.h"
+#endif
+#ifdef MIXDOWN
+# include "mixdown.h"
+#endif
+#ifdef SELFTEST
+# include "selftest.h"
+#endif
 #ifdef ANDROID
 # include <QtAndroidExtras/QtAndroid>
 #endif
@@ -49,9 +67,37 @@
 
 // Implementation **************************************************************
 QString GetClientName(const QString& sNFiName);
+bool BenchmarkServer ( CServer* pServer, const CStartup& Startup );
+template<typename T> void StartPacketTrace ( T* pObject, const CStartup& Startup );
+template<typename T> void StartNetworkEmulator ( T* pObject, const CStartup& Startup );
+template<typename T> void StartMetrics ( CMetricsServer& MetricsServer, T* pObject, const CStartup& Startup );
 
 int main ( int argc, char** argv )
 {
+#ifdef LOADGEN
+    // the load generator build target has its own command line and main loop
+    return LoadGenMain ( argc, argv );
+#endif
+#ifdef BENCH
+    // the benchmark build target has its own command line
+    return BenchMain ( argc, argv );
+#endif
+#ifdef JBEVAL
+    // the jitter buffer evaluation build target has its own command line
+    return JitterBufEvalMain ( argc, argv );
+#endif
+#ifdef RECDECODE
+    // the offline decoder of the coded recordings has its own command line
+    return RecDecodeMain ( argc, argv );
+#endif
+#ifdef MIXDOWN
+    // the offline mixdown of the recorded sessions has its own command line
+    return MixdownMain ( argc, argv );
+#endif
+#ifdef SELFTEST
+    // the self tests have their own command line
+    return SelfTestMain ( argc, argv );
+#endif
 
     QString        strArgument;
     double         rDbleArgument;
@@ -99,10 +145,27 @@ int main ( int argc, char** argv )
     Startup.iPortNumberClient                   = 22124+10;
     Startup.bUseMultithreading                  = false;
     Startup.bDisableRecording                   = false;
+    Startup.bRecordCodedPackets                 = false;
     Startup.strServerPublicIP                   = "";
     Startup.strServerListFilter                 = "";
     Startup.bMuteMeInPersonalMix                = false;
+    Startup.bP2P                                = false;
+    Startup.bDtx                                = false;
+    Startup.bRedundancy                         = false;
+    Startup.iTestSignalFreqHz                   = 0;
+    Startup.strSoundFileIn                      = "";
+    Startup.strSoundFileOut                     = "";
+    Startup.bVirtualClock                       = false;
     Startup.bNCentServPingServerInList          = false;
+    Startup.bServerBenchmark                    = false;
+    Startup.bServerCalibrate                    = false;
+    Startup.strPacketTraceFileName              = "";
+    Startup.bPacketTraceHashOnly                = false;
+    Startup.strPacketTraceReplayFileName        = "";
+    Startup.dPacketTraceReplaySpeed             = 1.0;
+    Startup.strNetworkEmulatorFileName          = "";
+    Startup.iNetworkEmulatorSeed                = 1;
+    Startup.strMetricsAddress                   = "";
 
     // QT docu: argv()[0] is the program name, argv()[1] is the first
     // argument and argv()[argc()-1] is the last argument.
@@ -169,6 +232,160 @@ int main ( int argc, char** argv )
         }
 
 
+        // Server benchmark ----------------------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--benchmark", // no short form
+                               "--benchmark" ) )
+        {
+            Startup.bServerBenchmark = true;
+            qInfo() << "- server benchmark mode";
+            continue;
+        }
+
+
+        // Server calibration at startup ---------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--calibrate", // no short form
+                               "--calibrate" ) )
+        {
+            Startup.bServerCalibrate = true;
+            qInfo() << "- calibrate the server at startup";
+            Startup.CommandLineOptions << "--calibrate";
+            continue;
+        }
+
+
+        // Packet trace capture ------------------------------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--tracefile", // no short form
+                                 "--tracefile",
+                                 strArgument ) )
+        {
+            Startup.strPacketTraceFileName = strArgument;
+            qInfo() << qUtf8Printable( QString( "- packet trace file: %1" )
+                .arg( Startup.strPacketTraceFileName ) );
+            Startup.CommandLineOptions << "--tracefile";
+            continue;
+        }
+
+
+        // Packet trace without payload ----------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--tracehashonly", // no short form
+                               "--tracehashonly" ) )
+        {
+            Startup.bPacketTraceHashOnly = true;
+            qInfo() << "- packet trace with payload hashes only";
+            Startup.CommandLineOptions << "--tracehashonly";
+            continue;
+        }
+
+
+        // Packet trace replay -------------------------------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--tracereplay", // no short form
+                                 "--tracereplay",
+                                 strArgument ) )
+        {
+            Startup.strPacketTraceReplayFileName = strArgument;
+            qInfo() << qUtf8Printable( QString( "- packet trace replay file: %1" )
+                .arg( Startup.strPacketTraceReplayFileName ) );
+            Startup.CommandLineOptions << "--tracereplay";
+            continue;
+        }
+
+
+        // Packet trace replay speed -------------------------------------------
+        if ( GetNumericArgument ( argc,
+                                  argv,
+                                  i,
+                                  "--tracespeed", // no short form
+                                  "--tracespeed",
+                                  0,
+                                  1000,
+                                  rDbleArgument ) )
+        {
+            Startup.dPacketTraceReplaySpeed = rDbleArgument;
+            qInfo() << qUtf8Printable( QString( "- packet trace replay speed: %1" )
+                .arg( Startup.dPacketTraceReplaySpeed ) );
+            Startup.CommandLineOptions << "--tracespeed";
+            continue;
+        }
+
+
+        // Network emulator rule -----------------------------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--netem", // no short form
+                                 "--netem",
+                                 strArgument ) )
+        {
+            Startup.slNetworkEmulatorRules << strArgument;
+            qInfo() << qUtf8Printable( QString( "- network emulator rule: %1" )
+                .arg( strArgument ) );
+            Startup.CommandLineOptions << "--netem";
+            continue;
+        }
+
+
+        // Network emulator config file ----------------------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--netemfile", // no short form
+                                 "--netemfile",
+                                 strArgument ) )
+        {
+            Startup.strNetworkEmulatorFileName = strArgument;
+            qInfo() << qUtf8Printable( QString( "- network emulator config file: %1" )
+                .arg( Startup.strNetworkEmulatorFileName ) );
+            Startup.CommandLineOptions << "--netemfile";
+            continue;
+        }
+
+
+        // Network emulator random seed ----------------------------------------
+        if ( GetNumericArgument ( argc,
+                                  argv,
+                                  i,
+                                  "--netemseed", // no short form
+                                  "--netemseed",
+                                  0,
+                                  2147483647,
+                                  rDbleArgument ) )
+        {
+            Startup.iNetworkEmulatorSeed = static_cast<int> ( rDbleArgument );
+            qInfo() << qUtf8Printable( QString( "- network emulator random seed: %1" )
+                .arg( Startup.iNetworkEmulatorSeed ) );
+            Startup.CommandLineOptions << "--netemseed";
+            continue;
+        }
+
+
+        // Metrics endpoint ----------------------------------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--metrics", // no short form
+                                 "--metrics",
+                                 strArgument ) )
+        {
+            Startup.strMetricsAddress = strArgument;
+            qInfo() << qUtf8Printable( QString( "- metrics endpoint address: %1" )
+                .arg( Startup.strMetricsAddress ) );
+            Startup.CommandLineOptions << "--metrics";
+            continue;
+        }
+
+
         // Maximum number of channels ------------------------------------------
         if ( GetNumericArgument ( argc,
                                   argv,
@@ -372,6 +589,19 @@ int main ( int argc, char** argv )
        }
 
 
+        // Record the coded packets --------------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--recordcoded", // no short form
+                               "--recordcoded" ) )
+        {
+            Startup.bRecordCodedPackets = true;
+            qInfo() << "- recording the coded packets (decode with jamulus-recdecode)";
+            Startup.CommandLineOptions << "--recordcoded";
+            continue;
+        }
+
+
         // Central server ------------------------------------------------------
         if ( GetStringArgument ( argc,
                                  argv,
@@ -507,6 +737,122 @@ int main ( int argc, char** argv )
         }
 
 
+        // For headless client enable P2P mode on startup ----------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--p2p", // no short form
+                               "--p2p" ) )
+        {
+            Startup.bP2P = true;
+            qInfo() << "- P2P mode enabled";
+            Startup.CommandLineOptions << "--p2p";
+            continue;
+        }
+
+
+        // Discontinuous transmission of silent input ------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--dtx", // no short form
+                               "--dtx" ) )
+        {
+            Startup.bDtx = true;
+            qInfo() << "- discontinuous transmission enabled";
+            Startup.CommandLineOptions << "--dtx";
+            continue;
+        }
+
+
+        // Redundant copy of the previous audio block -------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--redundancy", // no short form
+                               "--redundancy" ) )
+        {
+            Startup.bRedundancy = true;
+            qInfo() << "- redundant audio blocks enabled";
+            Startup.CommandLineOptions << "--redundancy";
+            continue;
+        }
+
+
+        // Test signal instead of the sound card input -------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--testsignal", // no short form
+                                 "--testsignal",
+                                 strArgument ) )
+        {
+            // format: [own frequency];[peer frequency 1];[peer frequency 2]; ...
+            const QStringList slFreqs = strArgument.split ( ";" );
+
+            Startup.veciTestSignalPeerFreqHz.clear();
+
+            for ( int iFreq = 0; iFreq < slFreqs.size(); iFreq++ )
+            {
+                if ( iFreq == 0 )
+                {
+                    Startup.iTestSignalFreqHz = slFreqs[iFreq].toInt();
+                }
+                else
+                {
+                    Startup.veciTestSignalPeerFreqHz.append ( slFreqs[iFreq].toInt() );
+                }
+            }
+
+            qInfo() << qUtf8Printable( QString( "- test signal: %1" )
+                .arg( strArgument ) );
+            Startup.CommandLineOptions << "--testsignal";
+            continue;
+        }
+
+
+        // WAV file instead of the sound card input ----------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--soundfilein", // no short form
+                                 "--soundfilein",
+                                 strArgument ) )
+        {
+            Startup.strSoundFileIn = strArgument;
+            qInfo() << qUtf8Printable( QString( "- sound input file: %1" )
+                .arg( Startup.strSoundFileIn ) );
+            Startup.CommandLineOptions << "--soundfilein";
+            continue;
+        }
+
+
+        // WAV file instead of the sound card output ---------------------------
+        if ( GetStringArgument ( argc,
+                                 argv,
+                                 i,
+                                 "--soundfileout", // no short form
+                                 "--soundfileout",
+                                 strArgument ) )
+        {
+            Startup.strSoundFileOut = strArgument;
+            qInfo() << qUtf8Printable( QString( "- sound output file: %1" )
+                .arg( Startup.strSoundFileOut ) );
+            Startup.CommandLineOptions << "--soundfileout";
+            continue;
+        }
+
+
+        // Virtual clock instead of real time sound card timing ----------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "--virtualclock", // no short form
+                               "--virtualclock" ) )
+        {
+            Startup.bVirtualClock = true;
+            qInfo() << "- virtual clock enabled";
+            Startup.CommandLineOptions << "--virtualclock";
+            continue;
+        }
+
+
         // Version number ------------------------------------------------------
         if ( ( !strcmp ( argv[i], "--version" ) ) ||
              ( !strcmp ( argv[i], "-v" ) ) )
@@ -580,6 +926,39 @@ int main ( int argc, char** argv )
         }
     }
 
+#if WITH_SOUND
+    // the WAV files replace the sound card, they are only available in the
+    // builds without sound card interface
+    if ( !Startup.strSoundFileIn.isEmpty() || !Startup.strSoundFileOut.isEmpty() || Startup.bVirtualClock )
+    {
+        qCritical() << "The sound files and the virtual clock are only supported without sound card "
+                       "interface (qmake \"CONFIG+=nosound\").";
+        exit ( 1 );
+    }
+#endif
+
+    // the virtual clock processes the client audio as fast as possible which is
+    // only allowed offline (it would flood the server and the peers with audio
+    // packets) and with a finite input (it would never end otherwise)
+    if ( Startup.bVirtualClock && Startup.strSoundFileIn.isEmpty() )
+    {
+        Startup.bVirtualClock = false;
+        qWarning() << "The virtual clock needs a sound input file (--soundfilein). Using the real time clock.";
+    }
+
+    if ( Startup.bVirtualClock && !Startup.strConnOnStartupAddress.isEmpty() )
+    {
+        Startup.strConnOnStartupAddress = "";
+        qWarning() << "The client runs offline with the virtual clock. The connect address is ignored.";
+    }
+
+    // the benchmark quits before the server is started, it must not take the
+    // port of a running server (the socket is bound to any free port instead)
+    if ( Startup.bServerBenchmark )
+    {
+        Startup.iPortNumberServer = 0;
+    }
+
     // per definition: if we are in "GUI" server mode and no central server
     // address is given, we use the default central server address
     if ( Startup.bIsServer && bUseGUI && Startup.strCentralServer.isEmpty() )
@@ -601,6 +980,9 @@ int main ( int argc, char** argv )
 
 
     try {
+        // the endpoint serves the metrics of the server and the client
+        CMetricsServer MetricsServer;
+
         if(!Startup.bNCentServPingServerInList)
         {
             if (Startup.strUserName.isEmpty()) {
@@ -652,6 +1034,17 @@ int main ( int argc, char** argv )
                                         Startup.bDisableRecording,
                                         Startup.eNLicenceType);
 
+                if ( BenchmarkServer ( pServer, Startup ) )
+                {
+                    return 0;
+                }
+
+                pServer->SetRecordCodedPackets ( Startup.bRecordCodedPackets );
+
+                StartPacketTrace ( pServer, Startup );
+                StartNetworkEmulator ( pServer, Startup );
+                StartMetrics ( MetricsServer, pServer, Startup );
+
                 // load settings from init-file
                 // CServerSettings Settings ( &Server, Startup.strIniFileName );
                 // Settings.Load();
@@ -694,8 +1087,61 @@ int main ( int argc, char** argv )
                 // qDebug() << "showing clientdlg";
                 pClientDlg->setModal(true);
                 pClientDlg->show();
-            }
+            } else
 #endif
+            {
+                // without GUI connect as soon as the central server sends the
+                // address of our session (the client dialog does this otherwise)
+                QObject::connect ( pClient, &CClient::ServerConnection,
+                    [pClient] ( QString strReceivedServerIp, QString )
+                    {
+                        if ( pClient->SetServerAddr ( strReceivedServerIp ) && !pClient->IsRunning() )
+                        {
+                            pClient->Start();
+                        }
+                    } );
+
+                if ( Startup.bP2P )
+                {
+                    pClient->SetP2pEnabled ( true );
+                }
+            }
+
+            if ( Startup.bDtx )
+            {
+                pClient->SetDtxEnabled ( true );
+            }
+
+            if ( Startup.bRedundancy )
+            {
+                pClient->SetRedundancyEnabled ( true );
+            }
+
+            if ( Startup.iTestSignalFreqHz > 0 )
+            {
+                pClient->SetTestSignal ( Startup.iTestSignalFreqHz, Startup.veciTestSignalPeerFreqHz );
+            }
+
+            if ( !Startup.strSoundFileIn.isEmpty() || !Startup.strSoundFileOut.isEmpty() || Startup.bVirtualClock )
+            {
+                pClient->SetSoundFiles ( Startup.strSoundFileIn, Startup.strSoundFileOut, Startup.bVirtualClock );
+            }
+
+            // an offline client does not get a session address from the
+            // central server, without GUI it processes the input file right away
+            if ( Startup.bVirtualClock && !bUseGUI )
+            {
+                pClient->Start();
+            }
+
+            if ( !Startup.bIsServer )
+            {
+                StartPacketTrace ( pClient, Startup );
+            }
+
+            StartNetworkEmulator ( pClient, Startup );
+            StartMetrics ( MetricsServer, pClient, Startup );
+
             if (Startup.bIsServer) {
                 QObject::connect(pServer,
                                 &CServer::ServerRegisteredSuccessfully,
@@ -724,6 +1170,17 @@ int main ( int argc, char** argv )
                                     Startup.bDisableRecording,
                                     Startup.eNLicenceType);
 
+            if ( BenchmarkServer ( pServer, Startup ) )
+            {
+                return 0;
+            }
+
+            pServer->SetRecordCodedPackets ( Startup.bRecordCodedPackets );
+
+            StartPacketTrace ( pServer, Startup );
+            StartNetworkEmulator ( pServer, Startup );
+            StartMetrics ( MetricsServer, pServer, Startup );
+
             // load settings from init-file
             // CServerSettings Settings ( &Server, Startup.strIniFileName );
             // Settings.Load();
@@ -814,6 +1271,64 @@ QString GetClientName(const QString& sNFiName)
 }
 
 
+/******************************************************************************\
+* Server and Client Startup Helpers                                            *
+\******************************************************************************/
+bool BenchmarkServer ( CServer* pServer, const CStartup& Startup )
+{
+    if ( Startup.bServerBenchmark )
+    {
+        // full benchmark: print the report and quit
+        qInfo() << qUtf8Printable ( pServer->RunBenchmark ( SERVER_BENCHMARK_NUM_FRAMES ).ToString() );
+        return true;
+    }
+
+    if ( Startup.bServerCalibrate )
+    {
+        // quick calibration: use the derived values for this server
+        const CServerBenchmarkResult Result = pServer->RunBenchmark ( SERVER_CALIBRATION_NUM_FRAMES );
+
+        qInfo() << qUtf8Printable ( Result.ToString() );
+        pServer->ApplyBenchmarkResult ( Result );
+    }
+
+    return false;
+}
+
+template<typename T> void StartPacketTrace ( T* pObject, const CStartup& Startup )
+{
+    if ( !Startup.strPacketTraceFileName.isEmpty() )
+    {
+        pObject->StartPacketTrace ( Startup.strPacketTraceFileName, Startup.bPacketTraceHashOnly );
+    }
+
+    if ( !Startup.strPacketTraceReplayFileName.isEmpty() )
+    {
+        pObject->StartPacketTraceReplay ( Startup.strPacketTraceReplayFileName, Startup.dPacketTraceReplaySpeed );
+    }
+}
+
+template<typename T> void StartNetworkEmulator ( T* pObject, const CStartup& Startup )
+{
+    if ( !Startup.slNetworkEmulatorRules.isEmpty() || !Startup.strNetworkEmulatorFileName.isEmpty() )
+    {
+        pObject->StartNetworkEmulator ( Startup.slNetworkEmulatorRules,
+                                        Startup.strNetworkEmulatorFileName,
+                                        Startup.iNetworkEmulatorSeed );
+    }
+}
+
+template<typename T> void StartMetrics ( CMetricsServer& MetricsServer, T* pObject, const CStartup& Startup )
+{
+    if ( !Startup.strMetricsAddress.isEmpty() )
+    {
+        pObject->EnableMetrics();
+        MetricsServer.AddSource ( [pObject] ( CMetricsWriter& Writer ) { pObject->WriteMetrics ( Writer ); } );
+        MetricsServer.Start ( Startup.strMetricsAddress );
+    }
+}
+
+
 /******************************************************************************\
 * Command Line Argument Parsing                                                *
 \******************************************************************************/
@@ -829,6 +1344,27 @@ QString UsageArguments ( char **argv )
         "  -p, --port            set your local port number\n"
         "  -t, --notranslation   disable translation (use English language)\n"
         "  -v, --version         output version information and exit\n"
+        "      --tracefile       capture the received packets in a trace file\n"
+        "                        (server socket in server mode, else client)\n"
+        "      --tracehashonly   store only a hash of the packet payloads\n"
+        "      --tracereplay     replay a packet trace file into the server or\n"
+        "                        the client (offline: nothing is sent to the\n"
+        "                        recorded addresses, quits at the end of the\n"
+        "                        trace)\n"
+        "      --tracespeed      replay speed factor (1 = original timing, 0 = as\n"
+        "                        fast as possible)\n"
+        "      --netem           network emulator rule for the sent and received\n"
+        "                        packets (can be given multiple times) in the\n"
+        "                        format: [key]=[value],... with the keys dir\n"
+        "                        (send, recv, both), addr ([IP] or [IP]:[port]),\n"
+        "                        delay (ms), jitter (ms), dist (uniform, normal,\n"
+        "                        pareto), loss (%), burst (mean loss burst length),\n"
+        "                        reorder (%), dup (%), rate (kbit/s)\n"
+        "      --netemfile       network emulator config file (one rule per line)\n"
+        "      --netemseed       random seed of the network emulator (one random\n"
+        "                        stream per direction)\n"
+        "      --metrics         Prometheus metrics endpoint: [port],\n"
+        "                        [host]:[port] or unix:[path]\n"
         "\nServer only:\n"
         "  -d, --discononquit    disconnect all clients on quit\n"
         "  -e, --centralserver   address of the server list on which to register\n"
@@ -843,10 +1379,16 @@ QString UsageArguments ( char **argv )
         "                        [name];[city];[country as QLocale ID]\n"
         "  -R, --recording       sets directory to contain recorded jams\n"
         "      --norecord        disables recording (when enabled by default by -R)\n"
+        "      --recordcoded     records the coded packets instead of WAV files\n"
+        "                        (decoded offline with jamulus-recdecode)\n"
         "  -s, --server          start server\n"
         "  -T, --multithreading  use multithreading to make better use of\n"
         "                        multi-core CPUs and support more clients\n"
         "  -u, --numchannels     maximum number of channels\n"
+        "      --benchmark       time decoding, mixing and encoding on this hardware,\n"
+        "                        print the derived server capacity and exit\n"
+        "      --calibrate       run a quick benchmark at startup and use the\n"
+        "                        calibrated multithreading block sizes\n"
         "  -w, --welcomemessage  welcome message on connect\n"
         "  -z, --startminimized  start minimizied\n"
         "      --serverpublicip  specify your public IP address when\n"
@@ -855,6 +1397,25 @@ QString UsageArguments ( char **argv )
         "\nClient only:\n"
         "  -M, --mutestream      starts the application in muted state\n"
         "      --mutemyown       mute me in my personal mix (headless only)\n"
+        "      --p2p             enable P2P mode on startup (headless only)\n"
+        "      --dtx             stop sending audio packets while the input is\n"
+        "                        silent or muted (the server and the peers must\n"
+        "                        support the keep-alive packets)\n"
+        "      --redundancy      each audio packet also carries the previous block\n"
+        "                        to restore single lost packets (about twice the\n"
+        "                        bandwidth, the server and the peers must support\n"
+        "                        it, P2P needs it on all peers)\n"
+        "      --testsignal      use a sine instead of the sound card input and\n"
+        "                        check the output for the tones of the peers\n"
+        "                        (no sound card only), in the format:\n"
+        "                        [own freq Hz];[peer freq Hz 1];[peer freq Hz 2]; ...\n"
+        "      --soundfilein     read the input from a WAV file (48 kHz, 16 bit,\n"
+        "                        no sound card only), quit at the end of the file\n"
+        "      --soundfileout    write the output to a WAV file (no sound card only)\n"
+        "      --virtualclock    process the audio as fast as possible instead of\n"
+        "                        in real time (no sound card only, needs\n"
+        "                        --soundfilein, the client runs offline and\n"
+        "                        decodes its own signal instead of the server mix)\n"
         "  -c, --connect         connect to given server address on startup\n"
         "  -j, --nojackconnect   disable auto Jack connections\n"
         "      --ctrlmidich      MIDI controller channel to listen\n"
@@ -0,0 +1,213 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QTimer>
+#include "metrics.h"
+
+
+/* Definitions ****************************************************************/
+// connections which do not send a complete request are closed after this time
+#define METRICS_CONNECTION_TIME_OUT_MS  5000
+
+static const int64_t MetricsDurationBucketsUs[METRICS_NUM_DURATION_BUCKETS] = METRICS_DURATION_BUCKETS_US;
+
+
+/* Implementation *************************************************************/
+void CMetricsDurationHistogram::Add ( const int64_t iDurationUs )
+{
+    int iBucket = 0;
+
+    while ( ( iBucket < METRICS_NUM_DURATION_BUCKETS ) && ( iDurationUs > MetricsDurationBucketsUs[iBucket] ) )
+    {
+        iBucket++;
+    }
+
+    Buckets[iBucket].Add();
+    SumUs.Add ( iDurationUs );
+}
+
+void CMetricsWriter::AddFamily ( const QString& strName,
+                                 const QString& strType,
+                                 const QString& strHelp )
+{
+    strText += QString ( "# HELP %1 %2\n# TYPE %1 %3\n" ).arg ( strName ).arg ( strHelp ).arg ( strType );
+}
+
+void CMetricsWriter::Add ( const QString& strName,
+                           const QString& strLabels,
+                           const double   dValue )
+{
+    if ( strLabels.isEmpty() )
+    {
+        strText += QString ( "%1 %2\n" ).arg ( strName ).arg ( dValue, 0, 'g', 15 );
+    }
+    else
+    {
+        strText += QString ( "%1{%2} %3\n" ).arg ( strName ).arg ( strLabels ).arg ( dValue, 0, 'g', 15 );
+    }
+}
+
+void CMetricsWriter::AddHistogram ( const QString&                   strName,
+                                    const QString&                   strLabels,
+                                    const CMetricsDurationHistogram& Histogram )
+{
+    // the buckets of the text format are cumulative
+    const QString strSeparator = strLabels.isEmpty() ? "" : ",";
+    int64_t       iCount       = 0;
+
+    for ( int i = 0; i <= METRICS_NUM_DURATION_BUCKETS; i++ )
+    {
+        iCount += Histogram.Buckets[i].Get();
+
+        const QString strBound = ( i < METRICS_NUM_DURATION_BUCKETS ) ?
+            QString::number ( static_cast<double> ( MetricsDurationBucketsUs[i] ) / 1000000, 'g', 6 ) : "+Inf";
+
+        Add ( strName + "_bucket", strLabels + strSeparator + Label ( "le", strBound ), iCount );
+    }
+
+    Add ( strName + "_sum",   strLabels, static_cast<double> ( Histogram.SumUs.Get() ) / 1000000 );
+    Add ( strName + "_count", strLabels, iCount );
+}
+
+QString CMetricsWriter::Label ( const QString& strName, const QString& strValue )
+{
+    // escape the characters which are not allowed in label values
+    QString strEscaped = strValue;
+    strEscaped.replace ( "\\", "\\\\" ).replace ( "\"", "\\\"" ).replace ( "\n", "\\n" );
+
+    return QString ( "%1=\"%2\"" ).arg ( strName ).arg ( strEscaped );
+}
+
+void CMetricsServer::Start ( const QString& strAddress )
+{
+    if ( TcpServer.isListening() || LocalServer.isListening() )
+    {
+        return;
+    }
+
+    if ( strAddress.startsWith ( METRICS_UNIX_SOCKET_PREFIX ) )
+    {
+        const QString strPath = strAddress.mid ( QString ( METRICS_UNIX_SOCKET_PREFIX ).length() );
+
+        // remove a stale socket file of a previous run
+        QLocalServer::removeServer ( strPath );
+
+        if ( !LocalServer.listen ( strPath ) )
+        {
+            throw CGenErr ( QString ( "The metrics endpoint %1 cannot be opened: %2" )
+                .arg ( strAddress ).arg ( LocalServer.errorString() ) );
+        }
+
+        QObject::connect ( &LocalServer, &QLocalServer::newConnection,
+            this, &CMetricsServer::OnNewLocalConnection );
+    }
+    else
+    {
+        // only the local host is used if no host is given
+        QHostAddress HostAddr ( QHostAddress::LocalHost );
+        QString      strPort = strAddress;
+        bool         bHostOk = true;
+        bool         bPortOk = false;
+
+        if ( strAddress.contains ( ':' ) )
+        {
+            bHostOk = HostAddr.setAddress ( strAddress.section ( ':', 0, -2 ) );
+            strPort = strAddress.section ( ':', -1 );
+        }
+
+        const quint16 iPort = static_cast<quint16> ( strPort.toUInt ( &bPortOk ) );
+
+        if ( !bHostOk || !bPortOk || ( iPort == 0 ) || !TcpServer.listen ( HostAddr, iPort ) )
+        {
+            throw CGenErr ( QString ( "The metrics endpoint %1 cannot be opened: %2" )
+                .arg ( strAddress ).arg ( TcpServer.errorString() ) );
+        }
+
+        QObject::connect ( &TcpServer, &QTcpServer::newConnection,
+            this, &CMetricsServer::OnNewTcpConnection );
+    }
+
+    qInfo() << qUtf8Printable ( QString ( "- metrics endpoint: %1" ).arg ( strAddress ) );
+}
+
+void CMetricsServer::Respond ( QIODevice* pDevice )
+{
+    CMetricsWriter Writer;
+
+    for ( int i = 0; i < vecSources.size(); i++ )
+    {
+        vecSources[i] ( Writer );
+    }
+
+    pDevice->write ( Writer.GetText().toUtf8() );
+}
+
+void CMetricsServer::OnNewTcpConnection()
+{
+    while ( TcpServer.hasPendingConnections() )
+    {
+        QTcpSocket* pSocket = TcpServer.nextPendingConnection();
+
+        QObject::connect ( pSocket, &QTcpSocket::disconnected,
+            pSocket, &QTcpSocket::deleteLater );
+
+        QTimer::singleShot ( METRICS_CONNECTION_TIME_OUT_MS, pSocket, &QTcpSocket::abort );
+
+        // answer when the HTTP request header is complete (the request itself
+        // is not evaluated, each path returns the metrics)
+        QObject::connect ( pSocket, &QTcpSocket::readyRead, this, [this, pSocket]()
+        {
+            if ( !pSocket->peek ( pSocket->bytesAvailable() ).contains ( "\r\n\r\n" ) )
+            {
+                return;
+            }
+
+            QObject::disconnect ( pSocket, &QTcpSocket::readyRead, this, nullptr );
+            pSocket->readAll();
+
+            pSocket->write ( "HTTP/1.0 200 OK\r\n"
+                             "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                             "Connection: close\r\n\r\n" );
+            Respond ( pSocket );
+            pSocket->disconnectFromHost();
+        } );
+    }
+}
+
+void CMetricsServer::OnNewLocalConnection()
+{
+    while ( LocalServer.hasPendingConnections() )
+    {
+        QLocalSocket* pSocket = LocalServer.nextPendingConnection();
+
+        QObject::connect ( pSocket, &QLocalSocket::disconnected,
+            pSocket, &QLocalSocket::deleteLater );
+
+        // the local socket returns the plain text without HTTP
+        Respond ( pSocket );
+        pSocket->disconnectFromServer();
+    }
+}
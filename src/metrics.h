@@ -0,0 +1,139 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Metrics of the server and the client in the Prometheus text format on a
+ * local TCP port or a Unix domain socket. The values are collected with
+ * relaxed atomics on the hot paths (socket thread, timer and audio callback)
+ * and only read when the endpoint is scraped.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QTcpServer>
+#include <QLocalServer>
+#include <atomic>
+#include <functional>
+#include "global.h"
+
+
+/* Definitions ****************************************************************/
+// upper bounds of the buckets of the duration histograms in us (the frame
+// durations of 64 and 128 samples are bucket bounds so that the deadline
+// can be read from the histogram)
+#define METRICS_NUM_DURATION_BUCKETS    10
+#define METRICS_DURATION_BUCKETS_US     { 100, 250, 500, 1000, 1333, 2000, 2667, 4000, 5333, 10000 }
+
+// prefix of the Unix domain socket endpoint address
+#define METRICS_UNIX_SOCKET_PREFIX      "unix:"
+
+
+/* Classes ********************************************************************/
+// monotonic counter which can be increased from any thread
+class CMetricsCounter
+{
+public:
+    CMetricsCounter() : iValue ( 0 ) {}
+
+    void    Add ( const int64_t iInc = 1 ) { iValue.fetch_add ( iInc, std::memory_order_relaxed ); }
+    int64_t Get() const { return iValue.load ( std::memory_order_relaxed ); }
+
+protected:
+    std::atomic<int64_t> iValue;
+};
+
+// histogram of durations with the fixed buckets METRICS_DURATION_BUCKETS_US
+class CMetricsDurationHistogram
+{
+public:
+    void Add ( const int64_t iDurationUs );
+
+    CMetricsCounter Buckets[METRICS_NUM_DURATION_BUCKETS + 1]; // last bucket: +Inf
+    CMetricsCounter SumUs;
+};
+
+// counters of one channel (jitter buffer and packets)
+class CChannelMetrics
+{
+public:
+    CMetricsCounter RxPackets;
+    CMetricsCounter RxBytes;
+    CMetricsCounter TxPackets;
+    CMetricsCounter TxBytes;
+    CMetricsCounter JitterBufGets;
+    CMetricsCounter JitterBufUnderruns; // gets without audio block (concealment)
+    CMetricsCounter JitterBufPutErrors; // packets which did not fit in the buffer
+    CMetricsCounter JitterBufRecovered; // missing blocks restored from the redundant copy
+};
+
+// composes the Prometheus text exposition format
+class CMetricsWriter
+{
+public:
+    void AddFamily ( const QString& strName,
+                     const QString& strType,
+                     const QString& strHelp );
+
+    void Add ( const QString& strName,
+               const QString& strLabels,
+               const double   dValue );
+
+    // the durations are written in seconds
+    void AddHistogram ( const QString&                   strName,
+                        const QString&                   strLabels,
+                        const CMetricsDurationHistogram& Histogram );
+
+    static QString Label ( const QString& strName, const QString& strValue );
+
+    const QString& GetText() const { return strText; }
+
+protected:
+    QString strText;
+};
+
+// endpoint which answers each connection (e.g. an HTTP GET of a Prometheus
+// scraper) with the current metrics of all sources, runs in the main thread
+class CMetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void ( CMetricsWriter& )> CSource;
+
+    // the address is a port number, [host]:[port] or unix:[path]
+    void Start ( const QString& strAddress ); // throws CGenErr
+    void AddSource ( const CSource& Source ) { vecSources.append ( Source ); }
+
+protected:
+    void Respond ( QIODevice* pDevice );
+
+    QTcpServer     TcpServer;
+    QLocalServer   LocalServer;
+    QList<CSource> vecSources;
+
+protected slots:
+    void OnNewTcpConnection();
+    void OnNewLocalConnection();
+};
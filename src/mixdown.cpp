@@ -0,0 +1,576 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent>
+#include <QFutureSynchronizer>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "mixdown.h"
+
+using namespace recorder;
+
+
+/* Implementation *************************************************************/
+CSessionMixdown::~CSessionMixdown()
+{
+    for ( int i = 0; i < vecpTracks.size(); i++ )
+    {
+        for ( int j = 0; j < vecpTracks[i]->vecItems.size(); j++ )
+        {
+            delete vecpTracks[i]->vecItems[j].pFile; // also unmaps the data
+        }
+
+        delete vecpTracks[i]->pStemWriter;
+        delete vecpTracks[i]->pStemFile;
+    }
+
+    qDeleteAll ( vecpTracks );
+}
+
+bool CSessionMixdown::AddFile ( const QString& strFileName )
+{
+    // the file names of the recorder:
+    // [name]-[host and port]-[start frame]-[number of channels][_affix]
+    const QFileInfo   FileInfo ( strFileName );
+    const QStringList vecstrParts = FileInfo.completeBaseName().split ( "-" );
+    bool              bStartOk    = false;
+    bool              bChannelsOk = false;
+
+    if ( vecstrParts.size() != 4 )
+    {
+        return false;
+    }
+
+    const qint64 iStartFrame = vecstrParts[2].toLongLong ( &bStartOk );
+    vecstrParts[3].split ( "_" )[0].toInt ( &bChannelsOk );
+
+    if ( !bStartOk || !bChannelsOk )
+    {
+        return false;
+    }
+
+    // find the format and the data chunk (the data size is not valid if the
+    // recording was not finalised, then the data goes to the end of the file)
+    QFile* pFile = new QFile ( strFileName );
+    uchar  vecbyHeader[12];
+
+    if ( !pFile->open ( QIODevice::ReadOnly ) ||
+         ( pFile->read ( reinterpret_cast<char*> ( vecbyHeader ), 12 ) != 12 ) ||
+         ( memcmp ( vecbyHeader, "RIFF", 4 ) != 0 ) ||
+         ( memcmp ( vecbyHeader + 8, "WAVE", 4 ) != 0 ) )
+    {
+        delete pFile;
+        return false;
+    }
+
+    CMixdownItem Item;
+    qint64       iDataPos  = 0;
+    qint64       iDataSize = 0;
+    uchar        vecbyChunk[16];
+
+    while ( pFile->read ( reinterpret_cast<char*> ( vecbyChunk ), 8 ) == 8 )
+    {
+        const qint64 iChunkSize = qFromLittleEndian<quint32> ( vecbyChunk + 4 );
+
+        if ( memcmp ( vecbyChunk, "fmt ", 4 ) == 0 )
+        {
+            if ( ( iChunkSize < 16 ) || ( pFile->read ( reinterpret_cast<char*> ( vecbyChunk ), 16 ) != 16 ) ||
+                 ( qFromLittleEndian<quint16> ( vecbyChunk + 0 ) != 1 /* PCM */ ) ||
+                 ( qFromLittleEndian<quint32> ( vecbyChunk + 4 ) != SYSTEM_SAMPLE_RATE_HZ ) ||
+                 ( qFromLittleEndian<quint16> ( vecbyChunk + 14 ) != 16 ) )
+            {
+                break;
+            }
+
+            Item.iNumAudioChannels = qFromLittleEndian<quint16> ( vecbyChunk + 2 );
+            pFile->seek ( pFile->pos() + iChunkSize - 16 );
+        }
+        else if ( memcmp ( vecbyChunk, "data", 4 ) == 0 )
+        {
+            iDataPos  = pFile->pos();
+            iDataSize = ( ( iChunkSize == 0 ) || ( iDataPos + iChunkSize > pFile->size() ) ) ? pFile->size() - iDataPos : iChunkSize;
+            break;
+        }
+        else
+        {
+            pFile->seek ( pFile->pos() + iChunkSize + ( iChunkSize & 1 ) );
+        }
+    }
+
+    if ( ( ( Item.iNumAudioChannels != 1 ) && ( Item.iNumAudioChannels != 2 ) ) ||
+         ( iDataSize < static_cast<qint64> ( sizeof ( int16_t ) ) * Item.iNumAudioChannels ) )
+    {
+        delete pFile;
+        return false;
+    }
+
+    // the pages of the mapped file are loaded by the OS when they are read and
+    // can be dropped again, the memory does not grow with the session length
+    Item.pFile        = pFile;
+    Item.psData       = reinterpret_cast<const int16_t*> ( pFile->map ( iDataPos, iDataSize ) );
+    Item.iStartSample = iStartFrame * iServerFrameSizeSamples;
+    Item.iNumSamples  = iDataSize / ( static_cast<qint64> ( sizeof ( int16_t ) ) * Item.iNumAudioChannels );
+
+    if ( Item.psData == nullptr )
+    {
+        delete pFile;
+        return false;
+    }
+
+    const QString strTrackName = vecstrParts[0] + "-" + vecstrParts[1];
+
+    if ( !mapTracks.contains ( strTrackName ) )
+    {
+        CMixdownTrack* pTrack = new CMixdownTrack();
+        pTrack->strName       = strTrackName;
+
+        vecpTracks.append ( pTrack );
+        mapTracks.insert ( strTrackName, pTrack );
+    }
+
+    mapTracks[strTrackName]->vecItems.append ( Item );
+    iSessionNumSamples = std::max ( iSessionNumSamples, Item.iStartSample + Item.iNumSamples );
+
+    return true;
+}
+
+bool CSessionMixdown::Open ( const QString& strSessionDirName )
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    // the mapped samples are used directly
+    qCritical() << "the mixdown is only supported on little endian hosts";
+    return false;
+#endif
+
+    const QDir SessionDir ( strSessionDirName );
+
+    foreach ( auto strEntry, SessionDir.entryList ( { "*.wav" }, QDir::Files, QDir::Name ) )
+    {
+        if ( !AddFile ( SessionDir.absoluteFilePath ( strEntry ) ) )
+        {
+            qInfo() << qUtf8Printable ( QString ( "- %1 is not a recorded track, skipped" ).arg ( strEntry ) );
+        }
+    }
+
+    return !vecpTracks.isEmpty();
+}
+
+void CSessionMixdown::SetGain ( const QString& strTrackPrefix, const float fGainDB )
+{
+    for ( int i = 0; i < vecpTracks.size(); i++ )
+    {
+        if ( vecpTracks[i]->strName.startsWith ( strTrackPrefix ) )
+        {
+            vecpTracks[i]->fGain = std::pow ( 10.0f, fGainDB / 20 );
+        }
+    }
+}
+
+void CSessionMixdown::SetPan ( const QString& strTrackPrefix, const float fPan )
+{
+    for ( int i = 0; i < vecpTracks.size(); i++ )
+    {
+        if ( vecpTracks[i]->strName.startsWith ( strTrackPrefix ) )
+        {
+            vecpTracks[i]->fPan = fPan;
+        }
+    }
+}
+
+void CSessionMixdown::AddItem ( const CMixdownItem& Item,
+                                const float         fGainL,
+                                const float         fGainR,
+                                const qint64        iBlockStart,
+                                const int           iBlockNumSamples,
+                                float*              pfOut )
+{
+    const qint64 iFrom = std::max ( iBlockStart, Item.iStartSample );
+    const qint64 iTo   = std::min ( iBlockStart + iBlockNumSamples, Item.iStartSample + Item.iNumSamples );
+
+    if ( iFrom >= iTo )
+    {
+        return;
+    }
+
+    const int      iNum  = static_cast<int> ( iTo - iFrom );
+    const int16_t* psIn  = Item.psData + ( iFrom - Item.iStartSample ) * Item.iNumAudioChannels;
+    float*         pfDst = pfOut + 2 * ( iFrom - iBlockStart );
+
+    // simple loops over contiguous buffers so that the compiler can vectorize
+    // them (same pan law as the server mix)
+    if ( Item.iNumAudioChannels == 1 )
+    {
+        for ( int i = 0; i < iNum; i++ )
+        {
+            pfDst[2 * i]     += psIn[i] * fGainL;
+            pfDst[2 * i + 1] += psIn[i] * fGainR;
+        }
+    }
+    else
+    {
+        for ( int i = 0; i < iNum; i++ )
+        {
+            pfDst[2 * i]     += psIn[2 * i]     * fGainL;
+            pfDst[2 * i + 1] += psIn[2 * i + 1] * fGainR;
+        }
+    }
+}
+
+void CSessionMixdown::WriteSamples ( CWaveWriter&      Writer,
+                                     const float*      pfData,
+                                     CVector<int16_t>& vecsOut,
+                                     const int         iNumSamples )
+{
+    for ( int i = 0; i < iNumSamples; i++ )
+    {
+        vecsOut[i] = Float2Short ( pfData[i] );
+    }
+
+    for ( int i = 0; i < iNumSamples; i += MIXDOWN_WRITE_CHUNK_SAMPLES )
+    {
+        Writer.AppendFrame ( &vecsOut[i], std::min ( MIXDOWN_WRITE_CHUNK_SAMPLES, iNumSamples - i ) );
+    }
+}
+
+void CSessionMixdown::RenderTracks ( const int    iFirstTrack,
+                                     const qint64 iBlockStart,
+                                     const int    iBlockNumSamples,
+                                     float*       pfMix,
+                                     float*       pfStem )
+{
+    std::fill ( pfMix, pfMix + 2 * iBlockNumSamples, 0.0f );
+
+    for ( int iTrack = iFirstTrack; iTrack < vecpTracks.size(); iTrack += iNumThreads )
+    {
+        const CMixdownTrack& Track  = *vecpTracks[iTrack];
+        const float          fGainL = MathUtils::GetLeftPan ( Track.fPan, false ) * Track.fGain;
+        const float          fGainR = MathUtils::GetRightPan ( Track.fPan, false ) * Track.fGain;
+
+        if ( Track.pStemWriter == nullptr )
+        {
+            for ( int i = 0; i < Track.vecItems.size(); i++ )
+            {
+                AddItem ( Track.vecItems[i], fGainL, fGainR, iBlockStart, iBlockNumSamples, pfMix );
+            }
+
+            continue;
+        }
+
+        // the stem is rendered separately, written and added to the mix
+        std::fill ( pfStem, pfStem + 2 * iBlockNumSamples, 0.0f );
+
+        for ( int i = 0; i < Track.vecItems.size(); i++ )
+        {
+            AddItem ( Track.vecItems[i], fGainL, fGainR, iBlockStart, iBlockNumSamples, pfStem );
+        }
+
+        WriteSamples ( *Track.pStemWriter, pfStem, vecvecsStem[iFirstTrack], 2 * iBlockNumSamples );
+
+        for ( int i = 0; i < 2 * iBlockNumSamples; i++ )
+        {
+            pfMix[i] += pfStem[i];
+        }
+    }
+}
+
+bool CSessionMixdown::Render ( const QString& strMixFileName,
+                               const QString& strStemDirName )
+{
+    QFile MixFile ( strMixFileName );
+
+    if ( !MixFile.open ( QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered ) )
+    {
+        qCritical() << qUtf8Printable ( QString ( "cannot write '%1'" ).arg ( strMixFileName ) );
+        return false;
+    }
+
+    CWaveWriter MixWriter ( &MixFile, 2 );
+
+    if ( !strStemDirName.isEmpty() )
+    {
+        const QDir StemDir ( strStemDirName );
+
+        if ( !QDir().mkpath ( StemDir.absolutePath() ) )
+        {
+            qCritical() << qUtf8Printable ( QString ( "cannot create '%1'" ).arg ( strStemDirName ) );
+            return false;
+        }
+
+        for ( int i = 0; i < vecpTracks.size(); i++ )
+        {
+            vecpTracks[i]->pStemFile = new QFile ( StemDir.absoluteFilePath ( vecpTracks[i]->strName + ".wav" ) );
+
+            if ( !vecpTracks[i]->pStemFile->open ( QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered ) )
+            {
+                qCritical() << qUtf8Printable ( QString ( "cannot write '%1'" ).arg ( vecpTracks[i]->pStemFile->fileName() ) );
+                return false;
+            }
+
+            vecpTracks[i]->pStemWriter = new CWaveWriter ( vecpTracks[i]->pStemFile, 2 );
+        }
+    }
+
+    // the buffers are allocated once, their size does not depend on the
+    // session length
+    iNumThreads = std::max ( 1, std::min ( QThread::idealThreadCount(), vecpTracks.size() ) );
+
+    vecvecvecfMix.Init ( MIXDOWN_NUM_BLOCK_BUFFERS );
+
+    for ( int iBuf = 0; iBuf < MIXDOWN_NUM_BLOCK_BUFFERS; iBuf++ )
+    {
+        vecvecvecfMix[iBuf].Init ( iNumThreads );
+
+        for ( int i = 0; i < iNumThreads; i++ )
+        {
+            vecvecvecfMix[iBuf][i].Init ( 2 * MIXDOWN_BLOCK_SIZE_SAMPLES );
+        }
+    }
+
+    vecvecfStem.Init ( iNumThreads );
+    vecvecsStem.Init ( iNumThreads );
+
+    for ( int i = 0; i < iNumThreads; i++ )
+    {
+        vecvecfStem[i].Init ( 2 * MIXDOWN_BLOCK_SIZE_SAMPLES );
+        vecvecsStem[i].Init ( 2 * MIXDOWN_BLOCK_SIZE_SAMPLES );
+    }
+
+    CVector<int16_t>          vecsMix ( 2 * MIXDOWN_BLOCK_SIZE_SAMPLES );
+    QFutureSynchronizer<void> FutureSynchronizer[MIXDOWN_NUM_BLOCK_BUFFERS];
+    const qint64              iNumBlocks = ( iSessionNumSamples + MIXDOWN_BLOCK_SIZE_SAMPLES - 1 ) / MIXDOWN_BLOCK_SIZE_SAMPLES;
+
+    auto BlockNumSamples = [this] ( const qint64 iBlock )
+    {
+        return static_cast<int> ( std::min ( static_cast<qint64> ( MIXDOWN_BLOCK_SIZE_SAMPLES ),
+                                             iSessionNumSamples - iBlock * MIXDOWN_BLOCK_SIZE_SAMPLES ) );
+    };
+
+    auto StartBlock = [&] ( const qint64 iBlock )
+    {
+        const int iBuf = static_cast<int> ( iBlock % MIXDOWN_NUM_BLOCK_BUFFERS );
+
+        for ( int i = 0; i < iNumThreads; i++ )
+        {
+            FutureSynchronizer[iBuf].addFuture ( QtConcurrent::run ( this,
+                                                                     &CSessionMixdown::RenderTracks,
+                                                                     i,
+                                                                     iBlock * MIXDOWN_BLOCK_SIZE_SAMPLES,
+                                                                     BlockNumSamples ( iBlock ),
+                                                                     &vecvecvecfMix[iBuf][i][0],
+                                                                     &vecvecfStem[i][0] ) );
+        }
+    };
+
+    if ( iNumBlocks > 0 )
+    {
+        StartBlock ( 0 );
+    }
+
+    for ( qint64 iBlock = 0; iBlock < iNumBlocks; iBlock++ )
+    {
+        const int iBuf        = static_cast<int> ( iBlock % MIXDOWN_NUM_BLOCK_BUFFERS );
+        const int iNumSamples = 2 * BlockNumSamples ( iBlock );
+
+        FutureSynchronizer[iBuf].waitForFinished();
+        FutureSynchronizer[iBuf].clearFutures();
+
+        // the next block is rendered while this one is summed and written (the
+        // stems of a track are only written by one block at a time)
+        if ( iBlock + 1 < iNumBlocks )
+        {
+            StartBlock ( iBlock + 1 );
+        }
+
+        float* pfMix = &vecvecvecfMix[iBuf][0][0];
+
+        for ( int i = 1; i < iNumThreads; i++ )
+        {
+            const float* pfPartialMix = &vecvecvecfMix[iBuf][i][0];
+
+            for ( int j = 0; j < iNumSamples; j++ )
+            {
+                pfMix[j] += pfPartialMix[j];
+            }
+        }
+
+        WriteSamples ( MixWriter, pfMix, vecsMix, iNumSamples );
+    }
+
+    MixWriter.finalise();
+
+    for ( int i = 0; i < vecpTracks.size(); i++ )
+    {
+        if ( vecpTracks[i]->pStemWriter != nullptr )
+        {
+            vecpTracks[i]->pStemWriter->finalise();
+        }
+    }
+
+    return true;
+}
+
+int MixdownMain ( int argc, char** argv )
+{
+    QString     strArgument;
+    QString     strSessionDirName;
+    QString     strMixFileName;
+    bool        bWriteStems             = false;
+    int         iServerFrameSizeSamples = DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+    QStringList vecstrGains;
+    QStringList vecstrPans;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( GetFlagArgument ( argv, i, "-h", "--help" ) )
+        {
+            qInfo() << qUtf8Printable ( QString (
+                "Usage: %1 [option] [session directory]\n"
+                "\nRenders the WAV tracks of a recorded session to a stereo mix.\n"
+                "\nOptions:\n"
+                "  -o, --output          mix file (default: mixdown.wav in the session\n"
+                "                        directory)\n"
+                "      --stems           also write one stem per track (stems directory\n"
+                "                        next to the mix file)\n"
+                "  -g, --gain            gain of the tracks in the format [track]:[dB]\n"
+                "                        (can be given multiple times, [track] is the\n"
+                "                        beginning of the track name)\n"
+                "  -p, --pan             pan of the tracks in the format [track]:[pan]\n"
+                "                        with 0 left, 0.5 center and 1 right\n"
+                "  -F, --fastupdate      the session was recorded with 64 samples frame\n"
+                "                        size\n"
+                "  -h, --help            display this help text and exit\n" )
+                .arg ( argv[0] ) );
+            return 0;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-o", "--output", strArgument ) )
+        {
+            strMixFileName = strArgument;
+            continue;
+        }
+
+        if ( GetFlagArgument ( argv, i, "--stems", "--stems" ) )
+        {
+            bWriteStems = true;
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-g", "--gain", strArgument ) )
+        {
+            vecstrGains.append ( strArgument );
+            continue;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-p", "--pan", strArgument ) )
+        {
+            vecstrPans.append ( strArgument );
+            continue;
+        }
+
+        if ( GetFlagArgument ( argv, i, "-F", "--fastupdate" ) )
+        {
+            iServerFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+            continue;
+        }
+
+        if ( argv[i][0] != '-' )
+        {
+            strSessionDirName = argv[i];
+            continue;
+        }
+
+        qCritical() << qUtf8Printable ( QString ( "%1: Unknown option '%2' -- use '--help' for help" )
+            .arg ( argv[0] ).arg ( argv[i] ) );
+    }
+
+    if ( strSessionDirName.isEmpty() )
+    {
+        qCritical() << qUtf8Printable ( QString ( "%1: no session directory given -- use '--help' for help" ).arg ( argv[0] ) );
+        return 1;
+    }
+
+    if ( strMixFileName.isEmpty() )
+    {
+        strMixFileName = QDir ( strSessionDirName ).absoluteFilePath ( "mixdown.wav" );
+    }
+
+    CSessionMixdown Mixdown ( iServerFrameSizeSamples );
+
+    if ( !Mixdown.Open ( strSessionDirName ) )
+    {
+        qCritical() << qUtf8Printable ( QString ( "%1: no recorded tracks in '%2'" ).arg ( argv[0] ).arg ( strSessionDirName ) );
+        return 1;
+    }
+
+    // [track]:[value], the track name does not contain a colon
+    for ( int i = 0; i < vecstrGains.size(); i++ )
+    {
+        const int iSep = vecstrGains[i].lastIndexOf ( ':' );
+        Mixdown.SetGain ( vecstrGains[i].left ( iSep ), vecstrGains[i].mid ( iSep + 1 ).toFloat() );
+    }
+
+    for ( int i = 0; i < vecstrPans.size(); i++ )
+    {
+        const int iSep = vecstrPans[i].lastIndexOf ( ':' );
+        Mixdown.SetPan ( vecstrPans[i].left ( iSep ), qBound ( 0.0f, vecstrPans[i].mid ( iSep + 1 ).toFloat(), 1.0f ) );
+    }
+
+    for ( int i = 0; i < Mixdown.GetTracks().size(); i++ )
+    {
+        const CMixdownTrack* pTrack = Mixdown.GetTracks()[i];
+
+        qInfo() << qUtf8Printable ( QString ( "- track %1: %2 files, gain %3, pan %4" )
+            .arg ( pTrack->strName )
+            .arg ( pTrack->vecItems.size() )
+            .arg ( pTrack->fGain, 0, 'f', 2 )
+            .arg ( pTrack->fPan, 0, 'f', 2 ) );
+    }
+
+    const QString strStemDirName = bWriteStems ? QFileInfo ( strMixFileName ).absoluteDir().absoluteFilePath ( "stems" ) : QString();
+    QElapsedTimer ElapsedTime;
+
+    ElapsedTime.start();
+
+    if ( !Mixdown.Render ( strMixFileName, strStemDirName ) )
+    {
+        return 1;
+    }
+
+    const double dSessionS = static_cast<double> ( Mixdown.GetSessionNumSamples() ) / SYSTEM_SAMPLE_RATE_HZ;
+    const double dElapsedS = std::max ( static_cast<double> ( ElapsedTime.elapsed() ) / 1000, 0.001 );
+
+    qInfo() << qUtf8Printable ( QString ( "- %1 s rendered in %2 s (%3x real time) to %4" )
+        .arg ( dSessionS, 0, 'f', 1 )
+        .arg ( dElapsedS, 0, 'f', 2 )
+        .arg ( dSessionS / dElapsedS, 0, 'f', 1 )
+        .arg ( strMixFileName ) );
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Offline mixdown of a recorded jam session: the WAV tracks of the session
+ * directory are memory mapped, aligned by their start frame and mixed with
+ * per track gain and pan to a stereo WAV file (optionally with one stem per
+ * track). The session is rendered in blocks, the tracks of a block are
+ * distributed over the processor cores and the next block is rendered while
+ * the previous one is written, so that the memory stays bounded for sessions
+ * of any length.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QFile>
+#include "global.h"
+#include "util.h"
+#include "recorder/cwavewriter.h"
+
+
+/* Definitions ****************************************************************/
+// number of samples per channel which are rendered in one block (about 1.4 s)
+#define MIXDOWN_BLOCK_SIZE_SAMPLES      65536
+
+// number of blocks which are in flight (one rendered, one written)
+#define MIXDOWN_NUM_BLOCK_BUFFERS       2
+
+// number of samples which are appended to a WAV writer at once (must be
+// smaller than its buffer)
+#define MIXDOWN_WRITE_CHUNK_SAMPLES     8192
+
+
+/* Classes ********************************************************************/
+// one recorded WAV file of a track
+class CMixdownItem
+{
+public:
+    CMixdownItem() : pFile ( nullptr ), psData ( nullptr ), iNumAudioChannels ( 0 ),
+        iStartSample ( 0 ), iNumSamples ( 0 ) {}
+
+    QFile*         pFile;
+    const int16_t* psData;       // memory mapped data chunk
+    int            iNumAudioChannels;
+    qint64         iStartSample; // in the session
+    qint64         iNumSamples;  // per channel
+};
+
+// all files of one musician (name and address)
+class CMixdownTrack
+{
+public:
+    CMixdownTrack() : fGain ( 1.0f ), fPan ( 0.5f ), pStemFile ( nullptr ), pStemWriter ( nullptr ) {}
+
+    QString                strName;
+    QList<CMixdownItem>    vecItems;
+    float                  fGain;
+    float                  fPan; // 0: left, 0.5: center, 1: right
+    QFile*                 pStemFile;
+    recorder::CWaveWriter* pStemWriter;
+};
+
+class CSessionMixdown
+{
+public:
+    CSessionMixdown ( const int iNServerFrameSizeSamples ) :
+        iServerFrameSizeSamples ( iNServerFrameSizeSamples ), iSessionNumSamples ( 0 ), iNumThreads ( 1 ) {}
+
+    virtual ~CSessionMixdown();
+
+    // maps the WAV files of the session directory, returns false if there is
+    // no track
+    bool Open ( const QString& strSessionDirName );
+
+    // gain in dB and pan of the tracks whose names start with the given text
+    void SetGain ( const QString& strTrackPrefix, const float fGainDB );
+    void SetPan ( const QString& strTrackPrefix, const float fPan );
+
+    // renders the stereo mix and optionally one stem per track to the directory
+    bool Render ( const QString& strMixFileName,
+                  const QString& strStemDirName );
+
+    const QList<CMixdownTrack*>& GetTracks() const { return vecpTracks; }
+    qint64                       GetSessionNumSamples() const { return iSessionNumSamples; }
+
+protected:
+    bool AddFile ( const QString& strFileName );
+
+    static void WriteSamples ( recorder::CWaveWriter& Writer,
+                               const float*           pfData,
+                               CVector<int16_t>&      vecsOut,
+                               const int              iNumSamples );
+
+    // renders the tracks iFirstTrack, iFirstTrack + iNumThreads, ... of the
+    // block into the stereo buffer (worker thread)
+    void RenderTracks ( const int    iFirstTrack,
+                        const qint64 iBlockStart,
+                        const int    iBlockNumSamples,
+                        float*       pfMix,
+                        float*       pfStem );
+
+    static void AddItem ( const CMixdownItem& Item,
+                          const float         fGainL,
+                          const float         fGainR,
+                          const qint64        iBlockStart,
+                          const int           iBlockNumSamples,
+                          float*              pfOut );
+
+    int                                  iServerFrameSizeSamples;
+    QList<CMixdownTrack*>                vecpTracks;
+    QMap<QString, CMixdownTrack*>        mapTracks;
+    qint64                               iSessionNumSamples;
+    int                                  iNumThreads;
+
+    // stereo mix per block buffer and thread, stem and its conversion buffer
+    // per thread (interleaved)
+    CVector<CVector<CVector<float> > >   vecvecvecfMix;
+    CVector<CVector<float> >             vecvecfStem;
+    CVector<CVector<int16_t> >           vecvecsStem;
+};
+
+
+/* Prototypes *****************************************************************/
+int MixdownMain ( int argc, char** argv );
@@ -0,0 +1,413 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QFile>
+#include <QTextStream>
+#include <cmath>
+#include <algorithm>
+#include "netemulator.h"
+#include "socket.h"
+
+
+/* Implementation *************************************************************/
+void CNetworkImpairment::Parse ( const QString& strRule )
+{
+    const QStringList slParams = strRule.split ( ",", QString::SkipEmptyParts );
+
+    for ( int i = 0; i < slParams.size(); i++ )
+    {
+        const QStringList slKeyValue = slParams[i].trimmed().split ( "=" );
+        bool              bOk        = true;
+
+        if ( slKeyValue.size() != 2 )
+        {
+            throw CGenErr ( QString ( "Invalid network emulator rule: %1" ).arg ( strRule ) );
+        }
+
+        const QString strKey   = slKeyValue[0].trimmed();
+        const QString strValue = slKeyValue[1].trimmed();
+
+        if ( strKey == "dir" )
+        {
+            bSend    = ( strValue == "send" ) || ( strValue == "both" );
+            bReceive = ( strValue == "recv" ) || ( strValue == "both" );
+            bOk      = bSend || bReceive;
+        }
+        else if ( strKey == "addr" )
+        {
+            strAddr = strValue;
+        }
+        else if ( strKey == "dist" )
+        {
+            if ( strValue == "uniform" )     { eDelayDist = DD_UNIFORM; }
+            else if ( strValue == "normal" ) { eDelayDist = DD_NORMAL; }
+            else if ( strValue == "pareto" ) { eDelayDist = DD_PARETO; }
+            else
+            {
+                bOk = false;
+            }
+        }
+        else if ( strKey == "delay" )   { dDelayMs          = strValue.toDouble ( &bOk ); }
+        else if ( strKey == "jitter" )  { dJitterMs         = strValue.toDouble ( &bOk ); }
+        else if ( strKey == "loss" )    { dLossPercent      = strValue.toDouble ( &bOk ); }
+        else if ( strKey == "burst" )   { dMeanBurstLength  = strValue.toDouble ( &bOk ); }
+        else if ( strKey == "reorder" ) { dReorderPercent   = strValue.toDouble ( &bOk ); }
+        else if ( strKey == "dup" )     { dDuplicatePercent = strValue.toDouble ( &bOk ); }
+        else if ( strKey == "rate" )    { dRateKbps         = strValue.toDouble ( &bOk ); }
+        else
+        {
+            bOk = false;
+        }
+
+        if ( !bOk )
+        {
+            throw CGenErr ( QString ( "Invalid network emulator rule parameter: %1" ).arg ( slParams[i] ) );
+        }
+    }
+
+    if ( ( dDelayMs < 0 ) || ( dJitterMs < 0 ) || ( dLossPercent < 0 ) || ( dLossPercent >= 100 ) ||
+         ( dMeanBurstLength < 1 ) || ( dReorderPercent < 0 ) || ( dDuplicatePercent < 0 ) || ( dRateKbps < 0 ) )
+    {
+        throw CGenErr ( QString ( "Network emulator rule parameter out of range: %1" ).arg ( strRule ) );
+    }
+}
+
+bool CNetworkImpairment::Matches ( const CHostAddress& HostAddr ) const
+{
+    if ( strAddr.isEmpty() )
+    {
+        return true;
+    }
+
+    // the address can be given with or without port
+    return strAddr.contains ( ':' ) ? ( strAddr == HostAddr.toString() ) :
+                                      ( strAddr == HostAddr.InetAddr.toString() );
+}
+
+CNetworkEmulator::CNetworkEmulator() :
+    pSocket        ( nullptr ),
+    iNumQueued     ( 0 ),
+    iNumLost       ( 0 ),
+    iNumDuplicated ( 0 ),
+    iNumReordered  ( 0 ),
+    bRun           ( false )
+{
+    setObjectName ( "CNetworkEmulator" );
+}
+
+void CNetworkEmulator::Init ( const QStringList& slRules,
+                              const QString&     strConfigFileName,
+                              const int          iSeed )
+{
+    for ( int i = 0; i < slRules.size(); i++ )
+    {
+        AddRule ( slRules[i] );
+    }
+
+    if ( !strConfigFileName.isEmpty() )
+    {
+        LoadConfigFile ( strConfigFileName );
+    }
+
+    // the directions use different streams of the same seed
+    RandGens[ND_SEND].seed    ( static_cast<unsigned int> ( iSeed ) );
+    RandGens[ND_RECEIVE].seed ( static_cast<unsigned int> ( iSeed ) ^ 0x9E3779B9u );
+}
+
+void CNetworkEmulator::AddRule ( const QString& strRule )
+{
+    CNetworkImpairment Rule;
+    Rule.Parse ( strRule );
+
+    QMutexLocker locker ( &Mutex );
+    vecRules.append ( Rule );
+}
+
+void CNetworkEmulator::LoadConfigFile ( const QString& strFileName )
+{
+    QFile File ( strFileName );
+
+    if ( !File.open ( QIODevice::ReadOnly | QIODevice::Text ) )
+    {
+        throw CGenErr ( QString ( "The network emulator config file %1 cannot be opened." ).arg ( strFileName ) );
+    }
+
+    QTextStream InStream ( &File );
+
+    while ( !InStream.atEnd() )
+    {
+        const QString strLine = InStream.readLine().trimmed();
+
+        if ( !strLine.isEmpty() && !strLine.startsWith ( "#" ) )
+        {
+            AddRule ( strLine );
+        }
+    }
+}
+
+void CNetworkEmulator::Start ( CSocket* pNSocket )
+{
+    if ( !IsEnabled() || isRunning() )
+    {
+        return;
+    }
+
+    pSocket = pNSocket;
+    bRun    = true;
+    ElapsedTime.start();
+
+    qInfo() << qUtf8Printable ( QString ( "- network emulator started with %1 rule(s)" ).arg ( vecRules.size() ) );
+
+    start ( QThread::TimeCriticalPriority );
+}
+
+void CNetworkEmulator::Stop()
+{
+    if ( !isRunning() )
+    {
+        return;
+    }
+
+    {
+        QMutexLocker locker ( &Mutex );
+        bRun = false;
+        WaitCondition.wakeAll();
+    }
+
+    wait();
+
+    // the packets still in the queue are dropped
+    QueuedPackets = std::priority_queue<CQueuedPacket>();
+
+    qInfo() << qUtf8Printable ( QString ( "- network emulator stopped: %1 packets queued, %2 lost, %3 duplicated, %4 reordered" )
+        .arg ( iNumQueued ).arg ( iNumLost ).arg ( iNumDuplicated ).arg ( iNumReordered ) );
+}
+
+bool CNetworkEmulator::Add ( const EDirection        eDirection,
+                             const CVector<uint8_t>& vecbyData,
+                             const int               iNumBytes,
+                             const CHostAddress&     HostAddr )
+{
+    QMutexLocker locker ( &Mutex );
+
+    if ( !bRun )
+    {
+        return false;
+    }
+
+    // the first matching rule is applied
+    int iRule = 0;
+
+    while ( ( iRule < vecRules.size() ) &&
+            !( ( ( eDirection == ND_SEND ) ? vecRules[iRule].bSend : vecRules[iRule].bReceive ) &&
+               vecRules[iRule].Matches ( HostAddr ) ) )
+    {
+        iRule++;
+    }
+
+    if ( iRule == vecRules.size() )
+    {
+        return false;
+    }
+
+    const CNetworkImpairment&              Rule        = vecRules[iRule];
+    std::mt19937&                          RandGen     = RandGens[eDirection];
+    std::uniform_real_distribution<double> UniformDist ( 0, 1 );
+    const qint64                           iNowUs      = ElapsedTime.nsecsElapsed() / 1000;
+    CLinkState&                            State       = mapLinkStates[( eDirection == ND_SEND ? ">" : "<" ) + HostAddr.toString()];
+
+    // Gilbert-Elliott burst loss: the mean burst length defines the probability
+    // to leave the loss state, the probability to enter it follows from the
+    // mean loss rate p_enter / ( p_enter + p_leave )
+    if ( Rule.dLossPercent > 0 )
+    {
+        const double dLossRate  = Rule.dLossPercent / 100;
+        const double dProbLeave = 1 / Rule.dMeanBurstLength;
+        const double dProbEnter = dLossRate * dProbLeave / ( 1 - dLossRate );
+
+        State.bInLossState = State.bInLossState ? ( UniformDist ( RandGen ) >= dProbLeave ) :
+                                                  ( UniformDist ( RandGen ) < dProbEnter );
+
+        if ( State.bInLossState )
+        {
+            iNumLost++;
+            return true;
+        }
+    }
+
+    // a full queue drops the packet like a router
+    if ( QueuedPackets.size() >= NET_EMULATOR_MAX_QUEUE_SIZE )
+    {
+        iNumLost++;
+        return true;
+    }
+
+    // bandwidth cap: the packets are serialized on the link
+    qint64 iSentUs = iNowUs;
+
+    if ( Rule.dRateKbps > 0 )
+    {
+        State.iLinkFreeUs = std::max ( State.iLinkFreeUs, iNowUs ) +
+                            static_cast<qint64> ( iNumBytes * 8 * 1000 / Rule.dRateKbps );
+        iSentUs           = State.iLinkFreeUs;
+    }
+
+    qint64 iDueUs;
+
+    if ( ( Rule.dReorderPercent > 0 ) && ( UniformDist ( RandGen ) < Rule.dReorderPercent / 100 ) )
+    {
+        // reordered packets are not delayed so they overtake the queued ones
+        // (like in netem)
+        iDueUs = iSentUs;
+        iNumReordered++;
+    }
+    else
+    {
+        // the jitter does not change the packet order, it rather causes bursts
+        iDueUs           = std::max ( iSentUs + static_cast<qint64> ( GetDelayUs ( Rule, RandGen ) ), State.iLastDueUs );
+        State.iLastDueUs = iDueUs;
+    }
+
+    Schedule ( eDirection, HostAddr, vecbyData, iNumBytes, iDueUs );
+
+    if ( ( Rule.dDuplicatePercent > 0 ) && ( UniformDist ( RandGen ) < Rule.dDuplicatePercent / 100 ) )
+    {
+        Schedule ( eDirection, HostAddr, vecbyData, iNumBytes, iDueUs );
+        iNumDuplicated++;
+    }
+
+    WaitCondition.wakeAll();
+
+    return true;
+}
+
+double CNetworkEmulator::GetDelayUs ( const CNetworkImpairment& Rule,
+                                      std::mt19937&             RandGen )
+{
+    const double dDelayUs  = Rule.dDelayMs * 1000;
+    const double dJitterUs = Rule.dJitterMs * 1000;
+
+    if ( dJitterUs <= 0 )
+    {
+        return dDelayUs;
+    }
+
+    double dRandomUs = 0;
+
+    switch ( Rule.eDelayDist )
+    {
+    case CNetworkImpairment::DD_UNIFORM:
+        dRandomUs = dJitterUs * ( 2 * std::uniform_real_distribution<double> ( 0, 1 ) ( RandGen ) - 1 );
+        break;
+
+    case CNetworkImpairment::DD_NORMAL:
+        dRandomUs = std::normal_distribution<double> ( 0, dJitterUs ) ( RandGen );
+        break;
+
+    case CNetworkImpairment::DD_PARETO:
+        // the Pareto distribution is shifted to start at zero and scaled so
+        // that the mean additional delay is the jitter
+        dRandomUs = dJitterUs * ( NET_EMULATOR_PARETO_SHAPE - 1 ) *
+            ( std::pow ( 1 - std::uniform_real_distribution<double> ( 0, 1 ) ( RandGen ), -1 / NET_EMULATOR_PARETO_SHAPE ) - 1 );
+        break;
+    }
+
+    return std::max ( dDelayUs + dRandomUs, 0.0 );
+}
+
+void CNetworkEmulator::Schedule ( const EDirection        eDirection,
+                                  const CHostAddress&     HostAddr,
+                                  const CVector<uint8_t>& vecbyData,
+                                  const int               iNumBytes,
+                                  const qint64            iDueUs )
+{
+    CQueuedPacket Packet;
+
+    Packet.iDueUs     = iDueUs;
+    Packet.iOrder     = iNumQueued++;
+    Packet.eDirection = eDirection;
+    Packet.HostAddr   = HostAddr;
+    Packet.vecbyData.assign ( vecbyData.begin(), vecbyData.begin() + iNumBytes );
+
+    QueuedPackets.push ( Packet );
+}
+
+void CNetworkEmulator::run()
+{
+    CVector<CQueuedPacket> vecDuePackets;
+
+    while ( bRun )
+    {
+        vecDuePackets.clear();
+
+        {
+            QMutexLocker locker ( &Mutex );
+
+            if ( QueuedPackets.empty() )
+            {
+                WaitCondition.wait ( &Mutex, NET_EMULATOR_MAX_WAIT_MS );
+                continue;
+            }
+
+            const qint64 iWaitUs = QueuedPackets.top().iDueUs - ElapsedTime.nsecsElapsed() / 1000;
+
+            if ( iWaitUs >= 1000 )
+            {
+                // a new packet may be due earlier, so wait on the condition
+                WaitCondition.wait ( &Mutex, static_cast<unsigned long> ( std::min ( iWaitUs / 1000, static_cast<qint64> ( NET_EMULATOR_MAX_WAIT_MS ) ) ) );
+                continue;
+            }
+
+            if ( iWaitUs > 0 )
+            {
+                locker.unlock();
+                usleep ( static_cast<unsigned long> ( iWaitUs ) );
+                continue;
+            }
+
+            while ( !QueuedPackets.empty() &&
+                    ( QueuedPackets.top().iDueUs <= ElapsedTime.nsecsElapsed() / 1000 ) )
+            {
+                vecDuePackets.push_back ( QueuedPackets.top() );
+                QueuedPackets.pop();
+            }
+        }
+
+        // the packets are handled outside the lock (the socket send function
+        // may call Add of this emulator)
+        for ( size_t i = 0; i < vecDuePackets.size(); i++ )
+        {
+            const CQueuedPacket& Packet = vecDuePackets[i];
+
+            if ( Packet.eDirection == ND_SEND )
+            {
+                pSocket->SendPacketDirect ( Packet.vecbyData, Packet.HostAddr );
+            }
+            else
+            {
+                pSocket->ProcessPacket ( Packet.vecbyData, Packet.vecbyData.Size(), Packet.HostAddr );
+            }
+        }
+    }
+}
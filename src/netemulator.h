@@ -0,0 +1,181 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Network impairment emulator in the socket (like netem but without root
+ * access): the sent and received packets can be delayed with a delay
+ * distribution, lost in bursts, reordered, duplicated and limited in
+ * bandwidth per address. Each direction has its own seeded random generator,
+ * so that the impairment sequence of a direction does not depend on the
+ * interleaving with the other direction (packets of one direction which are
+ * sent from several threads, e.g., audio and protocol, may still interleave
+ * differently from run to run).
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QList>
+#include <QStringList>
+#include <random>
+#include <queue>
+#include "global.h"
+#include "util.h"
+
+class CSocket; // forward declaration of CSocket
+
+
+/* Definitions ****************************************************************/
+// maximum number of queued packets (further packets are dropped like in a
+// full router queue)
+#define NET_EMULATOR_MAX_QUEUE_SIZE     10000
+
+// maximum time the emulator thread waits for new packets
+#define NET_EMULATOR_MAX_WAIT_MS        10
+
+// shape of the Pareto delay distribution (heavy tail)
+#define NET_EMULATOR_PARETO_SHAPE       3.0
+
+
+/* Classes ********************************************************************/
+// one impairment rule, format: [key]=[value],[key]=[value],... with the keys
+// dir (send, recv or both), addr ([IP] or [IP]:[port], default all), delay
+// (ms), jitter (ms), dist (uniform, normal or pareto), loss (%), burst (mean
+// loss burst length in packets), reorder (%), dup (%) and rate (kbit/s)
+class CNetworkImpairment
+{
+public:
+    enum EDelayDist
+    {
+        DD_UNIFORM,
+        DD_NORMAL,
+        DD_PARETO
+    };
+
+    CNetworkImpairment() : bSend ( true ), bReceive ( true ), dDelayMs ( 0 ), dJitterMs ( 0 ),
+        eDelayDist ( DD_UNIFORM ), dLossPercent ( 0 ), dMeanBurstLength ( 1 ), dReorderPercent ( 0 ),
+        dDuplicatePercent ( 0 ), dRateKbps ( 0 ) {}
+
+    void Parse ( const QString& strRule ); // throws CGenErr on invalid rules
+
+    bool Matches ( const CHostAddress& HostAddr ) const;
+
+    QString    strAddr; // empty for all addresses
+    bool       bSend;
+    bool       bReceive;
+    double     dDelayMs;
+    double     dJitterMs;
+    EDelayDist eDelayDist;
+    double     dLossPercent;
+    double     dMeanBurstLength;
+    double     dReorderPercent;
+    double     dDuplicatePercent;
+    double     dRateKbps; // 0 for no bandwidth cap
+};
+
+class CNetworkEmulator : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum EDirection
+    {
+        ND_SEND,
+        ND_RECEIVE
+    };
+
+    CNetworkEmulator();
+    virtual ~CNetworkEmulator() { Stop(); }
+
+    // the rules are given on the command line or in a config file (one rule
+    // per line, lines starting with # are ignored), the first matching rule
+    // of a packet is applied
+    void Init ( const QStringList& slRules, const QString& strConfigFileName, const int iSeed );
+    void AddRule ( const QString& strRule );
+    void LoadConfigFile ( const QString& strFileName );
+    bool IsEnabled() const { return !vecRules.isEmpty(); }
+
+    void Start ( CSocket* pNSocket );
+    void Stop();
+
+    // returns false if no rule matches (the caller handles the packet directly)
+    bool Add ( const EDirection        eDirection,
+               const CVector<uint8_t>& vecbyData,
+               const int               iNumBytes,
+               const CHostAddress&     HostAddr );
+
+protected:
+    // state of the impairment per direction and address
+    class CLinkState
+    {
+    public:
+        CLinkState() : bInLossState ( false ), iLinkFreeUs ( 0 ), iLastDueUs ( 0 ) {}
+
+        bool   bInLossState; // Gilbert-Elliott state
+        qint64 iLinkFreeUs;  // end of the transmission of the last packet (bandwidth cap)
+        qint64 iLastDueUs;   // keeps the packet order if no reordering is configured
+    };
+
+    class CQueuedPacket
+    {
+    public:
+        bool operator< ( const CQueuedPacket& Other ) const
+        {
+            // the priority queue returns the largest element first
+            return ( iDueUs != Other.iDueUs ) ? ( iDueUs > Other.iDueUs ) : ( iOrder > Other.iOrder );
+        }
+
+        qint64           iDueUs;
+        qint64           iOrder;
+        EDirection       eDirection;
+        CHostAddress     HostAddr;
+        CVector<uint8_t> vecbyData;
+    };
+
+    double GetDelayUs ( const CNetworkImpairment& Rule, std::mt19937& RandGen );
+
+    void Schedule ( const EDirection        eDirection,
+                    const CHostAddress&     HostAddr,
+                    const CVector<uint8_t>& vecbyData,
+                    const int               iNumBytes,
+                    const qint64            iDueUs );
+
+    virtual void run();
+
+    CSocket*                           pSocket;
+    QList<CNetworkImpairment>          vecRules;
+    QMap<QString, CLinkState>          mapLinkStates;
+    std::priority_queue<CQueuedPacket> QueuedPackets;
+    std::mt19937                       RandGens[2]; // per direction
+    QElapsedTimer                      ElapsedTime;
+    QMutex                             Mutex;
+    QWaitCondition                     WaitCondition;
+    qint64                             iNumQueued;
+    qint64                             iNumLost;
+    qint64                             iNumDuplicated;
+    qint64                             iNumReordered;
+    bool                               bRun;
+};
@@ -0,0 +1,265 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <cstring>
+#include <QDateTime>
+#include <QtEndian>
+#include "packettrace.h"
+#include "socket.h"
+
+
+/* Implementation *************************************************************/
+CPacketTrace::CPacketTrace() :
+    bHashOnly     ( false ),
+    iLastRecordUs ( 0 ),
+    iNumPackets   ( 0 )
+{
+    QObject::connect ( &TimerFlush, &QTimer::timeout,
+        this, &CPacketTrace::OnTimerFlush );
+}
+
+void CPacketTrace::Open ( const QString& strFileName, const bool bNHashOnly )
+{
+    Close();
+
+    File.setFileName ( strFileName );
+
+    if ( !File.open ( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        throw CGenErr ( QString ( "The packet trace file %1 cannot be opened." ).arg ( strFileName ) );
+    }
+
+    bHashOnly = bNHashOnly;
+
+    uchar byHeader[PACKET_TRACE_HEADER_SIZE];
+    qToLittleEndian<quint32> ( PACKET_TRACE_MAGIC, byHeader );
+    qToLittleEndian<quint16> ( PACKET_TRACE_VERSION, byHeader + 4 );
+    qToLittleEndian<quint16> ( bHashOnly ? PACKET_TRACE_FLAG_HASH_ONLY : 0, byHeader + 6 );
+    qToLittleEndian<quint64> ( QDateTime::currentMSecsSinceEpoch(), byHeader + 8 );
+
+    File.write ( reinterpret_cast<const char*> ( byHeader ), PACKET_TRACE_HEADER_SIZE );
+
+    QMutexLocker locker ( &Mutex );
+
+    vecbyBuffer.clear();
+    iLastRecordUs = 0;
+    iNumPackets   = 0;
+    ElapsedTime.start();
+
+    TimerFlush.start ( PACKET_TRACE_FLUSH_INTERVAL_MS );
+
+    qInfo() << qUtf8Printable ( QString ( "- packet trace started: %1" ).arg ( strFileName ) );
+}
+
+void CPacketTrace::Close()
+{
+    if ( File.isOpen() )
+    {
+        TimerFlush.stop();
+
+        {
+            QMutexLocker locker ( &Mutex );
+            ElapsedTime.invalidate();
+        }
+
+        OnTimerFlush();
+        File.close();
+
+        qInfo() << qUtf8Printable ( QString ( "- packet trace stopped: %1 packets" ).arg ( iNumPackets ) );
+    }
+}
+
+void CPacketTrace::Add ( const CVector<uint8_t>& vecbyData,
+                         const int               iNumBytes,
+                         const CHostAddress&     HostAddr )
+{
+    QMutexLocker locker ( &Mutex );
+
+    if ( !ElapsedTime.isValid() )
+    {
+        return;
+    }
+
+    // only the time difference to the previous record is stored to keep the
+    // records compact
+    const qint64 iNowUs   = ElapsedTime.nsecsElapsed() / 1000;
+    const qint64 iDeltaUs = std::min ( iNowUs - iLastRecordUs, static_cast<qint64> ( 0xFFFFFFFF ) );
+    iLastRecordUs         = iNowUs;
+    iNumPackets++;
+
+    const int iPayloadSize = bHashOnly ? 4 : iNumBytes;
+    const int iPos         = vecbyBuffer.size();
+
+    vecbyBuffer.resize ( iPos + PACKET_TRACE_RECORD_HDR_SIZE + iPayloadSize );
+
+    uchar* pbyRecord = reinterpret_cast<uchar*> ( vecbyBuffer.data() ) + iPos;
+
+    qToLittleEndian<quint32> ( static_cast<quint32> ( iDeltaUs ), pbyRecord );
+    qToLittleEndian<quint32> ( HostAddr.InetAddr.toIPv4Address(), pbyRecord + 4 );
+    qToLittleEndian<quint16> ( HostAddr.iPort, pbyRecord + 8 );
+    qToLittleEndian<quint16> ( static_cast<quint16> ( iNumBytes ), pbyRecord + 10 );
+
+    if ( bHashOnly )
+    {
+        qToLittleEndian<quint32> ( Hash ( &vecbyData[0], iNumBytes ), pbyRecord + PACKET_TRACE_RECORD_HDR_SIZE );
+    }
+    else
+    {
+        memcpy ( pbyRecord + PACKET_TRACE_RECORD_HDR_SIZE, &vecbyData[0], iNumBytes );
+    }
+}
+
+void CPacketTrace::OnTimerFlush()
+{
+    // swap the buffers so that the socket thread is only blocked for a short
+    // time, the file is written outside the lock
+    {
+        QMutexLocker locker ( &Mutex );
+
+        vecbyWriteBuffer.swap ( vecbyBuffer );
+        vecbyBuffer.clear();
+    }
+
+    if ( !vecbyWriteBuffer.isEmpty() )
+    {
+        File.write ( vecbyWriteBuffer );
+        File.flush();
+        vecbyWriteBuffer.clear();
+    }
+}
+
+uint32_t CPacketTrace::Hash ( const uint8_t* pbyData, const int iNumBytes )
+{
+    // FNV-1a
+    uint32_t iHash = 2166136261u;
+
+    for ( int i = 0; i < iNumBytes; i++ )
+    {
+        iHash = ( iHash ^ pbyData[i] ) * 16777619u;
+    }
+
+    return iHash;
+}
+
+void CPacketTraceReplay::Start ( CHighPrioSocket* pNSocket,
+                                 const QString&   strFileName,
+                                 const double     dNSpeed )
+{
+    Stop();
+
+    File.setFileName ( strFileName );
+
+    if ( !File.open ( QIODevice::ReadOnly ) )
+    {
+        throw CGenErr ( QString ( "The packet trace file %1 cannot be opened." ).arg ( strFileName ) );
+    }
+
+    const QByteArray vecbyHeader = File.read ( PACKET_TRACE_HEADER_SIZE );
+    const uchar*     pbyHeader   = reinterpret_cast<const uchar*> ( vecbyHeader.constData() );
+
+    if ( ( vecbyHeader.size() != PACKET_TRACE_HEADER_SIZE ) ||
+         ( qFromLittleEndian<quint32> ( pbyHeader ) != PACKET_TRACE_MAGIC ) ||
+         ( qFromLittleEndian<quint16> ( pbyHeader + 4 ) != PACKET_TRACE_VERSION ) )
+    {
+        File.close();
+        throw CGenErr ( QString ( "The file %1 is not a packet trace file." ).arg ( strFileName ) );
+    }
+
+    if ( qFromLittleEndian<quint16> ( pbyHeader + 6 ) & PACKET_TRACE_FLAG_HASH_ONLY )
+    {
+        File.close();
+        throw CGenErr ( QString ( "The packet trace file %1 contains no payload and cannot be replayed." ).arg ( strFileName ) );
+    }
+
+    pSocket = pNSocket;
+    dSpeed  = dNSpeed;
+    bRun    = true;
+
+    pSocket->SetOfflineMode ( true );
+
+    qInfo() << qUtf8Printable ( QString ( "- packet trace replay started: %1 (speed %2)" )
+        .arg ( strFileName ).arg ( dSpeed ) );
+
+    start ( QThread::TimeCriticalPriority );
+}
+
+void CPacketTraceReplay::run()
+{
+    CVector<uint8_t> vecbyRecBuf ( MAX_SIZE_BYTES_NETW_BUF );
+    CHostAddress     HostAddr;
+    QElapsedTimer    ElapsedTime;
+    qint64           iTraceTimeUs = 0;
+    qint64           iNumPackets  = 0;
+
+    ElapsedTime.start();
+
+    while ( bRun )
+    {
+        const QByteArray vecbyRecordHdr = File.read ( PACKET_TRACE_RECORD_HDR_SIZE );
+
+        if ( vecbyRecordHdr.size() != PACKET_TRACE_RECORD_HDR_SIZE )
+        {
+            break;
+        }
+
+        const uchar* pbyRecordHdr = reinterpret_cast<const uchar*> ( vecbyRecordHdr.constData() );
+        const int    iNumBytes    = qFromLittleEndian<quint16> ( pbyRecordHdr + 10 );
+
+        iTraceTimeUs += qFromLittleEndian<quint32> ( pbyRecordHdr );
+        HostAddr      = CHostAddress ( qFromLittleEndian<quint32> ( pbyRecordHdr + 4 ),
+                                       qFromLittleEndian<quint16> ( pbyRecordHdr + 8 ) );
+
+        if ( ( iNumBytes > MAX_SIZE_BYTES_NETW_BUF ) ||
+             ( File.read ( reinterpret_cast<char*> ( &vecbyRecBuf[0] ), iNumBytes ) != iNumBytes ) )
+        {
+            break;
+        }
+
+        // wait until the packet is due (scaled with the replay speed)
+        if ( dSpeed > 0 )
+        {
+            const qint64 iWaitUs = static_cast<qint64> ( iTraceTimeUs / dSpeed ) - ElapsedTime.nsecsElapsed() / 1000;
+
+            if ( iWaitUs > 0 )
+            {
+                usleep ( static_cast<unsigned long> ( iWaitUs ) );
+            }
+        }
+
+        pSocket->ProcessPacket ( vecbyRecBuf, iNumBytes, HostAddr );
+        iNumPackets++;
+    }
+
+    File.close();
+
+    qInfo() << qUtf8Printable ( QString ( "- packet trace replay finished: %1 packets, %2 s trace time in %3 s" )
+        .arg ( iNumPackets )
+        .arg ( static_cast<double> ( iTraceTimeUs ) / 1000000, 0, 'f', 2 )
+        .arg ( static_cast<double> ( ElapsedTime.elapsed() ) / 1000, 0, 'f', 2 ) );
+
+    if ( bRun )
+    {
+        emit Finished();
+    }
+}
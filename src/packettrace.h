@@ -0,0 +1,144 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Capture of the received UDP packets in a compact binary trace file and
+ * replay of a trace into the socket processing of a server or a client (with
+ * the original timing or accelerated) so that sessions can be reproduced.
+ * The replay is offline only: the socket does not send to the recorded
+ * addresses and ignores the live traffic while a trace is replayed. Note that
+ * the audio processing of the server and the client still runs on its real
+ * time timer or sound card, so only a replay with the original timing
+ * reproduces the jitter buffer behaviour of the session.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QTimer>
+#include <QFile>
+#include <QElapsedTimer>
+#include <atomic>
+#include "global.h"
+#include "util.h"
+
+class CHighPrioSocket; // forward declaration of CHighPrioSocket
+
+
+/* Definitions ****************************************************************/
+/*
+    Trace file format (all values little endian):
+
+    file header:
+    +------------------+-------------+-----------+-----------------------+
+    | 4 bytes "JPTR"   | 2 bytes ver | 2 bytes   | 8 bytes start time    |
+    |                  |             | flags     | (ms since epoch)      |
+    +------------------+-------------+-----------+-----------------------+
+
+    record per received packet:
+    +------------------+-------------+-----------+-----------+-----------+
+    | 4 bytes time     | 4 bytes     | 2 bytes   | 2 bytes   | payload   |
+    | since previous   | IPv4 source | source    | packet    | or 4 byte |
+    | record (us)      | address     | port      | size      | hash      |
+    +------------------+-------------+-----------+-----------+-----------+
+
+    If the flag PACKET_TRACE_FLAG_HASH_ONLY is set, the payload is replaced by
+    its FNV-1a hash (such traces can be analyzed but not replayed).
+*/
+#define PACKET_TRACE_MAGIC              0x5254504A // "JPTR"
+#define PACKET_TRACE_VERSION            1
+#define PACKET_TRACE_FLAG_HASH_ONLY     0x0001
+#define PACKET_TRACE_HEADER_SIZE        16
+#define PACKET_TRACE_RECORD_HDR_SIZE    12
+
+// the records are collected in memory by the socket thread and written to the
+// file by the main thread
+#define PACKET_TRACE_FLUSH_INTERVAL_MS  500
+
+
+/* Classes ********************************************************************/
+// capture of the received packets (called in the socket thread)
+class CPacketTrace : public QObject
+{
+    Q_OBJECT
+
+public:
+    CPacketTrace();
+    virtual ~CPacketTrace() { Close(); }
+
+    void Open ( const QString& strFileName, const bool bNHashOnly );
+    void Close();
+    bool IsOpen() const { return File.isOpen(); }
+
+    void Add ( const CVector<uint8_t>& vecbyData,
+               const int               iNumBytes,
+               const CHostAddress&     HostAddr );
+
+protected:
+    static uint32_t Hash ( const uint8_t* pbyData, const int iNumBytes );
+
+    QFile         File;
+    bool          bHashOnly;
+    QElapsedTimer ElapsedTime;
+    qint64        iLastRecordUs;
+    qint64        iNumPackets;
+    QMutex        Mutex;
+    QByteArray    vecbyBuffer;
+    QByteArray    vecbyWriteBuffer;
+    QTimer        TimerFlush;
+
+public slots:
+    void OnTimerFlush();
+};
+
+// replay of a trace into the socket processing (runs in its own thread which
+// takes the role of the socket receive thread, the socket is sandboxed in
+// replay mode from the start on)
+class CPacketTraceReplay : public QThread
+{
+    Q_OBJECT
+
+public:
+    CPacketTraceReplay() : pSocket ( nullptr ), dSpeed ( 1 ), bRun ( false ) { setObjectName ( "CPacketTraceReplay" ); }
+    virtual ~CPacketTraceReplay() { Stop(); }
+
+    // a speed of 0 replays the packets as fast as possible
+    void Start ( CHighPrioSocket* pNSocket,
+                 const QString&   strFileName,
+                 const double     dNSpeed );
+
+    void Stop() { bRun = false; wait(); }
+
+protected:
+    virtual void run();
+
+    CHighPrioSocket*  pSocket;
+    QFile             File;
+    double            dSpeed;
+    std::atomic<bool> bRun;
+
+signals:
+    // the whole trace was replayed (not emitted on Stop())
+    void Finished();
+};
@@ -435,6 +435,86 @@ CONNECTION LESS MESSAGES
           five times for one registration request at 500ms intervals.
           Beyond this, it should "ping" every 15 minutes
           (standard re-registration timeout).
+
+
+- PROTMESSID_CLM_SUBSCRIBE_SESSION: Subscribe to the address of a session
+
+    +------------------+-----------------------------------+
+    | 2 bytes number n | n bytes UTF-8 string session name |
+    +------------------+-----------------------------------+
+
+    Note: the central server answers with PROTMESSID_CLM_SESSION_ADDRESS as
+          soon as a server with the given name is registered (immediately if
+          it is already registered). A pending subscription times out if it
+          is not renewed, therefore the client retransmits the message with an
+          exponential backoff until the session address is received.
+
+
+- PROTMESSID_CLM_SESSION_ADDRESS: Address of a subscribed session
+
+    +--------------------------+----------------------------+ ...
+    | 4 bytes public client IP | 2 bytes public client port | ...
+    +--------------------------+----------------------------+ ...
+        ... --------------------+----------------------+ ...
+        ...  4 bytes session IP | 2 bytes session port | ...
+        ... --------------------+----------------------+ ...
+        ... ------------------+-----------------------------------+
+        ...  2 bytes number n | n bytes UTF-8 string session name |
+        ... ------------------+-----------------------------------+
+
+    - "public client IP/port": the address of the subscribing client as seen
+      by the central server (same as the prefix of
+      PROTMESSID_CLM_SERVER_LIST)
+
+
+- PROTMESSID_CLM_P2P_CONN_CHECK: P2P connectivity check of a candidate address
+
+    +-----------------------------+-----------------+-------------------------+ ...
+    | 4 bytes transmit time in ms | 1 byte channel  | 1 byte candidate index  | ...
+    +-----------------------------+-----------------+-------------------------+ ...
+        ... ------------------------+
+        ...  4 bytes transaction ID |
+        ... ------------------------+
+
+    - "channel": channel ID of the peer the check is addressed to
+    - "candidate index": index of the candidate address at the sender
+    - "transaction ID": random number of the check, a response is only
+      accepted if it carries the same ID
+
+    Note: a peer answers with PROTMESSID_CLM_P2P_CONN_CHECK_RESP if the channel
+          ID is its own channel ID.
+
+
+- PROTMESSID_CLM_P2P_CONN_CHECK_RESP: Response to a P2P connectivity check
+
+    +-----------------------------+-----------------+-------------------------+ ...
+    | 4 bytes transmit time in ms | 1 byte channel  | 1 byte candidate index  | ...
+    +-----------------------------+-----------------+-------------------------+ ...
+        ... ------------------------+
+        ...  4 bytes transaction ID |
+        ... ------------------------+
+
+    - all values are copied from the PROTMESSID_CLM_P2P_CONN_CHECK message
+
+
+- PROTMESSID_CLM_P2P_PING: P2P link ping with time stamp in us
+
+    +-----------------------------+
+    | 4 bytes transmit time in us |
+    +-----------------------------+
+
+    Note: the time stamp wraps around, only differences are evaluated
+
+
+- PROTMESSID_CLM_P2P_PING_RESP: Response to a P2P link ping
+
+    +-----------------------------+------------------------------------+
+    | 4 bytes transmit time in us | 4 bytes time of the responder in us |
+    +-----------------------------+------------------------------------+
+
+    - "transmit time": copied from the PROTMESSID_CLM_P2P_PING message
+    - "time of the responder": used to estimate the clock offset and the
+      one-way delays of the link
 */
 
 #include "protocol.h"
@@ -943,6 +1023,30 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
     case PROTMESSID_CLM_REGISTER_SERVER_RESP:
         EvaluateCLRegisterServerResp ( InetAddr, vecbyMesBodyData );
         break;
+
+    case PROTMESSID_CLM_SUBSCRIBE_SESSION:
+        EvaluateCLSubscribeSessionMes ( InetAddr, vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_CLM_SESSION_ADDRESS:
+        EvaluateCLSessionAddressMes ( InetAddr, vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_CLM_P2P_CONN_CHECK:
+        EvaluateCLP2pConnCheckMes ( InetAddr, vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_CLM_P2P_CONN_CHECK_RESP:
+        EvaluateCLP2pConnCheckRespMes ( InetAddr, vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_CLM_P2P_PING:
+        EvaluateCLP2pPingMes ( InetAddr, vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_CLM_P2P_PING_RESP:
+        EvaluateCLP2pPingRespMes ( InetAddr, vecbyMesBodyData );
+        break;
     }
 }
 
@@ -2967,6 +3071,299 @@ bool CProtocol::EvaluateCLRegisterServerResp ( const CHostAddress&     InetAddr,
     return false; // no error
 }
 
+void CProtocol::CreateCLSubscribeSessionMes ( const CHostAddress& InetAddr,
+                                              const QString&      strSessionName )
+{
+    int              iPos = 0; // init position pointer
+    const QByteArray strUTF8Name = strSessionName.toUtf8();
+
+    // build data vector
+    CVector<uint8_t> vecData ( 2 /* utf-8 str. size */ + strUTF8Name.size() );
+
+    // session name
+    PutStringUTF8OnStream ( vecData, iPos, strUTF8Name );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SUBSCRIBE_SESSION,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLSubscribeSessionMes ( const CHostAddress&     InetAddr,
+                                                const CVector<uint8_t>& vecData )
+{
+    int     iPos = 0; // init position pointer
+    QString strSessionName;
+
+    // session name
+    if ( GetStringFromStream ( vecData,
+                               iPos,
+                               MAX_LEN_SERVER_NAME,
+                               strSessionName ) )
+    {
+        return true; // return error code
+    }
+
+    // check size: all data is read, the position must now be at the end
+    if ( iPos != vecData.Size() )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit CLSubscribeSession ( InetAddr, strSessionName );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLSessionAddressMes ( const CHostAddress& InetAddr,
+                                            const CHostAddress& SessionInetAddr,
+                                            const QString&      strSessionName )
+{
+    int              iPos = 0; // init position pointer
+    const QByteArray strUTF8Name = strSessionName.toUtf8();
+
+    // build data vector
+    CVector<uint8_t> vecData ( 4 /* client IP */ + 2 /* client port */ +
+                               4 /* session IP */ + 2 /* session port */ +
+                               2 /* utf-8 str. size */ + strUTF8Name.size() );
+
+    // for p2p the clients need to know their public ip and port number
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( InetAddr.InetAddr.toIPv4Address() ), 4 );
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( InetAddr.iPort ), 2 );
+
+    // session address (6 bytes)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( SessionInetAddr.InetAddr.toIPv4Address() ), 4 );
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( SessionInetAddr.iPort ), 2 );
+
+    // session name
+    PutStringUTF8OnStream ( vecData, iPos, strUTF8Name );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SESSION_ADDRESS,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLSessionAddressMes ( const CHostAddress&     InetAddr,
+                                              const CVector<uint8_t>& vecData )
+{
+    int iPos = 0; // init position pointer
+
+    // check size (the next 12 bytes)
+    if ( vecData.Size() < 12 )
+    {
+        return true; // return error code
+    }
+
+    // public address of this client (6 bytes)
+    const quint32 iPublicIpAddr = static_cast<quint32> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const quint16 iPublicPort   = static_cast<quint16> ( GetValFromStream ( vecData, iPos, 2 ) );
+
+    // session address (6 bytes)
+    const quint32 iSessionIpAddr = static_cast<quint32> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const quint16 iSessionPort   = static_cast<quint16> ( GetValFromStream ( vecData, iPos, 2 ) );
+
+    // session name
+    QString strSessionName;
+    if ( GetStringFromStream ( vecData,
+                               iPos,
+                               MAX_LEN_SERVER_NAME,
+                               strSessionName ) )
+    {
+        return true; // return error code
+    }
+
+    // check size: all data is read, the position must now be at the end
+    if ( iPos != vecData.Size() )
+    {
+        return true; // return error code
+    }
+
+    // invoke message actions
+    emit CLPublicIpRec ( CHostAddress ( QHostAddress ( iPublicIpAddr ), iPublicPort ) );
+
+    emit CLSessionAddressReceived ( InetAddr,
+                                    CHostAddress ( QHostAddress ( iSessionIpAddr ), iSessionPort ),
+                                    strSessionName );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLP2pConnCheckMes ( const CHostAddress& InetAddr,
+                                          const int           iMs,
+                                          const int           iChanID,
+                                          const int           iCandidateIdx,
+                                          const uint32_t      iTransactionID )
+{
+    int iPos = 0; // init position pointer
+
+    // build data vector (10 bytes long)
+    CVector<uint8_t> vecData ( 10 );
+
+    // transmit time (4 bytes)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iMs ), 4 );
+
+    // channel ID of the checked peer (1 byte)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iChanID ), 1 );
+
+    // candidate index (1 byte)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iCandidateIdx ), 1 );
+
+    // transaction ID (4 bytes)
+    PutValOnStream ( vecData, iPos, iTransactionID, 4 );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_P2P_CONN_CHECK,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLP2pConnCheckMes ( const CHostAddress&     InetAddr,
+                                            const CVector<uint8_t>& vecData )
+{
+    int iPos = 0; // init position pointer
+
+    // check size
+    if ( vecData.Size() != 10 )
+    {
+        return true; // return error code
+    }
+
+    const int iMs           = static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const int iChanID       = static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+    const int iCandidateIdx = static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+
+    const uint32_t iTransactionID = static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+
+    // invoke message action
+    emit CLP2pConnCheckReceived ( InetAddr, iMs, iChanID, iCandidateIdx, iTransactionID );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLP2pConnCheckRespMes ( const CHostAddress& InetAddr,
+                                              const int           iMs,
+                                              const int           iChanID,
+                                              const int           iCandidateIdx,
+                                              const uint32_t      iTransactionID )
+{
+    int iPos = 0; // init position pointer
+
+    // build data vector (10 bytes long)
+    CVector<uint8_t> vecData ( 10 );
+
+    // transmit time (4 bytes)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iMs ), 4 );
+
+    // channel ID of the checked peer (1 byte)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iChanID ), 1 );
+
+    // candidate index (1 byte)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iCandidateIdx ), 1 );
+
+    // transaction ID (4 bytes)
+    PutValOnStream ( vecData, iPos, iTransactionID, 4 );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_P2P_CONN_CHECK_RESP,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLP2pConnCheckRespMes ( const CHostAddress&     InetAddr,
+                                                const CVector<uint8_t>& vecData )
+{
+    int iPos = 0; // init position pointer
+
+    // check size
+    if ( vecData.Size() != 10 )
+    {
+        return true; // return error code
+    }
+
+    const int iMs           = static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const int iChanID       = static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+    const int iCandidateIdx = static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+
+    const uint32_t iTransactionID = static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+
+    // invoke message action
+    emit CLP2pConnCheckRespReceived ( InetAddr, iMs, iChanID, iCandidateIdx, iTransactionID );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLP2pPingMes ( const CHostAddress& InetAddr,
+                                     const uint32_t      iTransmitUs )
+{
+    int iPos = 0; // init position pointer
+
+    // build data vector (4 bytes long)
+    CVector<uint8_t> vecData ( 4 );
+
+    // transmit time (4 bytes)
+    PutValOnStream ( vecData, iPos, iTransmitUs, 4 );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_P2P_PING,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLP2pPingMes ( const CHostAddress&     InetAddr,
+                                       const CVector<uint8_t>& vecData )
+{
+    int iPos = 0; // init position pointer
+
+    // check size
+    if ( vecData.Size() != 4 )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit CLP2pPingReceived ( InetAddr,
+                             static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) ) );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLP2pPingRespMes ( const CHostAddress& InetAddr,
+                                         const uint32_t      iTransmitUs,
+                                         const uint32_t      iPeerUs )
+{
+    int iPos = 0; // init position pointer
+
+    // build data vector (8 bytes long)
+    CVector<uint8_t> vecData ( 8 );
+
+    // transmit time (4 bytes)
+    PutValOnStream ( vecData, iPos, iTransmitUs, 4 );
+
+    // time of the responder (4 bytes)
+    PutValOnStream ( vecData, iPos, iPeerUs, 4 );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_P2P_PING_RESP,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLP2pPingRespMes ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData )
+{
+    int iPos = 0; // init position pointer
+
+    // check size
+    if ( vecData.Size() != 8 )
+    {
+        return true; // return error code
+    }
+
+    const uint32_t iTransmitUs = static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const uint32_t iPeerUs     = static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+
+    // invoke message action
+    emit CLP2pPingRespReceived ( InetAddr, iTransmitUs, iPeerUs );
+
+    return false; // no error
+}
+
 /******************************************************************************\
 * Message generation and parsing                                               *
 \******************************************************************************/
@@ -34,6 +34,7 @@
 #include <cmath>
 #include "global.h"
 #include "util.h"
+#include "metrics.h"
 
 
 /* Definitions ****************************************************************/
@@ -87,6 +88,12 @@
 #define PROTMESSID_CLM_REGISTER_SERVER_RESP   1016 // status of server registration request
 #define PROTMESSID_CLM_REGISTER_SERVER_EX     1017 // register server with extended information
 #define PROTMESSID_CLM_RED_SERVER_LIST        1018 // reduced server list
+#define PROTMESSID_CLM_SUBSCRIBE_SESSION      1019 // subscribe to the address of a session
+#define PROTMESSID_CLM_SESSION_ADDRESS        1020 // address of a subscribed session
+#define PROTMESSID_CLM_P2P_CONN_CHECK         1021 // P2P connectivity check of a candidate address
+#define PROTMESSID_CLM_P2P_CONN_CHECK_RESP    1022 // response to a P2P connectivity check
+#define PROTMESSID_CLM_P2P_PING               1023 // P2P link ping with time stamp in us
+#define PROTMESSID_CLM_P2P_PING_RESP          1024 // response to a P2P link ping with time stamp of the peer
 
 // special IDs
 #define PROTMESSID_SPECIAL_SPLIT_MESSAGE      2001 // a container for split messages
@@ -112,6 +119,10 @@ public:
     CProtocol();
 
     void Reset();
+
+    // number of messages which were sent again because of a missing
+    // acknowledgement
+    int64_t GetNumRetransmissions() const { return NumRetransmissions.Get(); }
     void SetSplitMessageSupported ( const bool bIn ) { bSplitMessageSupported = bIn; }
 
     void CreateJitBufMes ( const int iJitBufSize );
@@ -172,6 +183,26 @@ void CreateReqChannelLevelListMes();
     void CreateCLRegisterServerResp    ( const CHostAddress& InetAddr,
                                          const ESvrRegResult eResult,
                                          const QString ServerName );
+    void CreateCLSubscribeSessionMes   ( const CHostAddress& InetAddr,
+                                         const QString&      strSessionName );
+    void CreateCLSessionAddressMes     ( const CHostAddress& InetAddr,
+                                         const CHostAddress& SessionInetAddr,
+                                         const QString&      strSessionName );
+    void CreateCLP2pConnCheckMes       ( const CHostAddress& InetAddr,
+                                         const int           iMs,
+                                         const int           iChanID,
+                                         const int           iCandidateIdx,
+                                         const uint32_t      iTransactionID );
+    void CreateCLP2pConnCheckRespMes   ( const CHostAddress& InetAddr,
+                                         const int           iMs,
+                                         const int           iChanID,
+                                         const int           iCandidateIdx,
+                                         const uint32_t      iTransactionID );
+    void CreateCLP2pPingMes            ( const CHostAddress& InetAddr,
+                                         const uint32_t      iTransmitUs );
+    void CreateCLP2pPingRespMes        ( const CHostAddress& InetAddr,
+                                         const uint32_t      iTransmitUs,
+                                         const uint32_t      iPeerUs );
 
     static bool ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
                                     const int               iNumBytesIn,
@@ -321,6 +352,18 @@ protected:
                                            const CVector<uint8_t>& vecData );
     bool EvaluateCLSendIpsToServer       ( const CHostAddress&     InetAddr,
                                            const CVector<uint8_t>& vecData );
+    bool EvaluateCLSubscribeSessionMes   ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLSessionAddressMes     ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLP2pConnCheckMes       ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLP2pConnCheckRespMes   ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLP2pPingMes            ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLP2pPingRespMes        ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
 
     int                     iOldRecID;
     int                     iOldRecCnt;
@@ -331,6 +374,7 @@ protected:
 
     QTimer                  TimerSendMess;
     QMutex                  Mutex;
+    CMetricsCounter         NumRetransmissions;
 
     CVector<uint8_t>        vecbySplitMessageStorage;
     int                     iSplitMessageCnt;
@@ -338,7 +382,7 @@ protected:
     bool                    bSplitMessageSupported;
 
 public slots:
-    void OnTimerSendMess() { SendMessage(); }
+    void OnTimerSendMess() { NumRetransmissions.Add(); SendMessage(); }
 
 signals:
     // transmitting
@@ -405,6 +449,26 @@ signals:
                                         ESvrRegResult          eStatus,
                                         QString                strName );
     void CLPublicIpRec                ( CHostAddress           InetAddr );
+    void CLSubscribeSession           ( CHostAddress           InetAddr,
+                                        QString                strSessionName );
+    void CLSessionAddressReceived     ( CHostAddress           InetAddr,
+                                        CHostAddress           SessionInetAddr,
+                                        QString                strSessionName );
+    void CLP2pConnCheckReceived       ( CHostAddress           InetAddr,
+                                        int                    iMs,
+                                        int                    iChanID,
+                                        int                    iCandidateIdx,
+                                        uint32_t               iTransactionID );
+    void CLP2pConnCheckRespReceived   ( CHostAddress           InetAddr,
+                                        int                    iMs,
+                                        int                    iChanID,
+                                        int                    iCandidateIdx,
+                                        uint32_t               iTransactionID );
+    void CLP2pPingReceived            ( CHostAddress           InetAddr,
+                                        uint32_t               iTransmitUs );
+    void CLP2pPingRespReceived        ( CHostAddress           InetAddr,
+                                        uint32_t               iTransmitUs,
+                                        uint32_t               iPeerUs );
     void ClientIpsRec                 ( CHostAddress           LocalAddr,
                                         CHostAddress           PublicInetAddr );
 };
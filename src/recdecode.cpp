@@ -0,0 +1,281 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#ifdef USE_OPUS_SHARED_LIB
+# include "opus/opus_custom.h"
+#else
+# include "opus_custom.h"
+#endif
+#include "recorder/cpacketstream.h"
+#include "recorder/cwavewriter.h"
+#include "recorder/jamrecorder.h"
+#include "recdecode.h"
+
+using namespace recorder;
+
+
+/* Implementation *************************************************************/
+qint64 CRecordingDecoder::DecodeTrack ( const QString& strPacketFileName,
+                                        const QString& strWavFileName )
+{
+    QFile PacketFile ( strPacketFileName );
+
+    if ( !PacketFile.open ( QIODevice::ReadOnly ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "- cannot read '%1'" ).arg ( strPacketFileName ) );
+        return -1;
+    }
+
+    CPacketReader Reader ( &PacketFile );
+
+    if ( !Reader.ReadHeader() )
+    {
+        qWarning() << qUtf8Printable ( QString ( "- '%1' is not a supported packet stream" ).arg ( strPacketFileName ) );
+        return -1;
+    }
+
+    const int iNumAudioChannels      = Reader.GetNumAudioChannels();
+    const int iCodedFrameSizeSamples = ( Reader.GetAudioComprType() == CT_OPUS64 ) ? SYSTEM_FRAME_SIZE_SAMPLES :
+                                                                                      DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES;
+
+    if ( ( iServerFrameSizeSamples != 0 ) && ( iServerFrameSizeSamples != Reader.GetServerFrameSizeSamples() ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "- '%1' was recorded with a different server frame size" ).arg ( strPacketFileName ) );
+    }
+
+    iServerFrameSizeSamples = Reader.GetServerFrameSizeSamples();
+
+    // the same decoder as in the server (the packet loss concealment needs
+    // the state of the previous packets)
+    int                iOpusError;
+    OpusCustomMode*    pOpusMode    = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ, iCodedFrameSizeSamples, &iOpusError );
+    OpusCustomDecoder* pOpusDecoder = opus_custom_decoder_create ( pOpusMode, iNumAudioChannels, &iOpusError );
+
+    QFile WavFile ( strWavFileName );
+
+    if ( !WavFile.open ( QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "- cannot write '%1'" ).arg ( strWavFileName ) );
+        opus_custom_decoder_destroy ( pOpusDecoder );
+        opus_custom_mode_destroy ( pOpusMode );
+        return -1;
+    }
+
+    CWaveWriter      WaveWriter ( &WavFile, static_cast<uint16_t> ( iNumAudioChannels ) );
+    CVector<int16_t> vecsAudio ( iNumAudioChannels * iCodedFrameSizeSamples );
+    CVector<uint8_t> vecbyData;
+    uint32_t         iSequence;
+    uint32_t         iTick;
+    int              iNumBytes;
+    qint64           iNextSequence = 0;
+    qint64           iNumFrames    = 0; // written coded frames
+
+    while ( Reader.ReadPacket ( iSequence, iTick, vecbyData, iNumBytes ) )
+    {
+        // packets which are out of order cannot be inserted anymore
+        if ( iSequence < iNextSequence )
+        {
+            continue;
+        }
+
+        // the DTX silence records have sequence numbers, too, a silence of
+        // any length is therefore never a gap
+        if ( iSequence - iNextSequence > RECDECODE_MAX_GAP_PACKETS )
+        {
+            // a longer gap (e.g. a long outage or a corrupt sequence number)
+            // is written as silence of the maximum gap length, the decoding
+            // continues after it with a fresh decoder state
+            qWarning() << qUtf8Printable ( QString ( "- '%1': gap of %2 packets after %3 packets, clamped to %4 packets of silence" )
+                .arg ( strPacketFileName ).arg ( iSequence - iNextSequence ).arg ( iNextSequence ).arg ( RECDECODE_MAX_GAP_PACKETS ) );
+
+            vecsAudio.Reset ( 0 );
+
+            for ( int i = 0; i < RECDECODE_MAX_GAP_PACKETS; i++ )
+            {
+                WaveWriter.AppendFrame ( &vecsAudio[0], vecsAudio.Size() );
+            }
+
+            opus_custom_decoder_ctl ( pOpusDecoder, OPUS_RESET_STATE );
+
+            iNumFrames   += RECDECODE_MAX_GAP_PACKETS;
+            iNextSequence = iSequence;
+        }
+
+        // conceal the packets which were lost on the network or not recorded
+        for ( ; iNextSequence < iSequence; iNextSequence++ )
+        {
+            opus_custom_decode ( pOpusDecoder, nullptr, 0, &vecsAudio[0], iCodedFrameSizeSamples );
+            WaveWriter.AppendFrame ( &vecsAudio[0], vecsAudio.Size() );
+            iNumFrames++;
+            iNumConcealed++;
+        }
+
+        if ( iNumBytes == PACKET_STREAM_DTX_SILENCE_BYTES )
+        {
+            // the client suppressed its silent input in DTX mode, the server
+            // did not decode the frame either
+            vecsAudio.Reset ( 0 );
+            WaveWriter.AppendFrame ( &vecsAudio[0], vecsAudio.Size() );
+            iNumDtxSilence++;
+        }
+        else
+        {
+            opus_custom_decode ( pOpusDecoder, &vecbyData[0], iNumBytes, &vecsAudio[0], iCodedFrameSizeSamples );
+            WaveWriter.AppendFrame ( &vecsAudio[0], vecsAudio.Size() );
+            iNumPackets++;
+        }
+
+        iNextSequence++;
+        iNumFrames++;
+    }
+
+    WaveWriter.finalise();
+
+    opus_custom_decoder_destroy ( pOpusDecoder );
+    opus_custom_mode_destroy ( pOpusMode );
+
+    // length in server frames (rounded up)
+    return ( iNumFrames * iCodedFrameSizeSamples + iServerFrameSizeSamples - 1 ) / iServerFrameSizeSamples;
+}
+
+bool CRecordingDecoder::DecodeSession ( const QString& strSessionDirName )
+{
+    const QDir SessionDir ( strSessionDirName );
+
+    Tracks.clear();
+
+    // the file names are the same as for the WAV recording:
+    // [name]-[host and port]-[start frame]-[number of channels][_affix]
+    foreach ( auto strEntry, SessionDir.entryList ( { "*." PACKET_STREAM_FILE_SUFFIX }, QDir::Files, QDir::Name ) )
+    {
+        const QFileInfo   FileInfo ( SessionDir.absoluteFilePath ( strEntry ) );
+        const QStringList vecstrParts = FileInfo.completeBaseName().split ( "-" );
+
+        if ( vecstrParts.size() != 4 )
+        {
+            qWarning() << qUtf8Printable ( QString ( "- unexpected file name '%1', skipped" ).arg ( strEntry ) );
+            continue;
+        }
+
+        const QString strWavFileName = SessionDir.absoluteFilePath ( FileInfo.completeBaseName() + ".wav" );
+        const qint64  iLength        = DecodeTrack ( FileInfo.absoluteFilePath(), strWavFileName );
+
+        if ( iLength < 0 )
+        {
+            continue;
+        }
+
+        const QString strTrackName = vecstrParts[0] + "-" + vecstrParts[1];
+
+        Tracks[strTrackName].append ( STrackItem ( vecstrParts[3].split ( "_" )[0].toInt(),
+                                                   vecstrParts[2].toLongLong(),
+                                                   iLength,
+                                                   strWavFileName ) );
+
+        qInfo() << qUtf8Printable ( QString ( "- %1: %2 frames" ).arg ( strEntry ).arg ( iLength ) );
+    }
+
+    if ( Tracks.isEmpty() )
+    {
+        return false;
+    }
+
+    CJamRecorder::ReaperProjectFromTracks ( SessionDir.absoluteFilePath ( SessionDir.dirName() + ".rpp" ),
+                                            Tracks,
+                                            iServerFrameSizeSamples );
+
+    CJamRecorder::AudacityLofFromTracks ( SessionDir.absoluteFilePath ( SessionDir.dirName() + ".lof" ),
+                                          Tracks,
+                                          iServerFrameSizeSamples );
+
+    return true;
+}
+
+int RecDecodeMain ( int argc, char** argv )
+{
+    QStringList vecstrSessionDirs;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( GetFlagArgument ( argv, i, "-h", "--help" ) )
+        {
+            qInfo() << qUtf8Printable ( QString (
+                "Usage: %1 [session directory] ...\n"
+                "\nDecodes the sessions recorded with --recordcoded to WAV files (lost\n"
+                "packets are concealed) and writes the Reaper project and the Audacity\n"
+                "LOF file of each session.\n"
+                "\nOptions:\n"
+                "  -h, --help            display this help text and exit\n" )
+                .arg ( argv[0] ) );
+            return 0;
+        }
+
+        if ( argv[i][0] != '-' )
+        {
+            vecstrSessionDirs.append ( QString ( argv[i] ) );
+            continue;
+        }
+
+        qCritical() << qUtf8Printable ( QString ( "%1: Unknown option '%2' -- use '--help' for help" )
+            .arg ( argv[0] ).arg ( argv[i] ) );
+    }
+
+    if ( vecstrSessionDirs.isEmpty() )
+    {
+        qCritical() << qUtf8Printable ( QString ( "%1: no session directory given -- use '--help' for help" ).arg ( argv[0] ) );
+        return 1;
+    }
+
+    int iResult = 0;
+
+    for ( int i = 0; i < vecstrSessionDirs.size(); i++ )
+    {
+        CRecordingDecoder Decoder;
+        QElapsedTimer     ElapsedTime;
+
+        qInfo() << qUtf8Printable ( QString ( "Session %1" ).arg ( vecstrSessionDirs[i] ) );
+
+        ElapsedTime.start();
+
+        if ( !Decoder.DecodeSession ( vecstrSessionDirs[i] ) )
+        {
+            qCritical() << qUtf8Printable ( QString ( "%1: no coded tracks decoded in '%2'" )
+                .arg ( argv[0] ).arg ( vecstrSessionDirs[i] ) );
+            iResult = 1;
+            continue;
+        }
+
+        qInfo() << qUtf8Printable ( QString ( "- %1 packets decoded, %2 concealed, %3 DTX silence in %4 s" )
+            .arg ( Decoder.GetNumPackets() )
+            .arg ( Decoder.GetNumConcealed() )
+            .arg ( Decoder.GetNumDtxSilence() )
+            .arg ( static_cast<double> ( ElapsedTime.elapsed() ) / 1000, 0, 'f', 2 ) );
+    }
+
+    return iResult;
+}
@@ -0,0 +1,74 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Offline decoder of the coded recordings (--recordcoded): the packet streams
+ * of a session directory are decoded to WAV files (the missing packets are
+ * concealed by the decoder) and the Reaper project and the Audacity LOF file
+ * are written like for a session recorded as WAV files.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QMap>
+#include <QList>
+#include "global.h"
+#include "util.h"
+#include "recorder/cwavestream.h"
+
+
+/* Definitions ****************************************************************/
+// larger gaps in the sequence numbers are written as silence of this length
+#define RECDECODE_MAX_GAP_PACKETS       ( 60 * SYSTEM_SAMPLE_RATE_HZ / SYSTEM_FRAME_SIZE_SAMPLES )
+
+
+/* Classes ********************************************************************/
+class CRecordingDecoder
+{
+public:
+    CRecordingDecoder() : iServerFrameSizeSamples ( 0 ), iNumPackets ( 0 ), iNumConcealed ( 0 ), iNumDtxSilence ( 0 ) {}
+
+    // decodes all packet streams of the session and writes the project files,
+    // returns false if no track could be decoded
+    bool DecodeSession ( const QString& strSessionDirName );
+
+    // decodes one packet stream to a WAV file, returns the length in server
+    // frames or -1 on error
+    qint64 DecodeTrack ( const QString& strPacketFileName,
+                         const QString& strWavFileName );
+
+    qint64 GetNumPackets() const { return iNumPackets; }
+    qint64 GetNumConcealed() const { return iNumConcealed; }
+    qint64 GetNumDtxSilence() const { return iNumDtxSilence; }
+
+protected:
+    int                                        iServerFrameSizeSamples;
+    qint64                                     iNumPackets;
+    qint64                                     iNumConcealed;
+    qint64                                     iNumDtxSilence;
+    QMap<QString, QList<recorder::STrackItem>> Tracks;
+};
+
+
+/* Prototypes *****************************************************************/
+int RecDecodeMain ( int argc, char** argv );
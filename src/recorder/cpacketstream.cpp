@@ -0,0 +1,114 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QtEndian>
+#include <cstring>
+#include "cpacketstream.h"
+
+using namespace recorder;
+
+
+/* Implementation *************************************************************/
+CPacketWriter::CPacketWriter ( QFile*              pNFile,
+                               const uint16_t      iNNumAudioChannels,
+                               const EAudComprType eNAudioComprType,
+                               const int           iNServerFrameSizeSamples ) :
+    pFile ( pNFile )
+{
+    uchar vecbyHeader[PACKET_STREAM_HEADER_SIZE_BYTES];
+
+    memcpy ( vecbyHeader, "JMPK", 4 );
+    qToLittleEndian<quint16> ( PACKET_STREAM_VERSION,                             vecbyHeader + 4 );
+    qToLittleEndian<quint16> ( iNNumAudioChannels,                                vecbyHeader + 6 );
+    qToLittleEndian<quint16> ( static_cast<quint16> ( eNAudioComprType ),         vecbyHeader + 8 );
+    qToLittleEndian<quint16> ( static_cast<quint16> ( iNServerFrameSizeSamples ), vecbyHeader + 10 );
+
+    pFile->write ( reinterpret_cast<const char*> ( vecbyHeader ), PACKET_STREAM_HEADER_SIZE_BYTES );
+}
+
+void CPacketWriter::AppendPacket ( const uint32_t iSequence,
+                                   const uint32_t iTick,
+                                   const uint8_t* pbyData,
+                                   const int      iNumBytes )
+{
+    uchar vecbyRecord[PACKET_STREAM_RECORD_SIZE_BYTES];
+
+    qToLittleEndian<quint32> ( iSequence,                          vecbyRecord + 0 );
+    qToLittleEndian<quint32> ( iTick,                              vecbyRecord + 4 );
+    qToLittleEndian<quint16> ( static_cast<quint16> ( iNumBytes ), vecbyRecord + 8 );
+
+    // the file is buffered by QFile, the small writes are cheap
+    pFile->write ( reinterpret_cast<const char*> ( vecbyRecord ), PACKET_STREAM_RECORD_SIZE_BYTES );
+    pFile->write ( reinterpret_cast<const char*> ( pbyData ), iNumBytes );
+}
+
+bool CPacketReader::ReadHeader()
+{
+    uchar vecbyHeader[PACKET_STREAM_HEADER_SIZE_BYTES];
+
+    if ( ( pFile->read ( reinterpret_cast<char*> ( vecbyHeader ), PACKET_STREAM_HEADER_SIZE_BYTES ) != PACKET_STREAM_HEADER_SIZE_BYTES ) ||
+         ( memcmp ( vecbyHeader, "JMPK", 4 ) != 0 ) ||
+         ( qFromLittleEndian<quint16> ( vecbyHeader + 4 ) < 1 ) ||
+         ( qFromLittleEndian<quint16> ( vecbyHeader + 4 ) > PACKET_STREAM_VERSION ) )
+    {
+        return false;
+    }
+
+    iNumAudioChannels       = qFromLittleEndian<quint16> ( vecbyHeader + 6 );
+    eAudioComprType         = static_cast<EAudComprType> ( qFromLittleEndian<quint16> ( vecbyHeader + 8 ) );
+    iServerFrameSizeSamples = qFromLittleEndian<quint16> ( vecbyHeader + 10 );
+
+    return ( ( iNumAudioChannels == 1 ) || ( iNumAudioChannels == 2 ) ) &&
+           ( ( eAudioComprType == CT_OPUS ) || ( eAudioComprType == CT_OPUS64 ) ) &&
+           ( iServerFrameSizeSamples > 0 );
+}
+
+bool CPacketReader::ReadPacket ( uint32_t&         iSequence,
+                                 uint32_t&         iTick,
+                                 CVector<uint8_t>& vecbyData,
+                                 int&              iNumBytes )
+{
+    uchar vecbyRecord[PACKET_STREAM_RECORD_SIZE_BYTES];
+
+    if ( pFile->read ( reinterpret_cast<char*> ( vecbyRecord ), PACKET_STREAM_RECORD_SIZE_BYTES ) != PACKET_STREAM_RECORD_SIZE_BYTES )
+    {
+        return false;
+    }
+
+    iSequence = qFromLittleEndian<quint32> ( vecbyRecord + 0 );
+    iTick     = qFromLittleEndian<quint32> ( vecbyRecord + 4 );
+    iNumBytes = qFromLittleEndian<quint16> ( vecbyRecord + 8 );
+
+    if ( iNumBytes == PACKET_STREAM_DTX_SILENCE_BYTES )
+    {
+        return true;
+    }
+
+    if ( vecbyData.Size() < iNumBytes )
+    {
+        vecbyData.Init ( iNumBytes );
+    }
+
+    return pFile->read ( reinterpret_cast<char*> ( &vecbyData[0] ), iNumBytes ) == iNumBytes;
+}
@@ -0,0 +1,111 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Container for the coded packets of one recorded track (coded recording).
+ * The packets are stored as they were played out of the jitter buffer of the
+ * server, they are decoded offline (with packet loss concealment for the
+ * missing sequence numbers). All values are little endian:
+ *
+ *   header:
+ *     char[4]  "JMPK"
+ *     uint16   version
+ *     uint16   number of audio channels
+ *     uint16   audio compression type (CT_OPUS or CT_OPUS64)
+ *     uint16   server frame size in samples
+ *
+ *   record per received packet:
+ *     uint32   sequence number (relative to the first packet of the track)
+ *     uint32   server tick (relative to the start frame of the track)
+ *     uint16   number of coded bytes
+ *     uint8[]  coded bytes
+ *
+ * A record without coded bytes (version 2) marks a frame which the client
+ * suppressed in DTX mode, it is decoded as silence and not concealed.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include "../util.h"
+
+
+/* Definitions ****************************************************************/
+// file name suffix of the coded tracks
+#define PACKET_STREAM_FILE_SUFFIX        "jmpk"
+
+#define PACKET_STREAM_VERSION            2 // 1 is read, too (no DTX records)
+#define PACKET_STREAM_HEADER_SIZE_BYTES  12
+#define PACKET_STREAM_RECORD_SIZE_BYTES  10 // without the coded bytes
+
+// number of coded bytes of a DTX silence record
+#define PACKET_STREAM_DTX_SILENCE_BYTES  0
+
+namespace recorder {
+
+/* Classes ********************************************************************/
+class CPacketWriter
+{
+public:
+    // the file must be open for writing, the header is written immediately
+    CPacketWriter ( QFile*              pNFile,
+                    const uint16_t      iNNumAudioChannels,
+                    const EAudComprType eNAudioComprType,
+                    const int           iNServerFrameSizeSamples );
+
+    void AppendPacket ( const uint32_t iSequence,
+                        const uint32_t iTick,
+                        const uint8_t* pbyData,
+                        const int      iNumBytes );
+
+protected:
+    QFile* pFile;
+};
+
+class CPacketReader
+{
+public:
+    CPacketReader ( QFile* pNFile ) : pFile ( pNFile ), iNumAudioChannels ( 0 ),
+        eAudioComprType ( CT_NONE ), iServerFrameSizeSamples ( 0 ) {}
+
+    // returns false if the file is not a packet stream of a supported version
+    bool ReadHeader();
+
+    // returns false at the end of the file (or for a truncated record), a DTX
+    // silence record has PACKET_STREAM_DTX_SILENCE_BYTES coded bytes
+    bool ReadPacket ( uint32_t&         iSequence,
+                      uint32_t&         iTick,
+                      CVector<uint8_t>& vecbyData,
+                      int&              iNumBytes );
+
+    int           GetNumAudioChannels() const { return iNumAudioChannels; }
+    EAudComprType GetAudioComprType() const { return eAudioComprType; }
+    int           GetServerFrameSizeSamples() const { return iServerFrameSizeSamples; }
+
+protected:
+    QFile*        pFile;
+    int           iNumAudioChannels;
+    EAudComprType eAudioComprType;
+    int           iServerFrameSizeSamples;
+};
+
+}
@@ -0,0 +1,168 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <limits>
+#include "cwavewriter.h"
+
+#ifdef Q_OS_LINUX
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+using namespace recorder;
+
+
+/* Implementation *************************************************************/
+CWaveWriter::CWaveWriter ( QFile* pNFile, const uint16_t iNNumChannels ) :
+    pFile            ( pNFile ),
+    iNumChannels     ( iNNumChannels ),
+    iInitialPos      ( pNFile->pos() ),
+    pBuffer          ( static_cast<char*> ( qMallocAligned ( WAVE_WRITER_BUFFER_SIZE_BYTES, WAVE_WRITER_BUFFER_ALIGNMENT ) ) ),
+    iBufferUsed      ( 0 ),
+    iNumDataBytes    ( 0 ),
+    iAllocatedEndPos ( 0 )
+{
+    WriteHeaders();
+}
+
+CWaveWriter::~CWaveWriter()
+{
+    qFreeAligned ( pBuffer );
+}
+
+void CWaveWriter::WriteHeaders()
+{
+    // same headers as CWaveStream (the chunk sizes are patched in finalise())
+    const FmtSubChunk FmtChunk ( iNumChannels );
+    uchar*            pHeader = reinterpret_cast<uchar*> ( pBuffer );
+
+    qToLittleEndian<quint32> ( HdrRiff::chunkId,           pHeader + 0 );
+    qToLittleEndian<quint32> ( HdrRiff::chunkSize,         pHeader + 4 );
+    qToLittleEndian<quint32> ( HdrRiff::format,            pHeader + 8 );
+    qToLittleEndian<quint32> ( FmtSubChunk::chunkId,       pHeader + 12 );
+    qToLittleEndian<quint32> ( FmtSubChunk::chunkSize,     pHeader + 16 );
+    qToLittleEndian<quint16> ( FmtSubChunk::audioFormat,   pHeader + 20 );
+    qToLittleEndian<quint16> ( FmtChunk.numChannels,       pHeader + 22 );
+    qToLittleEndian<quint32> ( FmtSubChunk::sampleRate,    pHeader + 24 );
+    qToLittleEndian<quint32> ( FmtChunk.byteRate,          pHeader + 28 );
+    qToLittleEndian<quint16> ( FmtChunk.blockAlign,        pHeader + 32 );
+    qToLittleEndian<quint16> ( FmtSubChunk::bitsPerSample, pHeader + 34 );
+    qToLittleEndian<quint32> ( DataSubChunkHdr::chunkId,   pHeader + 36 );
+    qToLittleEndian<quint32> ( DataSubChunkHdr::chunkSize, pHeader + 40 );
+
+    iBufferUsed = WAVE_WRITER_HEADER_SIZE_BYTES;
+}
+
+void CWaveWriter::AppendFrame ( const int16_t* psData, const int iNumSamples )
+{
+    const int iNumBytes = iNumSamples * static_cast<int> ( sizeof ( int16_t ) );
+
+    if ( iBufferUsed + iNumBytes > WAVE_WRITER_BUFFER_SIZE_BYTES )
+    {
+        Flush();
+    }
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy ( pBuffer + iBufferUsed, psData, iNumBytes );
+#else
+    qToLittleEndian<qint16> ( psData, iNumSamples, pBuffer + iBufferUsed );
+#endif
+
+    iBufferUsed   += iNumBytes;
+    iNumDataBytes += iNumBytes;
+}
+
+void CWaveWriter::Flush()
+{
+    if ( iBufferUsed == 0 )
+    {
+        return;
+    }
+
+    Preallocate ( pFile->pos() + iBufferUsed );
+
+    pFile->write ( pBuffer, iBufferUsed );
+    iBufferUsed = 0;
+}
+
+void CWaveWriter::Preallocate ( const qint64 iEndPos )
+{
+#ifdef Q_OS_LINUX
+    if ( iEndPos > iAllocatedEndPos )
+    {
+        // reserve the next chunk without changing the file size (the file
+        // system may not support it, then the file grows with each write)
+        const qint64 iNewAllocatedEndPos = iEndPos + WAVE_WRITER_PREALLOC_SIZE_BYTES;
+
+        if ( fallocate ( pFile->handle(), FALLOC_FL_KEEP_SIZE, iAllocatedEndPos, iNewAllocatedEndPos - iAllocatedEndPos ) == 0 )
+        {
+            iAllocatedEndPos = iNewAllocatedEndPos;
+        }
+        else
+        {
+            iAllocatedEndPos = std::numeric_limits<qint64>::max();
+        }
+    }
+#else
+    Q_UNUSED ( iEndPos )
+#endif
+}
+
+void CWaveWriter::finalise()
+{
+    Flush();
+
+    const qint64   iCurrentPos    = pFile->pos();
+    const uint64_t fileLengthRiff = static_cast<uint64_t> ( iNumDataBytes + WAVE_WRITER_HEADER_SIZE_BYTES - 8 );
+    const uint64_t fileLengthData = static_cast<uint64_t> ( iNumDataBytes );
+
+    // check if lengths are within the range of the WAV file format
+    if ( ( fileLengthRiff < 0x100000000ULL ) && ( fileLengthData < 0x100000000ULL ) )
+    {
+        uchar vecbyLength[4];
+
+        qToLittleEndian<quint32> ( static_cast<quint32> ( fileLengthRiff ), vecbyLength );
+        pFile->seek  ( iInitialPos + 4 );
+        pFile->write ( reinterpret_cast<const char*> ( vecbyLength ), 4 );
+
+        qToLittleEndian<quint32> ( static_cast<quint32> ( fileLengthData ), vecbyLength );
+        pFile->seek  ( iInitialPos + 40 );
+        pFile->write ( reinterpret_cast<const char*> ( vecbyLength ), 4 );
+
+        pFile->seek ( iCurrentPos );
+    }
+
+#ifdef Q_OS_LINUX
+    // release the reserved space behind the end of the file
+    pFile->flush();
+
+    if ( ftruncate ( pFile->handle(), pFile->size() ) != 0 )
+    {
+        qWarning() << "CWaveWriter::finalise(): the reserved space of" << pFile->fileName() << "could not be released";
+    }
+#endif
+}
@@ -0,0 +1,80 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Buffered WAV file writer for the recorder: whole frames are copied in
+ * little endian byte order into a large aligned buffer which is written with
+ * one sequential write when it is full. On Linux the file space is reserved
+ * in large chunks with fallocate so that many concurrent tracks do not
+ * fragment the file system (e.g. on SD cards).
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include "cwavestream.h"
+
+
+/* Definitions ****************************************************************/
+// size of the write buffer (one write per buffer, about 1.4 s of stereo audio)
+#define WAVE_WRITER_BUFFER_SIZE_BYTES   ( 256 * 1024 )
+
+// alignment of the write buffer (page size)
+#define WAVE_WRITER_BUFFER_ALIGNMENT    4096
+
+// the file space is reserved in chunks of this size
+#define WAVE_WRITER_PREALLOC_SIZE_BYTES ( 8 * 1024 * 1024 )
+
+// size of the RIFF, fmt and data headers
+#define WAVE_WRITER_HEADER_SIZE_BYTES   44
+
+namespace recorder {
+
+/* Classes ********************************************************************/
+class CWaveWriter
+{
+public:
+    // the file must be open for writing (and seeking), the headers are
+    // written at the current position
+    CWaveWriter ( QFile* pNFile, const uint16_t iNNumChannels );
+    virtual ~CWaveWriter();
+
+    void AppendFrame ( const int16_t* psData, const int iNumSamples );
+
+    // writes the buffer and patches the chunk sizes in the headers
+    void finalise();
+
+protected:
+    void WriteHeaders();
+    void Flush();
+    void Preallocate ( const qint64 iEndPos );
+
+    QFile*         pFile;
+    const uint16_t iNumChannels;
+    const qint64   iInitialPos;
+    char*          pBuffer;
+    int            iBufferUsed;
+    qint64         iNumDataBytes;
+    qint64         iAllocatedEndPos;
+};
+
+}
@@ -31,7 +31,9 @@ CJamController::CJamController() :
     bEnableRecording     ( false ),
     strRecordingDir      ( "" ),
     pthJamRecorder       ( nullptr ),
-    pJamRecorder         ( nullptr )
+    pJamRecorder         ( nullptr ),
+    iFrameSizeSamples    ( 0 ),
+    bRecordCodedPackets  ( false )
 {
 }
 
@@ -76,7 +78,8 @@ void CJamController::SetEnableRecording  ( bool bNewEnableRecording, bool isRunn
 
 void CJamController::SetRecordingDir ( QString newRecordingDir,
                                        int     iServerFrameSizeSamples,
-                                       bool    bDisableRecording )
+                                       bool    bDisableRecording,
+                                       int     iNumChannels )
 {
     if ( bRecorderInitialised && pthJamRecorder != nullptr )
     {
@@ -90,6 +93,16 @@ void CJamController::SetRecordingDir ( QString newRecordingDir,
         pthJamRecorder = nullptr;
     }
 
+    // the ring is allocated once (the number of channels does not change), the
+    // frames which were not written by the previous recorder are dropped
+    if ( !RecorderRing.IsInitialized() )
+    {
+        RecorderRing.Init ( iNumChannels );
+    }
+
+    RecorderRing.Discard();
+    iFrameSizeSamples = iServerFrameSizeSamples;
+
     if ( !newRecordingDir.isEmpty() )
     {
         if ( pJamRecorder != nullptr )
@@ -99,7 +112,7 @@ void CJamController::SetRecordingDir ( QString newRecordingDir,
             delete pJamRecorder;
             pJamRecorder = nullptr;
         }
-        pJamRecorder = new recorder::CJamRecorder ( newRecordingDir, iServerFrameSizeSamples );
+        pJamRecorder = new recorder::CJamRecorder ( newRecordingDir, iServerFrameSizeSamples, &RecorderRing );
         strRecorderErrMsg = pJamRecorder->Init();
         bRecorderInitialised = ( strRecorderErrMsg == QString::null );
         bEnableRecording = bRecorderInitialised && !bDisableRecording;
@@ -130,6 +143,9 @@ void CJamController::SetRecordingDir ( QString newRecordingDir,
         QObject::connect ( pthJamRecorder, &QThread::finished,
             pJamRecorder, &QObject::deleteLater );
 
+        QObject::connect ( pthJamRecorder, &QThread::started,
+            pJamRecorder, &CJamRecorder::OnThreadStarted );
+
         QObject::connect( QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
             pJamRecorder, &CJamRecorder::OnAboutToQuit,
             Qt::ConnectionType::BlockingQueuedConnection );
@@ -152,10 +168,6 @@ void CJamController::SetRecordingDir ( QString newRecordingDir,
         QObject::connect( this, &CJamController::ClientDisconnected,
             pJamRecorder, &CJamRecorder::OnDisconnected );
 
-        qRegisterMetaType<CVector<int16_t>> ( "CVector<int16_t>" );
-        QObject::connect( this, &CJamController::AudioFrame,
-            pJamRecorder, &CJamRecorder::OnFrame );
-
         // from the recorder to the server
         QObject::connect ( pJamRecorder, &CJamRecorder::RecordingSessionStarted,
             this, &CJamController::RecordingSessionStarted );
@@ -27,6 +27,7 @@
 #include <QObject>
 
 #include "jamrecorder.h"
+#include "recorderring.h"
 
 namespace recorder {
 
@@ -42,9 +43,43 @@ public:
     void RequestNewRecording();
     void SetEnableRecording ( bool bNewEnableRecording, bool isRunning );
     QString GetRecordingDir() { return strRecordingDir; }
-    void SetRecordingDir ( QString newRecordingDir, int iServerFrameSizeSamples, bool bDisableRecording );
+    void SetRecordingDir ( QString newRecordingDir, int iServerFrameSizeSamples, bool bDisableRecording, int iNumChannels );
     ERecorderState GetRecorderState();
 
+    // called by the realtime thread for each channel and tick, the frames are
+    // passed to the recorder thread through the recorder ring
+    void PutFrame ( const int               iChID,
+                    const QString&          strChName,
+                    const CHostAddress&     RecHostAddr,
+                    const int               iNumAudChan,
+                    const CVector<int16_t>& vecsData )
+        { RecorderRing.Put ( iChID, strChName, RecHostAddr, iNumAudChan, vecsData, iNumAudChan * iFrameSizeSamples ); }
+
+    void PutFrame ( const int             iChID,
+                    const QString&        strChName,
+                    const CHostAddress&   RecHostAddr,
+                    const int             iNumAudChan,
+                    const CVector<float>& vecfData )
+        { RecorderRing.Put ( iChID, strChName, RecHostAddr, iNumAudChan, vecfData, iNumAudChan * iFrameSizeSamples ); }
+
+    // coded recording: the coded packets are recorded instead of the PCM
+    // frames (may be called concurrently for different channels)
+    void PutPacket ( const int           iChID,
+                     const QString&      strChName,
+                     const CHostAddress& RecHostAddr,
+                     const int           iNumAudChan,
+                     const EAudComprType eAudioComprType,
+                     const uint8_t*      pbyData,
+                     const int           iNumBytes )
+        { RecorderRing.PutPacket ( iChID, strChName, RecHostAddr, iNumAudChan, eAudioComprType, pbyData, iNumBytes ); }
+
+    void EndTick() { RecorderRing.EndTick(); }
+
+    bool GetRecordCodedPackets() const { return bRecordCodedPackets; }
+    void SetRecordCodedPackets ( const bool bNewRecordCodedPackets ) { bRecordCodedPackets = bNewRecordCodedPackets; }
+
+    int64_t GetNumRecorderOverflows() const { return RecorderRing.GetNumOverflows(); }
+
 private:
     CServer* pServer;
 
@@ -56,6 +91,10 @@ private:
     CJamRecorder* pJamRecorder;
     QString       strRecorderErrMsg;
 
+    CRecorderRing RecorderRing;
+    int           iFrameSizeSamples;
+    bool          bRecordCodedPackets;
+
 signals:
     void RestartRecorder();
     void StopRecorder();
@@ -63,12 +102,6 @@ signals:
     void EndRecorderThread();
     void Stopped();
     void ClientDisconnected ( int iChID );
-    void AudioFrame ( const int              iChID,
-                      const QString          stChName,
-                      const CHostAddress     RecHostAddr,
-                      const int              iNumAudChan,
-                      const CVector<int16_t> vecsData );
-
 };
 
 }
@@ -37,32 +37,55 @@ using namespace recorder;
  * @param name The client's current name
  * @param address IP and Port
  * @param recordBaseDir Session recording directory
+ * @param audioComprType CT_NONE for PCM frames, otherwise the codec of the coded packets
+ * @param iServerFrameSizeSamples The server frame size (stored with the coded packets)
  *
- * Creates a file for the raw PCM data and sets up a QDataStream to which to write received frames.
+ * Creates a file for the raw PCM data and sets up a CWaveWriter to which to write received frames.
  * The data is stored Little Endian.
+ *
+ * For coded packets a packet stream file is created instead, which is decoded offline.
  */
-CJamClient::CJamClient(const qint64 frame, const int _numChannels, const QString name, const CHostAddress address, const QDir recordBaseDir) :
+CJamClient::CJamClient(const qint64 frame, const int _numChannels, const QString name, const CHostAddress address, const QDir recordBaseDir,
+                       const EAudComprType _audioComprType, const int iServerFrameSizeSamples) :
     startFrame (frame),
     numChannels (static_cast<uint16_t>(_numChannels)),
     name (name),
     address (address),
-    out (nullptr)
+    audioComprType (_audioComprType),
+    out (nullptr),
+    packetOut (nullptr)
 {
+    const QString suffix = audioComprType == CT_NONE ? ".wav" : "." PACKET_STREAM_FILE_SUFFIX;
+
     // At this point we may not have much of a name
     QString fileName = ClientName() + "-" + QString::number(frame) + "-" + QString::number(_numChannels);
     QString affix = "";
-    while (recordBaseDir.exists(fileName + affix + ".wav"))
+    while (recordBaseDir.exists(fileName + affix + suffix))
     {
         affix = affix.length() == 0 ? "_1" : "_" + QString::number(affix.remove(0, 1).toInt() + 1);
     }
-    fileName = fileName + affix + ".wav";
+    fileName = fileName + affix + suffix;
 
     wavFile = new QFile(recordBaseDir.absoluteFilePath(fileName));
-    if (!wavFile->open(QFile::OpenMode(QIODevice::OpenModeFlag::ReadWrite))) // need to allow rewriting headers
+
+    if (audioComprType != CT_NONE)
     {
-        throw new std::runtime_error( ("Could not write to WAV file "  + wavFile->fileName()).toStdString() );
+        // the packets are only appended, QFile does the buffering
+        if (!wavFile->open(QFile::WriteOnly))
+        {
+            throw new std::runtime_error( ("Could not write to packet file "  + wavFile->fileName()).toStdString() );
+        }
+        packetOut = new CPacketWriter(wavFile, numChannels, audioComprType, iServerFrameSizeSamples);
+    }
+    else
+    {
+        // need to allow rewriting headers, the writer does its own buffering
+        if (!wavFile->open(QFile::OpenMode(QIODevice::OpenModeFlag::ReadWrite | QIODevice::OpenModeFlag::Unbuffered)))
+        {
+            throw new std::runtime_error( ("Could not write to WAV file "  + wavFile->fileName()).toStdString() );
+        }
+        out = new CWaveWriter(wavFile, numChannels);
     }
-    out = new CWaveStream(wavFile, numChannels);
 
     filename = wavFile->fileName();
 }
@@ -76,12 +99,32 @@ void CJamClient::Frame(const QString _name, const CVector<int16_t>& pcm, int iSe
 {
     name = _name;
 
-    for(int i = 0; i < numChannels * iServerFrameSizeSamples; i++)
+    out->AppendFrame(&pcm[0], numChannels * iServerFrameSizeSamples);
+
+    frameCount++;
+}
+
+/**
+ * @brief CJamClient::Packet Handle a coded packet from a client connected to the server
+ * @param _name The client's current name
+ * @param frame The coded packet with its sequence number
+ * @param trackFrame The server frame in which the packet was played out, relative to the start frame
+ *
+ * The sequence numbers are stored relative to the first packet, the missing ones are concealed when decoding.
+ */
+void CJamClient::Packet(const QString _name, const CRecorderFrame& frame, const qint64 trackFrame)
+{
+    name = _name;
+
+    if (packetCount == 0)
     {
-        *out << pcm[i];
+        firstSequence = frame.iSequence;
     }
 
-    frameCount++;
+    packetOut->AppendPacket(frame.iSequence - firstSequence, static_cast<uint32_t>(trackFrame), &frame.vecbyData[0], frame.iNumBytes);
+
+    packetCount++;
+    frameCount = trackFrame + 1;
 }
 
 /**
@@ -91,11 +134,17 @@ void CJamClient::Disconnect()
 {
     if (out)
     {
-        static_cast<CWaveStream*>(out)->finalise();
+        out->finalise();
         delete out;
         out = nullptr;
     }
 
+    if (packetOut)
+    {
+        delete packetOut;
+        packetOut = nullptr;
+    }
+
     wavFile->close();
 
     delete wavFile;
@@ -109,14 +158,17 @@ void CJamClient::Disconnect()
 /**
  * @brief CJamSession::CJamSession Construct a new jam recording session
  * @param recordBaseDir The recording base directory
+ * @param iNumChannels The number of channels of the recorder ring
  *
  * Each session is stored into its own subdirectory of the recording base directory.
  */
-CJamSession::CJamSession(QDir recordBaseDir) :
+CJamSession::CJamSession(QDir recordBaseDir, int iNumChannels) :
     sessionDir (QDir(recordBaseDir.absoluteFilePath("Jam-" + QDateTime().currentDateTimeUtc().toString("yyyyMMdd-HHmmsszzz")))),
     currentFrame (0),
+    firstTick (-1),
+    hasCodedTracks (false),
     chIdDisconnected (-1),
-    vecptrJamClients (MAX_NUM_CHANNELS),
+    vecptrJamClients (iNumChannels),
     jamClientConnections()
 {
     QFileInfo fi(sessionDir.absolutePath());
@@ -176,19 +228,22 @@ void CJamSession::DisconnectClient(int iChID)
 
 /**
  * @brief CJamSession::Frame Process a frame emitted for a client by the server
- * @param iChID the client channel id
- * @param name the client name
- * @param address the client IP and port number
- * @param numAudioChannels the client number of audio channels
- * @param data the frame data
+ * @param frame the client channel id, name, IP and port number, number of audio channels and the frame data
  *
  * Manages changes that affect how the recording is stored - i.e. if the number of audio channels changes, we need a new file.
  * Files are grouped by IP and port number, so if either of those change for a connection, we also start a new file.
  *
- * Also manages the overall current frame counter for the session.
+ * Also manages the overall current frame counter for the session. For coded packets (a client may have none, one or
+ * two packets per server frame) the current frame is taken from the server tick.
  */
-void CJamSession::Frame(const int iChID, const QString name, const CHostAddress address, const int numAudioChannels, const CVector<int16_t> data, int iServerFrameSizeSamples)
+void CJamSession::Frame(const CRecorderFrame& frame, int iServerFrameSizeSamples)
 {
+    const int           iChID            = frame.iChID;
+    const QString&      name             = frame.strName;
+    const CHostAddress& address          = frame.Address;
+    const int           numAudioChannels = frame.iNumAudioChannels;
+    const bool          isCoded          = frame.eAudioComprType != CT_NONE;
+
     if ( iChID == chIdDisconnected )
     {
         // DisconnectClient has just been called for this channel - this frame is "too late"
@@ -196,12 +251,23 @@ void CJamSession::Frame(const int iChID, const QString name, const CHostAddress
         return;
     }
 
+    if (isCoded)
+    {
+        if (firstTick < 0)
+        {
+            firstTick = frame.iTick;
+        }
+        currentFrame = frame.iTick - firstTick;
+        hasCodedTracks = true;
+    }
+
     if (vecptrJamClients[iChID] == nullptr)
     {
         // then we have not seen this client this session
-        vecptrJamClients[iChID] = new CJamClient(currentFrame, numAudioChannels, name, address, sessionDir);
+        vecptrJamClients[iChID] = new CJamClient(currentFrame, numAudioChannels, name, address, sessionDir, frame.eAudioComprType, iServerFrameSizeSamples);
     }
     else if (numAudioChannels != vecptrJamClients[iChID]->NumAudioChannels()
+             || frame.eAudioComprType != vecptrJamClients[iChID]->AudioComprType()
              || address.InetAddr != vecptrJamClients[iChID]->ClientAddress().InetAddr
              || address.iPort != vecptrJamClients[iChID]->ClientAddress().iPort)
     {
@@ -212,7 +278,7 @@ void CJamSession::Frame(const int iChID, const QString name, const CHostAddress
         }
         else
         {
-            vecptrJamClients[iChID] = new CJamClient(currentFrame, numAudioChannels, name, address, sessionDir);
+            vecptrJamClients[iChID] = new CJamClient(currentFrame, numAudioChannels, name, address, sessionDir, frame.eAudioComprType, iServerFrameSizeSamples);
         }
     }
 
@@ -222,7 +288,13 @@ void CJamSession::Frame(const int iChID, const QString name, const CHostAddress
         return;
     }
 
-    vecptrJamClients[iChID]->Frame(name, data, iServerFrameSizeSamples);
+    if (isCoded)
+    {
+        vecptrJamClients[iChID]->Packet(name, frame, currentFrame - vecptrJamClients[iChID]->StartFrame());
+        return;
+    }
+
+    vecptrJamClients[iChID]->Frame(name, frame.vecsData, iServerFrameSizeSamples);
 
     // If _any_ connected client frame steps past currentFrame, increase currentFrame
     if (vecptrJamClients[iChID]->StartFrame() + vecptrJamClients[iChID]->FrameCount() > currentFrame)
@@ -363,7 +435,7 @@ void CJamRecorder::Start() {
     // needs to be after OnEnd() as that also locks
     ChIdMutex.lock();
     {
-        currentSession = new CJamSession( recordBaseDir );
+        currentSession = new CJamSession( recordBaseDir, pRecorderRing->GetNumChannels() );
         isRecording = true;
     }
     ChIdMutex.unlock();
@@ -377,6 +449,12 @@ void CJamRecorder::Start() {
  */
 void CJamRecorder::OnEnd()
 {
+    // write the frames which are still in the ring
+    if ( isRecording )
+    {
+        DrainRing();
+    }
+
     ChIdMutex.lock(); // iChId used in currentSession->End()
     {
         if ( isRecording )
@@ -384,8 +462,16 @@ void CJamRecorder::OnEnd()
             isRecording = false;
             currentSession->End();
 
-            ReaperProjectFromCurrentSession();
-            AudacityLofFromCurrentSession();
+            if ( currentSession->HasCodedTracks() )
+            {
+                // the WAV files and with them the project files are created by the offline decoder
+                qInfo() << "Session recorded as coded packets, decode it with jamulus-recdecode:" << currentSession->SessionDir().path();
+            }
+            else
+            {
+                ReaperProjectFromCurrentSession();
+                AudacityLofFromCurrentSession();
+            }
 
             delete currentSession;
             currentSession = nullptr;
@@ -419,12 +505,25 @@ void CJamRecorder::OnAboutToQuit()
 
 void CJamRecorder::ReaperProjectFromCurrentSession()
 {
-    QString reaperProjectFileName = currentSession->SessionDir().filePath(currentSession->Name().append(".rpp"));
+    ReaperProjectFromTracks(currentSession->SessionDir().filePath(currentSession->Name().append(".rpp")),
+                            currentSession->Tracks(),
+                            iServerFrameSizeSamples);
+}
+
+void CJamRecorder::AudacityLofFromCurrentSession()
+{
+    AudacityLofFromTracks(currentSession->SessionDir().filePath(currentSession->Name().append(".lof")),
+                          currentSession->Tracks(),
+                          iServerFrameSizeSamples);
+}
+
+void CJamRecorder::ReaperProjectFromTracks(const QString& reaperProjectFileName, const QMap<QString, QList<STrackItem>>& tracks, int serverFrameSizeSamples)
+{
     const QFileInfo fi(reaperProjectFileName);
 
     if (fi.exists())
     {
-        qWarning() << "CJamRecorder::ReaperProjectFromCurrentSession():" << fi.absolutePath() << "exists and will not be overwritten.";
+        qWarning() << "CJamRecorder::ReaperProjectFromTracks():" << fi.absolutePath() << "exists and will not be overwritten.";
     }
     else
     {
@@ -432,24 +531,23 @@ void CJamRecorder::ReaperProjectFromCurrentSession()
         if ( outf.open(QFile::WriteOnly) )
         {
             QTextStream out(&outf);
-            out << CReaperProject( currentSession->Tracks(), iServerFrameSizeSamples ).toString() << endl;
+            out << CReaperProject( tracks, serverFrameSizeSamples ).toString() << endl;
             qDebug() << "Session RPP:" << reaperProjectFileName;
         }
         else
         {
-            qWarning() << "CJamRecorder::ReaperProjectFromCurrentSession():" << fi.absolutePath() << "could not be created, no RPP written.";
+            qWarning() << "CJamRecorder::ReaperProjectFromTracks():" << fi.absolutePath() << "could not be created, no RPP written.";
         }
     }
 }
 
-void CJamRecorder::AudacityLofFromCurrentSession()
+void CJamRecorder::AudacityLofFromTracks(const QString& audacityLofFileName, const QMap<QString, QList<STrackItem>>& tracks, int serverFrameSizeSamples)
 {
-    QString audacityLofFileName = currentSession->SessionDir().filePath(currentSession->Name().append(".lof"));
     const QFileInfo fi(audacityLofFileName);
 
     if (fi.exists())
     {
-        qWarning() << "CJamRecorder::AudacityLofFromCurrentSession():" << fi.absolutePath() << "exists and will not be overwritten.";
+        qWarning() << "CJamRecorder::AudacityLofFromTracks():" << fi.absolutePath() << "exists and will not be overwritten.";
     }
     else
     {
@@ -458,12 +556,12 @@ void CJamRecorder::AudacityLofFromCurrentSession()
         {
             QTextStream sOut(&outf);
 
-            foreach ( auto trackName, currentSession->Tracks().keys() )
+            foreach ( auto trackName, tracks.keys() )
             {
-                foreach ( auto item, currentSession->Tracks()[trackName] ) {
+                foreach ( auto item, tracks[trackName] ) {
                     QFileInfo fi ( item.fileName );
                     sOut << "file " << '"' << fi.fileName() << '"';
-                    sOut << " offset " << secondsAt48K( item.startFrame, iServerFrameSizeSamples ) << endl;
+                    sOut << " offset " << secondsAt48K( item.startFrame, serverFrameSizeSamples ) << endl;
                 }
             }
 
@@ -472,7 +570,7 @@ void CJamRecorder::AudacityLofFromCurrentSession()
         }
         else
         {
-            qWarning() << "CJamRecorder::AudacityLofFromCurrentSession():" << fi.absolutePath() << "could not be created, no LOF written.";
+            qWarning() << "CJamRecorder::AudacityLofFromTracks():" << fi.absolutePath() << "could not be created, no LOF written.";
         }
     }
 }
@@ -514,6 +612,9 @@ void CJamRecorder::SessionDirToReaper(QString& strSessionDirName, int serverFram
  */
 void CJamRecorder::OnDisconnected(int iChID)
 {
+    // the frames of the channel before the disconnection must be written first
+    DrainRing();
+
     ChIdMutex.lock();
     {
         if ( !isRecording )
@@ -533,15 +634,11 @@ void CJamRecorder::OnDisconnected(int iChID)
 
 /**
  * @brief CJamRecorder::OnFrame Handle a frame emitted for a client by the server
- * @param iChID the client channel id
- * @param name the client name
- * @param address the client IP and port number
- * @param numAudioChannels the client number of audio channels
- * @param data the frame data
+ * @param frame the client channel id, name, IP and port number, number of audio channels and the frame data (PCM or coded packet)
  *
  * Ensures recording has started.
  */
-void CJamRecorder::OnFrame(const int iChID, const QString name, const CHostAddress address, const int numAudioChannels, const CVector<int16_t> data)
+void CJamRecorder::OnFrame(const CRecorderFrame& frame)
 {
     // Make sure we are ready
     if ( !isRecording )
@@ -552,7 +649,25 @@ void CJamRecorder::OnFrame(const int iChID, const QString name, const CHostAddre
     // needs to be after Start() as that also locks
     ChIdMutex.lock();
     {
-        currentSession->Frame ( iChID, name, address, numAudioChannels, data, iServerFrameSizeSamples );
+        currentSession->Frame ( frame, iServerFrameSizeSamples );
     }
     ChIdMutex.unlock();
 }
+
+/**
+ * @brief CJamRecorder::DrainRing Process all frames which the realtime thread put in the recorder ring
+ *
+ * Reports when frames were dropped because the ring was full.
+ */
+void CJamRecorder::DrainRing()
+{
+    pRecorderRing->Drain ( [this] ( const CRecorderFrame& frame ) { OnFrame ( frame ); } );
+
+    const int64_t iNewNumOverflows = pRecorderRing->GetNumOverflows();
+
+    if ( iNewNumOverflows != iNumOverflows )
+    {
+        qWarning() << "CJamRecorder::DrainRing:" << iNewNumOverflows - iNumOverflows << "frames dropped (recorder ring full)";
+        iNumOverflows = iNewNumOverflows;
+    }
+}
@@ -28,12 +28,16 @@
 #include <QFile>
 #include <QDateTime>
 #include <QMutex>
+#include <QTimer>
 
 #include "../util.h"
 #include "../channel.h"
 
 #include "creaperproject.h"
 #include "cwavestream.h"
+#include "cwavewriter.h"
+#include "cpacketstream.h"
+#include "recorderring.h"
 
 namespace recorder {
 
@@ -70,15 +74,19 @@ class CJamClient : public QObject
     Q_OBJECT
 
 public:
-    CJamClient(const qint64 frame, const int numChannels, const QString name, const CHostAddress address, const QDir recordBaseDir);
+    CJamClient(const qint64 frame, const int numChannels, const QString name, const CHostAddress address, const QDir recordBaseDir,
+               const EAudComprType audioComprType, const int iServerFrameSizeSamples);
 
     void Frame(const QString name, const CVector<int16_t>& pcm, int iServerFrameSizeSamples);
 
+    void Packet(const QString name, const CRecorderFrame& frame, const qint64 trackFrame);
+
     void Disconnect();
 
     qint64       StartFrame()       { return startFrame; }
     qint64       FrameCount()       { return frameCount; }
     uint16_t     NumAudioChannels() { return numChannels; }
+    EAudComprType AudioComprType()   { return audioComprType; }
     QString      ClientName()       { return name.leftJustified(4, '_', false).replace(QRegExp("[-.:/\\ ]"), "_")
                                                 .append("-")
                                                 .append(address.toString(CHostAddress::EStringMode::SM_IP_NO_LAST_BYTE_PORT).replace(QRegExp("[-.:/\\ ]"), "_"))
@@ -89,15 +97,19 @@ public:
     QString      FileName()         { return filename; }
 
 private:
-    const qint64       startFrame;
-    const uint16_t     numChannels;
-          QString      name;
-    const CHostAddress address;
-
-          QString      filename;
-          QFile*       wavFile;
-          QDataStream* out;
-          qint64       frameCount = 0;
+    const qint64        startFrame;
+    const uint16_t      numChannels;
+          QString       name;
+    const CHostAddress  address;
+    const EAudComprType audioComprType; // CT_NONE: PCM recorded to WAV
+
+          QString        filename;
+          QFile*         wavFile;
+          CWaveWriter*   out;
+          CPacketWriter* packetOut;
+          uint32_t       firstSequence = 0;
+          qint64         packetCount = 0;
+          qint64         frameCount = 0;
 };
 
 class CJamSession : public QObject
@@ -106,11 +118,11 @@ class CJamSession : public QObject
 
 public:
 
-    CJamSession(QDir recordBaseDir);
+    CJamSession(QDir recordBaseDir, int iNumChannels);
 
     virtual ~CJamSession();
 
-    void Frame(const int iChID, const QString name, const CHostAddress address, const int numAudioChannels, const CVector<int16_t> data, int iServerFrameSizeSamples);
+    void Frame(const CRecorderFrame& frame, int iServerFrameSizeSamples);
 
     void End();
 
@@ -122,6 +134,8 @@ public:
 
     const QDir SessionDir() { return sessionDir; }
 
+    bool HasCodedTracks() { return hasCodedTracks; }
+
     void DisconnectClient(int iChID);
 
     static QMap<QString, QList<STrackItem>> TracksFromSessionDir(const QString& name, int iServerFrameSizeSamples);
@@ -132,6 +146,8 @@ private:
     const QDir sessionDir;
 
     qint64 currentFrame;
+    qint64 firstTick;
+    bool hasCodedTracks;
     int chIdDisconnected;
     QVector<CJamClient*> vecptrJamClients;
     QList<CJamClientConnection*> jamClientConnections;
@@ -142,12 +158,17 @@ class CJamRecorder : public QObject
     Q_OBJECT
 
 public:
-    CJamRecorder ( const QString strRecordingBaseDir,
-                   const int     iServerFrameSizeSamples ) :
+    CJamRecorder ( const QString  strRecordingBaseDir,
+                   const int      iServerFrameSizeSamples,
+                   CRecorderRing* pRecorderRing ) :
         recordBaseDir           ( strRecordingBaseDir ),
         iServerFrameSizeSamples ( iServerFrameSizeSamples ),
-        isRecording             ( false )
+        isRecording             ( false ),
+        pRecorderRing           ( pRecorderRing ),
+        pDrainTimer             ( new QTimer ( this ) ),
+        iNumOverflows           ( pRecorderRing->GetNumOverflows() )
     {
+        QObject::connect ( pDrainTimer, &QTimer::timeout, this, &CJamRecorder::OnDrainTimer );
     }
 
     /**
@@ -163,10 +184,27 @@ public:
      */
     static void SessionDirToReaper( QString& strSessionDirName, int serverFrameSizeSamples );
 
+    /**
+     * @brief ReaperProjectFromTracks Write the RPP file of a session
+     * @param reaperProjectFileName The RPP file, it is not overwritten
+     * @param tracks Map of track name to the items of the track
+     * @param serverFrameSizeSamples What the server frame size was for the session
+     */
+    static void ReaperProjectFromTracks( const QString& reaperProjectFileName, const QMap<QString, QList<STrackItem>>& tracks, int serverFrameSizeSamples );
+
+    /**
+     * @brief AudacityLofFromTracks Write the LOF file of a session
+     * @param audacityLofFileName The LOF file, it is not overwritten
+     * @param tracks Map of track name to the items of the track
+     * @param serverFrameSizeSamples What the server frame size was for the session
+     */
+    static void AudacityLofFromTracks( const QString& audacityLofFileName, const QMap<QString, QList<STrackItem>>& tracks, int serverFrameSizeSamples );
+
 private:
     void Start();
     void ReaperProjectFromCurrentSession();
     void AudacityLofFromCurrentSession();
+    void DrainRing();
 
     QDir         recordBaseDir;
     int          iServerFrameSizeSamples;
@@ -174,6 +212,10 @@ private:
     CJamSession* currentSession;
     QMutex       ChIdMutex;
 
+    CRecorderRing* pRecorderRing;
+    QTimer*        pDrainTimer;
+    int64_t        iNumOverflows;
+
 signals:
     void RecordingSessionStarted ( QString sessionDir );
 
@@ -200,9 +242,19 @@ public slots:
     void OnDisconnected ( int iChID );
 
     /**
-     * @brief Handle a frame of data to process
+     * @brief Start draining the recorder ring in the recorder thread
+     */
+    void OnThreadStarted() { pDrainTimer->start ( RECORDER_RING_DRAIN_INTERVAL_MS ); }
+
+    /**
+     * @brief Process the frames in the recorder ring
+     */
+    void OnDrainTimer() { DrainRing(); }
+
+    /**
+     * @brief Handle a frame of data (PCM or coded packet) to process
      */
-    void OnFrame ( const int iChID, const QString name, const CHostAddress address, const int numAudioChannels, const CVector<int16_t> data );
+    void OnFrame ( const CRecorderFrame& frame );
 };
 
 }
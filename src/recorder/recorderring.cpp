@@ -0,0 +1,293 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <algorithm>
+#include "recorderring.h"
+
+using namespace recorder;
+
+
+/* Implementation *************************************************************/
+void CRecorderRing::Init ( const int iNewNumChannels )
+{
+    delete[] pChannels;
+
+    pChannels    = new CChannelRing[iNewNumChannels];
+    iNumChannels = iNewNumChannels;
+
+    for ( int i = 0; i < iNumChannels; i++ )
+    {
+        pChannels[i].vecsData.Init                ( RECORDER_RING_NUM_FRAMES * RECORDER_RING_SLOT_SIZE );
+        pChannels[i].vecbyCodedData.Init          ( RECORDER_RING_NUM_FRAMES * RECORDER_RING_CODED_SLOT_SIZE );
+        pChannels[i].veciTick.Init                ( RECORDER_RING_NUM_FRAMES );
+        pChannels[i].veciNumAudioChannels.Init    ( RECORDER_RING_NUM_FRAMES );
+        pChannels[i].veciNumSamples.Init          ( RECORDER_RING_NUM_FRAMES );
+        pChannels[i].veciAudioComprType.Init      ( RECORDER_RING_NUM_FRAMES );
+        pChannels[i].veciSequence.Init            ( RECORDER_RING_NUM_FRAMES );
+        pChannels[i].veciMetaGen.Init             ( RECORDER_RING_NUM_FRAMES );
+        pChannels[i].ConsumerFrame.vecsData.Init  ( RECORDER_RING_SLOT_SIZE );
+        pChannels[i].ConsumerFrame.vecbyData.Init ( RECORDER_RING_CODED_SLOT_SIZE );
+        pChannels[i].ConsumerFrame.iChID          = i;
+    }
+}
+
+int CRecorderRing::BeginPut ( const int           iChID,
+                              const QString&      strName,
+                              const CHostAddress& Address )
+{
+    if ( ( iChID < 0 ) || ( iChID >= iNumChannels ) )
+    {
+        return INVALID_INDEX;
+    }
+
+    CChannelRing& Ring      = pChannels[iChID];
+    const int64_t iWriteCnt = Ring.iWriteCnt.load ( std::memory_order_relaxed );
+
+    if ( iWriteCnt - Ring.iReadCnt.load ( std::memory_order_acquire ) >= RECORDER_RING_NUM_FRAMES )
+    {
+        // the recorder thread does not keep up
+        Ring.iNumOverflows.fetch_add ( 1, std::memory_order_relaxed );
+        return INVALID_INDEX;
+    }
+
+    // the metadata is only passed if it changes (only the producer writes the
+    // shared copy, therefore it can be compared without the mutex)
+    if ( ( strName != Ring.strSharedName ) || !( Address == Ring.SharedAddress ) )
+    {
+        QMutexLocker locker ( &Ring.MetaMutex );
+
+        Ring.strSharedName = strName;
+        Ring.SharedAddress = Address;
+        Ring.iSharedMetaGen++;
+    }
+
+    const int iSlot = static_cast<int> ( iWriteCnt % RECORDER_RING_NUM_FRAMES );
+
+    Ring.veciTick[iSlot]    = iCurTick;
+    Ring.veciMetaGen[iSlot] = Ring.iSharedMetaGen;
+
+    return iSlot;
+}
+
+bool CRecorderRing::Put ( const int               iChID,
+                          const QString&          strName,
+                          const CHostAddress&     Address,
+                          const int               iNumAudioChannels,
+                          const CVector<int16_t>& vecsData,
+                          const int               iNumSamples )
+{
+    const int iSlot = BeginPut ( iChID, strName, Address );
+
+    if ( iSlot == INVALID_INDEX )
+    {
+        return false;
+    }
+
+    CChannelRing& Ring            = pChannels[iChID];
+    const int     iNumCopySamples = std::min ( iNumSamples, static_cast<int> ( RECORDER_RING_SLOT_SIZE ) );
+
+    std::copy ( vecsData.begin(), vecsData.begin() + iNumCopySamples,
+                Ring.vecsData.begin() + iSlot * RECORDER_RING_SLOT_SIZE );
+
+    Ring.veciNumAudioChannels[iSlot] = iNumAudioChannels;
+    Ring.veciNumSamples[iSlot]       = iNumCopySamples;
+    Ring.veciAudioComprType[iSlot]   = CT_NONE;
+
+    Ring.iWriteCnt.store ( Ring.iWriteCnt.load ( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+    return true;
+}
+
+bool CRecorderRing::Put ( const int             iChID,
+                          const QString&        strName,
+                          const CHostAddress&   Address,
+                          const int             iNumAudioChannels,
+                          const CVector<float>& vecfData,
+                          const int             iNumSamples )
+{
+    const int iSlot = BeginPut ( iChID, strName, Address );
+
+    if ( iSlot == INVALID_INDEX )
+    {
+        return false;
+    }
+
+    CChannelRing& Ring            = pChannels[iChID];
+    const int     iNumCopySamples = std::min ( iNumSamples, static_cast<int> ( RECORDER_RING_SLOT_SIZE ) );
+    int16_t*      psSlot          = &Ring.vecsData[iSlot * RECORDER_RING_SLOT_SIZE];
+
+    for ( int i = 0; i < iNumCopySamples; i++ )
+    {
+        psSlot[i] = Float2Short ( vecfData[i] * _MAXSHORT );
+    }
+
+    Ring.veciNumAudioChannels[iSlot] = iNumAudioChannels;
+    Ring.veciNumSamples[iSlot]       = iNumCopySamples;
+    Ring.veciAudioComprType[iSlot]   = CT_NONE;
+
+    Ring.iWriteCnt.store ( Ring.iWriteCnt.load ( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+    return true;
+}
+
+bool CRecorderRing::PutPacket ( const int           iChID,
+                                const QString&      strName,
+                                const CHostAddress& Address,
+                                const int           iNumAudioChannels,
+                                const EAudComprType eAudioComprType,
+                                const uint8_t*      pbyData,
+                                const int           iNumBytes )
+{
+    if ( ( iChID < 0 ) || ( iChID >= iNumChannels ) )
+    {
+        return false;
+    }
+
+    // a dropped packet is also counted so that it is concealed when decoding
+    const uint32_t iSequence   = pChannels[iChID].iSequence++;
+    const bool     bDtxSilence = ( iNumBytes == PACKET_STREAM_DTX_SILENCE_BYTES );
+
+    if ( !bDtxSilence && ( ( pbyData == nullptr ) || ( iNumBytes < 0 ) || ( iNumBytes > RECORDER_RING_CODED_SLOT_SIZE ) ) )
+    {
+        return true;
+    }
+
+    const int iSlot = BeginPut ( iChID, strName, Address );
+
+    if ( iSlot == INVALID_INDEX )
+    {
+        return false;
+    }
+
+    CChannelRing& Ring = pChannels[iChID];
+
+    if ( !bDtxSilence )
+    {
+        std::copy ( pbyData, pbyData + iNumBytes,
+                    Ring.vecbyCodedData.begin() + iSlot * RECORDER_RING_CODED_SLOT_SIZE );
+    }
+
+    Ring.veciNumAudioChannels[iSlot] = iNumAudioChannels;
+    Ring.veciNumSamples[iSlot]       = iNumBytes;
+    Ring.veciAudioComprType[iSlot]   = eAudioComprType;
+    Ring.veciSequence[iSlot]         = iSequence;
+
+    Ring.iWriteCnt.store ( Ring.iWriteCnt.load ( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+    return true;
+}
+
+void CRecorderRing::Drain ( const CConsumer& Consumer )
+{
+    const qint64 iLastTick = iPublishedTick.load ( std::memory_order_acquire );
+
+    for ( ; iNextDrainTick < iLastTick; iNextDrainTick++ )
+    {
+        bool bAnyPending = false;
+
+        // the channels are processed in the same order as the producer wrote
+        // them within a tick (with coded packets a channel may have more than
+        // one packet per tick)
+        for ( int iChID = 0; iChID < iNumChannels; iChID++ )
+        {
+            CChannelRing&   Ring     = pChannels[iChID];
+            CRecorderFrame& Frame    = Ring.ConsumerFrame;
+            int64_t         iReadCnt = Ring.iReadCnt.load ( std::memory_order_relaxed );
+
+            while ( iReadCnt != Ring.iWriteCnt.load ( std::memory_order_acquire ) )
+            {
+                bAnyPending     = true;
+                const int iSlot = static_cast<int> ( iReadCnt % RECORDER_RING_NUM_FRAMES );
+
+                if ( Ring.veciTick[iSlot] > iNextDrainTick )
+                {
+                    break;
+                }
+
+                if ( Ring.veciMetaGen[iSlot] != Ring.iConsumerMetaGen )
+                {
+                    QMutexLocker locker ( &Ring.MetaMutex );
+
+                    Frame.strName         = Ring.strSharedName;
+                    Frame.Address         = Ring.SharedAddress;
+                    Ring.iConsumerMetaGen = Ring.veciMetaGen[iSlot];
+                }
+
+                Frame.iNumAudioChannels = Ring.veciNumAudioChannels[iSlot];
+                Frame.eAudioComprType   = static_cast<EAudComprType> ( Ring.veciAudioComprType[iSlot] );
+                Frame.iTick             = Ring.veciTick[iSlot];
+
+                if ( Frame.eAudioComprType == CT_NONE )
+                {
+                    std::copy ( Ring.vecsData.begin() + iSlot * RECORDER_RING_SLOT_SIZE,
+                                Ring.vecsData.begin() + iSlot * RECORDER_RING_SLOT_SIZE + Ring.veciNumSamples[iSlot],
+                                Frame.vecsData.begin() );
+                }
+                else
+                {
+                    std::copy ( Ring.vecbyCodedData.begin() + iSlot * RECORDER_RING_CODED_SLOT_SIZE,
+                                Ring.vecbyCodedData.begin() + iSlot * RECORDER_RING_CODED_SLOT_SIZE + Ring.veciNumSamples[iSlot],
+                                Frame.vecbyData.begin() );
+
+                    Frame.iNumBytes = Ring.veciNumSamples[iSlot];
+                    Frame.iSequence = Ring.veciSequence[iSlot];
+                }
+
+                Consumer ( Frame );
+
+                Ring.iReadCnt.store ( ++iReadCnt, std::memory_order_release );
+            }
+        }
+
+        // skip the ticks without recorded frames
+        if ( !bAnyPending )
+        {
+            iNextDrainTick = iLastTick;
+            break;
+        }
+    }
+}
+
+void CRecorderRing::Discard()
+{
+    iNextDrainTick = iPublishedTick.load ( std::memory_order_acquire );
+
+    for ( int i = 0; i < iNumChannels; i++ )
+    {
+        pChannels[i].iReadCnt.store ( pChannels[i].iWriteCnt.load ( std::memory_order_acquire ),
+                                      std::memory_order_release );
+    }
+}
+
+int64_t CRecorderRing::GetNumOverflows() const
+{
+    int64_t iNumOverflows = 0;
+
+    for ( int i = 0; i < iNumChannels; i++ )
+    {
+        iNumOverflows += pChannels[i].iNumOverflows.load ( std::memory_order_relaxed );
+    }
+
+    return iNumOverflows;
+}
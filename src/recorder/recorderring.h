@@ -0,0 +1,183 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Per channel single producer single consumer PCM rings between the realtime
+ * thread (server timer or client audio callback) and the recorder thread. The
+ * frames are copied into preallocated slots, no memory is allocated and no
+ * event is posted per frame. The recorder drains the rings in blocks in the
+ * tick order of the producer. The channel name and address are only passed
+ * (under a mutex) when they change. Instead of the PCM frames the coded
+ * packets can be passed (coded recording), each packet is stamped with a per
+ * channel sequence number which also counts the lost packets.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include "../global.h"
+#include "../util.h"
+#include "cpacketstream.h"
+
+
+/* Definitions ****************************************************************/
+// number of frames per channel ring (64 frames are 85 ms with 64 samples
+// frame size and 170 ms with 128 samples)
+#define RECORDER_RING_NUM_FRAMES        64
+
+// each slot can hold a stereo frame of the largest frame size
+#define RECORDER_RING_SLOT_SIZE         ( 2 /* stereo */ * DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES )
+
+// each slot can hold a coded packet of the largest size (stereo, high quality
+// and 128 samples frame size are 165 bytes)
+#define RECORDER_RING_CODED_SLOT_SIZE   256
+
+// interval in which the recorder thread drains the rings
+#define RECORDER_RING_DRAIN_INTERVAL_MS 10
+
+namespace recorder {
+
+/* Classes ********************************************************************/
+// one frame of a channel as it is passed to the consumer
+class CRecorderFrame
+{
+public:
+    CRecorderFrame() : iChID ( INVALID_INDEX ), iNumAudioChannels ( 0 ), eAudioComprType ( CT_NONE ),
+        iNumBytes ( 0 ), iSequence ( 0 ), iTick ( 0 ) {}
+
+    int              iChID;
+    QString          strName;
+    CHostAddress     Address;
+    int              iNumAudioChannels;
+    EAudComprType    eAudioComprType; // CT_NONE: PCM frame, otherwise coded packet
+    CVector<int16_t> vecsData;        // PCM frame
+    CVector<uint8_t> vecbyData;       // coded packet
+    int              iNumBytes;
+    uint32_t         iSequence;       // of the coded packet
+    qint64           iTick;
+};
+
+class CRecorderRing
+{
+public:
+    // the consumer is called for each frame in the tick order of the producer
+    typedef std::function<void ( const CRecorderFrame& Frame )> CConsumer;
+
+    CRecorderRing() : pChannels ( nullptr ), iNumChannels ( 0 ), iCurTick ( 0 ), iPublishedTick ( 0 ), iNextDrainTick ( 0 ) {}
+    virtual ~CRecorderRing() { delete[] pChannels; }
+
+    // allocates the rings, must not be called while a producer is running
+    void Init ( const int iNewNumChannels );
+    bool IsInitialized() const { return iNumChannels > 0; }
+    int  GetNumChannels() const { return iNumChannels; }
+
+    // producer ----------------------------------------------------------------
+    // returns false if the ring of the channel is full (the frame is dropped)
+    bool Put ( const int               iChID,
+               const QString&          strName,
+               const CHostAddress&     Address,
+               const int               iNumAudioChannels,
+               const CVector<int16_t>& vecsData,
+               const int               iNumSamples );
+
+    // float samples in the range -1 to 1 are converted to int16 when copied
+    bool Put ( const int             iChID,
+               const QString&        strName,
+               const CHostAddress&   Address,
+               const int             iNumAudioChannels,
+               const CVector<float>& vecfData,
+               const int             iNumSamples );
+
+    // the coded packets of different channels may be put concurrently, a
+    // lost packet (null pointer) only increases the sequence number, a frame
+    // suppressed by DTX is put with PACKET_STREAM_DTX_SILENCE_BYTES (no data)
+    // and recorded as silence marker
+    bool PutPacket ( const int           iChID,
+                     const QString&      strName,
+                     const CHostAddress& Address,
+                     const int           iNumAudioChannels,
+                     const EAudComprType eAudioComprType,
+                     const uint8_t*      pbyData,
+                     const int           iNumBytes );
+
+    // makes the frames of the current tick available to the consumer
+    void EndTick() { iPublishedTick.store ( ++iCurTick, std::memory_order_release ); }
+
+    // consumer ----------------------------------------------------------------
+    void Drain ( const CConsumer& Consumer );
+
+    // drops all pending frames (only if no consumer is running)
+    void Discard();
+
+    // any thread --------------------------------------------------------------
+    int64_t GetNumOverflows() const;
+
+protected:
+    class CChannelRing
+    {
+    public:
+        CChannelRing() : iWriteCnt ( 0 ), iReadCnt ( 0 ), iNumOverflows ( 0 ),
+            iSharedMetaGen ( 0 ), iConsumerMetaGen ( 0 ), iSequence ( 0 ) {}
+
+        // slots (written by the producer before the write counter is increased)
+        CVector<int16_t>     vecsData;
+        CVector<uint8_t>     vecbyCodedData;
+        CVector<qint64>      veciTick;
+        CVector<int>         veciNumAudioChannels;
+        CVector<int>         veciNumSamples; // number of bytes for coded packets
+        CVector<int>         veciAudioComprType;
+        CVector<uint32_t>    veciSequence;
+        CVector<int>         veciMetaGen;
+
+        std::atomic<int64_t> iWriteCnt;
+        std::atomic<int64_t> iReadCnt;
+        std::atomic<int64_t> iNumOverflows;
+
+        // metadata: the shared copy is only written by the producer (under
+        // the mutex), the consumer copies it if the generation changes
+        QMutex               MetaMutex;
+        QString              strSharedName;
+        CHostAddress         SharedAddress;
+        int                  iSharedMetaGen;
+
+        int                  iConsumerMetaGen;
+        CRecorderFrame       ConsumerFrame;
+
+        uint32_t             iSequence; // producer only
+    };
+
+    // returns the slot to be written or INVALID_INDEX if the ring is full
+    int BeginPut ( const int           iChID,
+                   const QString&      strName,
+                   const CHostAddress& Address );
+
+    CChannelRing*        pChannels; // not copyable (atomics and mutex)
+    int                  iNumChannels;
+    qint64               iCurTick;       // producer only
+    std::atomic<qint64>  iPublishedTick;
+    qint64               iNextDrainTick; // consumer only
+};
+
+}
@@ -0,0 +1,923 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QSet>
+#include <QFile>
+#include <QTimer>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdlib>
+#include "protocol.h"
+#include "serverlist.h"
+#include "client.h"
+#include "recorder/cwavestream.h"
+#include "recorder/cwavewriter.h"
+#include "recorder/cpacketstream.h"
+#include "recorder/recorderring.h"
+#include "recdecode.h"
+#include "selftest.h"
+
+
+/* Test helpers ***************************************************************/
+// server list of a central server with access to the session directory index
+class CSelfTestServerList : public CServerListManager
+{
+public:
+    CSelfTestServerList ( CProtocol* pNConLProt ) :
+        CServerListManager ( DEFAULT_PORT_NUMBER, "localhost", "", "", "127.0.0.1", 10, pNConLProt ) {}
+
+    void RemoveExpired ( const qint64 iTimeOutMs )
+    {
+        CVector<CHostAddress> vecRemovedHostAddr;
+        QMutexLocker          locker ( &Mutex );
+
+        RemoveExpiredServerListEntries ( iTimeOutMs, vecRemovedHostAddr );
+    }
+
+    QList<CHostAddress> GetRegisteredAddresses()
+    {
+        QList<CHostAddress> vecHostAddr;
+        QMutexLocker        locker ( &Mutex );
+
+        for ( int iIdx = 1; iIdx < ServerList.size(); iIdx++ )
+        {
+            vecHostAddr.append ( ServerList[iIdx].HostAddr );
+        }
+
+        return vecHostAddr;
+    }
+
+    // every list entry (except the central server itself) must be found by its
+    // name and its address and the index must not have additional entries
+    bool IsIndexConsistent()
+    {
+        QMutexLocker locker ( &Mutex );
+
+        if ( ( SessionNameIndex.size() != ServerList.size() - 1 ) ||
+             ( ServerAddrIndex.size() != ServerList.size() - 1 ) )
+        {
+            return false;
+        }
+
+        for ( int iIdx = 1; iIdx < ServerList.size(); iIdx++ )
+        {
+            if ( ( SessionNameIndex.value ( ServerList[iIdx].strName, INVALID_INDEX ) != iIdx ) ||
+                 ( ServerAddrIndex.value ( GetHostAddrKey ( ServerList[iIdx].HostAddr ), INVALID_INDEX ) != iIdx ) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+// distinct public address of a test session
+static CHostAddress GetTestHostAddr ( const int iAddr )
+{
+    return CHostAddress ( QHostAddress ( QString ( "10.0.0.%1" ).arg ( iAddr + 1 ) ), DEFAULT_PORT_NUMBER );
+}
+
+// writes a packet stream of a coded mono tone (OPUS64) with the given sequence
+// numbers, the tick of a packet is its sequence number (the given DTX frames
+// are written as silence records)
+static bool WriteTestPacketStream ( const QString&         strFileName,
+                                    const QList<uint32_t>& veciSequences,
+                                    const QSet<uint32_t>&  setDtxSequences = QSet<uint32_t>() )
+{
+    QFile PacketFile ( strFileName );
+
+    if ( !PacketFile.open ( QIODevice::WriteOnly ) )
+    {
+        return false;
+    }
+
+    // same encoder settings as in the client
+    int                iOpusError;
+    OpusCustomMode*    pOpusMode    = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ, SYSTEM_FRAME_SIZE_SAMPLES, &iOpusError );
+    OpusCustomEncoder* pOpusEncoder = opus_custom_encoder_create ( pOpusMode, 1, &iOpusError );
+
+    opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_VBR ( 0 ) );
+    opus_custom_encoder_ctl ( pOpusEncoder, OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+    recorder::CPacketWriter PacketWriter ( &PacketFile, 1, CT_OPUS64, SYSTEM_FRAME_SIZE_SAMPLES );
+    CTestSignal             TestSignal;
+    CVector<int16_t>        vecsAudio ( SYSTEM_FRAME_SIZE_SAMPLES );
+    CVector<uint8_t>        vecbyCoded ( OPUS_NUM_BYTES_MONO_NORMAL_QUALITY );
+
+    TestSignal.Init ( 440, QList<int>() );
+
+    for ( const uint32_t iSequence : veciSequences )
+    {
+        TestSignal.GetInput ( vecsAudio, 1 );
+
+        if ( setDtxSequences.contains ( iSequence ) )
+        {
+            PacketWriter.AppendPacket ( iSequence, iSequence, &vecbyCoded[0], PACKET_STREAM_DTX_SILENCE_BYTES );
+            continue;
+        }
+
+        const int iNumBytes = opus_custom_encode ( pOpusEncoder,
+                                                   &vecsAudio[0],
+                                                   SYSTEM_FRAME_SIZE_SAMPLES,
+                                                   &vecbyCoded[0],
+                                                   OPUS_NUM_BYTES_MONO_NORMAL_QUALITY );
+
+        PacketWriter.AppendPacket ( iSequence, iSequence, &vecbyCoded[0], iNumBytes );
+    }
+
+    opus_custom_encoder_destroy ( pOpusEncoder );
+    opus_custom_mode_destroy ( pOpusMode );
+
+    return true;
+}
+
+// reads the samples of a WAV file written by CWaveWriter
+static QVector<int16_t> ReadTestWavSamples ( const QString& strFileName )
+{
+    QFile            WavFile ( strFileName );
+    QVector<int16_t> vecsSamples;
+
+    if ( WavFile.open ( QIODevice::ReadOnly ) )
+    {
+        const QByteArray vecbyData = WavFile.readAll().mid ( WAVE_WRITER_HEADER_SIZE_BYTES );
+        const uchar*     pbyData   = reinterpret_cast<const uchar*> ( vecbyData.constData() );
+
+        vecsSamples.resize ( vecbyData.size() / 2 );
+
+        for ( int i = 0; i < vecsSamples.size(); i++ )
+        {
+            vecsSamples[i] = qFromLittleEndian<qint16> ( pbyData + 2 * i );
+        }
+    }
+
+    return vecsSamples;
+}
+
+// largest magnitude of the samples in the range
+static int GetTestPeak ( const QVector<int16_t>& vecsSamples, const int iStart, const int iEnd )
+{
+    int iPeak = 0;
+
+    for ( int i = iStart; i < iEnd; i++ )
+    {
+        iPeak = std::max ( iPeak, std::abs ( static_cast<int> ( vecsSamples[i] ) ) );
+    }
+
+    return iPeak;
+}
+
+// the per sample reverb as it was before the block processing of CAudioReverb
+// (JCRev: 3 allpass filters in series, 4 parallel comb filters and two output
+// delay lines), the block processing must give the same output
+class CReferenceReverb
+{
+public:
+    void Init ( const EAudChanConf eNAudioChannelConf,
+                const int          iNStereoBlockSizeSam,
+                const int          iSampleRate,
+                const float        fT60 = 1.1f )
+    {
+        eAudioChannelConf   = eNAudioChannelConf;
+        iStereoBlockSizeSam = iNStereoBlockSizeSam;
+
+        // delay lengths for 44100 Hz sample rate
+        int         lengths[9] = { 1116, 1356, 1422, 1617, 225, 341, 441, 211, 179 };
+        const float scaler     = static_cast<float> ( iSampleRate ) / 44100.0f;
+
+        if ( scaler != 1.0f )
+        {
+            for ( int i = 0; i < 9; i++ )
+            {
+                int delay = static_cast<int> ( floorf ( scaler * lengths[i] ) );
+
+                if ( ( delay & 1 ) == 0 )
+                {
+                    delay++;
+                }
+
+                while ( !isPrime ( delay ) )
+                {
+                    delay += 2;
+                }
+
+                lengths[i] = delay;
+            }
+        }
+
+        for ( int i = 0; i < 3; i++ )
+        {
+            allpassDelays[i].Init ( lengths[i + 4], 0 );
+        }
+
+        for ( int i = 0; i < 4; i++ )
+        {
+            combDelays[i].Init ( lengths[i], 0 );
+            combLastSample[i]  = 0;
+            combCoefficient[i] = powf ( 10.0f, static_cast<float> ( -3.0f * lengths[i] / ( fT60 * iSampleRate ) ) );
+        }
+
+        outLeftDelay.Init ( lengths[7], 0 );
+        outRightDelay.Init ( lengths[8], 0 );
+        allpassCoefficient = 0.7f;
+    }
+
+    template<typename TSample>
+    void Process ( CVector<TSample>& vecStereoInOut,
+                   const bool        bReverbOnLeftChan,
+                   const float       fAttenuation )
+    {
+        float fMixedInput, temp, temp0, temp1, temp2;
+
+        for ( int i = 0; i < iStereoBlockSizeSam; i += 2 )
+        {
+            if ( eAudioChannelConf == CC_STEREO )
+            {
+                fMixedInput = 0.5f * ( vecStereoInOut[i] + vecStereoInOut[i + 1] );
+            }
+            else
+            {
+                fMixedInput = bReverbOnLeftChan ? vecStereoInOut[i] : vecStereoInOut[i + 1];
+            }
+
+            temp   = allpassDelays[0].Get();
+            temp0  = allpassCoefficient * temp;
+            temp0 += fMixedInput;
+            allpassDelays[0].Add ( temp0 );
+            temp0 = - ( allpassCoefficient * temp0 ) + temp;
+
+            temp   = allpassDelays[1].Get();
+            temp1  = allpassCoefficient * temp;
+            temp1 += temp0;
+            allpassDelays[1].Add ( temp1 );
+            temp1 = - ( allpassCoefficient * temp1 ) + temp;
+
+            temp   = allpassDelays[2].Get();
+            temp2  = allpassCoefficient * temp;
+            temp2 += temp1;
+            allpassDelays[2].Add ( temp2 );
+            temp2 = - ( allpassCoefficient * temp2 ) + temp;
+
+            float combOut[4];
+
+            for ( int j = 0; j < 4; j++ )
+            {
+                // one pole lowpass with the pole at 0.2 in the feedback
+                combLastSample[j] = ( 1.0f - 0.2f ) * ( combCoefficient[j] * combDelays[j].Get() ) - ( -0.2f ) * combLastSample[j];
+                combOut[j]        = temp2 + combLastSample[j];
+            }
+
+            for ( int j = 0; j < 4; j++ )
+            {
+                combDelays[j].Add ( combOut[j] );
+            }
+
+            const float filtout = combOut[0] + combOut[1] + combOut[2] + combOut[3];
+
+            outLeftDelay.Add  ( filtout );
+            outRightDelay.Add ( filtout );
+
+            if ( ( eAudioChannelConf == CC_STEREO ) || bReverbOnLeftChan )
+            {
+                vecStereoInOut[i] = Float2Sample<TSample> (
+                    ( 1.0f - fAttenuation ) * vecStereoInOut[i] +
+                    0.5f * fAttenuation * outLeftDelay.Get() );
+            }
+
+            if ( ( eAudioChannelConf == CC_STEREO ) || !bReverbOnLeftChan )
+            {
+                vecStereoInOut[i + 1] = Float2Sample<TSample> (
+                    ( 1.0f - fAttenuation ) * vecStereoInOut[i + 1] +
+                    0.5f * fAttenuation * outRightDelay.Get() );
+            }
+        }
+    }
+
+protected:
+    static bool isPrime ( const int number )
+    {
+        if ( number == 2 )
+        {
+            return true;
+        }
+
+        if ( number & 1 )
+        {
+            for ( int i = 3; i < static_cast<int> ( sqrtf ( static_cast<float> ( number ) ) ) + 1; i += 2 )
+            {
+                if ( ( number % i ) == 0 )
+                {
+                    return false;
+                }
+            }
+
+            return true; // prime
+        }
+        else
+        {
+            return false; // even
+        }
+    }
+
+    EAudChanConf eAudioChannelConf;
+    int          iStereoBlockSizeSam;
+    CFIFO<float> allpassDelays[3];
+    CFIFO<float> combDelays[4];
+    float        combLastSample[4];
+    CFIFO<float> outLeftDelay;
+    CFIFO<float> outRightDelay;
+    float        allpassCoefficient;
+    float        combCoefficient[4];
+};
+
+// runs the block and the reference reverb on the same noise, returns the
+// largest difference of the output samples
+template<typename TSample>
+static double GetReverbMaxDiff ( const EAudChanConf eAudioChannelConf,
+                                 const int          iNumFrames,
+                                 const bool         bReverbOnLeftChan,
+                                 const double       dInputScale )
+{
+    CAudioReverb     AudioReverb;
+    CReferenceReverb ReferenceReverb;
+    CVector<TSample> vecBlock ( 2 * iNumFrames );
+    CVector<TSample> vecReference ( 2 * iNumFrames );
+    quint32          iRandState = 1;
+    double           dMaxDiff   = 0;
+
+    AudioReverb.Init ( eAudioChannelConf, 2 * iNumFrames, SYSTEM_SAMPLE_RATE_HZ );
+    ReferenceReverb.Init ( eAudioChannelConf, 2 * iNumFrames, SYSTEM_SAMPLE_RATE_HZ );
+
+    // long enough for the reverb tail to pass all delay lines several times
+    for ( int iBlock = 0; iBlock < 20 * SYSTEM_SAMPLE_RATE_HZ / 10 / iNumFrames; iBlock++ )
+    {
+        for ( int i = 0; i < vecBlock.Size(); i++ )
+        {
+            iRandState = iRandState * 1664525 + 1013904223; // linear congruential generator
+
+            // noise at a quarter of full scale (silence in the second half so
+            // that the decaying tail is compared, too)
+            const double dNoise = iBlock < 10 * SYSTEM_SAMPLE_RATE_HZ / 10 / iNumFrames ?
+                ( static_cast<double> ( iRandState >> 16 ) / 65536 - 0.5 ) / 2 : 0;
+
+            vecBlock[i]     = static_cast<TSample> ( dNoise * dInputScale );
+            vecReference[i] = vecBlock[i];
+        }
+
+        AudioReverb.Process ( vecBlock, bReverbOnLeftChan, 0.5f );
+        ReferenceReverb.Process ( vecReference, bReverbOnLeftChan, 0.5f );
+
+        for ( int i = 0; i < vecBlock.Size(); i++ )
+        {
+            dMaxDiff = std::max ( dMaxDiff, std::abs ( static_cast<double> ( vecBlock[i] ) - vecReference[i] ) );
+        }
+    }
+
+    return dMaxDiff;
+}
+
+// a P2P peer whose sound card clock is off by the skew sends its frames (with
+// network jitter) into a jitter buffer which the drift compensation reads as
+// in the client, after the lock-in the fill level must stay in the band around
+// the target and no frame may be dropped (buffer full) or inserted (empty)
+static bool RunDriftCompSkew ( const double dSkewPpm )
+{
+    const int              iNumBufFrames  = 6;
+    const double           dTargetBlocks  = ( iNumBufFrames - 1 ) / 2.0;
+    const double           dMaxLevelError = 1.5; // in blocks
+    const double           dFramePeriodS  = static_cast<double> ( SYSTEM_FRAME_SIZE_SAMPLES ) / SYSTEM_SAMPLE_RATE_HZ;
+    const double           dSendPeriodS   = dFramePeriodS / ( 1 + dSkewPpm * 1e-6 );
+    const int              iNumUpdates    = static_cast<int> ( 120 / dFramePeriodS );
+    const int              iLockInUpdates = static_cast<int> ( 30 / dFramePeriodS );
+    CClockDriftCompensator DriftComp;
+    CVector<int16_t>       vecsFrame ( SYSTEM_FRAME_SIZE_SAMPLES, 0 );
+    quint32                iRandState     = 1;
+    qint64                 iNumSent       = 0;
+    double                 dNextArrivalS  = 0;
+    int                    iNumQueued     = 0;
+    int                    iNumDropped    = 0;
+    int                    iNumInserted   = 0;
+    double                 dMinLevel      = iNumBufFrames;
+    double                 dMaxLevel      = 0;
+
+    DriftComp.Init ( 1, SYSTEM_FRAME_SIZE_SAMPLES, SYSTEM_SAMPLE_RATE_HZ );
+
+    for ( int iUpdate = 0; iUpdate < iNumUpdates; iUpdate++ )
+    {
+        const double dTimeS    = iUpdate * dFramePeriodS;
+        const bool   bLockedIn = iUpdate >= iLockInUpdates;
+
+        // the frames which arrived until this callback (up to half a frame of
+        // network jitter)
+        while ( dNextArrivalS <= dTimeS )
+        {
+            if ( iNumQueued < iNumBufFrames )
+            {
+                iNumQueued++;
+            }
+            else if ( bLockedIn )
+            {
+                iNumDropped++;
+            }
+
+            iNumSent++;
+            iRandState    = iRandState * 1664525 + 1013904223; // linear congruential generator
+            dNextArrivalS = iNumSent * dSendPeriodS + 0.5 * dFramePeriodS * ( iRandState >> 16 ) / 65536;
+        }
+
+        while ( DriftComp.NeedsInput() )
+        {
+            if ( iNumQueued > 0 )
+            {
+                iNumQueued--;
+            }
+            else if ( bLockedIn )
+            {
+                iNumInserted++; // concealed by the decoder
+            }
+
+            DriftComp.Put ( vecsFrame );
+        }
+
+        DriftComp.Get ( vecsFrame );
+
+        const double dLevel = iNumQueued + DriftComp.GetNumBufferedSamples() / SYSTEM_FRAME_SIZE_SAMPLES;
+
+        DriftComp.Update ( dLevel, dTargetBlocks );
+
+        if ( bLockedIn )
+        {
+            dMinLevel = std::min ( dMinLevel, dLevel );
+            dMaxLevel = std::max ( dMaxLevel, dLevel );
+        }
+    }
+
+    if ( ( iNumDropped > 0 ) || ( iNumInserted > 0 ) ||
+         ( dMinLevel < dTargetBlocks - dMaxLevelError ) || ( dMaxLevel > dTargetBlocks + dMaxLevelError ) ||
+         ( std::abs ( DriftComp.GetDriftPpm() - dSkewPpm ) > 0.2 * std::abs ( dSkewPpm ) ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "skew %1 ppm: %2 dropped, %3 inserted, level %4 to %5 blocks "
+                                                 "(target %6), estimated drift %7 ppm" )
+            .arg ( dSkewPpm ).arg ( iNumDropped ).arg ( iNumInserted )
+            .arg ( dMinLevel, 0, 'f', 2 ).arg ( dMaxLevel, 0, 'f', 2 ).arg ( dTargetBlocks )
+            .arg ( DriftComp.GetDriftPpm(), 0, 'f', 1 ) );
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Tests **********************************************************************/
+// interleaved registrations (including renames), unregistrations and expiries
+// of the session directory must keep the index consistent with the list
+static bool TestServerListIndex()
+{
+    const int           iNumAddresses = 40;
+    CProtocol           Protocol;
+    CSelfTestServerList ServerList ( &Protocol );
+    QSet<int>           setRegistered;
+    quint32             iRandState = 1;
+
+    for ( int iStep = 0; iStep < 400; iStep++ )
+    {
+        iRandState = iRandState * 1664525 + 1013904223; // linear congruential generator
+
+        const int iAddr = ( iRandState >> 16 ) % iNumAddresses;
+
+        if ( ( ( iRandState >> 8 ) % 3 ) < 2 )
+        {
+            // some sessions share the name so that the renaming is covered, a
+            // registered session may also change its name
+            CServerCoreInfo ServerInfo;
+            ServerInfo.strName = QString ( "session%1" ).arg ( ( iAddr + iStep / 100 ) % ( iNumAddresses / 2 ) );
+
+            ServerList.CentralServerRegisterServer ( GetTestHostAddr ( iAddr ), GetTestHostAddr ( iAddr ), ServerInfo );
+            setRegistered.insert ( iAddr );
+        }
+        else
+        {
+            ServerList.CentralServerUnregisterServer ( GetTestHostAddr ( iAddr ) );
+            setRegistered.remove ( iAddr );
+        }
+
+        // let all sessions expire except of the ones which are renewed after
+        // the pause
+        if ( ( iStep % 50 ) == 49 )
+        {
+            QThread::msleep ( 100 );
+
+            setRegistered.clear();
+
+            for ( int iRenewAddr = 0; iRenewAddr < iNumAddresses; iRenewAddr += 3 )
+            {
+                CServerCoreInfo ServerInfo;
+                ServerInfo.strName = QString ( "renewed%1" ).arg ( iRenewAddr );
+
+                ServerList.CentralServerRegisterServer ( GetTestHostAddr ( iRenewAddr ), CHostAddress(), ServerInfo );
+                setRegistered.insert ( iRenewAddr );
+            }
+
+            ServerList.RemoveExpired ( 50 );
+        }
+
+        if ( !ServerList.IsIndexConsistent() )
+        {
+            qWarning() << qUtf8Printable ( QString ( "index inconsistent after step %1" ).arg ( iStep ) );
+            return false;
+        }
+
+        const QList<CHostAddress> vecHostAddr = ServerList.GetRegisteredAddresses();
+
+        if ( vecHostAddr.size() != setRegistered.size() )
+        {
+            qWarning() << qUtf8Printable ( QString ( "%1 sessions registered instead of %2 after step %3" )
+                .arg ( vecHostAddr.size() ).arg ( setRegistered.size() ).arg ( iStep ) );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#if defined ( Q_OS_LINUX ) && !WITH_SOUND
+// a client with the virtual clock runs offline and decodes its own coded
+// signal, the tone of the input file must be found in the output file
+static bool TestVirtualClockLoopback()
+{
+    const int      iNumInputFrames = 2 * SYSTEM_SAMPLE_RATE_HZ;
+    const int      iBlockNumFrames = 480;
+    QTemporaryDir  TempDir;
+    const QString  strInFileName  = TempDir.filePath ( "in.wav" );
+    const QString  strOutFileName = TempDir.filePath ( "out.wav" );
+    CTestSignal    TestSignal;
+    CVector<int16_t> vecsBlock ( 2 * iBlockNumFrames );
+
+    TestSignal.Init ( 440, QList<int>() );
+
+    {
+        QFile InFile ( strInFileName );
+
+        if ( !InFile.open ( QIODevice::WriteOnly ) )
+        {
+            qWarning() << "cannot write the input file";
+            return false;
+        }
+
+        recorder::CWaveStream InStream ( &InFile, 2 );
+
+        for ( int iFrame = 0; iFrame < iNumInputFrames; iFrame += iBlockNumFrames )
+        {
+            TestSignal.GetInput ( vecsBlock );
+
+            for ( int i = 0; i < vecsBlock.Size(); i++ )
+            {
+                InStream << static_cast<qint16> ( vecsBlock[i] );
+            }
+        }
+
+        InStream.finalise();
+    }
+
+    {
+        CClient Client ( 0, "", "", false, "selftest", false, "", 1, false );
+        QTimer  TimeOut;
+
+        // the client quits the event loop at the end of the input file, the
+        // time-out only catches a hanging client
+        TimeOut.setSingleShot ( true );
+        QObject::connect ( &TimeOut, &QTimer::timeout, QCoreApplication::instance(), &QCoreApplication::quit );
+        TimeOut.start ( 60000 );
+
+        Client.SetSoundFiles ( strInFileName, strOutFileName, true );
+        Client.Start();
+        QCoreApplication::exec();
+        Client.Stop();
+
+        if ( !TimeOut.isActive() )
+        {
+            qWarning() << "the client did not finish the input file";
+            return false;
+        }
+    }
+
+    QFile OutFile ( strOutFileName );
+
+    if ( !OutFile.open ( QIODevice::ReadOnly ) )
+    {
+        qWarning() << "cannot read the output file";
+        return false;
+    }
+
+    // skip the RIFF, format and data chunk headers
+    const QByteArray vecbyData = OutFile.readAll().mid ( 44 );
+    const uchar*     pbyData   = reinterpret_cast<const uchar*> ( vecbyData.constData() );
+    const int        iNumBlocks = vecbyData.size() / ( 4 * iBlockNumFrames );
+    int              iNumWindows  = 0;
+    int              iNumDetected = 0;
+
+    for ( int iBlock = 0; iBlock < iNumBlocks; iBlock++ )
+    {
+        for ( int i = 0; i < vecsBlock.Size(); i++ )
+        {
+            vecsBlock[i] = qFromLittleEndian<qint16> ( pbyData + 2 * ( iBlock * vecsBlock.Size() + i ) );
+        }
+
+        if ( TestSignal.AnalyzeOutput ( vecsBlock ) )
+        {
+            iNumWindows++;
+
+            if ( TestSignal.IsOwnToneDetected() )
+            {
+                iNumDetected++;
+            }
+        }
+    }
+
+    // the first window may contain the start-up of the codec
+    if ( ( iNumWindows < 10 ) || ( iNumDetected < iNumWindows - 1 ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "the tone was found in %1 of %2 output windows" )
+            .arg ( iNumDetected ).arg ( iNumWindows ) );
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+// a gap longer than the limit is written as silence of the maximum gap length
+// and the packets after the gap are still decoded
+static bool TestRecDecodeLongGap()
+{
+    const int       iNumPacketsBefore = 100;
+    const int       iNumPacketsAfter  = 100;
+    const uint32_t  iGapEndSequence   = iNumPacketsBefore + RECDECODE_MAX_GAP_PACKETS + 1000;
+    const int       iThreshold        = static_cast<int> ( TEST_SIGNAL_AMPLITUDE * 32767 / 4 );
+    QTemporaryDir   TempDir;
+    const QString   strPacketFileName = TempDir.filePath ( "track." PACKET_STREAM_FILE_SUFFIX );
+    const QString   strWavFileName    = TempDir.filePath ( "track.wav" );
+    QList<uint32_t> veciSequences;
+
+    for ( int i = 0; i < iNumPacketsBefore; i++ )
+    {
+        veciSequences.append ( i );
+    }
+
+    for ( int i = 0; i < iNumPacketsAfter; i++ )
+    {
+        veciSequences.append ( iGapEndSequence + i );
+    }
+
+    if ( !WriteTestPacketStream ( strPacketFileName, veciSequences ) )
+    {
+        qWarning() << "cannot write the packet stream";
+        return false;
+    }
+
+    CRecordingDecoder      Decoder;
+    const qint64           iLength        = Decoder.DecodeTrack ( strPacketFileName, strWavFileName );
+    const qint64           iExpLength     = iNumPacketsBefore + RECDECODE_MAX_GAP_PACKETS + iNumPacketsAfter;
+    const QVector<int16_t> vecsSamples    = ReadTestWavSamples ( strWavFileName );
+    const int              iGapStart      = iNumPacketsBefore * SYSTEM_FRAME_SIZE_SAMPLES;
+    const int              iGapEnd        = iGapStart + RECDECODE_MAX_GAP_PACKETS * SYSTEM_FRAME_SIZE_SAMPLES;
+
+    if ( ( iLength != iExpLength ) || ( vecsSamples.size() != iExpLength * SYSTEM_FRAME_SIZE_SAMPLES ) ||
+         ( Decoder.GetNumPackets() != veciSequences.size() ) || ( Decoder.GetNumConcealed() != 0 ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "%1 frames (%2 samples, %3 packets, %4 concealed) instead of %5 frames" )
+            .arg ( iLength ).arg ( vecsSamples.size() ).arg ( Decoder.GetNumPackets() )
+            .arg ( Decoder.GetNumConcealed() ).arg ( iExpLength ) );
+        return false;
+    }
+
+    if ( ( GetTestPeak ( vecsSamples, iGapStart, iGapEnd ) != 0 ) ||
+         ( GetTestPeak ( vecsSamples, iGapEnd, vecsSamples.size() ) < iThreshold ) )
+    {
+        qWarning() << "the gap is not silent or the packets after the gap are missing";
+        return false;
+    }
+
+    return true;
+}
+
+// the block processing of the reverb gives the same output as the per sample
+// reference for all channel configurations and several block sizes
+static bool TestReverbBlockProcessing()
+{
+    for ( const EAudChanConf eAudioChannelConf : { CC_MONO, CC_MONO_IN_STEREO_OUT, CC_STEREO } )
+    {
+        for ( const int iNumFrames : { SYSTEM_FRAME_SIZE_SAMPLES, DOUBLE_SYSTEM_FRAME_SIZE_SAMPLES, 4 * SYSTEM_FRAME_SIZE_SAMPLES } )
+        {
+            for ( const bool bReverbOnLeftChan : { true, false } )
+            {
+                // the int16 output must be identical, the float output within
+                // the rounding of one int16 step
+                const double dShortDiff = GetReverbMaxDiff<int16_t> ( eAudioChannelConf, iNumFrames, bReverbOnLeftChan, 32768 );
+                const double dFloatDiff = GetReverbMaxDiff<float> ( eAudioChannelConf, iNumFrames, bReverbOnLeftChan, 1 );
+
+                if ( ( dShortDiff > 0 ) || ( dFloatDiff > 1.0 / 32768 ) )
+                {
+                    qWarning() << qUtf8Printable ( QString ( "channel configuration %1, %2 frames, reverb on the %3 channel: "
+                                                             "difference %4 (int16), %5 (float)" )
+                        .arg ( static_cast<int> ( eAudioChannelConf ) ).arg ( iNumFrames ).arg ( bReverbOnLeftChan ? "left" : "right" )
+                        .arg ( dShortDiff ).arg ( dFloatDiff ) );
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// frames suppressed by DTX pass the recorder ring as silence markers and are
+// decoded as silence without concealment, also if the silence is longer than
+// the gap limit
+static bool TestRecordDtxSilence()
+{
+    const int       iNumPacketsBefore = 100;
+    const int       iNumDtxFrames     = RECDECODE_MAX_GAP_PACKETS + 500;
+    const int       iNumPacketsAfter  = 100;
+    const int       iThreshold        = static_cast<int> ( TEST_SIGNAL_AMPLITUDE * 32767 / 4 );
+    const uint8_t   vecbyCoded[]      = { 1, 2, 3 };
+    QTemporaryDir   TempDir;
+    const QString   strPacketFileName = TempDir.filePath ( "track." PACKET_STREAM_FILE_SUFFIX );
+    const QString   strWavFileName    = TempDir.filePath ( "track.wav" );
+    QList<uint32_t> veciSequences;
+    QSet<uint32_t>  setDtxSequences;
+
+    // the recorder ring keeps the marker and the sequence number
+    recorder::CRecorderRing RecorderRing;
+    QList<int>              veciNumBytes;
+    QList<uint32_t>         veciRingSequences;
+
+    RecorderRing.Init ( 1 );
+    RecorderRing.PutPacket ( 0, "dtx", CHostAddress(), 1, CT_OPUS64, vecbyCoded, 3 );
+    RecorderRing.PutPacket ( 0, "dtx", CHostAddress(), 1, CT_OPUS64, nullptr, PACKET_STREAM_DTX_SILENCE_BYTES );
+    RecorderRing.PutPacket ( 0, "dtx", CHostAddress(), 1, CT_OPUS64, nullptr, 3 ); // lost
+    RecorderRing.PutPacket ( 0, "dtx", CHostAddress(), 1, CT_OPUS64, vecbyCoded, 3 );
+    RecorderRing.EndTick();
+    RecorderRing.Drain ( [&] ( const recorder::CRecorderFrame& Frame )
+    {
+        veciNumBytes.append ( Frame.iNumBytes );
+        veciRingSequences.append ( Frame.iSequence );
+    } );
+
+    if ( ( veciNumBytes != QList<int> ( { 3, PACKET_STREAM_DTX_SILENCE_BYTES, 3 } ) ) ||
+         ( veciRingSequences != QList<uint32_t> ( { 0, 1, 3 } ) ) )
+    {
+        qWarning() << "the recorder ring does not keep the DTX silence marker";
+        return false;
+    }
+
+    for ( int i = 0; i < iNumPacketsBefore + iNumDtxFrames + iNumPacketsAfter; i++ )
+    {
+        veciSequences.append ( i );
+
+        if ( ( i >= iNumPacketsBefore ) && ( i < iNumPacketsBefore + iNumDtxFrames ) )
+        {
+            setDtxSequences.insert ( i );
+        }
+    }
+
+    if ( !WriteTestPacketStream ( strPacketFileName, veciSequences, setDtxSequences ) )
+    {
+        qWarning() << "cannot write the packet stream";
+        return false;
+    }
+
+    CRecordingDecoder      Decoder;
+    const qint64           iLength     = Decoder.DecodeTrack ( strPacketFileName, strWavFileName );
+    const qint64           iExpLength  = veciSequences.size();
+    const QVector<int16_t> vecsSamples = ReadTestWavSamples ( strWavFileName );
+    const int              iDtxStart   = iNumPacketsBefore * SYSTEM_FRAME_SIZE_SAMPLES;
+    const int              iDtxEnd     = iDtxStart + iNumDtxFrames * SYSTEM_FRAME_SIZE_SAMPLES;
+
+    if ( ( iLength != iExpLength ) || ( vecsSamples.size() != iExpLength * SYSTEM_FRAME_SIZE_SAMPLES ) ||
+         ( Decoder.GetNumPackets() != iNumPacketsBefore + iNumPacketsAfter ) ||
+         ( Decoder.GetNumDtxSilence() != iNumDtxFrames ) || ( Decoder.GetNumConcealed() != 0 ) )
+    {
+        qWarning() << qUtf8Printable ( QString ( "%1 frames (%2 packets, %3 DTX silence, %4 concealed) instead of %5 frames" )
+            .arg ( iLength ).arg ( Decoder.GetNumPackets() ).arg ( Decoder.GetNumDtxSilence() )
+            .arg ( Decoder.GetNumConcealed() ).arg ( iExpLength ) );
+        return false;
+    }
+
+    if ( ( GetTestPeak ( vecsSamples, iDtxStart, iDtxEnd ) != 0 ) ||
+         ( GetTestPeak ( vecsSamples, iDtxEnd, vecsSamples.size() ) < iThreshold ) )
+    {
+        qWarning() << "the DTX frames are not silent or the packets after them are missing";
+        return false;
+    }
+
+    return true;
+}
+
+// the drift compensation locks to a sender which is 100 ppm faster or slower
+static bool TestDriftCompSkew()
+{
+    return RunDriftCompSkew ( 100 ) && RunDriftCompSkew ( -100 );
+}
+
+
+/* Implementation *************************************************************/
+void CSelfTestRunner::Run ( const QString&        strName,
+                            std::function<bool()> Test )
+{
+    if ( !strFilter.isEmpty() && !strName.contains ( strFilter ) )
+    {
+        return;
+    }
+
+    if ( Test() )
+    {
+        qInfo() << qUtf8Printable ( QString ( "PASS %1" ).arg ( strName ) );
+        iNumPassed++;
+    }
+    else
+    {
+        qInfo() << qUtf8Printable ( QString ( "FAIL %1" ).arg ( strName ) );
+        iNumFailed++;
+    }
+}
+
+int SelfTestMain ( int argc, char** argv )
+{
+    QString strArgument;
+    QString strFilter;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( GetFlagArgument ( argv, i, "-h", "--help" ) )
+        {
+            qInfo() << qUtf8Printable ( QString (
+                "Usage: %1 [option] [optional argument]\n"
+                "\nSelf tests of the components which do not need a network or a sound\n"
+                "card, the exit code is 1 if a test failed.\n"
+                "\nRecognized options:\n"
+                "  -h, --help            display this help text and exit\n"
+                "  -f, --filter          only run tests whose name contains the text\n" )
+                .arg ( argv[0] ) );
+            return 0;
+        }
+
+        if ( GetStringArgument ( argc, argv, i, "-f", "--filter", strArgument ) )
+        {
+            strFilter = strArgument;
+            continue;
+        }
+
+        qCritical() << qUtf8Printable ( QString ( "%1: Unknown option '%2' -- use '--help' for help" )
+            .arg ( argv[0] ).arg ( argv[i] ) );
+    }
+
+    QCoreApplication App ( argc, argv );
+    CSelfTestRunner  Runner ( strFilter );
+
+    try
+    {
+        Runner.Run ( "serverlist_index", TestServerListIndex );
+        Runner.Run ( "recdecode_long_gap", TestRecDecodeLongGap );
+        Runner.Run ( "reverb_block_processing", TestReverbBlockProcessing );
+        Runner.Run ( "record_dtx_silence", TestRecordDtxSilence );
+        Runner.Run ( "drift_comp_skew", TestDriftCompSkew );
+#if defined ( Q_OS_LINUX ) && !WITH_SOUND
+        Runner.Run ( "virtualclock_loopback", TestVirtualClockLoopback );
+#endif
+    }
+    catch ( const CGenErr& generr )
+    {
+        qCritical() << "CRITICAL Error:" << generr.GetErrorText();
+        return 1;
+    }
+
+    qInfo() << qUtf8Printable ( QString ( "%1 passed, %2 failed" )
+        .arg ( Runner.GetNumPassed() ).arg ( Runner.GetNumFailed() ) );
+
+    return Runner.GetNumFailed() > 0 ? 1 : 0;
+}
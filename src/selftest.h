@@ -0,0 +1,58 @@
+/******************************************************************************\
+ * Copyright (c) 2021
+ *
+ * Author(s):
+ *  Institut of Embedded Systems ZHAW (www.zhaw.ch/ines)
+ *
+ * Self tests of components which can be checked without a network or a sound
+ * card. Each test prints PASS or FAIL, the exit code is 1 if a test failed so
+ * that the tests can be run in the CI.
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+\******************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <functional>
+#include "global.h"
+#include "util.h"
+
+
+/* Classes ********************************************************************/
+// runs the tests and counts the failures
+class CSelfTestRunner
+{
+public:
+    CSelfTestRunner ( const QString& strNFilter ) :
+        strFilter ( strNFilter ), iNumPassed ( 0 ), iNumFailed ( 0 ) {}
+
+    // a test returns false on a failure (details are printed by the test)
+    void Run ( const QString& strName, std::function<bool()> Test );
+
+    int GetNumPassed() const { return iNumPassed; }
+    int GetNumFailed() const { return iNumFailed; }
+
+protected:
+    QString strFilter;
+    int     iNumPassed;
+    int     iNumFailed;
+};
+
+// entry point of the self test build target
+int SelfTestMain ( int argc, char** argv );
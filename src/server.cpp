@@ -26,6 +26,7 @@
 \******************************************************************************/
 
 #include "server.h"
+#include "client.h" // coded bytes of the benchmark
 
 
 // CHighPrecisionTimer implementation ******************************************
@@ -239,7 +240,12 @@ CServer::CServer ( const int          iNewMaxNumChan,
                    const ELicenceType eNLicenceType ) :
     bUseDoubleSystemFrameSize   ( bNUseDoubleSystemFrameSize ),
     bUseMultithreading          ( bNUseMultithreading ),
+    iMTDecodeBlockSize          ( MT_DEFAULT_DECODE_BLOCK_SIZE ),
+    iMaximumMixOpsInTimeBudget  ( MT_DEFAULT_MAX_MIX_OPS_IN_BUDGET ),
+    bMetricsEnabled             ( false ),
     iMaxNumChannels             ( iNewMaxNumChan ),
+    bRecordFramesInTick         ( false ),
+    bRecordPacketsInTick        ( false ),
     Socket                      ( this, iPortNumber ),
     Logging                     ( ),
     iFrameCount                 ( 0 ),
@@ -450,6 +456,9 @@ CServer::CServer ( const int          iNewMaxNumChan,
     QObject::connect ( &ConnLessProtocol, &CProtocol::CLReqServerList,
         this, &CServer::OnCLReqServerList );
 
+    QObject::connect ( &ConnLessProtocol, &CProtocol::CLSubscribeSession,
+        this, &CServer::OnCLSubscribeSession );
+
     QObject::connect ( &ConnLessProtocol, &CProtocol::CLRegisterServerResp,
         this, &CServer::OnCLRegisterServerResp );
 
@@ -489,10 +498,6 @@ CServer::CServer ( const int          iNewMaxNumChan,
     QObject::connect ( this, &CServer::ClientDisconnected,
         &JamController, &recorder::CJamController::ClientDisconnected );
 
-    qRegisterMetaType<CVector<int16_t>> ( "CVector<int16_t>" );
-    QObject::connect ( this, &CServer::AudioFrame,
-        &JamController, &recorder::CJamController::AudioFrame );
-
     QObject::connect ( QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
         this, &CServer::OnAboutToQuit );
 
@@ -567,6 +572,11 @@ void CServer::CreateAndSendJitBufMessage ( const int iCurChanID,
 
 CServer::~CServer()
 {
+    // the emulator thread must not deliver packets to the socket which is
+    // destroyed before the emulator (the socket thread which is still running
+    // then handles its packets directly)
+    NetworkEmulator.Stop();
+
     for ( int i = 0; i < iMaxNumChannels; i++ )
     {
         // free audio encoders and decoders
@@ -798,11 +808,18 @@ void CServer::OnTimer()
 /*
 static CTimingMeas JitterMeas ( 1000, "test2.dat" ); JitterMeas.Measure(); // TEST do a timer jitter measurement
 */
+    const qint64 iTickStartNs = bMetricsEnabled ? MetricsTimer.nsecsElapsed() : 0;
+
     // Get data from all connected clients -------------------------------------
     // some inits
     int iNumClients           = 0; // init connected client counter
     bChannelIsNowDisconnected = false; // note that the flag must be a member function since QtConcurrent::run can only take 5 params
 
+    // the recording state is read once so that each tick is complete
+    const bool bRecordingEnabled = JamController.GetRecordingEnabled();
+    bRecordPacketsInTick         = bRecordingEnabled && JamController.GetRecordCodedPackets();
+    bRecordFramesInTick          = bRecordingEnabled && !bRecordPacketsInTick;
+
     // Make put and get calls thread safe. Do not forget to unlock mutex
     // afterwards!
     Mutex.lock();
@@ -831,9 +848,9 @@ static CTimingMeas JitterMeas ( 1000, "test2.dat" ); JitterMeas.Measure(); // TE
         }
         else
         {
-            // processing with multithreading
-// TODO optimization of the MTBlockSize value
-            const int iMTBlockSize = 10; // every 10 users a new thread is created
+            // processing with multithreading (the block size is calibrated
+            // with RunBenchmark(), by default every 10 users a new thread is created)
+            const int iMTBlockSize = iMTDecodeBlockSize;
             const int iNumBlocks   = ( iNumClients - 1 ) / iMTBlockSize + 1;
 
             for ( int iBlockCnt = 0; iBlockCnt < iNumBlocks; iBlockCnt++ )
@@ -894,13 +911,13 @@ static CTimingMeas JitterMeas ( 1000, "test2.dat" ); JitterMeas.Measure(); // TE
             }
 
             // export the audio data for recording purpose
-            if ( JamController.GetRecordingEnabled() )
+            if ( bRecordFramesInTick )
             {
-                emit AudioFrame ( iCurChanID,
-                                  vecChannels[iCurChanID].GetName(),
-                                  vecChannels[iCurChanID].GetAddress(),
-                                  vecNumAudioChannels[iChanCnt],
-                                  vecvecsData[iChanCnt] );
+                JamController.PutFrame ( iCurChanID,
+                                         vecChannels[iCurChanID].GetName(),
+                                         vecChannels[iCurChanID].GetAddress(),
+                                         vecNumAudioChannels[iChanCnt],
+                                         vecvecsData[iChanCnt] );
             }
 
             // processing without multithreading
@@ -912,13 +929,17 @@ static CTimingMeas JitterMeas ( 1000, "test2.dat" ); JitterMeas.Measure(); // TE
             }
         }
 
+        if ( bRecordFramesInTick || bRecordPacketsInTick )
+        {
+            JamController.EndTick();
+        }
+
         // processing with multithreading
         if ( bUseMultithreading )
         {
             // introduced by kraney (#653): each thread must complete within the 1 or 2ms time budget for the timer
-// TODO determine at startup by running a small benchmark
-            const int iMaximumMixOpsInTimeBudget = 500; // approximate limit as observed on GCP e2-standard instance
-            const int iMTBlockSize = iMaximumMixOpsInTimeBudget / iNumClients; // number of ops = block size * total number of clients
+            // (the maximum number of mix operations is calibrated with RunBenchmark())
+            const int iMTBlockSize = std::max ( 1, iMaximumMixOpsInTimeBudget / iNumClients ); // number of ops = block size * total number of clients
             const int iNumBlocks   = ( iNumClients - 1 ) / iMTBlockSize + 1;
 
             for ( int iBlockCnt = 0; iBlockCnt < iNumBlocks; iBlockCnt++ )
@@ -942,6 +963,19 @@ static CTimingMeas JitterMeas ( 1000, "test2.dat" ); JitterMeas.Measure(); // TE
             FutureSynchronizer.waitForFinished();
             FutureSynchronizer.clearFutures();
         }
+
+        // the processing of a tick must be done within one frame duration
+        if ( bMetricsEnabled )
+        {
+            const int64_t iTickUs = ( MetricsTimer.nsecsElapsed() - iTickStartNs ) / 1000;
+
+            TickDurationHist.Add ( iTickUs );
+
+            if ( iTickUs * SYSTEM_SAMPLE_RATE_HZ > static_cast<int64_t> ( iServerFrameSizeSamples ) * 1000000 )
+            {
+                NumDeadlineMisses.Add();
+            }
+        }
     }
     else
     {
@@ -951,6 +985,195 @@ static CTimingMeas JitterMeas ( 1000, "test2.dat" ); JitterMeas.Measure(); // TE
     }
 }
 
+QString CServerBenchmarkResult::ToString() const
+{
+    return QString ( "Server benchmark (%1 samples frame size, %2 us frame duration, %3 core(s)):\n"
+                     "  decode %4 us, mix %5 us per input channel, encode %6 us\n"
+                     "  decode block size %7 channels, %8 mix operations per thread task\n"
+                     "  maximum safe number of channels: %9" )
+        .arg ( iFrameSizeSamples )
+        .arg ( dFrameDurationUs, 0, 'f', 1 )
+        .arg ( iNumCores )
+        .arg ( dDecodeUs, 0, 'f', 2 )
+        .arg ( dMixOpUs, 0, 'f', 3 )
+        .arg ( dEncodeUs, 0, 'f', 2 )
+        .arg ( iMTDecodeBlockSize )
+        .arg ( iMaximumMixOpsInTimeBudget )
+        .arg ( iMaxNumChannels );
+}
+
+CServerBenchmarkResult CServer::RunBenchmark ( const int iNumFrames )
+{
+    int                    i, j, k, iOpusError;
+    CServerBenchmarkResult Result;
+    QElapsedTimer          ElapsedTimer;
+    qint64                 iDecodeNs = 0;
+    qint64                 iMixNs    = 0;
+    qint64                 iEncodeNs = 0;
+
+    // the benchmark uses the OPUS frame size which matches the server frame
+    // size (i.e. one decoding and encoding per frame) and stereo high quality
+    // for all channels which is the worst case
+    const int iNumSamples    = 2 /* stereo */ * iServerFrameSizeSamples;
+    const int iNumCodedBytes = bUseDoubleSystemFrameSize ? OPUS_NUM_BYTES_STEREO_HIGH_QUALITY_DBLE_FRAMESIZE
+                                                         : OPUS_NUM_BYTES_STEREO_HIGH_QUALITY;
+
+    // we use our own encoder/decoder so that the states of the channel codecs
+    // are not modified
+    OpusCustomMode*    pCurOpusMode    = bUseDoubleSystemFrameSize ? OpusMode[0] : Opus64Mode[0];
+    OpusCustomEncoder* pCurOpusEncoder = opus_custom_encoder_create ( pCurOpusMode, 2, &iOpusError );
+    OpusCustomDecoder* pCurOpusDecoder = opus_custom_decoder_create ( pCurOpusMode, 2, &iOpusError );
+
+    // same settings as for the channel encoders
+    opus_custom_encoder_ctl ( pCurOpusEncoder, OPUS_SET_VBR ( 0 ) );
+    opus_custom_encoder_ctl ( pCurOpusEncoder, OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+    opus_custom_encoder_ctl ( pCurOpusEncoder, OPUS_SET_BITRATE ( CalcBitRateBitsPerSecFromCodedBytes ( iNumCodedBytes, iServerFrameSizeSamples ) ) );
+
+    if ( bUseDoubleSystemFrameSize )
+    {
+        opus_custom_encoder_ctl ( pCurOpusEncoder, OPUS_SET_COMPLEXITY ( 1 ) );
+    }
+    else
+    {
+        opus_custom_encoder_ctl ( pCurOpusEncoder, OPUS_SET_PACKET_LOSS_PERC ( 35 ) );
+    }
+
+    CVector<int16_t>           vecsAudio         ( iNumSamples );
+    CVector<float>             vecfIntermProcBuf ( iNumSamples );
+    CVector<uint8_t>           vecbyCoded        ( iNumFrames * iNumCodedBytes );
+    CVector<CVector<int16_t> > vecvecsDecoded    ( SERVER_BENCHMARK_NUM_MIX_CHANNELS );
+
+    for ( j = 0; j < SERVER_BENCHMARK_NUM_MIX_CHANNELS; j++ )
+    {
+        vecvecsDecoded[j].Init ( iNumSamples );
+    }
+
+    // Encoding ----------------------------------------------------------------
+    // the test signal is a tone with some noise so that the encoder has to
+    // do the full work
+    quint32 iNoiseState = 1;
+
+    for ( int iFrame = 0; iFrame < iNumFrames; iFrame++ )
+    {
+        for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
+        {
+            iNoiseState = iNoiseState * 1664525 + 1013904223; // linear congruential generator
+
+            const int iTone  = static_cast<int> ( 8000 * sin ( 0.05 * ( iFrame * iServerFrameSizeSamples + i ) ) );
+            const int iNoise = static_cast<int> ( iNoiseState >> 20 ) - 2048;
+
+            vecsAudio[k]     = static_cast<int16_t> ( iTone + iNoise );
+            vecsAudio[k + 1] = static_cast<int16_t> ( iTone - iNoise );
+        }
+
+        ElapsedTimer.start();
+
+        opus_custom_encode ( pCurOpusEncoder,
+                             &vecsAudio[0],
+                             iServerFrameSizeSamples,
+                             &vecbyCoded[iFrame * iNumCodedBytes],
+                             iNumCodedBytes );
+
+        iEncodeNs += ElapsedTimer.nsecsElapsed();
+    }
+
+    // Decoding ----------------------------------------------------------------
+    ElapsedTimer.start();
+
+    for ( int iFrame = 0; iFrame < iNumFrames; iFrame++ )
+    {
+        opus_custom_decode ( pCurOpusDecoder,
+                             &vecbyCoded[iFrame * iNumCodedBytes],
+                             iNumCodedBytes,
+                             &vecvecsDecoded[iFrame % SERVER_BENCHMARK_NUM_MIX_CHANNELS][0],
+                             iServerFrameSizeSamples );
+    }
+
+    iDecodeNs = ElapsedTimer.nsecsElapsed();
+
+    // Mixing ------------------------------------------------------------------
+    // same processing as for a stereo target channel with gain and panning in
+    // MixEncodeTransmitData()
+    const float fGainL = MathUtils::GetLeftPan ( 0.3f, false ) * 0.8f;
+    const float fGainR = MathUtils::GetRightPan ( 0.3f, false ) * 0.8f;
+
+    ElapsedTimer.start();
+
+    for ( int iFrame = 0; iFrame < iNumFrames; iFrame++ )
+    {
+        vecfIntermProcBuf.Reset ( 0 );
+
+        for ( j = 0; j < SERVER_BENCHMARK_NUM_MIX_CHANNELS; j++ )
+        {
+            const CVector<int16_t>& vecsData = vecvecsDecoded[j];
+
+            for ( i = 0; i < iNumSamples; i += 2 )
+            {
+                vecfIntermProcBuf[i]     += vecsData[i] *     fGainL;
+                vecfIntermProcBuf[i + 1] += vecsData[i + 1] * fGainR;
+            }
+        }
+
+        for ( i = 0; i < iNumSamples; i++ )
+        {
+            vecsAudio[i] = Float2Short ( vecfIntermProcBuf[i] );
+        }
+    }
+
+    iMixNs = ElapsedTimer.nsecsElapsed();
+
+    opus_custom_encoder_destroy ( pCurOpusEncoder );
+    opus_custom_decoder_destroy ( pCurOpusDecoder );
+
+    // Derive the parameters ---------------------------------------------------
+    Result.iFrameSizeSamples = iServerFrameSizeSamples;
+    Result.iNumCores         = bUseMultithreading ? std::max ( QThread::idealThreadCount(), 1 ) : 1;
+    Result.dFrameDurationUs  = 1e6 * iServerFrameSizeSamples / SYSTEM_SAMPLE_RATE_HZ;
+    Result.dDecodeUs         = iDecodeNs / 1000.0 / iNumFrames;
+    Result.dEncodeUs         = iEncodeNs / 1000.0 / iNumFrames;
+    Result.dMixOpUs          = iMixNs / 1000.0 / iNumFrames / SERVER_BENCHMARK_NUM_MIX_CHANNELS;
+
+    const double dTaskBudgetUs = SERVER_BENCHMARK_TASK_BUDGET * Result.dFrameDurationUs;
+    const double dLoadBudgetUs = SERVER_BENCHMARK_LOAD_LIMIT * Result.dFrameDurationUs * Result.iNumCores;
+
+    // per frame each channel is decoded and encoded once and mixed into each
+    // other channel: N * ( decode + encode ) + N^2 * mix <= load budget
+    const double dMixOpUs = std::max ( Result.dMixOpUs, 1e-6 );
+    const double dCodecUs = Result.dDecodeUs + Result.dEncodeUs;
+
+    Result.iMaxNumChannels = static_cast<int> ( ( sqrt ( dCodecUs * dCodecUs + 4 * dMixOpUs * dLoadBudgetUs ) - dCodecUs ) / ( 2 * dMixOpUs ) );
+    Result.iMaxNumChannels = std::min ( Result.iMaxNumChannels, MAX_NUM_CHANNELS );
+
+    // a decode thread task processes as many channels as fit in the task budget
+    Result.iMTDecodeBlockSize = static_cast<int> ( dTaskBudgetUs / std::max ( Result.dDecodeUs, 1e-3 ) );
+    Result.iMTDecodeBlockSize = std::max ( 1, std::min ( Result.iMTDecodeBlockSize, MAX_NUM_CHANNELS ) );
+
+    // a mix operation is the mixing of one input channel including its share
+    // of the encoding, the share is taken at the maximum number of channels
+    // since the time budget is only critical under full load
+    const double dCostPerMixOpUs = Result.dMixOpUs + Result.dEncodeUs / std::max ( Result.iMaxNumChannels, 1 );
+
+    Result.iMaximumMixOpsInTimeBudget = static_cast<int> ( dTaskBudgetUs / std::max ( dCostPerMixOpUs, 1e-3 ) );
+    Result.iMaximumMixOpsInTimeBudget = std::max ( 1, std::min ( Result.iMaximumMixOpsInTimeBudget, MAX_NUM_CHANNELS * MAX_NUM_CHANNELS ) );
+
+    return Result;
+}
+
+void CServer::ApplyBenchmarkResult ( const CServerBenchmarkResult& Result )
+{
+    // must be called before the server is started since the values are used
+    // in the timer callback without locking
+    iMTDecodeBlockSize         = Result.iMTDecodeBlockSize;
+    iMaximumMixOpsInTimeBudget = Result.iMaximumMixOpsInTimeBudget;
+
+    if ( iMaxNumChannels > Result.iMaxNumChannels )
+    {
+        qWarning() << qUtf8Printable ( QString ( "- the maximum number of channels (%1) exceeds the safe number of channels on this hardware (%2)" )
+            .arg ( iMaxNumChannels )
+            .arg ( Result.iMaxNumChannels ) );
+    }
+}
+
 void CServer::DecodeReceiveDataBlocks ( const int iStartChanCnt,
                                         const int iStopChanCnt,
                                         const int iNumClients )
@@ -1105,14 +1328,42 @@ void CServer::DecodeReceiveData ( const int iChanCnt,
                 pCurCodedData = nullptr;
             }
 
-            // OPUS decode received data stream
-            if ( CurOpusDecoder != nullptr )
+            // export the coded packet for recording purpose (a lost packet is
+            // also passed so that it is concealed when decoding, a frame
+            // suppressed by DTX is recorded as silence)
+            if ( bRecordPacketsInTick && ( CurOpusDecoder != nullptr ) )
+            {
+                JamController.PutPacket ( iCurChanID,
+                                          vecChannels[iCurChanID].GetName(),
+                                          vecChannels[iCurChanID].GetAddress(),
+                                          vecNumAudioChannels[iChanCnt],
+                                          vecAudioComprType[iChanCnt],
+                                          pCurCodedData,
+                                          ( eGetStat == GS_DTX_SILENCE ) ? PACKET_STREAM_DTX_SILENCE_BYTES : iCeltNumCodedBytes );
+            }
+
+            // OPUS decode received data stream (the client suppresses its
+            // silent input in DTX mode, no decoding needed)
+            if ( eGetStat == GS_DTX_SILENCE )
             {
+                std::fill ( vecvecsData[iChanCnt].begin() + iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[iChanCnt],
+                            vecvecsData[iChanCnt].begin() + ( iB * SYSTEM_FRAME_SIZE_SAMPLES + iClientFrameSizeSamples ) * vecNumAudioChannels[iChanCnt],
+                            static_cast<int16_t> ( 0 ) );
+            }
+            else if ( CurOpusDecoder != nullptr )
+            {
+                const qint64 iDecodeStartNs = bMetricsEnabled ? MetricsTimer.nsecsElapsed() : 0;
+
                 iUnused = opus_custom_decode ( CurOpusDecoder,
                                                pCurCodedData,
                                                iCeltNumCodedBytes,
                                                &vecvecsData[iChanCnt][iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[iChanCnt]],
                                                iClientFrameSizeSamples );
+
+                if ( bMetricsEnabled )
+                {
+                    DecodeTimeNs.Add ( MetricsTimer.nsecsElapsed() - iDecodeStartNs );
+                }
             }
         }
 
@@ -1327,11 +1578,18 @@ void CServer::MixEncodeTransmitData ( const int iChanCnt,
 //      optimization it would be better to set it only if the network frame size is changed
 opus_custom_encoder_ctl ( pCurOpusEncoder, OPUS_SET_BITRATE ( CalcBitRateBitsPerSecFromCodedBytes ( iCeltNumCodedBytes, iClientFrameSizeSamples ) ) );
 
+                const qint64 iEncodeStartNs = bMetricsEnabled ? MetricsTimer.nsecsElapsed() : 0;
+
                 iUnused = opus_custom_encode ( pCurOpusEncoder,
                                                &vecsSendData[iB * SYSTEM_FRAME_SIZE_SAMPLES * vecNumAudioChannels[iChanCnt]],
                                                iClientFrameSizeSamples,
                                                &vecvecbyCodedData[iChanCnt][0],
                                                iCeltNumCodedBytes );
+
+                if ( bMetricsEnabled )
+                {
+                    EncodeTimeNs.Add ( MetricsTimer.nsecsElapsed() - iEncodeStartNs );
+                }
             }
 
             // send separate mix to current clients
@@ -1637,6 +1895,43 @@ void CServer::GetConCliParam ( CVector<CHostAddress>& vecHostAddresses,
     }
 }
 
+void CServer::WriteMetrics ( CMetricsWriter& Writer )
+{
+    QList<CChannel*> vecpChannels;
+    QStringList      vecstrLabels;
+
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( vecChannels[i].IsConnected() )
+        {
+            vecpChannels.append ( &vecChannels[i] );
+            vecstrLabels.append ( CMetricsWriter::Label ( "channel", QString::number ( i ) ) + "," +
+                                  CMetricsWriter::Label ( "name", vecChannels[i].GetName() ) + "," +
+                                  CMetricsWriter::Label ( "address", vecChannels[i].GetAddress().toString() ) );
+        }
+    }
+
+    Writer.AddFamily ( "jamulus_server_channels_connected", "gauge", "Connected channels." );
+    Writer.Add ( "jamulus_server_channels_connected", "", vecpChannels.size() );
+
+    CChannel::WriteMetrics ( Writer, "jamulus_server_channel", vecpChannels, vecstrLabels );
+
+    Writer.AddFamily ( "jamulus_server_tick_duration_seconds", "histogram", "Processing time of a server tick." );
+    Writer.AddHistogram ( "jamulus_server_tick_duration_seconds", "", TickDurationHist );
+
+    Writer.AddFamily ( "jamulus_server_deadline_misses_total", "counter", "Ticks which took longer than a frame." );
+    Writer.Add ( "jamulus_server_deadline_misses_total", "", NumDeadlineMisses.Get() );
+
+    Writer.AddFamily ( "jamulus_server_decode_seconds_total", "counter", "CPU time of the OPUS decoder." );
+    Writer.Add ( "jamulus_server_decode_seconds_total", "", static_cast<double> ( DecodeTimeNs.Get() ) / 1e9 );
+
+    Writer.AddFamily ( "jamulus_server_encode_seconds_total", "counter", "CPU time of the OPUS encoder." );
+    Writer.Add ( "jamulus_server_encode_seconds_total", "", static_cast<double> ( EncodeTimeNs.Get() ) / 1e9 );
+
+    Writer.AddFamily ( "jamulus_server_recorder_overflows_total", "counter", "Frames dropped because the recorder ring was full." );
+    Writer.Add ( "jamulus_server_recorder_overflows_total", "", JamController.GetNumRecorderOverflows() );
+}
+
 void CServer::SetEnableRecording ( bool bNewEnableRecording )
 {
     JamController.SetEnableRecording ( bNewEnableRecording, IsRunning() );
@@ -32,6 +32,7 @@
 #include <QDateTime>
 #include <QHostAddress>
 #include <QFileInfo>
+#include <QElapsedTimer>
 #include <QtConcurrent>
 #include <QFutureSynchronizer>
 #include <algorithm>
@@ -44,6 +45,9 @@
 #include "buffer.h"
 #include "signalhandler.h"
 #include "socket.h"
+#include "packettrace.h"
+#include "netemulator.h"
+#include "metrics.h"
 #include "channel.h"
 #include "util.h"
 #include "serverlogging.h"
@@ -54,6 +58,25 @@
 // no valid channel number
 #define INVALID_CHANNEL_ID                  ( MAX_NUM_CHANNELS + 1 )
 
+// multithreading block sizes which are used if the server was not calibrated
+// (approximate limits as observed on a GCP e2-standard instance, see #653)
+#define MT_DEFAULT_DECODE_BLOCK_SIZE        10
+#define MT_DEFAULT_MAX_MIX_OPS_IN_BUDGET    500
+
+// number of frames processed by the server benchmark (--benchmark) and by the
+// quick calibration at startup (--calibrate)
+#define SERVER_BENCHMARK_NUM_FRAMES         2000
+#define SERVER_CALIBRATION_NUM_FRAMES       200
+
+// number of input channels the benchmark mixes into one output channel
+#define SERVER_BENCHMARK_NUM_MIX_CHANNELS   10
+
+// fraction of the frame duration a single decode or mix/encode thread task
+// may use and fraction of the total processing time which may be used at the
+// maximum channel count
+#define SERVER_BENCHMARK_TASK_BUDGET        0.5
+#define SERVER_BENCHMARK_LOAD_LIMIT         0.7
+
 
 /* Classes ********************************************************************/
 #if ( defined ( WIN32 ) || defined ( _WIN32 ) )
@@ -165,6 +188,35 @@ template<>
 class CServerSlots<0> {};
 
 
+// result of the server benchmark: measured processing times and the values
+// derived from them
+class CServerBenchmarkResult
+{
+public:
+    CServerBenchmarkResult() :
+        iFrameSizeSamples          ( 0 ),
+        iNumCores                  ( 1 ),
+        dFrameDurationUs           ( 0 ),
+        dDecodeUs                  ( 0 ),
+        dMixOpUs                   ( 0 ),
+        dEncodeUs                  ( 0 ),
+        iMTDecodeBlockSize         ( MT_DEFAULT_DECODE_BLOCK_SIZE ),
+        iMaximumMixOpsInTimeBudget ( MT_DEFAULT_MAX_MIX_OPS_IN_BUDGET ),
+        iMaxNumChannels            ( 0 ) {}
+
+    QString ToString() const;
+
+    int    iFrameSizeSamples;
+    int    iNumCores;                  // number of cores available for the processing
+    double dFrameDurationUs;
+    double dDecodeUs;                  // decoding of one stereo frame
+    double dMixOpUs;                   // mixing of one stereo input into one stereo output
+    double dEncodeUs;                  // encoding of one stereo frame
+    int    iMTDecodeBlockSize;         // number of channels decoded per thread task
+    int    iMaximumMixOpsInTimeBudget; // number of mix operations per thread task
+    int    iMaxNumChannels;            // maximum safe number of channels
+};
+
 class CServer :
         public QObject,
         public CServerSlots<MAX_NUM_CHANNELS>
@@ -194,6 +246,11 @@ public:
     void Stop();
     bool IsRunning() { return HighPrecisionTimer.isActive(); }
 
+    // times decoding, mixing and encoding on this hardware and derives the
+    // multithreading block sizes and the maximum safe number of channels
+    CServerBenchmarkResult RunBenchmark ( const int iNumFrames );
+    void ApplyBenchmarkResult ( const CServerBenchmarkResult& Result );
+
     bool PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
                         const int               iNumBytesRead,
                         const CHostAddress&     HostAdr,
@@ -220,11 +277,40 @@ public:
     QString GetRecordingDir() { return JamController.GetRecordingDir(); }
 
     void SetRecordingDir( QString newRecordingDir )
-        { JamController.SetRecordingDir ( newRecordingDir, iServerFrameSizeSamples, bDisableRecording ); }
+        { JamController.SetRecordingDir ( newRecordingDir, iServerFrameSizeSamples, bDisableRecording, iMaxNumChannels ); }
+
+    // record the coded packets instead of the decoded audio (decoded offline)
+    void SetRecordCodedPackets ( const bool bNewRecordCodedPackets )
+        { JamController.SetRecordCodedPackets ( bNewRecordCodedPackets ); }
 
     void CreateAndSendRecorderStateForAllConChannels();
 
 
+    // Packet trace ------------------------------------------------------------
+    void StartPacketTrace ( const QString& strFileName, const bool bHashOnly )
+        { PacketTrace.Open ( strFileName, bHashOnly ); Socket.SetPacketTrace ( &PacketTrace ); }
+
+    // the replay is offline only (see CPacketTraceReplay), the application
+    // quits when the whole trace was replayed
+    void StartPacketTraceReplay ( const QString& strFileName, const double dSpeed )
+    {
+        QObject::connect ( &PacketTraceReplay, &CPacketTraceReplay::Finished,
+                           QCoreApplication::instance(), &QCoreApplication::quit, Qt::QueuedConnection );
+
+        PacketTraceReplay.Start ( &Socket, strFileName, dSpeed );
+    }
+
+    // network impairment emulation of the sent and received packets
+    void StartNetworkEmulator ( const QStringList& slRules, const QString& strConfigFileName, const int iSeed )
+        { NetworkEmulator.Init ( slRules, strConfigFileName, iSeed ); Socket.SetNetworkEmulator ( &NetworkEmulator ); }
+
+
+    // Metrics -----------------------------------------------------------------
+    // the tick and codec timing is only measured if the metrics are enabled
+    void EnableMetrics() { MetricsTimer.start(); bMetricsEnabled = true; }
+    void WriteMetrics ( CMetricsWriter& Writer );
+
+
     // Server list management --------------------------------------------------
     void UpdateServerList() { ServerListManager.Update(); }
 
@@ -326,6 +412,16 @@ protected:
     // variables needed for multithreading support
     bool                      bUseMultithreading;
     QFutureSynchronizer<void> FutureSynchronizer;
+    int                       iMTDecodeBlockSize;
+    int                       iMaximumMixOpsInTimeBudget;
+
+    // metrics (the counters can be increased in the multithreading tasks)
+    bool                      bMetricsEnabled;
+    QElapsedTimer             MetricsTimer;
+    CMetricsDurationHistogram TickDurationHist;
+    CMetricsCounter           NumDeadlineMisses;
+    CMetricsCounter           DecodeTimeNs;
+    CMetricsCounter           EncodeTimeNs;
 
     bool CreateLevelsForAllConChannels  ( const int                        iNumClients,
                                           const CVector<int>&              vecNumAudioChannels,
@@ -340,6 +436,8 @@ protected:
     QMutex                     Mutex;
     QMutex                     MutexWelcomeMessage;
     bool                       bChannelIsNowDisconnected;
+    bool                       bRecordFramesInTick;  // recording state of the current tick
+    bool                       bRecordPacketsInTick; // (also read by the decoding threads)
 
     // audio encoder/decoder
     OpusCustomMode*            Opus64Mode[MAX_NUM_CHANNELS];
@@ -372,8 +470,14 @@ protected:
     // Channel levels
     CVector<uint16_t>          vecChannelLevels;
 
-    // actual working objects
+    // actual working objects (the packet trace and the network emulator must
+    // outlive the socket which uses them, the socket must outlive the trace
+    // replay, the emulator thread which sends through the socket is stopped
+    // in the destructor)
+    CPacketTrace               PacketTrace;
+    CNetworkEmulator           NetworkEmulator;
     CHighPrioSocket            Socket;
+    CPacketTraceReplay         PacketTraceReplay;
 
     // logging
     CServerLogging             Logging;
@@ -411,11 +515,6 @@ signals:
     void Stopped();
     void ClientDisconnected ( const int iChID );
     void SvrRegStatusChanged();
-    void AudioFrame ( const int              iChID,
-                      const QString          stChName,
-                      const CHostAddress     RecHostAddr,
-                      const int              iNumAudChan,
-                      const CVector<int16_t> vecsData );
 
     void CLVersionAndOSReceived ( CHostAddress           InetAddr,
                                   COSUtil::EOpSystemType eOSType,
@@ -474,6 +573,9 @@ public slots:
     void OnCLReqServerList ( CHostAddress InetAddr, QString ServerName )
         { ServerListManager.CentralServerQueryServerList ( InetAddr, ServerName ); }
 
+    void OnCLSubscribeSession ( CHostAddress InetAddr, QString strSessionName )
+        { ServerListManager.CentralServerSubscribeSession ( InetAddr, strSessionName ); }
+
     void OnCLReqVersionAndOS ( CHostAddress InetAddr )
         { ConnLessProtocol.CreateCLVersionAndOSMes ( InetAddr ); }
 
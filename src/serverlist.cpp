@@ -284,23 +284,21 @@ void CServerListManager::OnTimerPollList()
 
     QMutexLocker locker ( &Mutex );
 
-    // Check all list entries except of the very first one (which is the central
-    // server entry) if they are still valid.
-    // Note that we have to use "ServerList.size()" function in the for loop
-    // since we may remove elements from the server list inside the for loop.
-    for ( int iIdx = 1; iIdx < ServerList.size(); )
+    // 1 minute = 60 * 1000 ms
+    RemoveExpiredServerListEntries ( SERVLIST_TIME_OUT_MINUTES * 60000, vecRemovedHostAddr );
+
+    // remove session subscriptions which were not renewed by the client
+    QMultiHash<QString, CSessionSubscription>::iterator it = SessionSubscriptions.begin();
+
+    while ( it != SessionSubscriptions.end() )
     {
-        // 1 minute = 60 * 1000 ms
-        if ( ServerList[iIdx].RegisterTime.elapsed() > ( SERVLIST_TIME_OUT_MINUTES * 60000 ) )
+        if ( it.value().SubscribeTime.elapsed() > SESSION_SUBSCR_TIME_OUT_MS )
         {
-            // remove this list entry
-            vecRemovedHostAddr.Add ( ServerList[iIdx].HostAddr );
-            ServerList.removeAt ( iIdx );
+            it = RemoveSessionSubscription ( it );
         }
         else
         {
-            // move to the next entry (only on else)
-            iIdx++;
+            ++it;
         }
     }
 
@@ -352,52 +350,47 @@ void CServerListManager::CentralServerRegisterServer ( const CHostAddress&    In
 
         const int iCurServerListSize = ServerList.size();
 
-        int serverNameAddon = 1;
-        QString ServerName = ServerInfo.strName;
+        // Check if server is already registered (the very first list entry is
+        // per definition the central server (i.e., this server) and is not
+        // part of the index).
+        int iSelIdx = ServerAddrIndex.value ( GetHostAddrKey ( InetAddr ), INVALID_INDEX );
 
-        // Check if server is already registered.
-        // The very first list entry must not be checked since
-        // this is per definition the central server (i.e., this server)
-        int iSelIdx = INVALID_INDEX; // initialize with an illegal value
+        // if the server name is already taken by another server, search for a
+        // new name by appending a number
+        int     serverNameAddon = 1;
+        QString ServerName      = ServerInfo.strName;
+        int     iNameIdx        = SessionNameIndex.value ( ServerName, INVALID_INDEX );
 
-        for ( int iIdx = 1; iIdx < iCurServerListSize; iIdx++ )
+        while ( ( iNameIdx != INVALID_INDEX ) && ( iNameIdx != iSelIdx ) )
         {
-            if ( ServerList[iIdx].HostAddr == InetAddr )
-            {
-                // store entry index
-                iSelIdx = iIdx;
-
-                // entry found, leave for-loop
-                continue;
-            }
-            else if ( ServerList[iIdx].strName == ServerName )
-            {
-                //server name already taken by another InetAddr
-
-                //search for new name
-                ServerName = ServerInfo.strName + QString::number(serverNameAddon);
-
-                //increment serverNameAddon in case this name is also already taken
-                serverNameAddon++;
-
-                //restart loop with new server name
-                iIdx = 0;
-            }
+            ServerName = ServerInfo.strName + QString::number ( serverNameAddon );
+            serverNameAddon++;
+            iNameIdx = SessionNameIndex.value ( ServerName, INVALID_INDEX );
         }
 
         // if server is not yet registered, we have to create a new entry
         if ( iSelIdx == INVALID_INDEX )
         {
-            // check for maximum allowed number of servers in the server list
-            if ( iCurServerListSize < MAX_NUM_SERVERS_IN_SERVER_LIST )
+            // check for maximum allowed number of sessions in the directory
+            if ( iCurServerListSize < MAX_NUM_SESSIONS_IN_DIRECTORY )
             {
                 // create a new server list entry and init with received data
                 ServerList.append ( CServerListEntry ( InetAddr, LInetAddr, ServerInfo, ServerName ) );
                 iSelIdx = iCurServerListSize;
+
+                ServerAddrIndex.insert ( GetHostAddrKey ( InetAddr ), iSelIdx );
+                SessionNameIndex.insert ( ServerName, iSelIdx );
             }
         }
         else
         {
+            // the session may have been renamed, update the name index
+            if ( ServerList[iSelIdx].strName != ServerName )
+            {
+                SessionNameIndex.remove ( ServerList[iSelIdx].strName );
+                SessionNameIndex.insert ( ServerName, iSelIdx );
+            }
+
             // update all data and call update registration function
             ServerList[iSelIdx].LHostAddr        = LInetAddr;
             ServerList[iSelIdx].strName          = ServerName;
@@ -409,14 +402,25 @@ void CServerListManager::CentralServerRegisterServer ( const CHostAddress&    In
             ServerList[iSelIdx].UpdateRegistration();
         }
 
-        // tsConsoleStream << "Requested to register entry for "
-        //                 << InetAddr.toString() << " (" << LInetAddr.toString() << ")"
-        //                 << ": " << ServerName << endl;
-
         pConnLessProtocol->CreateCLRegisterServerResp ( InetAddr, iSelIdx == INVALID_INDEX
                                                             ? ESvrRegResult::SRR_CENTRAL_SVR_FULL
                                                             : ESvrRegResult::SRR_REGISTERED,
                                                             ServerName );
+
+        // push the session address to all clients which are waiting for it
+        if ( iSelIdx != INVALID_INDEX )
+        {
+            QMultiHash<QString, CSessionSubscription>::iterator it = SessionSubscriptions.find ( ServerName );
+
+            while ( ( it != SessionSubscriptions.end() ) && ( it.key() == ServerName ) )
+            {
+                pConnLessProtocol->CreateCLSessionAddressMes ( it.value().HostAddr,
+                                                               GetServerAddrForClient ( iSelIdx, it.value().HostAddr ),
+                                                               ServerName );
+
+                it = RemoveSessionSubscription ( it );
+            }
+        }
     }
 }
 
@@ -429,24 +433,14 @@ void CServerListManager::CentralServerUnregisterServer ( const CHostAddress& Ine
 
         QMutexLocker locker ( &Mutex );
 
-        const int iCurServerListSize = ServerList.size();
+        // Find the server to unregister in the index. The very first list
+        // entry is per definition the central server (i.e., this server) and
+        // is not part of the index.
+        const int iIdx = ServerAddrIndex.value ( GetHostAddrKey ( InetAddr ), INVALID_INDEX );
 
-        // Find the server to unregister in the list. The very first list entry
-        // must not be checked since this is per definition the central server
-        // (i.e., this server).
-        for ( int iIdx = 1; iIdx < iCurServerListSize; iIdx++ )
+        if ( iIdx != INVALID_INDEX )
         {
-            if ( ServerList[iIdx].HostAddr == InetAddr )
-            {
-                // remove this list entry
-                ServerList.removeAt ( iIdx );
-
-                // entry found, leave for-loop (it is important to exit the
-                // for loop since when we remove an item from the server list,
-                // "iCurServerListSize" is not correct anymore and we could get
-                // a segmentation fault)
-                break;
-            }
+            RemoveServerListEntry ( iIdx );
         }
     }
 }
@@ -457,70 +451,172 @@ void CServerListManager::CentralServerQueryServerList ( const CHostAddress& Inet
 
     if ( bIsCentralServer && bEnabled )
     {
-        const int iCurServerListSize = ServerList.size();
+        // per definition the first entry is the central server itself, the
+        // only other entry is the requested session (if it is registered)
+        CVector<CServerInfo> vecServerInfo ( 1 );
+        vecServerInfo[0] = ServerList[0];
 
-        // allocate memory for the entire list
-        CVector<CServerInfo> vecServerInfo ( iCurServerListSize );
+        const int iIdx = SessionNameIndex.value ( ServerName, INVALID_INDEX );
 
-        // copy the list (we have to copy it since the message requires
-        // a vector but the list is actually stored in a QList object and
-        // not in a vector object
-        for ( int iIdx = 0; iIdx < iCurServerListSize; iIdx++ )
+        if ( iIdx != INVALID_INDEX )
         {
-            if ( (ServerName != ServerList[iIdx].strName) )//&& (ServerName != "") )
-            {
-                continue;
-            }
+            vecServerInfo.Add ( ServerList[iIdx] );
+            vecServerInfo[1].HostAddr = GetServerAddrForClient ( iIdx, InetAddr );
+        }
+
+        // since the list has at most two entries, there is no UDP
+        // fragmentation issue and we do not have to send the reduced list
+        pConnLessProtocol->CreateCLServerListMes ( InetAddr, vecServerInfo );
+    }
+}
+
+void CServerListManager::CentralServerSubscribeSession ( const CHostAddress& InetAddr,
+                                                         const QString&      strSessionName )
+{
+    QMutexLocker locker ( &Mutex );
+
+    if ( bIsCentralServer && bEnabled )
+    {
+        // if the session is already registered, we can answer right away
+        const int iIdx = SessionNameIndex.value ( strSessionName, INVALID_INDEX );
+
+        if ( iIdx != INVALID_INDEX )
+        {
+            pConnLessProtocol->CreateCLSessionAddressMes ( InetAddr,
+                                                           GetServerAddrForClient ( iIdx, InetAddr ),
+                                                           strSessionName );
+            return;
+        }
 
-            // copy list item
-            vecServerInfo[iIdx] = ServerList[iIdx];
+        // the session is not yet registered, store (or renew) the subscription
+        // so that the address is pushed as soon as the session registers
+        QMultiHash<QString, CSessionSubscription>::iterator it = SessionSubscriptions.find ( strSessionName );
 
-            if ( iIdx > 0 )
+        while ( ( it != SessionSubscriptions.end() ) && ( it.key() == strSessionName ) )
+        {
+            if ( it.value().HostAddr == InetAddr )
             {
-                // check if the address of the client which is requesting the
-                // list is the same address as one server in the list -> in this
-                // case he has to connect to the local host address and port
-                // to allow for NAT.
-                if ( vecServerInfo[iIdx].HostAddr.InetAddr == InetAddr.InetAddr )
-                {
-                    vecServerInfo[iIdx].HostAddr = ServerList[iIdx].LHostAddr;
-                }
-                else if ( !NetworkUtil::IsPrivateNetworkIP ( InetAddr.InetAddr ) &&
-                          NetworkUtil::IsPrivateNetworkIP ( vecServerInfo[iIdx].HostAddr.InetAddr ) &&
-                          !NetworkUtil::IsPrivateNetworkIP ( ServerList[iIdx].LHostAddr.InetAddr ) )
-                {
-                    // We've got a request from a public client, the server
-                    // list's entry's primary address is a private address,
-                    // but it supplied an additional public address using
-                    // --serverpublicip.
-                    // In this case, use the latter.
-                    // This is common when running a central server with slave
-                    // servers behind a NAT and dealing with external, public
-                    // clients.
-                    vecServerInfo[iIdx].HostAddr = ServerList[iIdx].LHostAddr;
-                }
-                else
-                {
-                    // create "send empty message" for all registered servers
-                    // (except of the very first list entry since this is this
-                    // server (central server) per definition) and also it is
-                    // not required to send this message, if the server is on
-                    // the same computer
-                    pConnLessProtocol->CreateCLSendEmptyMesMes (
-                        vecServerInfo[iIdx].HostAddr,
-                        InetAddr );
-                }
+                it.value().SubscribeTime.start();
+                return;
             }
+
+            ++it;
         }
 
-        // send the server list to the client, since we do not know that the client
-        // has a UDP fragmentation issue, we send both lists, the reduced and the
-        // normal list after each other
-        pConnLessProtocol->CreateCLRedServerListMes ( InetAddr, vecServerInfo );
-        pConnLessProtocol->CreateCLServerListMes ( InetAddr, vecServerInfo );
+        // limit the memory a single client (or a flood of spoofed requests)
+        // can allocate on the central server, a rejected client retries and
+        // gets through as soon as older subscriptions time out
+        if ( ( SessionSubscriptions.size() >= MAX_NUM_SESSION_SUBSCR ) ||
+             ( NumSessionSubscrPerAddr.value ( InetAddr.InetAddr, 0 ) >= MAX_NUM_SESSION_SUBSCR_PER_ADDR ) )
+        {
+            return;
+        }
+
+        SessionSubscriptions.insert ( strSessionName, CSessionSubscription ( InetAddr, strSessionName ) );
+        NumSessionSubscrPerAddr[InetAddr.InetAddr]++;
+    }
+}
+
+QMultiHash<QString, CSessionSubscription>::iterator
+    CServerListManager::RemoveSessionSubscription ( QMultiHash<QString, CSessionSubscription>::iterator it )
+{
+    // note that the mutex must be locked by the caller
+    QHash<QHostAddress, int>::iterator itNum = NumSessionSubscrPerAddr.find ( it.value().HostAddr.InetAddr );
+
+    if ( ( itNum != NumSessionSubscrPerAddr.end() ) && ( --itNum.value() <= 0 ) )
+    {
+        NumSessionSubscrPerAddr.erase ( itNum );
+    }
+
+    return SessionSubscriptions.erase ( it );
+}
+
+void CServerListManager::RemoveServerListEntry ( const int iIdx )
+{
+    // note that the mutex must be locked by the caller
+    const int iLastIdx = ServerList.size() - 1;
+
+    SessionNameIndex.remove ( ServerList[iIdx].strName );
+    ServerAddrIndex.remove ( GetHostAddrKey ( ServerList[iIdx].HostAddr ) );
+
+    // the order of the list entries is not relevant, therefore the last entry
+    // is moved into the gap so that only its index slots have to be updated
+    // instead of rebuilding the complete index
+    if ( iIdx != iLastIdx )
+    {
+        ServerList[iIdx] = ServerList[iLastIdx];
+
+        SessionNameIndex.insert ( ServerList[iIdx].strName, iIdx );
+        ServerAddrIndex.insert ( GetHostAddrKey ( ServerList[iIdx].HostAddr ), iIdx );
+    }
+
+    ServerList.removeLast();
+}
+
+void CServerListManager::RemoveExpiredServerListEntries ( const qint64           iTimeOutMs,
+                                                          CVector<CHostAddress>& vecRemovedHostAddr )
+{
+    // note that the mutex must be locked by the caller
+
+    // Check all list entries except of the very first one (which is the central
+    // server entry) if they are still valid.
+    // Note that we have to use "ServerList.size()" function in the for loop
+    // since we may remove elements from the server list inside the for loop.
+    for ( int iIdx = 1; iIdx < ServerList.size(); )
+    {
+        if ( ServerList[iIdx].RegisterTime.elapsed() > iTimeOutMs )
+        {
+            // remove this list entry, the last entry is moved to this position
+            // and must be checked in the next iteration
+            vecRemovedHostAddr.Add ( ServerList[iIdx].HostAddr );
+            RemoveServerListEntry ( iIdx );
+        }
+        else
+        {
+            // move to the next entry (only on else)
+            iIdx++;
+        }
     }
 }
 
+CHostAddress CServerListManager::GetServerAddrForClient ( const int           iIdx,
+                                                          const CHostAddress& ClientInetAddr )
+{
+    // note that the mutex must be locked by the caller
+
+    // check if the address of the client which is requesting the
+    // list is the same address as one server in the list -> in this
+    // case he has to connect to the local host address and port
+    // to allow for NAT.
+    if ( ServerList[iIdx].HostAddr.InetAddr == ClientInetAddr.InetAddr )
+    {
+        return ServerList[iIdx].LHostAddr;
+    }
+    else if ( !NetworkUtil::IsPrivateNetworkIP ( ClientInetAddr.InetAddr ) &&
+              NetworkUtil::IsPrivateNetworkIP ( ServerList[iIdx].HostAddr.InetAddr ) &&
+              !NetworkUtil::IsPrivateNetworkIP ( ServerList[iIdx].LHostAddr.InetAddr ) )
+    {
+        // We've got a request from a public client, the server
+        // list's entry's primary address is a private address,
+        // but it supplied an additional public address using
+        // --serverpublicip.
+        // In this case, use the latter.
+        // This is common when running a central server with slave
+        // servers behind a NAT and dealing with external, public
+        // clients.
+        return ServerList[iIdx].LHostAddr;
+    }
+
+    // create "send empty message" for all registered servers
+    // (except of the very first list entry since this is this
+    // server (central server) per definition) and also it is
+    // not required to send this message, if the server is on
+    // the same computer
+    pConnLessProtocol->CreateCLSendEmptyMesMes ( ServerList[iIdx].HostAddr,
+                                                 ClientInetAddr );
+
+    return ServerList[iIdx].HostAddr;
+}
 
 /* Slave server functionality *************************************************/
 void CServerListManager::StoreRegistrationResult ( ESvrRegResult eResult )
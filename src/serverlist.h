@@ -65,6 +65,8 @@ private network.
 #include <QObject>
 #include <QLocale>
 #include <QList>
+#include <QHash>
+#include <QMultiHash>
 #include <QElapsedTimer>
 #include <QMutex>
 #if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
@@ -135,6 +137,22 @@ public:
     QElapsedTimer RegisterTime;
 };
 
+// pending subscription of a client for the address of a session which is not
+// yet registered at the central server
+class CSessionSubscription
+{
+public:
+    CSessionSubscription() {}
+
+    CSessionSubscription ( const CHostAddress& NHAddr,
+                           const QString&      NsSessionName ) :
+        HostAddr ( NHAddr ), strSessionName ( NsSessionName ) { SubscribeTime.start(); }
+
+    CHostAddress  HostAddr;
+    QString       strSessionName;
+    QElapsedTimer SubscribeTime;
+};
+
 class CServerListManager : public QObject
 {
     Q_OBJECT
@@ -172,6 +190,8 @@ public:
 
     void CentralServerQueryServerList ( const CHostAddress& InetAddr, const QString& ServerName);
 
+    void CentralServerSubscribeSession ( const CHostAddress& InetAddr, const QString& strSessionName );
+
     void SlaveServerUnregister() { SlaveServerRegisterServer ( false ); }
 
     // set server infos -> per definition the server info of this server is
@@ -200,6 +220,20 @@ protected:
     void SlaveServerRegisterServer ( const bool bIsRegister );
     void SetSvrRegStatus ( ESvrRegStatus eNSvrRegStatus );
 
+    CHostAddress GetServerAddrForClient ( const int           iIdx,
+                                          const CHostAddress& ClientInetAddr );
+
+    void RemoveServerListEntry ( const int iIdx );
+
+    void RemoveExpiredServerListEntries ( const qint64           iTimeOutMs,
+                                          CVector<CHostAddress>& vecRemovedHostAddr );
+
+    QMultiHash<QString, CSessionSubscription>::iterator
+        RemoveSessionSubscription ( QMultiHash<QString, CSessionSubscription>::iterator it );
+
+    static quint64 GetHostAddrKey ( const CHostAddress& HostAddr )
+        { return ( static_cast<quint64> ( HostAddr.InetAddr.toIPv4Address() ) << 16 ) | HostAddr.iPort; }
+
     QTimer                  TimerPollList;
     QTimer                  TimerRegistering;
     QTimer                  TimerPingServerInList;
@@ -210,6 +244,16 @@ protected:
 
     QList<CServerListEntry> ServerList;
 
+    // session directory index (central server only): maps the session name
+    // and the server address to the position in the server list
+    QHash<QString, int>     SessionNameIndex;
+    QHash<quint64, int>     ServerAddrIndex;
+
+    // pending session subscriptions keyed by the session name and their number
+    // per client IP address (central server only)
+    QMultiHash<QString, CSessionSubscription> SessionSubscriptions;
+    QHash<QHostAddress, int>                  NumSessionSubscrPerAddr;
+
     QString                 strCentralServerAddress;
     bool                    bEnabled;
     bool                    bIsCentralServer;
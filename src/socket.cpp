@@ -28,6 +28,8 @@
 #include "socket.h"
 #include "server.h"
 #include "client.h"
+#include "packettrace.h"
+#include "netemulator.h"
 
 
 /* Implementation *************************************************************/
@@ -162,9 +164,38 @@ CSocket::~CSocket()
 #endif
 }
 
+void CSocket::SetNetworkEmulator ( CNetworkEmulator* pNNetworkEmulator )
+{
+    if ( pNNetworkEmulator->IsEnabled() )
+    {
+        pNNetworkEmulator->Start ( this );
+        pNetworkEmulator = pNNetworkEmulator;
+    }
+}
+
 void CSocket::SendPacket ( const CVector<uint8_t>& vecbySendBuf,
                            const CHostAddress&     HostAddr )
 {
+    // the network emulator sends the packet later (if a rule matches)
+    if ( ( pNetworkEmulator != nullptr ) &&
+         pNetworkEmulator->Add ( CNetworkEmulator::ND_SEND, vecbySendBuf, vecbySendBuf.Size(), HostAddr ) )
+    {
+        return;
+    }
+
+    SendPacketDirect ( vecbySendBuf, HostAddr );
+}
+
+void CSocket::SendPacketDirect ( const CVector<uint8_t>& vecbySendBuf,
+                                 const CHostAddress&     HostAddr )
+{
+    // an offline session (e.g. a replayed trace) must not send anything to the
+    // real hosts
+    if ( bOfflineMode )
+    {
+        return;
+    }
+
     QMutexLocker locker ( &Mutex );
 
     const int iVecSizeOut = vecbySendBuf.Size();
@@ -240,13 +271,37 @@ void CSocket::OnDataReceived()
     RecHostAddr.InetAddr.setAddress ( ntohl ( SenderAddr.sin_addr.s_addr ) );
     RecHostAddr.iPort = ntohs ( SenderAddr.sin_port );
 
+    // the live traffic would interleave with the replayed packets
+    if ( bOfflineMode )
+    {
+        return;
+    }
+
+    if ( pPacketTrace != nullptr )
+    {
+        pPacketTrace->Add ( vecbyRecBuf, iNumBytesRead, RecHostAddr );
+    }
+
+    // the network emulator processes the packet later (if a rule matches)
+    if ( ( pNetworkEmulator != nullptr ) &&
+         pNetworkEmulator->Add ( CNetworkEmulator::ND_RECEIVE, vecbyRecBuf, iNumBytesRead, RecHostAddr ) )
+    {
+        return;
+    }
 
+    ProcessPacket ( vecbyRecBuf, iNumBytesRead, RecHostAddr );
+}
+
+void CSocket::ProcessPacket ( const CVector<uint8_t>& vecbyPacket,
+                              const int               iNumBytesRead,
+                              const CHostAddress&     HostAddr )
+{
     // check if this is a protocol message
     int              iRecCounter;
     int              iRecID;
     CVector<uint8_t> vecbyMesBodyData;
 
-    if ( !CProtocol::ParseMessageFrame ( vecbyRecBuf,
+    if ( !CProtocol::ParseMessageFrame ( vecbyPacket,
                                          iNumBytesRead,
                                          vecbyMesBodyData,
                                          iRecCounter,
@@ -258,14 +313,14 @@ void CSocket::OnDataReceived()
 
 // TODO a copy of the vector is used -> avoid malloc in real-time routine
 
-            emit ProtcolCLMessageReceived ( iRecID, vecbyMesBodyData, RecHostAddr );
+            emit ProtcolCLMessageReceived ( iRecID, vecbyMesBodyData, HostAddr );
         }
         else
         {
 
 // TODO a copy of the vector is used -> avoid malloc in real-time routine
 
-            emit ProtcolMessageReceived ( iRecCounter, iRecID, vecbyMesBodyData, RecHostAddr );
+            emit ProtcolMessageReceived ( iRecCounter, iRecID, vecbyMesBodyData, HostAddr );
         }
     }
     else
@@ -274,10 +329,10 @@ void CSocket::OnDataReceived()
         if ( bIsClient )
         {
 
-            if ( pChannel->GetAddress() == RecHostAddr )
+            if ( pChannel->GetAddress() == HostAddr )
             {
                 // client channel:
-                switch ( pChannel->PutAudioData ( vecbyRecBuf, iNumBytesRead, RecHostAddr ) )
+                switch ( pChannel->PutAudioData ( vecbyPacket, iNumBytesRead, HostAddr ) )
                 {
                 case PS_AUDIO_ERR:
                 case PS_GEN_ERROR:
@@ -291,7 +346,7 @@ void CSocket::OnDataReceived()
 
                 case PS_AUDIO_INVALID:
                     // inform about received invalid packet by fireing an event
-                    emit InvalidPacketReceived ( RecHostAddr );
+                    emit InvalidPacketReceived ( HostAddr );
                     break;
 
                 default:
@@ -303,9 +358,9 @@ void CSocket::OnDataReceived()
             {
                 // p2p channel:
                 int iCurChanID;
-                if( pClient->PutAudioData ( vecbyRecBuf, iNumBytesRead, RecHostAddr, iCurChanID ) )
+                if( pClient->PutAudioData ( vecbyPacket, iNumBytesRead, HostAddr, iCurChanID ) )
                 {
-                    emit NewP2pConnection ( iCurChanID, RecHostAddr );
+                    emit NewP2pConnection ( iCurChanID, HostAddr );
                 }
             }
         }
@@ -315,10 +370,10 @@ void CSocket::OnDataReceived()
 
             int iCurChanID;
 
-            if ( pServer->PutAudioData ( vecbyRecBuf, iNumBytesRead, RecHostAddr, iCurChanID ) )
+            if ( pServer->PutAudioData ( vecbyPacket, iNumBytesRead, HostAddr, iCurChanID ) )
             {
                 // we have a new connection, emit a signal
-                emit NewConnection ( iCurChanID, RecHostAddr );
+                emit NewConnection ( iCurChanID, HostAddr );
 
                 // this was an audio packet, start server if it is in sleep mode
                 if ( !pServer->IsRunning() )
@@ -333,7 +388,7 @@ void CSocket::OnDataReceived()
             if ( iCurChanID == INVALID_CHANNEL_ID )
             {
                 // fire message for the state that no free channel is available
-                emit ServerFull ( RecHostAddr );
+                emit ServerFull ( HostAddr );
             }
         }
     }
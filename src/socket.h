@@ -31,6 +31,7 @@
 #include <QThread>
 #include <QMutex>
 #include <vector>
+#include <atomic>
 #include "global.h"
 #include "protocol.h"
 #include "util.h"
@@ -43,8 +44,10 @@
 // The header files channel.h and server.h require to include this header file
 // so we get a cyclic dependency. To solve this issue, a prototype of the
 // channel class and server class is defined here.
-class CServer;  // forward declaration of CServer
-class CChannel; // forward declaration of CChannel
+class CServer;          // forward declaration of CServer
+class CChannel;         // forward declaration of CChannel
+class CPacketTrace;     // forward declaration of CPacketTrace
+class CNetworkEmulator; // forward declaration of CNetworkEmulator
 
 
 /* Definitions ****************************************************************/
@@ -64,23 +67,49 @@ public:
               const quint16 iPortNumber )
         : pClient ( pNewClient ),
           pChannel ( pNewChannel ),
+          pPacketTrace ( nullptr ),
+          pNetworkEmulator ( nullptr ),
           bIsClient ( true ),
-          bJitterBufferOK ( true ) { Init ( iPortNumber ); }
+          bJitterBufferOK ( true ),
+          bOfflineMode ( false ) { Init ( iPortNumber ); }
 
     CSocket ( CServer*      pNServP,
               const quint16 iPortNumber )
         : pServer ( pNServP ),
+          pPacketTrace ( nullptr ),
+          pNetworkEmulator ( nullptr ),
           bIsClient ( false ),
-          bJitterBufferOK ( true ) { Init ( iPortNumber ); }
+          bJitterBufferOK ( true ),
+          bOfflineMode ( false ) { Init ( iPortNumber ); }
 
     virtual ~CSocket();
 
     void SendPacket ( const CVector<uint8_t>& vecbySendBuf,
                       const CHostAddress&     HostAddr );
 
+    // sends the packet without the network emulator
+    void SendPacketDirect ( const CVector<uint8_t>& vecbySendBuf,
+                            const CHostAddress&     HostAddr );
+
     bool GetAndResetbJitterBufferOKFlag();
     void Close();
 
+    // the received packets are added to the trace (nullptr disables the trace)
+    void SetPacketTrace ( CPacketTrace* pNPacketTrace ) { pPacketTrace = pNPacketTrace; }
+
+    // the sent and received packets pass the network emulator (started here)
+    void SetNetworkEmulator ( CNetworkEmulator* pNNetworkEmulator );
+
+    // in offline mode (e.g. during a trace replay) the socket is sandboxed:
+    // no packets are sent and the packets from the network are ignored (only
+    // replayed packets are processed)
+    void SetOfflineMode ( const bool bEnable ) { bOfflineMode = bEnable; }
+
+    // processing of one received packet (also used for the trace replay)
+    void ProcessPacket ( const CVector<uint8_t>& vecbyPacket,
+                         const int               iNumBytesRead,
+                         const CHostAddress&     HostAddr );
+
 protected:
     void Init ( const quint16 iPortNumber );
 
@@ -101,10 +130,15 @@ protected:
     CChannel*        pChannel; // for client
     CServer*         pServer;  // for server
 
+    CPacketTrace*     pPacketTrace;
+    CNetworkEmulator* pNetworkEmulator;
+
     bool             bIsClient;
 
     bool             bJitterBufferOK;
 
+    std::atomic<bool> bOfflineMode;
+
 public:
     void OnDataReceived();
 
@@ -174,6 +208,28 @@ public:
         return Socket.GetAndResetbJitterBufferOKFlag();
     }
 
+    void SetPacketTrace ( CPacketTrace* pNPacketTrace )
+    {
+        Socket.SetPacketTrace ( pNPacketTrace );
+    }
+
+    void SetNetworkEmulator ( CNetworkEmulator* pNNetworkEmulator )
+    {
+        Socket.SetNetworkEmulator ( pNNetworkEmulator );
+    }
+
+    void SetOfflineMode ( const bool bEnable )
+    {
+        Socket.SetOfflineMode ( bEnable );
+    }
+
+    void ProcessPacket ( const CVector<uint8_t>& vecbyPacket,
+                         const int               iNumBytesRead,
+                         const CHostAddress&     HostAddr )
+    {
+        Socket.ProcessPacket ( vecbyPacket, iNumBytesRead, HostAddr );
+    }
+
 protected:
     class CSocketThread : public QThread
     {
@@ -44,6 +44,7 @@ CSoundBase::CSoundBase ( const QString& strNewSystemDriverTechniqueName,
                          const QString& strMIDISetup ) :
     fpProcessCallback            ( fpNewProcessCallback ),
     pProcessCallbackArg          ( pParg ),
+    fpProcessCallbackFloat       ( nullptr ),
     bRun                         ( false ),
     bCallbackEntered             ( false ),
     strSystemDriverTechniqueName ( strNewSystemDriverTechniqueName ),
@@ -96,9 +96,27 @@ public:
     virtual int     GetRightOutputChannel() { return 1; }
 
     virtual float   GetInOutLatencyMs() { return 0.0f; } // "0.0" means no latency is available
+    virtual float   GetInLatencyMs()    { return 0.0f; }
+    virtual float   GetOutLatencyMs()   { return 0.0f; }
 
     virtual void    OpenDriverSetup() {}
 
+    // test signal instead of the sound card input (only supported without
+    // sound card)
+    virtual void    SetTestSignal ( const int, const QList<int>& ) {}
+    virtual QString GetTestSignalReport() { return ""; }
+
+    // WAV files instead of the sound card input and output, optionally with
+    // a virtual clock (only supported without sound card)
+    virtual void    SetSoundFiles ( const QString&, const QString&, const bool ) {}
+
+    // optional callback with float samples in the range -1 to 1, the sound
+    // interfaces with float samples use it instead of the int16 callback
+    void SetFloatProcessCallback ( void (*fpNewProcessCallbackFloat) ( CVector<float>& vecfData, void* pParg ) )
+        { fpProcessCallbackFloat = fpNewProcessCallbackFloat; }
+
+    bool HasFloatProcessCallback() const { return fpProcessCallbackFloat != nullptr; }
+
     bool IsRunning() const { return bRun; }
     bool IsCallbackEntered() const { return bCallbackEntered; }
 
@@ -146,6 +164,14 @@ protected:
         (*fpProcessCallback) ( psData, pProcessCallbackArg );
     }
 
+    void (*fpProcessCallbackFloat) ( CVector<float>& vecfData, void* arg );
+
+    void ProcessCallbackFloat ( CVector<float>& vecfData )
+    {
+        bCallbackEntered = true;
+        (*fpProcessCallbackFloat) ( vecfData, pProcessCallbackArg );
+    }
+
     void ParseMIDIMessage ( const CVector<uint8_t>& vMIDIPaketBytes );
 
     bool    bRun;
@@ -46,6 +46,13 @@ public:
     QString             strSessionName;
     bool                bIsServer;
     bool                bP2P;
+    bool                bDtx;
+    bool                bRedundancy;
+    int                 iTestSignalFreqHz;
+    QList<int>          veciTestSignalPeerFreqHz;
+    QString             strSoundFileIn;
+    QString             strSoundFileOut;
+    bool                bVirtualClock;
 
     // client settings
     QString             strIniFileName;
@@ -70,8 +77,25 @@ public:
     ELicenceType        eNLicenceType;
     bool                bUseMultithreading;
     bool                bDisableRecording;
+    bool                bRecordCodedPackets;
     QString             strServerPublicIP;
     QString             strServerListFilter;
+    bool                bServerBenchmark;
+    bool                bServerCalibrate;
+
+    // packet trace (server in server mode, otherwise client)
+    QString             strPacketTraceFileName;
+    bool                bPacketTraceHashOnly;
+    QString             strPacketTraceReplayFileName;
+    double              dPacketTraceReplaySpeed;
+
+    // network emulator (server and client sockets)
+    QStringList         slNetworkEmulatorRules;
+    QString             strNetworkEmulatorFileName;
+    int                 iNetworkEmulatorSeed;
+
+    // metrics endpoint (port, host:port or unix:path)
+    QString             strMetricsAddress;
 
     // central server
     bool                bNCentServPingServerInList;
@@ -129,7 +129,7 @@ public slots:
         ESvrRegResult          eSvrRegResult;
 
         // generate random protocol message
-        switch ( GenRandomIntInRange ( 0, 34 ) )
+        switch ( GenRandomIntInRange ( 0, 40 ) )
         {
         case 0: // PROTMESSID_JITT_BUF_SIZE
             Protocol.CreateJitBufMes ( GenRandomIntInRange ( 0, 10 ) );
@@ -320,6 +320,44 @@ public slots:
         case 34: // PROTMESSID_CLIENT_ID
             Protocol.CreateClientIDMes ( GenRandomIntInRange ( -2, 20 ) );
             break;
+
+        case 35: // PROTMESSID_CLM_SUBSCRIBE_SESSION
+            Protocol.CreateCLSubscribeSessionMes ( CurHostAddress,
+                                                   GenRandomString() );
+            break;
+
+        case 36: // PROTMESSID_CLM_SESSION_ADDRESS
+            Protocol.CreateCLSessionAddressMes ( CurHostAddress,
+                                                 CurLocalAddress,
+                                                 GenRandomString() );
+            break;
+
+        case 37: // PROTMESSID_CLM_P2P_CONN_CHECK
+            Protocol.CreateCLP2pConnCheckMes ( CurHostAddress,
+                                               GenRandomIntInRange ( -2, 1000 ),
+                                               GenRandomIntInRange ( -2, 20 ),
+                                               GenRandomIntInRange ( -2, 20 ),
+                                               static_cast<uint32_t> ( GenRandomIntInRange ( 0, 1000000 ) ) );
+            break;
+
+        case 38: // PROTMESSID_CLM_P2P_CONN_CHECK_RESP
+            Protocol.CreateCLP2pConnCheckRespMes ( CurHostAddress,
+                                                   GenRandomIntInRange ( -2, 1000 ),
+                                                   GenRandomIntInRange ( -2, 20 ),
+                                                   GenRandomIntInRange ( -2, 20 ),
+                                                   static_cast<uint32_t> ( GenRandomIntInRange ( 0, 1000000 ) ) );
+            break;
+
+        case 39: // PROTMESSID_CLM_P2P_PING
+            Protocol.CreateCLP2pPingMes ( CurHostAddress,
+                                          GenRandomIntInRange ( 0, 100000 ) );
+            break;
+
+        case 40: // PROTMESSID_CLM_P2P_PING_RESP
+            Protocol.CreateCLP2pPingRespMes ( CurHostAddress,
+                                              GenRandomIntInRange ( 0, 100000 ),
+                                              GenRandomIntInRange ( 0, 100000 ) );
+            break;
         }
     }
 
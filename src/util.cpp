@@ -31,6 +31,23 @@
 void CStereoSignalLevelMeter::Update ( const CVector<short>& vecsAudio,
                                        const int             iMonoBlockSizeSam,
                                        const bool            bIsStereoIn )
+{
+    UpdateSamples ( vecsAudio, iMonoBlockSizeSam, bIsStereoIn, 1.0 );
+}
+
+void CStereoSignalLevelMeter::Update ( const CVector<float>& vecfAudio,
+                                       const int             iMonoBlockSizeSam,
+                                       const bool            bIsStereoIn )
+{
+    // the level is calculated in the int16 range
+    UpdateSamples ( vecfAudio, iMonoBlockSizeSam, bIsStereoIn, _MAXSHORT );
+}
+
+template<typename TSample>
+void CStereoSignalLevelMeter::UpdateSamples ( const CVector<TSample>& vecAudio,
+                                              const int               iMonoBlockSizeSam,
+                                              const bool              bIsStereoIn,
+                                              const double            dFullScale )
 {
     // Get maximum of current block
     //
@@ -42,8 +59,8 @@ void CStereoSignalLevelMeter::Update ( const CVector<short>& vecsAudio,
     // With these speed optimizations we might loose some information in
     // special cases but for the average music signals the following code
     // should give good results.
-    short sMinLOrMono = 0;
-    short sMinR       = 0;
+    TSample MinLOrMono = 0;
+    TSample MinR       = 0;
 
     if ( bIsStereoIn )
     {
@@ -51,14 +68,14 @@ void CStereoSignalLevelMeter::Update ( const CVector<short>& vecsAudio,
         for ( int i = 0; i < 2 * iMonoBlockSizeSam; i += 6 ) // 2 * 3 = 6 -> stereo
         {
             // left (or mono) and right channel
-            sMinLOrMono = std::min ( sMinLOrMono, vecsAudio[i] );
-            sMinR       = std::min ( sMinR,       vecsAudio[i + 1] );
+            MinLOrMono = std::min ( MinLOrMono, vecAudio[i] );
+            MinR       = std::min ( MinR,       vecAudio[i + 1] );
         }
 
         // in case of mono out use minimum of both channels
         if ( !bIsStereoOut )
         {
-            sMinLOrMono = std::min ( sMinLOrMono, sMinR );
+            MinLOrMono = std::min ( MinLOrMono, MinR );
         }
     }
     else
@@ -66,16 +83,16 @@ void CStereoSignalLevelMeter::Update ( const CVector<short>& vecsAudio,
         // mono in
         for ( int i = 0; i < iMonoBlockSizeSam; i += 3 )
         {
-            sMinLOrMono = std::min ( sMinLOrMono, vecsAudio[i] );
+            MinLOrMono = std::min ( MinLOrMono, vecAudio[i] );
         }
     }
 
     // apply smoothing, if in stereo out mode, do this for two channels
-    dCurLevelLOrMono = UpdateCurLevel ( dCurLevelLOrMono, -sMinLOrMono );
+    dCurLevelLOrMono = UpdateCurLevel ( dCurLevelLOrMono, -dFullScale * MinLOrMono );
 
     if ( bIsStereoOut )
     {
-        dCurLevelR = UpdateCurLevel ( dCurLevelR, -sMinR );
+        dCurLevelR = UpdateCurLevel ( dCurLevelR, -dFullScale * MinR );
     }
 }
 
@@ -129,6 +146,99 @@ double CStereoSignalLevelMeter::CalcLogResultForMeter ( const double& dLinearLev
 }
 
 
+// Rolling histogram -----------------------------------------------------------
+void CRollingHistogram::Init ( const int    iNewNumBins,
+                               const double dNewBinWidth,
+                               const int    iNewWindowSize )
+{
+    dBinWidth = dNewBinWidth;
+    veciBinCount.Init ( iNewNumBins );
+    veciHistory.Init ( iNewWindowSize );
+
+    Reset();
+}
+
+void CRollingHistogram::Reset()
+{
+    veciBinCount.Reset ( 0 );
+    veciHistory.Reset ( 0 );
+    iHistoryPos = 0;
+    iNumValues  = 0;
+}
+
+void CRollingHistogram::Add ( const double dValue )
+{
+    const int iNumBins = veciBinCount.Size();
+
+    if ( ( iNumBins == 0 ) || ( veciHistory.Size() == 0 ) )
+    {
+        return; // not initialized
+    }
+
+    // negative values are counted in the first bin
+    const int iBin = std::min ( std::max ( static_cast<int> ( dValue / dBinWidth ), 0 ), iNumBins - 1 );
+
+    // remove the oldest value if the window is full
+    if ( iNumValues == veciHistory.Size() )
+    {
+        veciBinCount[veciHistory[iHistoryPos]]--;
+    }
+    else
+    {
+        iNumValues++;
+    }
+
+    veciBinCount[iBin]++;
+    veciHistory[iHistoryPos] = iBin;
+
+    // increase position pointer and test if wrap
+    iHistoryPos++;
+
+    if ( iHistoryPos >= veciHistory.Size() )
+    {
+        iHistoryPos = 0;
+    }
+}
+
+double CRollingHistogram::GetPercentile ( const double dFraction ) const
+{
+    const int iNumBins = veciBinCount.Size();
+    int       iCount   = 0;
+
+    if ( iNumValues == 0 )
+    {
+        return 0;
+    }
+
+    for ( int iBin = 0; iBin < iNumBins; iBin++ )
+    {
+        iCount += veciBinCount[iBin];
+
+        if ( iCount >= dFraction * iNumValues )
+        {
+            return ( iBin + 1 ) * dBinWidth;
+        }
+    }
+
+    return iNumBins * dBinWidth;
+}
+
+QString CRollingHistogram::ToString() const
+{
+    QString strHist;
+
+    for ( int iBin = 0; iBin < veciBinCount.Size(); iBin++ )
+    {
+        if ( veciBinCount[iBin] > 0 )
+        {
+            strHist += QString ( "%1:%2 " ).arg ( iBin * dBinWidth ).arg ( veciBinCount[iBin] );
+        }
+    }
+
+    return strHist.trimmed();
+}
+
+
 // CRC -------------------------------------------------------------------------
 void CCRC::Reset()
 {
@@ -224,24 +334,62 @@ void CAudioReverb::Init ( const EAudChanConf eNAudioChannelConf,
         }
     }
 
-    for ( int i = 0; i < 3; i++ )
+    for ( int i = 0; i < AUD_REVERB_NUM_ALLPASS; i++ )
     {
         allpassDelays[i].Init ( lengths[i + 4] );
     }
 
-    for ( int i = 0; i < 4; i++ )
+    // the comb delay lines share one interleaved buffer which is large enough
+    // for the longest delay
+    int iMaxCombDelay = 0;
+
+    for ( int i = 0; i < AUD_REVERB_NUM_COMBS; i++ )
     {
-        combDelays[i].Init ( lengths[i] );
-        combFilters[i].setPole ( 0.2f );
+        combDelays[i] = lengths[i];
+        iMaxCombDelay = std::max ( iMaxCombDelay, lengths[i] );
     }
 
+    iCombMask = NextPowerOfTwo ( iMaxCombDelay + 1 ) - 1;
+    vecfCombBuffer.Init ( AUD_REVERB_NUM_COMBS * ( iCombMask + 1 ) );
+
+    // one pole lowpass with the pole at 0.2
+    combPoleA = -0.2f;
+    combPoleB = 1.0f - 0.2f;
+
     setT60 ( fT60, iSampleRate );
+
+    // the output delay lines are written before they are read (one sample less
+    // delay than the length)
     outLeftDelay.Init ( lengths[7] );
     outRightDelay.Init ( lengths[8] );
     allpassCoefficient = 0.7f;
+
+    vecfBlock.Init ( iStereoBlockSizeSam / 2 );
+
     Clear();
 }
 
+int CAudioReverb::NextPowerOfTwo ( const int iValue )
+{
+    int iPowerOfTwo = 1;
+
+    while ( iPowerOfTwo < iValue )
+    {
+        iPowerOfTwo <<= 1;
+    }
+
+    return iPowerOfTwo;
+}
+
+void CAudioReverb::CDelayLine::Init ( const int iNDelay )
+{
+    iDelay    = iNDelay;
+    iMask     = NextPowerOfTwo ( iNDelay + 1 ) - 1;
+    iWritePos = 0;
+
+    vecfBuffer.Init ( iMask + 1, 0 );
+}
+
 bool CAudioReverb::isPrime ( const int number )
 {
 /*
@@ -274,122 +422,417 @@ bool CAudioReverb::isPrime ( const int number )
 void CAudioReverb::Clear()
 {
     // reset and clear all internal state
-    allpassDelays[0].Reset ( 0 );
-    allpassDelays[1].Reset ( 0 );
-    allpassDelays[2].Reset ( 0 );
-    combDelays[0].Reset ( 0 );
-    combDelays[1].Reset ( 0 );
-    combDelays[2].Reset ( 0 );
-    combDelays[3].Reset ( 0 );
-    combFilters[0].Reset();
-    combFilters[1].Reset();
-    combFilters[2].Reset();
-    combFilters[3].Reset();
-    outRightDelay.Reset ( 0 );
-    outLeftDelay.Reset ( 0 );
+    for ( int i = 0; i < AUD_REVERB_NUM_ALLPASS; i++ )
+    {
+        allpassDelays[i].Reset();
+    }
+
+    vecfCombBuffer.Reset ( 0 );
+    iCombWritePos = 0;
+
+    for ( int i = 0; i < AUD_REVERB_NUM_COMBS; i++ )
+    {
+        combLastSample[i] = 0;
+    }
+
+    outRightDelay.Reset();
+    outLeftDelay.Reset();
 }
 
 void CAudioReverb::setT60 ( const float fT60,
                             const int   iSampleRate )
 {
     // set the reverberation T60 decay time
-    for ( int i = 0; i < 4; i++ )
+    for ( int i = 0; i < AUD_REVERB_NUM_COMBS; i++ )
     {
         combCoefficient[i] = powf ( 10.0f, static_cast<float> ( -3.0f *
-            combDelays[i].Size() / ( fT60 * iSampleRate ) ) );
+            combDelays[i] / ( fT60 * iSampleRate ) ) );
     }
 }
 
-void CAudioReverb::COnePole::setPole ( const float fPole )
+void CAudioReverb::Process ( CVector<int16_t>& vecsStereoInOut,
+                             const bool        bReverbOnLeftChan,
+                             const float       fAttenuation )
 {
-    // calculate IIR filter coefficients based on the pole value
-    fA = -fPole;
-    fB = 1.0f - fPole;
+    ProcessSamples ( vecsStereoInOut, bReverbOnLeftChan, fAttenuation );
 }
 
-float CAudioReverb::COnePole::Calc ( const float fIn )
+void CAudioReverb::Process ( CVector<float>& vecfStereoInOut,
+                             const bool      bReverbOnLeftChan,
+                             const float     fAttenuation )
 {
-    // calculate IIR filter
-    fLastSample = fB * fIn - fA * fLastSample;
-
-    return fLastSample;
+    ProcessSamples ( vecfStereoInOut, bReverbOnLeftChan, fAttenuation );
 }
 
-void CAudioReverb::Process ( CVector<int16_t>& vecsStereoInOut,
-                             const bool        bReverbOnLeftChan,
-                             const float       fAttenuation )
+template<typename TSample>
+void CAudioReverb::ProcessSamples ( CVector<TSample>& vecStereoInOut,
+                                    const bool        bReverbOnLeftChan,
+                                    const float       fAttenuation )
 {
-    float fMixedInput, temp, temp0, temp1, temp2;
+    const int iNumFrames = iStereoBlockSizeSam / 2;
+    float*    pfBlock    = &vecfBlock[0];
+    int       i;
 
-    for ( int i = 0; i < iStereoBlockSizeSam; i += 2 )
+    // we sum up the stereo input channels (in case mono input is used, only
+    // the selected channel is used)
+    if ( eAudioChannelConf == CC_STEREO )
     {
-        // we sum up the stereo input channels (in case mono input is used, a zero
-        // shall be input for the right channel)
-        if ( eAudioChannelConf == CC_STEREO )
+        for ( i = 0; i < iNumFrames; i++ )
         {
-            fMixedInput = 0.5f * ( vecsStereoInOut[i] + vecsStereoInOut[i + 1] );
+            pfBlock[i] = 0.5f * ( vecStereoInOut[2 * i] + vecStereoInOut[2 * i + 1] );
         }
-        else
+    }
+    else
+    {
+        const int iInChan = bReverbOnLeftChan ? 0 : 1;
+
+        for ( i = 0; i < iNumFrames; i++ )
+        {
+            pfBlock[i] = vecStereoInOut[2 * i + iInChan];
+        }
+    }
+
+    // allpass filters in series, one stage after the other over the block
+    for ( int iAllpass = 0; iAllpass < AUD_REVERB_NUM_ALLPASS; iAllpass++ )
+    {
+        CDelayLine& Allpass = allpassDelays[iAllpass];
+
+        for ( i = 0; i < iNumFrames; i++ )
+        {
+            const float fDelayed = Allpass.Read();
+            const float fTemp    = allpassCoefficient * fDelayed + pfBlock[i];
+
+            Allpass.Write ( fTemp );
+            pfBlock[i] = - ( allpassCoefficient * fTemp ) + fDelayed;
+        }
+    }
+
+    // parallel comb filters: the lanes are independent, only the read
+    // positions differ (the result replaces the block)
+    for ( i = 0; i < iNumFrames; i++ )
+    {
+        float        fDelayed[AUD_REVERB_NUM_COMBS];
+        float* const pfWrite = &vecfCombBuffer[AUD_REVERB_NUM_COMBS * iCombWritePos];
+
+        for ( int iComb = 0; iComb < AUD_REVERB_NUM_COMBS; iComb++ )
         {
-            if ( bReverbOnLeftChan )
+            fDelayed[iComb] = vecfCombBuffer[AUD_REVERB_NUM_COMBS * ( ( iCombWritePos - combDelays[iComb] ) & iCombMask ) + iComb];
+        }
+
+        for ( int iComb = 0; iComb < AUD_REVERB_NUM_COMBS; iComb++ )
+        {
+            combLastSample[iComb] = combPoleB * ( combCoefficient[iComb] * fDelayed[iComb] ) - combPoleA * combLastSample[iComb];
+            pfWrite[iComb]        = pfBlock[i] + combLastSample[iComb];
+        }
+
+        pfBlock[i]    = pfWrite[0] + pfWrite[1] + pfWrite[2] + pfWrite[3];
+        iCombWritePos = ( iCombWritePos + 1 ) & iCombMask;
+    }
+
+    // inplace apply the attenuated reverb signal through the decorrelation
+    // delay lines (for stereo always apply reverberation effect on both
+    // channels, the delay lines are always updated)
+    const float fDryGain = 1.0f - fAttenuation;
+    const float fWetGain = 0.5f * fAttenuation;
+
+    auto MixOutput = [&] ( CDelayLine& OutDelay, const int iChan, const bool bApply )
+    {
+        if ( bApply )
+        {
+            for ( i = 0; i < iNumFrames; i++ )
             {
-                fMixedInput = vecsStereoInOut[i];
+                OutDelay.Write ( pfBlock[i] );
+
+                vecStereoInOut[2 * i + iChan] = Float2Sample<TSample> (
+                    fDryGain * vecStereoInOut[2 * i + iChan] + fWetGain * OutDelay.Read() );
             }
-            else
+        }
+        else
+        {
+            for ( i = 0; i < iNumFrames; i++ )
             {
-                fMixedInput = vecsStereoInOut[i + 1];
+                OutDelay.Write ( pfBlock[i] );
             }
         }
+    };
+
+    MixOutput ( outLeftDelay,  0, ( eAudioChannelConf == CC_STEREO ) ||  bReverbOnLeftChan );
+    MixOutput ( outRightDelay, 1, ( eAudioChannelConf == CC_STEREO ) || !bReverbOnLeftChan );
+}
+
+
+/******************************************************************************\
+* Clock Drift Compensation                                                     *
+\******************************************************************************/
+void CClockDriftCompensator::Init ( const int iNNumChannels,
+                                    const int iNFrameSizeSamples,
+                                    const int iSampleRate )
+{
+    if ( ( iNNumChannels == iNumChannels ) && ( iNFrameSizeSamples == iFrameSizeSamples ) )
+    {
+        return;
+    }
+
+    iNumChannels      = iNNumChannels;
+    iFrameSizeSamples = iNFrameSizeSamples;
+    dUpdateIntervalS  = static_cast<double> ( iFrameSizeSamples ) / iSampleRate;
+    iNumSettleUpdates = static_cast<int> ( DRIFT_COMP_SETTLE_TIME_S / dUpdateIntervalS );
+
+    // the FIFO holds at most the taps, the remainder of the previous frame and
+    // two new frames (if the ratio is above one), use some margin
+    vecfFifo.Init ( ( 3 * iFrameSizeSamples + DRIFT_COMP_NUM_TAPS_BEFORE + DRIFT_COMP_NUM_TAPS_AFTER ) * iNumChannels );
+
+    Reset();
+}
+
+void CClockDriftCompensator::Reset()
+{
+    iFifoNumSamples = 0;
+    dReadPos        = 0;
+    dRatio          = 1;
+    dDrift          = 0;
+    dLevel          = 0;
+    iSettleCnt      = 0;
+}
+
+void CClockDriftCompensator::Update ( const double dLevelBlocks,
+                                      const double dTargetBlocks )
+{
+    // after a reset the jitter buffer size first has to settle, the ratio stays
+    // at one (the interpolation then only delays the samples)
+    if ( iSettleCnt < iNumSettleUpdates )
+    {
+        iSettleCnt++;
+        dLevel = dLevelBlocks;
+        return;
+    }
+
+    dLevel += ( dLevelBlocks - dLevel ) * dUpdateIntervalS / DRIFT_COMP_LEVEL_FILTER_S;
+
+    // a level above the target means that the peer clock is faster, i.e., more
+    // decoded samples per output sample must be consumed
+    const double dError = dLevel - dTargetBlocks;
+
+    dDrift = std::max ( -DRIFT_COMP_MAX_DRIFT,
+                        std::min ( DRIFT_COMP_MAX_DRIFT, dDrift + DRIFT_COMP_GAIN_INT * dUpdateIntervalS * dError ) );
+
+    dRatio = 1 + std::max ( -DRIFT_COMP_MAX_CORRECTION,
+                            std::min ( DRIFT_COMP_MAX_CORRECTION, dDrift + DRIFT_COMP_GAIN_PROP * dError ) );
+}
+
+void CClockDriftCompensator::Put ( const CVector<int16_t>& vecsIn )
+{
+    PutSamples ( vecsIn );
+}
+
+void CClockDriftCompensator::Put ( const CVector<float>& vecfIn )
+{
+    PutSamples ( vecfIn );
+}
+
+void CClockDriftCompensator::Get ( CVector<int16_t>& vecsOut )
+{
+    GetSamples ( vecsOut );
+}
+
+void CClockDriftCompensator::Get ( CVector<float>& vecfOut )
+{
+    GetSamples ( vecfOut );
+}
+
+template<typename TSample>
+void CClockDriftCompensator::PutSamples ( const CVector<TSample>& vecIn )
+{
+    // the FIFO cannot overflow as long as a frame is only put if NeedsInput()
+    // is true, start again with the history if it happens anyway
+    if ( ( iFifoNumSamples + iFrameSizeSamples ) * iNumChannels > vecfFifo.Size() )
+    {
+        Reset();
+    }
+
+    // the first frame after a reset is preceded by silence for the taps (this
+    // is the delay of the interpolation)
+    if ( iFifoNumSamples == 0 )
+    {
+        iFifoNumSamples = DRIFT_COMP_NUM_TAPS_BEFORE + DRIFT_COMP_NUM_TAPS_AFTER;
+        dReadPos        = DRIFT_COMP_NUM_TAPS_BEFORE;
+
+        std::fill ( vecfFifo.begin(), vecfFifo.begin() + iFifoNumSamples * iNumChannels, 0.0f );
+    }
+
+    float* pfFifo = &vecfFifo[iFifoNumSamples * iNumChannels];
+
+    for ( int i = 0; i < iFrameSizeSamples * iNumChannels; i++ )
+    {
+        pfFifo[i] = static_cast<float> ( vecIn[i] );
+    }
+
+    iFifoNumSamples += iFrameSizeSamples;
+}
 
-        temp   = allpassDelays[0].Get();
-        temp0  = allpassCoefficient * temp;
-        temp0 += fMixedInput;
-        allpassDelays[0].Add ( temp0 );
-        temp0 = - ( allpassCoefficient * temp0 ) + temp;
-
-        temp   = allpassDelays[1].Get();
-        temp1  = allpassCoefficient * temp;
-        temp1 += temp0;
-        allpassDelays[1].Add ( temp1 );
-        temp1 = - ( allpassCoefficient * temp1 ) + temp;
-
-        temp   = allpassDelays[2].Get();
-        temp2  = allpassCoefficient * temp;
-        temp2 += temp1;
-        allpassDelays[2].Add ( temp2 );
-        temp2 = - ( allpassCoefficient * temp2 ) + temp;
-
-        const float temp3 = temp2 + combFilters[0].Calc ( combCoefficient[0] * combDelays[0].Get() );
-        const float temp4 = temp2 + combFilters[1].Calc ( combCoefficient[1] * combDelays[1].Get() );
-        const float temp5 = temp2 + combFilters[2].Calc ( combCoefficient[2] * combDelays[2].Get() );
-        const float temp6 = temp2 + combFilters[3].Calc ( combCoefficient[3] * combDelays[3].Get() );
-
-        combDelays[0].Add ( temp3 );
-        combDelays[1].Add ( temp4 );
-        combDelays[2].Add ( temp5 );
-        combDelays[3].Add ( temp6 );
-
-        const float filtout = temp3 + temp4 + temp5 + temp6;
-
-        outLeftDelay.Add  ( filtout );
-        outRightDelay.Add ( filtout );
-
-        // inplace apply the attenuated reverb signal (for stereo always apply
-        // reverberation effect on both channels)
-        if ( ( eAudioChannelConf == CC_STEREO ) || bReverbOnLeftChan )
+template<typename TSample>
+void CClockDriftCompensator::GetSamples ( CVector<TSample>& vecOut )
+{
+    // not enough input (only possible if the caller did not follow NeedsInput())
+    if ( NeedsInput() )
+    {
+        std::fill ( vecOut.begin(), vecOut.begin() + iFrameSizeSamples * iNumChannels, static_cast<TSample> ( 0 ) );
+        return;
+    }
+
+    const float* pfFifo = &vecfFifo[0];
+
+    for ( int i = 0; i < iFrameSizeSamples; i++ )
+    {
+        const int   iPos = static_cast<int> ( dReadPos );
+        const float fT   = static_cast<float> ( dReadPos - iPos );
+
+        for ( int iCh = 0; iCh < iNumChannels; iCh++ )
         {
-            vecsStereoInOut[i] = Float2Short (
-                ( 1.0f - fAttenuation ) * vecsStereoInOut[i] +
-                0.5f * fAttenuation * outLeftDelay.Get() );
+            // cubic Hermite interpolation between the samples at iPos and iPos + 1
+            const float fXm1 = pfFifo[( iPos - 1 ) * iNumChannels + iCh];
+            const float fX0  = pfFifo[iPos * iNumChannels + iCh];
+            const float fX1  = pfFifo[( iPos + 1 ) * iNumChannels + iCh];
+            const float fX2  = pfFifo[( iPos + 2 ) * iNumChannels + iCh];
+
+            const float fC1 = 0.5f * ( fX1 - fXm1 );
+            const float fC2 = fXm1 - 2.5f * fX0 + 2.0f * fX1 - 0.5f * fX2;
+            const float fC3 = 0.5f * ( fX2 - fXm1 ) + 1.5f * ( fX0 - fX1 );
+
+            vecOut[i * iNumChannels + iCh] = Float2Sample<TSample> ( ( ( fC3 * fT + fC2 ) * fT + fC1 ) * fT + fX0 );
         }
 
-        if ( ( eAudioChannelConf == CC_STEREO ) || !bReverbOnLeftChan )
+        dReadPos += dRatio;
+    }
+
+    // remove the consumed samples but keep the history of the next read position
+    const int iNumConsumed = static_cast<int> ( dReadPos ) - DRIFT_COMP_NUM_TAPS_BEFORE;
+
+    std::copy ( vecfFifo.begin() + iNumConsumed * iNumChannels,
+                vecfFifo.begin() + iFifoNumSamples * iNumChannels,
+                vecfFifo.begin() );
+
+    iFifoNumSamples -= iNumConsumed;
+    dReadPos        -= iNumConsumed;
+}
+
+
+/******************************************************************************\
+* Test Signal                                                                  *
+\******************************************************************************/
+static const double dTestSignalTwoPi = 6.283185307179586;
+
+void CTestSignal::Init ( const int         iNFreqHz,
+                         const QList<int>& veciNPeerFreqHz,
+                         const double      dNAmplitude )
+{
+    iFreqHz            = iNFreqHz;
+    veciPeerFreqHz     = veciNPeerFreqHz;
+    dAmplitude         = dNAmplitude;
+    dPhase             = 0;
+    iWindowPos         = 0;
+    iNumWindows        = 0;
+    dOwnToneAmplitude  = 0;
+    bPeerTonesDetected = false;
+
+    vecdWindow.Init ( TEST_SIGNAL_WINDOW_SAMPLES, 0 );
+
+    veciNumDetected.clear();
+
+    for ( int i = 0; i < veciPeerFreqHz.size(); i++ )
+    {
+        veciNumDetected.append ( 0 );
+    }
+}
+
+void CTestSignal::GetInput ( CVector<int16_t>& vecsOut, const int iNumChannels )
+{
+    const double dPhaseInc = dTestSignalTwoPi * iFreqHz / SYSTEM_SAMPLE_RATE_HZ;
+
+    for ( int i = 0; i < vecsOut.Size(); i += iNumChannels )
+    {
+        const int16_t sSample = static_cast<int16_t> ( dAmplitude * _MAXSHORT * sin ( dPhase ) );
+
+        for ( int j = 0; j < iNumChannels; j++ )
         {
-            vecsStereoInOut[i + 1] = Float2Short (
-                ( 1.0f - fAttenuation ) * vecsStereoInOut[i + 1] +
-                0.5f * fAttenuation * outRightDelay.Get() );
+            vecsOut[i + j] = sSample;
         }
+
+        dPhase += dPhaseInc;
     }
+
+    dPhase = fmod ( dPhase, dTestSignalTwoPi );
+}
+
+bool CTestSignal::AnalyzeOutput ( const CVector<int16_t>& vecsIn, const int iNumChannels )
+{
+    bool bWindowCompleted = false;
+
+    for ( int i = 0; i < vecsIn.Size(); i += iNumChannels )
+    {
+        vecdWindow[iWindowPos++] = static_cast<double> ( vecsIn[i] ) / _MAXSHORT;
+
+        if ( iWindowPos == TEST_SIGNAL_WINDOW_SAMPLES )
+        {
+            bPeerTonesDetected = true;
+
+            for ( int iPeer = 0; iPeer < veciPeerFreqHz.size(); iPeer++ )
+            {
+                if ( GetToneAmplitude ( veciPeerFreqHz[iPeer] ) > GetDetectThreshold() )
+                {
+                    veciNumDetected[iPeer]++;
+                }
+                else
+                {
+                    bPeerTonesDetected = false;
+                }
+            }
+
+            dOwnToneAmplitude = GetToneAmplitude ( iFreqHz );
+            iWindowPos        = 0;
+            bWindowCompleted  = true;
+            iNumWindows++;
+        }
+    }
+
+    return bWindowCompleted;
+}
+
+double CTestSignal::GetToneAmplitude ( const int iToneFreqHz ) const
+{
+    // Goertzel algorithm, the window length is chosen so that all test tones
+    // are exactly on a frequency bin
+    const double dCoeff = 2 * cos ( dTestSignalTwoPi * iToneFreqHz / SYSTEM_SAMPLE_RATE_HZ );
+    double       dS1    = 0;
+    double       dS2    = 0;
+
+    for ( int i = 0; i < TEST_SIGNAL_WINDOW_SAMPLES; i++ )
+    {
+        const double dS0 = vecdWindow[i] + dCoeff * dS1 - dS2;
+
+        dS2 = dS1;
+        dS1 = dS0;
+    }
+
+    const double dPower = dS1 * dS1 + dS2 * dS2 - dCoeff * dS1 * dS2;
+
+    return 2 * sqrt ( std::max ( dPower, 0.0 ) ) / TEST_SIGNAL_WINDOW_SAMPLES;
+}
+
+QString CTestSignal::ToString() const
+{
+    QString strPeers;
+
+    for ( int i = 0; i < veciPeerFreqHz.size(); i++ )
+    {
+        strPeers += QString ( " %1:%2" ).arg ( veciPeerFreqHz[i] ).arg ( veciNumDetected[i] );
+    }
+
+    return QString ( "test signal %1 Hz, windows %2, own tone level %3, peer tones [Hz:windows detected]%4" )
+        .arg ( iFreqHz )
+        .arg ( iNumWindows )
+        .arg ( dOwnToneAmplitude, 0, 'f', 3 )
+        .arg ( strPeers );
 }
 
 
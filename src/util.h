@@ -95,6 +95,17 @@ inline short Float2Short ( const float fInput )
     return static_cast<short> ( fInput );
 }
 
+// converting float to the sample type of the audio processing (int16 samples
+// are clipped, float samples in the range -1 to 1 are not clipped)
+template<typename TSample> inline TSample Float2Sample ( const float fInput );
+template<> inline int16_t Float2Sample<int16_t> ( const float fInput ) { return Float2Short ( fInput ); }
+template<> inline float   Float2Sample<float>   ( const float fInput ) { return fInput; }
+
+// full scale value of the sample type of the audio processing
+template<typename TSample> inline float SampleFullScale();
+template<> inline float SampleFullScale<int16_t>() { return _MAXSHORT; }
+template<> inline float SampleFullScale<float>()   { return 1.0f; }
+
 // calculate the bit rate in bits per second from the number of coded bytes
 inline int CalcBitRateBitsPerSecFromCodedBytes ( const int iCeltNumCodedBytes,
                                                  const int iFrameSize )
@@ -367,6 +378,48 @@ template<class TData> void CMovingAv<TData>::Add ( const TData tNewD )
 }
 
 
+/******************************************************************************\
+* CRollingHistogram Class                                                      *
+\******************************************************************************/
+// Histogram over the last "window size" values with equally spaced bins. All
+// memory is allocated in Init() so that Add() can be used in real-time threads.
+class CRollingHistogram
+{
+public:
+    CRollingHistogram() :
+        dBinWidth ( 1 ),
+        iHistoryPos ( 0 ),
+        iNumValues ( 0 ) {}
+
+    void Init ( const int    iNewNumBins,
+                const double dNewBinWidth,
+                const int    iNewWindowSize );
+
+    void Reset();
+
+    // values larger than the histogram range are counted in the last bin
+    void Add ( const double dValue );
+
+    int    GetNumBins() const { return veciBinCount.Size(); }
+    double GetBinWidth() const { return dBinWidth; }
+    int    GetBinCount ( const int iBin ) const { return veciBinCount[iBin]; }
+    int    GetNumValues() const { return iNumValues; }
+
+    // upper edge of the bin in which the given fraction of values is reached
+    double GetPercentile ( const double dFraction ) const;
+
+    // compact textual representation of the non-empty bins
+    QString ToString() const;
+
+protected:
+    CVector<int> veciBinCount;
+    CVector<int> veciHistory; // bin indices of the values in the window
+    double       dBinWidth;
+    int          iHistoryPos;
+    int          iNumValues;
+};
+
+
 /******************************************************************************\
 * GUI Utilities                                                                *
 \******************************************************************************/
@@ -525,7 +578,8 @@ enum ENetwFlags
 {
     // used for protocol -> enum values must be fixed!
     NF_NONE = 0,
-    NF_WITH_COUNTER = 1 // using a network counter to correctly order UDP packets in jitter buffer
+    NF_WITH_COUNTER = 1, // using a network counter to correctly order UDP packets in jitter buffer
+    NF_WITH_COUNTER_REDUNDANCY = 3 // network counter and each block also carries the coded bytes of the previous block
 };
 
 
@@ -545,7 +599,8 @@ enum EGetDataStat
     GS_BUFFER_OK,
     GS_BUFFER_UNDERRUN,
     GS_CHAN_NOW_DISCONNECTED,
-    GS_CHAN_NOT_CONNECTED
+    GS_CHAN_NOT_CONNECTED,
+    GS_DTX_SILENCE // the sender suppresses its silent input (no underrun)
 };
 
 
@@ -737,6 +792,11 @@ public:
                   const int             iInSize,
                   const bool            bIsStereoIn );
 
+    // float samples in the range -1 to 1
+    void Update ( const CVector<float>& vecfAudio,
+                  const int             iInSize,
+                  const bool            bIsStereoIn );
+
     double        GetLevelForMeterdBLeftOrMono() { return CalcLogResultForMeter ( dCurLevelLOrMono ); }
     double        GetLevelForMeterdBRight()      { return CalcLogResultForMeter ( dCurLevelR ); }
     static double CalcLogResultForMeter ( const double& dLinearLevel );
@@ -748,6 +808,12 @@ public:
     }
 
 protected:
+    template<typename TSample>
+    void UpdateSamples ( const CVector<TSample>& vecAudio,
+                         const int               iMonoBlockSizeSam,
+                         const bool              bIsStereoIn,
+                         const double            dFullScale );
+
     double UpdateCurLevel ( double       dCurLevel,
                             const double dMax );
 
@@ -1241,10 +1307,18 @@ public:
 
 
 // Audio reverbration ----------------------------------------------------------
+// Schroeder reverb (3 allpass filters in series, 4 parallel comb filters) which
+// processes a block at a time: each stage runs over the whole block on delay
+// lines with power of two sizes (masked index instead of a wrap around check)
+// and the 4 comb filters run as lanes of an interleaved buffer so that the
+// compiler can vectorize them
+#define AUD_REVERB_NUM_ALLPASS      3
+#define AUD_REVERB_NUM_COMBS        4
+
 class CAudioReverb
 {
 public:
-    CAudioReverb() {}
+    CAudioReverb() : iCombMask ( 0 ), iCombWritePos ( 0 ) {}
     
     void Init ( const EAudChanConf eNAudioChannelConf,
                 const int          iNStereoBlockSizeSam,
@@ -1256,33 +1330,186 @@ public:
                    const bool        bReverbOnLeftChan,
                    const float       fAttenuation );
 
+    // float samples in the range -1 to 1 (the output is not clipped)
+    void Process ( CVector<float>& vecfStereoInOut,
+                   const bool      bReverbOnLeftChan,
+                   const float     fAttenuation );
+
 protected:
+    template<typename TSample>
+    void ProcessSamples ( CVector<TSample>& vecStereoInOut,
+                          const bool        bReverbOnLeftChan,
+                          const float       fAttenuation );
+
     void setT60 ( const float fT60, const int iSampleRate );
     bool isPrime ( const int number );
 
-    class COnePole
+    static int NextPowerOfTwo ( const int iValue );
+
+    class CDelayLine
     {
     public:
-        COnePole() : fA ( 0 ), fB ( 0 ) { Reset(); }
-        void  setPole ( const float fPole );
-        float Calc ( const float fIn );
-        void  Reset() { fLastSample = 0; }
+        CDelayLine() : iDelay ( 0 ), iMask ( 0 ), iWritePos ( 0 ) {}
+
+        void Init ( const int iNDelay );
+        void Reset() { vecfBuffer.Reset ( 0 ); iWritePos = 0; }
+
+        // sample which was written iDelay samples before the next write
+        float Read() const { return vecfBuffer[( iWritePos - iDelay ) & iMask]; }
+
+        void Write ( const float fSample )
+        {
+            vecfBuffer[iWritePos] = fSample;
+            iWritePos             = ( iWritePos + 1 ) & iMask;
+        }
 
     protected:
-        float fA;
-        float fB;
-        float fLastSample;
+        CVector<float> vecfBuffer;
+        int            iDelay;
+        int            iMask;
+        int            iWritePos;
     };
 
-    EAudChanConf eAudioChannelConf;
-    int          iStereoBlockSizeSam;
-    CFIFO<float> allpassDelays[3];
-    CFIFO<float> combDelays[4];
-    COnePole     combFilters[4];
-    CFIFO<float> outLeftDelay;
-    CFIFO<float> outRightDelay;
-    float        allpassCoefficient;
-    float        combCoefficient[4];
+    EAudChanConf   eAudioChannelConf;
+    int            iStereoBlockSizeSam;
+    CVector<float> vecfBlock; // mono signal of the current block
+    CDelayLine     allpassDelays[AUD_REVERB_NUM_ALLPASS];
+    CDelayLine     outLeftDelay;
+    CDelayLine     outRightDelay;
+    float          allpassCoefficient;
+
+    // comb filters: delay lines interleaved in one buffer, each followed by a
+    // one pole lowpass in the feedback
+    CVector<float> vecfCombBuffer;
+    int            iCombMask;
+    int            iCombWritePos;
+    int            combDelays[AUD_REVERB_NUM_COMBS];
+    float          combCoefficient[AUD_REVERB_NUM_COMBS];
+    float          combLastSample[AUD_REVERB_NUM_COMBS];
+    float          combPoleA;
+    float          combPoleB;
+};
+
+
+// Clock drift compensation ----------------------------------------------------
+// The sound card of a P2P peer runs on its own clock, so its blocks arrive a
+// little faster or slower than they are played out here. Instead of letting the
+// jitter buffer drop or insert blocks when it runs full or empty, the decoded
+// audio is resampled by the ratio of the clocks: a PI controller on the filtered
+// jitter buffer fill level estimates the ratio (its integral part converges to
+// the drift) and a cubic Hermite interpolator reads the decoded frames at that
+// rate. Since a frame is only decoded if the interpolator needs one, the fill
+// level is regulated instead of sliding between the buffer bounds.
+#define DRIFT_COMP_MAX_DRIFT           0.0005 // USB interface clocks are within about 100 ppm
+#define DRIFT_COMP_MAX_CORRECTION      0.001  // pitch shift below 2 cent
+#define DRIFT_COMP_LEVEL_FILTER_S      1.0    // time constant of the fill level filter
+#define DRIFT_COMP_SETTLE_TIME_S       5.0    // no correction until the jitter buffer size settled
+#define DRIFT_COMP_GAIN_PROP           2e-4   // ratio per block of level error
+#define DRIFT_COMP_GAIN_INT            1e-5   // ratio per block of level error and second
+#define DRIFT_COMP_NUM_TAPS_BEFORE     1      // interpolation history (samples before the read position)
+#define DRIFT_COMP_NUM_TAPS_AFTER      2      // interpolation lookahead (samples after the read position)
+
+class CClockDriftCompensator
+{
+public:
+    CClockDriftCompensator() : iNumChannels ( 0 ), iFrameSizeSamples ( 0 ), dUpdateIntervalS ( 0 ),
+        iNumSettleUpdates ( 0 ) { Reset(); }
+
+    // nothing happens if the properties stay the same
+    void Init ( const int iNNumChannels,
+                const int iNFrameSizeSamples,
+                const int iSampleRate );
+
+    // clears the buffered samples and the drift estimation (cheap, it can be
+    // called on each block)
+    void Reset();
+
+    // updates the drift estimation with the current fill level of the jitter
+    // buffer (once per output frame)
+    void Update ( const double dLevelBlocks, const double dTargetBlocks );
+
+    // true if another decoded frame is required for the next output frame
+    bool NeedsInput() const
+        { return static_cast<int> ( dReadPos + ( iFrameSizeSamples - 1 ) * dRatio ) + DRIFT_COMP_NUM_TAPS_AFTER >= iFifoNumSamples; }
+
+    // appends one decoded frame / reads one resampled frame (interleaved
+    // samples of the frame size and number of channels of the initialization)
+    void Put ( const CVector<int16_t>& vecsIn );
+    void Put ( const CVector<float>& vecfIn );
+    void Get ( CVector<int16_t>& vecsOut );
+    void Get ( CVector<float>& vecfOut );
+
+    // decoded samples per channel which wait beyond the interpolation taps
+    double GetNumBufferedSamples() const
+        { return iFifoNumSamples > 0 ? iFifoNumSamples - dReadPos - DRIFT_COMP_NUM_TAPS_AFTER : 0; }
+
+    double GetDriftPpm() const { return dDrift * 1e6; }
+
+protected:
+    template<typename TSample> void PutSamples ( const CVector<TSample>& vecIn );
+    template<typename TSample> void GetSamples ( CVector<TSample>& vecOut );
+
+    int            iNumChannels;
+    int            iFrameSizeSamples;
+    double         dUpdateIntervalS;
+    CVector<float> vecfFifo;        // interleaved decoded samples
+    int            iFifoNumSamples; // per channel
+    double         dReadPos;        // in the FIFO (samples per channel)
+    double         dRatio;          // decoded samples per output sample
+    double         dDrift;          // integral part of the controller
+    double         dLevel;          // filtered fill level in blocks
+    int            iSettleCnt;
+    int            iNumSettleUpdates;
+};
+
+
+// Test signal -----------------------------------------------------------------
+// sine which replaces the sound card input if no sound card is used (e.g. for
+// loopback tests with many headless clients or the synthetic clients of the
+// load generator), the output is checked for the own tone and the tones of the
+// peers with the Goertzel algorithm on windows of 100 ms (10 Hz resolution,
+// the test frequencies must be multiples of 10 Hz)
+#define TEST_SIGNAL_AMPLITUDE          0.1  // relative to full scale
+#define TEST_SIGNAL_WINDOW_SAMPLES     4800
+
+class CTestSignal
+{
+public:
+    CTestSignal() : iFreqHz ( 0 ), dAmplitude ( 0 ), dPhase ( 0 ), iWindowPos ( 0 ),
+        iNumWindows ( 0 ), dOwnToneAmplitude ( 0 ), bPeerTonesDetected ( false ) {}
+
+    // a tone is detected if its level is above a quarter of the amplitude
+    void Init ( const int         iNFreqHz,
+                const QList<int>& veciNPeerFreqHz,
+                const double      dNAmplitude = TEST_SIGNAL_AMPLITUDE );
+
+    bool IsEnabled() const { return iFreqHz > 0; }
+
+    // the blocks are interleaved with the given number of channels, only the
+    // first channel is analyzed, AnalyzeOutput() returns true if a window was
+    // completed with this block
+    void    GetInput ( CVector<int16_t>& vecsOut, const int iNumChannels = 2 );
+    bool    AnalyzeOutput ( const CVector<int16_t>& vecsIn, const int iNumChannels = 2 );
+    QString ToString() const;
+
+    // results of the last completed window
+    bool IsOwnToneDetected() const { return dOwnToneAmplitude > GetDetectThreshold(); }
+    bool ArePeerTonesDetected() const { return bPeerTonesDetected; }
+
+protected:
+    double GetToneAmplitude ( const int iToneFreqHz ) const;
+    double GetDetectThreshold() const { return dAmplitude / 4; }
+
+    int             iFreqHz;
+    QList<int>      veciPeerFreqHz;
+    double          dAmplitude;
+    double          dPhase;
+    CVector<double> vecdWindow;
+    int             iWindowPos;
+    int             iNumWindows;
+    QList<int>      veciNumDetected; // windows in which the peer tone was found
+    double          dOwnToneAmplitude;
+    bool            bPeerTonesDetected;
 };
 
 
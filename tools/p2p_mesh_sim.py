@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+"""
+P2P mesh loopback simulator for multi-peer client tests.
+
+Starts a central server and K headless clients on loopback which form a full
+P2P mesh. The first client also runs the session server. Each client uses the
+dummy sound interface (Jamulus built with "CONFIG+=headless nosound") fed with
+a test tone of its own frequency and checks its output for the tones of the
+other peers. Afterwards the following is reported:
+
+- setup time: start of the clients until all P2P links carry audio
+- per-peer decode success: received packets vs. lost frames of each P2P link
+- mix correctness: share of the 100 ms windows in which each peer tone is found
+- CPU load of each client process (from /proc)
+
+The statistics are read from the telemetry dump which the clients print on
+SIGUSR1, so this only runs on Linux. The exit code is non-zero if the setup
+times out or the decode success or the mix correctness is below the limits,
+so it can be used in CI-like conditions on one box.
+
+Usage:
+./tools/p2p_mesh_sim.py --jamulus ./Jamulus --peers 4 --duration 20
+./tools/p2p_mesh_sim.py --jamulus ./Jamulus --peers 8 --duration 60 --json mesh.json
+./tools/p2p_mesh_sim.py --jamulus ./Jamulus --peers 4 --netem dir=send,delay=20,jitter=3,loss=1,burst=2
+
+"""
+import argparse
+import json
+import logging
+import os
+import re
+import signal
+import subprocess
+import sys
+import threading
+import time
+
+logger = logging.getLogger('')
+
+# the test tones must be multiples of 10 Hz (see CTestSignal in src/util.h)
+BASE_FREQ_HZ = 400
+FREQ_STEP_HZ = 40
+
+RE_P2P_CHANNEL = re.compile(r'P2P channel (\d+) \(([^)]*)\): packets (\d+), lost frames (\d+)')
+RE_TEST_SIGNAL = re.compile(r'test signal (\d+) Hz, windows (\d+), own tone level ([\d.]+), '
+                            r'peer tones \[Hz:windows detected\](.*)')
+
+
+class Peer:
+    """
+    One Jamulus process and the statistics parsed from its console output.
+    """
+
+    def __init__(self, name, cmd):
+        self.name = name
+        self.cmd = cmd
+        self.lock = threading.Lock()
+        self.links = {}         # peer address -> (packets, lost frames)
+        self.test_signal = None  # (windows, {freq: windows detected})
+        self.log = []
+        self.proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                     universal_newlines=True, bufsize=1)
+        self.reader = threading.Thread(target=self.read_output, daemon=True)
+        self.reader.start()
+
+    def read_output(self):
+        for line in self.proc.stdout:
+            with self.lock:
+                self.log.append(line.rstrip())
+                match = RE_P2P_CHANNEL.search(line)
+                if match:
+                    self.links[match.group(2)] = (int(match.group(3)), int(match.group(4)))
+                match = RE_TEST_SIGNAL.search(line)
+                if match:
+                    detected = {}
+                    for entry in match.group(4).split():
+                        freq, windows = entry.split(':')
+                        detected[int(freq)] = int(windows)
+                    self.test_signal = (int(match.group(2)), detected)
+
+    def request_dump(self):
+        if self.proc.poll() is None:
+            self.proc.send_signal(signal.SIGUSR1)
+
+    def snapshot(self):
+        with self.lock:
+            return dict(self.links), self.test_signal
+
+    def cpu_seconds(self):
+        # utime and stime are the fields 14 and 15 of /proc/<pid>/stat (the
+        # process name in field 2 may contain spaces)
+        try:
+            with open('/proc/%d/stat' % self.proc.pid) as stat_file:
+                fields = stat_file.read().rsplit(')', 1)[1].split()
+        except OSError:
+            return 0.0
+        return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+    def stop(self):
+        if self.proc.poll() is None:
+            self.proc.terminate()
+            try:
+                self.proc.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+
+
+def all_links_up(peers):
+    for peer in peers:
+        links, _ = peer.snapshot()
+        if len([1 for packets, _ in links.values() if packets > 0]) < len(peers) - 1:
+            return False
+    return True
+
+
+def poll(peers, interval):
+    for peer in peers:
+        peer.request_dump()
+    time.sleep(interval)
+
+
+def evaluate(peers, freqs, start, end, cpu_start, cpu_end, duration):
+    result = []
+    for idx, peer in enumerate(peers):
+        links_start, signal_start = start[idx]
+        links_end, signal_end = end[idx]
+
+        decode = {}
+        for address, (packets, lost) in links_end.items():
+            packets_start, lost_start = links_start.get(address, (0, 0))
+            received = packets - packets_start
+            lost = lost - lost_start
+            decode[address] = received / (received + lost) if received + lost > 0 else 0.0
+
+        mix = {}
+        if signal_start and signal_end:
+            windows = signal_end[0] - signal_start[0]
+            for freq in freqs:
+                if freq != freqs[idx]:
+                    detected = signal_end[1].get(freq, 0) - signal_start[1].get(freq, 0)
+                    mix[freq] = detected / windows if windows > 0 else 0.0
+
+        result.append({'peer': peer.name,
+                       'decode_success': decode,
+                       'mix_correctness': mix,
+                       'cpu_percent': 100.0 * (cpu_end[idx] - cpu_start[idx]) / duration})
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='P2P mesh loopback simulator for multi-peer client tests')
+    parser.add_argument('--jamulus', default='./Jamulus', help='headless nosound Jamulus binary')
+    parser.add_argument('--peers', type=int, default=4, help='number of clients in the mesh')
+    parser.add_argument('--duration', type=float, default=20.0, help='measurement duration in seconds')
+    parser.add_argument('--central-port', type=int, default=22124, help='port of the central server')
+    parser.add_argument('--base-port', type=int, default=22200, help='first port of the clients')
+    parser.add_argument('--session', default='meshsim', help='session name')
+    parser.add_argument('--setup-timeout', type=float, default=30.0, help='time out for the mesh setup in seconds')
+    parser.add_argument('--poll-interval', type=float, default=0.25, help='telemetry poll interval in seconds')
+    parser.add_argument('--min-decode', type=float, default=0.99, help='minimum decode success per link')
+    parser.add_argument('--min-mix', type=float, default=0.9, help='minimum mix correctness per peer tone')
+    parser.add_argument('--netem', action='append', default=[],
+                        help='network emulator rule of the clients (see --netem of Jamulus, can be repeated)')
+    parser.add_argument('--seed', type=int, default=1, help='network emulator seed (incremented per client)')
+    parser.add_argument('--json', help='write the results to this JSON file')
+    parser.add_argument('--verbose', action='store_true', help='print the console output of the processes')
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(message)s')
+
+    freqs = [BASE_FREQ_HZ + FREQ_STEP_HZ * i for i in range(args.peers)]
+    central = '127.0.0.1:%d' % args.central_port
+    peers = []
+
+    # the central server address "localhost" selects the central server mode
+    central_server = Peer('central', [args.jamulus, '-n', '-g', '-e', 'localhost', '-p', str(args.central_port)])
+    time.sleep(1)
+
+    try:
+        setup_start = time.perf_counter()
+        for i in range(args.peers):
+            testsignal = ';'.join(str(freq) for freq in [freqs[i]] + freqs[:i] + freqs[i + 1:])
+            cmd = [args.jamulus, '-n', '-p', str(args.base_port + 20 * i), '-e', central,
+                   '-S', args.session, '-U', 'peer%d' % i, '--p2p', '--testsignal', testsignal]
+            for rule in args.netem:
+                cmd += ['--netem', rule]
+            if args.netem:
+                cmd += ['--netemseed', str(args.seed + i)]
+            if i == 0:
+                cmd.insert(2, '-s')
+            peers.append(Peer('peer%d' % i, cmd))
+
+        while not all_links_up(peers):
+            if time.perf_counter() - setup_start > args.setup_timeout:
+                logger.error('mesh setup timed out after %.1f s', args.setup_timeout)
+                for peer in peers:
+                    logger.error('%s links: %s', peer.name, peer.snapshot()[0])
+                return 1
+            poll(peers, args.poll_interval)
+        setup_time = time.perf_counter() - setup_start
+        logger.info('mesh of %d peers set up in %.2f s', args.peers, setup_time)
+
+        poll(peers, args.poll_interval)
+        start = [peer.snapshot() for peer in peers]
+        cpu_start = [peer.cpu_seconds() for peer in peers]
+        measure_start = time.perf_counter()
+
+        time.sleep(args.duration)
+
+        poll(peers, 1.0)
+        end = [peer.snapshot() for peer in peers]
+        cpu_end = [peer.cpu_seconds() for peer in peers]
+        duration = time.perf_counter() - measure_start
+    finally:
+        for peer in peers + [central_server]:
+            peer.stop()
+        if args.verbose:
+            for peer in [central_server] + peers:
+                for line in peer.log:
+                    print('%s: %s' % (peer.name, line))
+
+    result = evaluate(peers, freqs, start, end, cpu_start, cpu_end, duration)
+
+    ok = True
+    for entry in result:
+        decode = entry['decode_success'].values()
+        mix = entry['mix_correctness'].values()
+        ok = ok and len(decode) == args.peers - 1 and all(value >= args.min_decode for value in decode)
+        ok = ok and len(mix) == args.peers - 1 and all(value >= args.min_mix for value in mix)
+        logger.info('%s: CPU %5.1f %%, decode success min %.4f, mix correctness min %.3f',
+                    entry['peer'], entry['cpu_percent'], min(decode, default=0.0), min(mix, default=0.0))
+
+    if args.json:
+        with open(args.json, 'w') as json_file:
+            json.dump({'peers': args.peers, 'setup_time_s': setup_time, 'duration_s': duration,
+                       'results': result}, json_file, indent=2)
+
+    logger.info('result: %s', 'OK' if ok else 'FAILED')
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
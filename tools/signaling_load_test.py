@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""
+Load test for the session directory of a central server.
+
+Registers a number of synthetic sessions at a running central server (each
+session uses its own UDP socket so that it gets its own directory entry) and
+afterwards measures the throughput and the latency of session queries and,
+optionally, session subscriptions. Intended to be run on loopback against a
+server started with e.g. "Jamulus -s -n -e 127.0.0.1:22124".
+
+Usage:
+./tools/signaling_load_test.py --server 127.0.0.1:22124 --sessions 2000 --queries 20000
+./tools/signaling_load_test.py --server 127.0.0.1:22124 --sessions 500 --queries 5000 --subscribe
+
+"""
+import argparse
+import logging
+import random
+import select
+import socket
+import struct
+import time
+
+logger = logging.getLogger('')
+
+# connection less protocol message IDs (see src/protocol.h)
+PROTMESSID_CLM_SERVER_LIST = 1006
+PROTMESSID_CLM_REGISTER_SERVER = 1004
+PROTMESSID_CLM_REQ_SERVER_LIST = 1007
+PROTMESSID_CLM_REGISTER_SERVER_RESP = 1016
+PROTMESSID_CLM_SUBSCRIBE_SESSION = 1019
+PROTMESSID_CLM_SESSION_ADDRESS = 1020
+
+MESS_HEADER_LENGTH_BYTE = 7
+
+
+def crc(data):
+    """
+    CRC as implemented in CCRC (src/util.cpp).
+    """
+    poly = (1 << 5) | (1 << 12)
+    bit_out_mask = 1 << 16
+    state = 0xFFFFFFFF
+    for byte in data:
+        for i in range(8):
+            state = (state << 1) & 0xFFFFFFFF
+            if state & bit_out_mask:
+                state |= 1
+            if byte & (1 << (7 - i)):
+                state ^= 1
+            if state & 1:
+                state ^= poly
+    return (~state) & (bit_out_mask - 1)
+
+
+def utf8_string(value):
+    encoded = value.encode('utf-8')
+    return struct.pack('<H', len(encoded)) + encoded
+
+
+def message_frame(message_id, data):
+    """
+    Generates a protocol frame as done by CProtocol::GenMessageFrame.
+    """
+    frame = struct.pack('<HHBH', 0, message_id, 0, len(data)) + data
+    return frame + struct.pack('<H', crc(frame))
+
+
+def parse_message_id(frame):
+    if len(frame) < MESS_HEADER_LENGTH_BYTE + 2:
+        return None
+    tag, message_id, _, length = struct.unpack_from('<HHBH', frame)
+    if tag != 0 or len(frame) != MESS_HEADER_LENGTH_BYTE + length + 2:
+        return None
+    if crc(frame[:-2]) != struct.unpack_from('<H', frame, len(frame) - 2)[0]:
+        return None
+    return message_id
+
+
+def register_message(name, local_port):
+    data = struct.pack('<HHBB', local_port, 0, 10, 0)
+    data += utf8_string(name)
+    data += utf8_string('127.0.0.1')
+    data += utf8_string('loadtest')
+    return message_frame(PROTMESSID_CLM_REGISTER_SERVER, data)
+
+
+def wait_for(sock, message_id, timeout):
+    """
+    Waits for a message with the given ID, other messages (e.g. the firewall
+    opening empty messages) are ignored. Returns False on time out.
+    """
+    deadline = time.perf_counter() + timeout
+    while True:
+        remaining = deadline - time.perf_counter()
+        if remaining <= 0:
+            return False
+        readable, _, _ = select.select([sock], [], [], remaining)
+        if not readable:
+            return False
+        frame, _ = sock.recvfrom(20000)
+        if parse_message_id(frame) == message_id:
+            return True
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return float('nan')
+    return sorted_values[min(len(sorted_values) - 1, int(fraction * len(sorted_values)))]
+
+
+def report(label, latencies, failures, duration):
+    latencies.sort()
+    logger.info('%s: %d ok, %d timed out, %.0f ops/s, latency [ms] p50 %.3f p99 %.3f max %.3f',
+                label, len(latencies), failures, len(latencies) / duration if duration > 0 else 0,
+                percentile(latencies, 0.5) * 1e3, percentile(latencies, 0.99) * 1e3,
+                latencies[-1] * 1e3 if latencies else float('nan'))
+
+
+def run_requests(label, sock, server, frames, response_id, timeout):
+    latencies = []
+    failures = 0
+    start = time.perf_counter()
+    for frame in frames:
+        sent = time.perf_counter()
+        sock.sendto(frame, server)
+        if wait_for(sock, response_id, timeout):
+            latencies.append(time.perf_counter() - sent)
+        else:
+            failures += 1
+    report(label, latencies, failures, time.perf_counter() - start)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Session directory load test for a central server')
+    parser.add_argument('--server', default='127.0.0.1:22124', help='central server address (host:port)')
+    parser.add_argument('--sessions', type=int, default=1000, help='number of sessions to register')
+    parser.add_argument('--queries', type=int, default=10000, help='number of session queries')
+    parser.add_argument('--subscribe', action='store_true', help='also measure session subscriptions')
+    parser.add_argument('--timeout', type=float, default=1.0, help='response time out in seconds')
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(message)s')
+
+    host, port = args.server.rsplit(':', 1)
+    server = (socket.gethostbyname(host), int(port))
+
+    # register all sessions, each session needs its own socket
+    session_socks = []
+    names = []
+    latencies = []
+    failures = 0
+    start = time.perf_counter()
+    for i in range(args.sessions):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.bind(('0.0.0.0', 0))
+        name = 'loadtest-%d' % i
+        sent = time.perf_counter()
+        sock.sendto(register_message(name, sock.getsockname()[1]), server)
+        if wait_for(sock, PROTMESSID_CLM_REGISTER_SERVER_RESP, args.timeout):
+            latencies.append(time.perf_counter() - sent)
+            names.append(name)
+        else:
+            failures += 1
+        session_socks.append(sock)
+    report('register', latencies, failures, time.perf_counter() - start)
+
+    if not names:
+        logger.error('no session could be registered')
+        return
+
+    client = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    client.bind(('0.0.0.0', 0))
+
+    # the names are drawn at random so that the lookup cannot profit from
+    # any ordering of the directory
+    frames = [message_frame(PROTMESSID_CLM_REQ_SERVER_LIST, utf8_string(random.choice(names)))
+              for _ in range(args.queries)]
+    run_requests('query', client, server, frames, PROTMESSID_CLM_SERVER_LIST, args.timeout)
+
+    if args.subscribe:
+        frames = [message_frame(PROTMESSID_CLM_SUBSCRIBE_SESSION, utf8_string(random.choice(names)))
+                  for _ in range(args.queries)]
+        run_requests('subscribe', client, server, frames, PROTMESSID_CLM_SESSION_ADDRESS, args.timeout)
+
+    for sock in session_socks:
+        sock.close()
+    client.close()
+
+
+if __name__ == '__main__':
+    main()